@@ -27,8 +27,10 @@
 #include "swig-runtime.h"
 #include <libguile.h>
 #include <cstring>
+#include <algorithm>
 
 #include "Account.h"
+#include "Account.hpp"
 #include "engine-helpers.h"
 #include "gnc-engine-guile.h"
 #include "gnc-date.h"
@@ -1846,6 +1848,50 @@ SCM gnc_account_value_ptr_to_scm (GncAccountValue *av)
                      gnc_numeric_to_scm (val));
 }
 
+SCM
+gnc_scm_accounts_get_balances_at_dates (SCM accounts, SCM dates,
+                                        gboolean include_closing,
+                                        SCM report_commodity)
+{
+    swig_type_info * account_type = get_acct_type();
+    AccountVec acc_vec;
+    std::vector<time64> date_vec;
+    gnc_commodity *comm = nullptr;
+
+    for (; scm_is_pair (accounts); accounts = SCM_CDR (accounts))
+    {
+        auto acc_scm = SCM_CAR (accounts);
+        if (!SWIG_IsPointerOfType (acc_scm, account_type))
+            return SCM_BOOL_F;
+        acc_vec.push_back (static_cast<Account*>
+                           (SWIG_MustGetPtr (acc_scm, account_type, 1, 0)));
+    }
+
+    for (; scm_is_pair (dates); dates = SCM_CDR (dates))
+        date_vec.push_back (scm_to_int64 (SCM_CAR (dates)));
+
+    if (!std::is_sorted (date_vec.begin (), date_vec.end ()))
+    {
+        PERR ("dates must be sorted");
+        return SCM_BOOL_F;
+    }
+
+    if (scm_is_true (report_commodity))
+        comm = gnc_scm_to_commodity (report_commodity);
+
+    auto balances = gnc_accounts_get_balances_at_dates (acc_vec, date_vec,
+                                                        include_closing, comm);
+    SCM rv = SCM_EOL;
+    for (auto acc_bal = balances.rbegin (); acc_bal != balances.rend (); ++acc_bal)
+    {
+        SCM row = SCM_EOL;
+        for (auto bal = acc_bal->rbegin (); bal != acc_bal->rend (); ++bal)
+            row = scm_cons (gnc_numeric_to_scm (*bal), row);
+        rv = scm_cons (row, rv);
+    }
+    return rv;
+}
+
 typedef struct
 {
     SCM proc;
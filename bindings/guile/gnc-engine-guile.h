@@ -71,6 +71,23 @@ GncAccountValue* gnc_scm_to_account_value_ptr(SCM valuearg);
 
 SCM gnc_account_value_ptr_to_scm(GncAccountValue*);
 
+/** Compute the balances of a list of accounts at a list of dates in one
+ *  pass per account. See gnc_accounts_get_balances_at_dates in Account.hpp.
+ *
+ *  @param accounts A list of accounts.
+ *
+ *  @param dates A list of time64, sorted in ascending order.
+ *
+ *  @param include_closing Whether closing transactions are included.
+ *
+ *  @param report_commodity A commodity to convert the balances to, or #f to
+ *  leave them in the account commodity.
+ *
+ *  @return A list with, for each account, a list of balances at each date. */
+SCM gnc_scm_accounts_get_balances_at_dates (SCM accounts, SCM dates,
+                                            gboolean include_closing,
+                                            SCM report_commodity);
+
 /**
  * add Scheme-style danglers from a hook
  */
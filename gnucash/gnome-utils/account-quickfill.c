@@ -243,7 +243,7 @@ listen_for_account_events (QofInstance* entity, QofEventId event_type,
 {
     QFB* qfb = user_data;
     QuickFill* qf = qfb->qf;
-    QuickFill* match;
+    QuickFillMatch match;
     char* name;
     const char* match_str;
     Account* account;
@@ -312,7 +312,7 @@ listen_for_account_events (QofInstance* entity, QofEventId event_type,
 
             /* check if the name has changed */
             match = gnc_quickfill_get_string_match (qf, old_name);
-            if (match && (g_strcmp0 (old_name, new_name) != 0))
+            if (match.node && (g_strcmp0 (old_name, new_name) != 0))
                 gnc_quickfill_remove (qf, old_name, QUICKFILL_ALPHA);
 
             if (qfb->dont_add_cb &&
@@ -387,7 +387,7 @@ listen_for_account_events (QofInstance* entity, QofEventId event_type,
             break;
 
         match = gnc_quickfill_get_string_match (qf, name);
-        if (match)
+        if (match.node)
         {
             match_str = gnc_quickfill_string (match);
             if (match_str && (g_strcmp0 (match_str, name) != 0))
@@ -815,7 +815,7 @@ gnc_xfer_description_insert_cb(GtkEditable *editable,
                                XferDialog *xferData)
 {
     gchar *prefix, *suffix, *new_text;
-    QuickFill *match;
+    QuickFillMatch match;
     const gchar *match_str;
     gint prefix_len, new_text_len, match_str_len;
 
@@ -840,8 +840,8 @@ gnc_xfer_description_insert_cb(GtkEditable *editable,
     new_text_len = prefix_len + insert_text_len;
     g_free(prefix);
 
-    if ((match = gnc_quickfill_get_string_match(xferData->qf, new_text))
-        && (match_str = gnc_quickfill_string(match))
+    match = gnc_quickfill_get_string_match(xferData->qf, new_text);
+    if ((match_str = gnc_quickfill_string(match))
         && ((match_str_len = strlen(match_str)) > new_text_len))
     {
         g_signal_handlers_block_matched (G_OBJECT (editable),
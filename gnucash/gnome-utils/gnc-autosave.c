@@ -64,7 +64,7 @@ autosave_remove_timer_cb(QofBook *book, gpointer key, gpointer user_data);
  * "undirty".
  *
  * - Or the auto-save timer hits its timeout, hence calling
- * autosave_timeout_cb(). In this case gnc_file_save() is invoked, the
+ * autosave_timeout_cb(). In this case gnc_file_autosave() is invoked, the
  * auto-save timer is removed, and all returns to the initial state
  * with the book "undirty".  (As an exceptional addition to this, on
  * the very first call to autosave_timeout_cb, if the key
@@ -213,7 +213,7 @@ static gboolean autosave_timeout_cb(gpointer user_data)
         else
             DEBUG("autosave_timeout_cb: toplevel is not a GNC_WINDOW\n");
 
-        gnc_file_save (GTK_WINDOW (toplevel));
+        gnc_file_autosave (GTK_WINDOW (toplevel));
 
         gnc_main_window_set_progressbar_window(NULL);
 
@@ -1388,8 +1388,8 @@ gnc_file_do_export(GtkWindow *parent, const char * filename)
 
 static gboolean been_here_before = FALSE;
 
-void
-gnc_file_save (GtkWindow *parent)
+static void
+file_save (GtkWindow *parent, gboolean autosave)
 {
     QofBackendError io_err;
     const char * newfile;
@@ -1427,7 +1427,10 @@ gnc_file_save (GtkWindow *parent)
     save_in_progress++;
     gnc_set_busy_cursor (NULL, TRUE);
     gnc_window_show_progress(_("Writing file…"), 0.0);
-    qof_session_save (session, gnc_window_show_progress);
+    if (autosave)
+        qof_session_autosave (session, gnc_window_show_progress);
+    else
+        qof_session_save (session, gnc_window_show_progress);
     gnc_window_show_progress(NULL, -1.0);
     gnc_unset_busy_cursor (NULL);
     save_in_progress--;
@@ -1453,6 +1456,18 @@ gnc_file_save (GtkWindow *parent)
     LEAVE (" ");
 }
 
+void
+gnc_file_save (GtkWindow *parent)
+{
+    file_save (parent, FALSE);
+}
+
+void
+gnc_file_autosave (GtkWindow *parent)
+{
+    file_save (parent, TRUE);
+}
+
 /* Note: this dialog will only be used when dbi is not enabled
  *       paths used in it always refer to files and are
  *       never db uris. See gnc_file_do_save_as for that.
@@ -1053,7 +1053,7 @@ gnc_customer_addr_common_insert_cb(GtkEditable *editable,
 {
     CustomerWindow *wdata = user_data;
     gchar *concatenated_text;
-    QuickFill *match;
+    QuickFillMatch match;
     gint prefix_len, concatenated_text_len;
 
     if (new_text_length <= 0)
@@ -1082,7 +1082,7 @@ gnc_customer_addr_common_insert_cb(GtkEditable *editable,
 
     match = gnc_quickfill_get_string_match(qf, concatenated_text);
     g_free(concatenated_text);
-    if (match)
+    if (match.node)
     {
         const char* match_str = gnc_quickfill_string(match);
         if (match_str)
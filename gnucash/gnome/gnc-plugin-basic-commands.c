@@ -245,7 +245,8 @@ static void update_inactive_actions (GncPluginPage *plugin_page)
 
     // We are readonly - so we have to switch particular actions to inactive.
     gboolean is_readwrite = !qof_book_is_readonly(gnc_get_current_book());
-    gboolean is_dirty = qof_book_session_not_saved (gnc_get_current_book ());
+    gboolean is_dirty = qof_book_session_not_saved (gnc_get_current_book ()) ||
+        qof_session_autosave_pending (gnc_get_current_session ());
 
     // We continue only if the current page is a plugin page
     if (!plugin_page || !GNC_IS_PLUGIN_PAGE(plugin_page))
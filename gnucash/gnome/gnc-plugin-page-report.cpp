@@ -1467,6 +1467,9 @@ gnc_plugin_page_report_reload_cb (GSimpleAction *simple,
         return;
 
     DEBUG( "reload-redraw" );
+    /* An explicit reload runs the report again rather than showing what
+     * the report cache kept. */
+    scm_call_1(scm_c_eval_string("gnc:report-uncache!"), priv->cur_report);
     dirty_report = scm_c_eval_string("gnc:report-set-dirty?!");
     scm_call_2(dirty_report, priv->cur_report, SCM_BOOL_T);
 
@@ -66,6 +66,10 @@ namespace Gnucash {
         boost::optional <std::string> m_report_name;
         boost::optional <std::string> m_export_type;
         boost::optional <std::string> m_output_file;
+
+        bool m_scrub = false;
+        bool m_scrub_lots = false;
+        unsigned m_scrub_threads = 0;
     };
 
 }
@@ -124,6 +128,17 @@ may be specified to describe some saved options.\n"
     m_opt_desc_display->add (report_options);
     m_opt_desc_all.add (report_options);
 
+    bpo::options_description scrub_options(_("Check & Repair Options"));
+    scrub_options.add_options()
+    ("scrub", bpo::bool_switch (&m_scrub),
+     _("Check the given GnuCash datafile for orphaned, unbalanced and wrong currency transactions, repair them and save the file. Interrupting stops the repairs and saves the ones already made.\n"))
+    ("scrub-lots", bpo::bool_switch (&m_scrub_lots),
+     _("Also check and repair the lots of accounts with trades.\n"))
+    ("scrub-threads", bpo::value (&m_scrub_threads),
+     _("Number of threads to look for problems with, by default one per processor.\n"));
+    m_opt_desc_display->add (scrub_options);
+    m_opt_desc_all.add (scrub_options);
+
 }
 
 int
@@ -215,6 +230,18 @@ Gnucash::GnucashCli::start ([[maybe_unused]] int argc, [[maybe_unused]] char **a
         }
     }
 
+    if (m_scrub)
+    {
+        if (!m_file_to_load || m_file_to_load->empty())
+        {
+            std::cerr << _("Missing data file parameter") << "\n\n"
+                      << *m_opt_desc_display.get() << std::endl;
+            return 1;
+        }
+        return Gnucash::scrub_book (m_file_to_load, m_scrub_lots,
+                                    m_scrub_threads);
+    }
+
     std::cerr << _("Missing command or option") << "\n\n"
               << *m_opt_desc_display.get() << std::endl;
 
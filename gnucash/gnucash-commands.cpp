@@ -38,8 +38,11 @@
 #include <gnc-gnome-utils.h>
 #include <gnc-session.h>
 #include <qoflog.h>
+#include <Scrub.h>
+#include <ScrubBook.h>
 
 #include <boost/locale.hpp>
+#include <csignal>
 #include <fstream>
 #include <iostream>
 #include <iomanip>
@@ -425,3 +428,75 @@ Gnucash::report_list (void)
     scm_boot_guile (0, nullptr, scm_report_list, NULL);
     return 0;
 }
+
+static void
+scrub_interrupted (int)
+{
+    gnc_set_abort_scrub (TRUE);
+}
+
+/* Prints each tenth of each phase, enough to follow a nightly run in
+ * its log. */
+static void
+print_scrub_progress (const char *message, double percent)
+{
+    static int last_tenth = -1;
+    if (!message)
+    {
+        last_tenth = -1;
+        return;
+    }
+    auto tenth = static_cast<int>(percent) / 10;
+    if (tenth == last_tenth)
+        return;
+    last_tenth = tenth;
+    std::cerr << message << std::endl;
+}
+
+int
+Gnucash::scrub_book (const bo_str& uri, bool scrub_lots, unsigned n_threads)
+{
+    gnc_prefs_init ();
+    qof_event_suspend();
+
+    auto session = gnc_get_current_session();
+    if (!session)
+        return 1;
+
+    qof_session_begin(session, uri->c_str(), SESSION_NORMAL_OPEN);
+    if (qof_session_get_error(session) != ERR_BACKEND_NO_ERR)
+        return cleanup_and_exit_with_failure (session);
+
+    qof_session_load(session, NULL);
+    if (qof_session_get_error(session) != ERR_BACKEND_NO_ERR)
+        return cleanup_and_exit_with_failure (session);
+
+    auto flags = static_cast<GncScrubFlags>(GNC_SCRUB_ORPHANS |
+                                            GNC_SCRUB_CURRENCY |
+                                            GNC_SCRUB_IMBALANCE);
+    if (scrub_lots)
+        flags = GNC_SCRUB_ALL;
+
+    gnc_set_abort_scrub (FALSE);
+    auto old_int = std::signal (SIGINT, scrub_interrupted);
+    auto old_term = std::signal (SIGTERM, scrub_interrupted);
+    auto repaired = xaccBookScrub (qof_session_get_book (session), flags,
+                                   n_threads, print_scrub_progress);
+    std::signal (SIGINT, old_int);
+    std::signal (SIGTERM, old_term);
+
+    if (gnc_get_abort_scrub ())
+        std::cerr << bl::translate ("Check & Repair interrupted.") << std::endl;
+    std::cout << bl::format (bl::translate ("Repaired {1} transactions and accounts.")) % repaired << std::endl;
+
+    if (repaired)
+    {
+        qof_session_save(session, NULL);
+        if (qof_session_get_error(session) != ERR_BACKEND_NO_ERR)
+            return cleanup_and_exit_with_failure (session);
+    }
+
+    qof_session_destroy(session);
+    qof_event_resume();
+    return gnc_get_abort_scrub () ? 1 : 0;
+}
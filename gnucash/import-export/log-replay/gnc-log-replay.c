@@ -356,22 +356,195 @@ static void dump_split_record(split_record record)
     }
 }
 
+/* The transaction being replayed from the records of one log entry. */
+typedef struct
+{
+    QofBook *book;
+    Transaction *trans;
+    char *trans_ro;
+    int first_record;
+} replay_state;
+
+static void replay_start(replay_state *state)
+{
+    state->book = gnc_get_current_book();
+    state->trans = NULL;
+    state->trans_ro = NULL;
+    state->first_record = TRUE;
+}
+
+static void replay_split_record(replay_state *state, const split_record *record)
+{
+    Split * split = NULL;
+    Account * acct = NULL;
+
+    if (record->log_action_present)
+    {
+        switch (record->log_action)
+        {
+        case LOG_BEGIN_EDIT:
+            DEBUG("replay_split_record():Ignoring log action: LOG_BEGIN_EDIT"); /*Do nothing, there is no point*/
+            break;
+        case LOG_ROLLBACK:
+            DEBUG("replay_split_record():Ignoring log action: LOG_ROLLBACK");/*Do nothing, since we didn't do the begin_edit either*/
+            break;
+        case LOG_DELETE:
+            DEBUG("replay_split_record(): Playing back LOG_DELETE");
+            if ((state->trans = xaccTransLookup (&(record->trans_guid), state->book)) != NULL
+                    && state->first_record == TRUE)
+            {
+                state->first_record = FALSE;
+                if (xaccTransGetReadOnly(state->trans))
+                {
+                    PWARN("Destroying a read only transaction.");
+                    xaccTransClearReadOnly(state->trans);
+                }
+                xaccTransBeginEdit(state->trans);
+                xaccTransDestroy(state->trans);
+            }
+            else if (state->first_record == TRUE)
+            {
+                PERR("The transaction to delete was not found!");
+            }
+            else
+                xaccTransDestroy(state->trans);
+            break;
+        case LOG_COMMIT:
+            DEBUG("replay_split_record(): Playing back LOG_COMMIT");
+            if (record->trans_guid_present == TRUE
+                    && state->first_record == TRUE)
+            {
+                state->trans = xaccTransLookupDirect (record->trans_guid, state->book);
+                if (state->trans != NULL)
+                {
+                    DEBUG("replay_split_record(): Transaction to be edited was found");
+                    xaccTransBeginEdit(state->trans);
+                    state->trans_ro = g_strdup(xaccTransGetReadOnly(state->trans));
+                    if (state->trans_ro)
+                    {
+                        PWARN("Replaying a read only transaction.");
+                        xaccTransClearReadOnly(state->trans);
+                    }
+                }
+                else
+                {
+                    DEBUG("replay_split_record(): Creating a new transaction");
+                    state->trans = xaccMallocTransaction (state->book);
+                    xaccTransBeginEdit(state->trans);
+                }
+
+                qof_instance_set_guid (QOF_INSTANCE (state->trans),
+					       &(record->trans_guid));
+                /*Fill the transaction info*/
+                if (record->date_entered_present)
+                {
+                    xaccTransSetDateEnteredSecs(state->trans, record->date_entered);
+                }
+                if (record->date_posted_present)
+                {
+                    xaccTransSetDatePostedSecs(state->trans, record->date_posted);
+                }
+                if (record->trans_num_present)
+                {
+                    xaccTransSetNum(state->trans, record->trans_num);
+                }
+                if (record->trans_descr_present)
+                {
+                    xaccTransSetDescription(state->trans, record->trans_descr);
+                }
+                if (record->trans_notes_present)
+                {
+                    xaccTransSetNotes(state->trans, record->trans_notes);
+                }
+            }
+            if (record->split_guid_present == TRUE) /*Fill the split info*/
+            {
+                gboolean is_new_split;
+
+                split = xaccSplitLookupDirect (record->split_guid, state->book);
+                if (split != NULL)
+                {
+                    DEBUG("replay_split_record(): Split to be edited was found");
+                    is_new_split = FALSE;
+                }
+                else
+                {
+                    DEBUG("replay_split_record(): Creating a new split");
+                    split = xaccMallocSplit(state->book);
+                    is_new_split = TRUE;
+                }
+                xaccSplitSetGUID (split, &(record->split_guid));
+                if (record->acc_guid_present)
+                {
+                    acct = xaccAccountLookupDirect(record->acc_guid, state->book);
+                    xaccAccountInsertSplit(acct, split);
+
+                    // No currency in the txn yet? Set one now.
+                    if (!xaccTransGetCurrency(state->trans))
+                        xaccTransSetCurrency(state->trans, gnc_account_or_default_currency(acct, NULL));
+                }
+                if (is_new_split)
+                    xaccTransAppendSplit(state->trans, split);
+
+                if (record->split_memo_present)
+                {
+                    xaccSplitSetMemo(split, record->split_memo);
+                }
+                if (record->split_action_present)
+                {
+                    xaccSplitSetAction(split, record->split_action);
+                }
+                if (record->date_reconciled_present)
+                {
+                    xaccSplitSetDateReconciledSecs (split, record->date_reconciled);
+                }
+                if (record->split_reconcile_present)
+                {
+                    xaccSplitSetReconcile(split, record->split_reconcile);
+                }
+
+                if (record->amount_present)
+                {
+                    xaccSplitSetAmount(split, record->amount);
+                }
+                if (record->value_present)
+                {
+                    xaccSplitSetValue(split, record->value);
+                }
+            }
+            state->first_record = FALSE;
+            break;
+        }
+    }
+    else
+    {
+        PERR("Corrupted record");
+    }
+}
+
+static void replay_end(replay_state *state)
+{
+    if (state->trans != NULL) /*If we played with a transaction, commit it here*/
+    {
+        xaccTransScrubCurrency(state->trans);
+        xaccTransSetReadOnly(state->trans, state->trans_ro);
+        xaccTransCommitEdit(state->trans);
+        g_free(state->trans_ro);
+    }
+}
+
 /* File pointer must already be at the beginning of a record */
 static void  process_trans_record(  FILE *log_file)
 {
     char read_buf[2048];
     char *read_retval;
-    char * trans_ro = NULL;
     const char * record_end_str = "===== END";
-    int first_record = TRUE;
     int record_ended = FALSE;
     split_record record;
-    Transaction * trans = NULL;
-    Split * split = NULL;
-    Account * acct = NULL;
-    QofBook * book = gnc_get_current_book();
+    replay_state state;
 
     DEBUG("process_trans_record(): Begin...\n");
+    replay_start(&state);
 
     while ( record_ended == FALSE)
     {
@@ -383,162 +556,97 @@ static void  process_trans_record(  FILE *log_file)
 
             record = interpret_split_record(g_strchomp(read_buf));
             dump_split_record( record);
-            if (record.log_action_present)
-            {
-                switch (record.log_action)
-                {
-                case LOG_BEGIN_EDIT:
-                    DEBUG("process_trans_record():Ignoring log action: LOG_BEGIN_EDIT"); /*Do nothing, there is no point*/
-                    break;
-                case LOG_ROLLBACK:
-                    DEBUG("process_trans_record():Ignoring log action: LOG_ROLLBACK");/*Do nothing, since we didn't do the begin_edit either*/
-                    break;
-                case LOG_DELETE:
-                    DEBUG("process_trans_record(): Playing back LOG_DELETE");
-                    if ((trans = xaccTransLookup (&(record.trans_guid), book)) != NULL
-                            && first_record == TRUE)
-                    {
-                        first_record = FALSE;
-                        if (xaccTransGetReadOnly(trans))
-                        {
-                            PWARN("Destroying a read only transaction.");
-                            xaccTransClearReadOnly(trans);
-                        }
-                        xaccTransBeginEdit(trans);
-                        xaccTransDestroy(trans);
-                    }
-                    else if (first_record == TRUE)
-                    {
-                        PERR("The transaction to delete was not found!");
-                    }
-                    else
-                        xaccTransDestroy(trans);
-                    break;
-                case LOG_COMMIT:
-                    DEBUG("process_trans_record(): Playing back LOG_COMMIT");
-                    if (record.trans_guid_present == TRUE
-                            && first_record == TRUE)
-                    {
-                        trans = xaccTransLookupDirect (record.trans_guid, book);
-                        if (trans != NULL)
-                        {
-                            DEBUG("process_trans_record(): Transaction to be edited was found");
-                            xaccTransBeginEdit(trans);
-                            trans_ro = g_strdup(xaccTransGetReadOnly(trans));
-                            if (trans_ro)
-                            {
-                                PWARN("Replaying a read only transaction.");
-                                xaccTransClearReadOnly(trans);
-                            }
-                        }
-                        else
-                        {
-                            DEBUG("process_trans_record(): Creating a new transaction");
-                            trans = xaccMallocTransaction (book);
-                            xaccTransBeginEdit(trans);
-                        }
-
-                        qof_instance_set_guid (QOF_INSTANCE (trans),
-					       &(record.trans_guid));
-                        /*Fill the transaction info*/
-                        if (record.date_entered_present)
-                        {
-                            xaccTransSetDateEnteredSecs(trans, record.date_entered);
-                        }
-                        if (record.date_posted_present)
-                        {
-                            xaccTransSetDatePostedSecs(trans, record.date_posted);
-                        }
-                        if (record.trans_num_present)
-                        {
-                            xaccTransSetNum(trans, record.trans_num);
-                        }
-                        if (record.trans_descr_present)
-                        {
-                            xaccTransSetDescription(trans, record.trans_descr);
-                        }
-                        if (record.trans_notes_present)
-                        {
-                            xaccTransSetNotes(trans, record.trans_notes);
-                        }
-                    }
-                    if (record.split_guid_present == TRUE) /*Fill the split info*/
-                    {
-                        gboolean is_new_split;
-
-                        split = xaccSplitLookupDirect (record.split_guid, book);
-                        if (split != NULL)
-                        {
-                            DEBUG("process_trans_record(): Split to be edited was found");
-                            is_new_split = FALSE;
-                        }
-                        else
-                        {
-                            DEBUG("process_trans_record(): Creating a new split");
-                            split = xaccMallocSplit(book);
-                            is_new_split = TRUE;
-                        }
-                        xaccSplitSetGUID (split, &(record.split_guid));
-                        if (record.acc_guid_present)
-                        {
-                            acct = xaccAccountLookupDirect(record.acc_guid, book);
-                            xaccAccountInsertSplit(acct, split);
-
-                            // No currency in the txn yet? Set one now.
-                            if (!xaccTransGetCurrency(trans))
-                                xaccTransSetCurrency(trans, gnc_account_or_default_currency(acct, NULL));
-                        }
-                        if (is_new_split)
-                            xaccTransAppendSplit(trans, split);
-
-                        if (record.split_memo_present)
-                        {
-                            xaccSplitSetMemo(split, record.split_memo);
-                        }
-                        if (record.split_action_present)
-                        {
-                            xaccSplitSetAction(split, record.split_action);
-                        }
-                        if (record.date_reconciled_present)
-                        {
-                            xaccSplitSetDateReconciledSecs (split, record.date_reconciled);
-                        }
-                        if (record.split_reconcile_present)
-                        {
-                            xaccSplitSetReconcile(split, record.split_reconcile);
-                        }
-
-                        if (record.amount_present)
-                        {
-                            xaccSplitSetAmount(split, record.amount);
-                        }
-                        if (record.value_present)
-                        {
-                            xaccSplitSetValue(split, record.value);
-                        }
-                    }
-                    first_record = FALSE;
-                    break;
-                }
-            }
-            else
-            {
-                PERR("Corrupted record");
-            }
+            replay_split_record(&state, &record);
         }
         else /* The record ended */
         {
             record_ended = TRUE;
             DEBUG("process_trans_record(): Record ended\n");
-            if (trans != NULL) /*If we played with a transaction, commit it here*/
-            {
-                xaccTransScrubCurrency(trans);
-                xaccTransSetReadOnly(trans, trans_ro);
-                xaccTransCommitEdit(trans);
-                g_free(trans_ro);
-            }
+            replay_end(&state);
+        }
+    }
+}
+
+/* Fill in a split_record just as interpret_split_record() would from
+ * the text log line for the split. */
+static void binary_split_record(const TransLogRecord *trans_record,
+                                const TransLogSplit *split_rec,
+                                split_record *record)
+{
+    memset(record, 0, sizeof(*record));
+    switch (trans_record->flag)
+    {
+    case 'B':
+        record->log_action = LOG_BEGIN_EDIT;
+        break;
+    case 'D':
+        record->log_action = LOG_DELETE;
+        break;
+    case 'C':
+        record->log_action = LOG_COMMIT;
+        break;
+    case 'R':
+        record->log_action = LOG_ROLLBACK;
+        break;
+    }
+    record->log_action_present = TRUE;
+    record->trans_guid = trans_record->trans_guid;
+    record->trans_guid_present = TRUE;
+    record->split_guid = split_rec->split_guid;
+    record->split_guid_present = TRUE;
+    record->log_date = trans_record->time_now;
+    record->log_date_present = TRUE;
+    record->date_entered = trans_record->date_entered;
+    record->date_entered_present = TRUE;
+    record->date_posted = trans_record->date_posted;
+    record->date_posted_present = TRUE;
+    if (!guid_equal(&split_rec->acc_guid, guid_null()))
+    {
+        record->acc_guid = split_rec->acc_guid;
+        record->acc_guid_present = TRUE;
+    }
+    record->acc_name_present = *split_rec->acc_name != '\0';
+    g_strlcpy(record->acc_name, split_rec->acc_name, STRING_FIELD_SIZE);
+    record->trans_num_present = *trans_record->num != '\0';
+    g_strlcpy(record->trans_num, trans_record->num, STRING_FIELD_SIZE);
+    record->trans_descr_present = *trans_record->description != '\0';
+    g_strlcpy(record->trans_descr, trans_record->description, STRING_FIELD_SIZE);
+    record->trans_notes_present = *trans_record->notes != '\0';
+    g_strlcpy(record->trans_notes, trans_record->notes, STRING_FIELD_SIZE);
+    record->split_memo_present = *split_rec->memo != '\0';
+    g_strlcpy(record->split_memo, split_rec->memo, STRING_FIELD_SIZE);
+    record->split_action_present = *split_rec->action != '\0';
+    g_strlcpy(record->split_action, split_rec->action, STRING_FIELD_SIZE);
+    record->split_reconcile = split_rec->reconciled;
+    record->split_reconcile_present = TRUE;
+    record->amount = split_rec->amount;
+    record->amount_present = TRUE;
+    record->value = split_rec->value;
+    record->value_present = TRUE;
+    record->date_reconciled = split_rec->date_reconciled;
+    record->date_reconciled_present = TRUE;
+}
+
+/* Replays the records of a binary log; returns FALSE if it stopped at a
+ * damaged one. */
+static gboolean process_binary_log(TransLogReader *reader)
+{
+    TransLogRecord trans_record;
+    split_record record;
+
+    while (xaccLogReaderNext(reader, &trans_record))
+    {
+        replay_state state;
+
+        replay_start(&state);
+        for (guint i = 0; i < trans_record.num_splits; i++)
+        {
+            binary_split_record(&trans_record, &trans_record.splits[i], &record);
+            replay_split_record(&state, &record);
         }
+        replay_end(&state);
     }
+    return !xaccLogReaderFailed(reader);
 }
 
 void gnc_file_log_replay (GtkWindow *parent)
@@ -549,6 +657,7 @@ void gnc_file_log_replay (GtkWindow *parent)
     char *read_retval;
     GtkFileFilter *filter;
     FILE *log_file;
+    TransLogReader *reader;
     char * record_start_str = "===== START";
     /* NOTE: This string must match src/engine/TransLog.c (sans newline) */
     char * expected_header_orig = "mod\ttrans_guid\tsplit_guid\ttime_now\t"
@@ -598,7 +707,7 @@ void gnc_file_log_replay (GtkWindow *parent)
         else
         {
             DEBUG("Opening selected file");
-            log_file = g_fopen(selected_filename, "r");
+            log_file = g_fopen(selected_filename, "rb");
             if (!log_file || ferror(log_file) != 0)
             {
                 int err = errno;
@@ -611,6 +720,15 @@ void gnc_file_log_replay (GtkWindow *parent)
                                  selected_filename,
                                  strerror(err));
             }
+            else if ((reader = xaccLogReaderNew(log_file)) != NULL)
+            {
+                if (!process_binary_log(reader))
+                    gnc_error_dialog(NULL, "%s",
+                                     _("The log file you selected is damaged. "
+                                       "The transactions before the damage were replayed."));
+                xaccLogReaderDestroy(reader);
+                fclose(log_file);
+            }
             else
             {
                 if ((read_retval = fgets(read_buf, sizeof(read_buf), log_file)) == NULL)
@@ -35,6 +35,7 @@
 #include "gnc-engine.h"
 #include "gnc-event.h"
 #include "gnc-ledger-display.h"
+#include "gnc-ledger-index.h"
 #include "gnc-prefs.h"
 #include "gnc-ui-util.h"
 #include <gnc-glib-utils.h>
@@ -59,12 +60,16 @@ struct gnc_ledger_display
     GncGUID leader;
 
     Query* query;
+    /* The query's results, updated as transactions change. */
+    GNCLedgerIndex* index;
 
     GNCLedgerDisplayType ld_type;
 
     SplitRegister* reg;
 
     gboolean loading;
+    /* The register wasn't loaded with the latest results. */
+    gboolean needs_reload;
     gboolean use_double_line_default;
 
     GNCLedgerDisplayDestroy destroy;
@@ -578,6 +583,62 @@ gnc_ledger_display_set_watches (GNCLedgerDisplay* ld, GList* splits)
     }
 }
 
+/* Watch the transactions in changes that may have entered the ledger. */
+static void
+gnc_ledger_display_watch_changes (GNCLedgerDisplay* ld, GHashTable* changes)
+{
+    GHashTableIter iter;
+    gpointer key;
+
+    g_hash_table_iter_init (&iter, changes);
+    while (g_hash_table_iter_next (&iter, &key, NULL))
+    {
+        if (xaccTransLookup (key, gnc_get_current_book()))
+            gnc_gui_component_watch_entity (ld->component_id, key,
+                                            QOF_EVENT_MODIFY);
+    }
+}
+
+/* Bring the register up to date with changes by updating the index
+ * instead of re-running the query. If no rows were added, removed or
+ * moved, and the transaction under the cursor didn't change, the rows
+ * only need redrawing as their contents are read from the engine.
+ * Returns FALSE if the query must be re-run.
+ */
+static gboolean
+gnc_ledger_display_refresh_changes (GNCLedgerDisplay* ld, GHashTable* changes)
+{
+    Transaction* current_trans;
+    GList* splits;
+
+    switch (gnc_ledger_index_update (ld->index, ld->query, changes))
+    {
+    case GNC_LEDGER_INDEX_STALE:
+        return FALSE;
+
+    case GNC_LEDGER_INDEX_UNCHANGED:
+        current_trans = gnc_split_register_get_current_trans (ld->reg);
+        if (!ld->needs_reload &&
+            !(current_trans &&
+              gnc_gui_get_entity_events (changes, xaccTransGetGUID (current_trans))))
+        {
+            gnc_ledger_display_watch_changes (ld, changes);
+            gnc_table_refresh_gui (ld->reg->table, FALSE);
+            return TRUE;
+        }
+        break;
+
+    case GNC_LEDGER_INDEX_ROWS_CHANGED:
+        break;
+    }
+
+    splits = gnc_ledger_index_get_splits (ld->index);
+    gnc_ledger_display_watch_changes (ld, changes);
+    gnc_ledger_display_refresh_internal (ld, splits);
+    g_list_free (splits);
+    return TRUE;
+}
+
 static void
 refresh_handler (GHashTable* changes, gpointer user_data)
 {
@@ -623,26 +684,29 @@ refresh_handler (GHashTable* changes, gpointer user_data)
     if (ld->ld_type == LD_SUBACCOUNT)
     {
         Account* leader = gnc_ledger_display_leader (ld);
-        GList* accounts = gnc_account_get_descendants (leader);
 
-        if (g_list_length (accounts) != ld->number_of_subaccounts)
+        if (gnc_account_n_descendants (leader) != ld->number_of_subaccounts)
             gnc_ledger_display_make_query (ld,
                                            gnc_prefs_get_float (GNC_PREFS_GROUP_GENERAL_REGISTER, GNC_PREF_MAX_TRANS),
                                            gnc_get_reg_type (leader, ld->ld_type));
-
-        g_list_free (accounts);
     }
 
     // Exclude any template accounts for search register and gl
     if (!ld->reg->is_template && (ld->reg->type == SEARCH_LEDGER || ld->ld_type == LD_GL))
         exclude_template_accounts (ld->query, ld->excluded_template_acc_hash);
 
-    /* Its not clear if we should re-run the query, or if we should
-     * just use qof_query_last_run().  Its possible that the dates
-     * changed, requiring a full new query.  Similar considerations
-     * needed for multi-user mode.
+    if (changes && gnc_ledger_display_refresh_changes (ld, changes))
+    {
+        LEAVE ("updated %u rows", gnc_ledger_index_get_length (ld->index));
+        return;
+    }
+
+    /* Without a change set, re-run the query rather than using
+     * qof_query_last_run(): the dates may have changed, requiring a full
+     * new query.  Similar considerations needed for multi-user mode.
      */
     splits = qof_query_run (ld->query);
+    gnc_ledger_index_reset (ld->index, ld->query, splits);
 
     gnc_ledger_display_set_watches (ld, splits);
 
@@ -667,6 +731,9 @@ close_handler (gpointer user_data)
     gnc_split_register_destroy (ld->reg);
     ld->reg = NULL;
 
+    gnc_ledger_index_destroy (ld->index);
+    ld->index = NULL;
+
     // Destroy the excluded template account hash
     if (ld->excluded_template_acc_hash)
         g_hash_table_destroy (ld->excluded_template_acc_hash);
@@ -836,8 +903,10 @@ gnc_ledger_display_internal (Account* lead_account, Query* q,
 
     ld->leader = *xaccAccountGetGUID (lead_account);
     ld->query = NULL;
+    ld->index = gnc_ledger_index_new ();
     ld->ld_type = ld_type;
     ld->loading = FALSE;
+    ld->needs_reload = FALSE;
     ld->destroy = NULL;
     ld->get_parent = NULL;
     ld->user_data = NULL;
@@ -868,6 +937,7 @@ gnc_ledger_display_internal (Account* lead_account, Query* q,
     gnc_split_register_set_data (ld->reg, ld, gnc_ledger_display_parent);
 
     splits = qof_query_run (ld->query);
+    gnc_ledger_index_reset (ld->index, ld->query, splits);
 
     gnc_ledger_display_set_watches (ld, splits);
 
@@ -908,7 +978,10 @@ gnc_ledger_display_refresh_internal (GNCLedgerDisplay* ld, GList* splits)
         return;
 
     if (!gnc_split_register_full_refresh_ok (ld->reg))
+    {
+        ld->needs_reload = TRUE;
         return;
+    }
 
     ld->loading = TRUE;
 
@@ -916,11 +989,14 @@ gnc_ledger_display_refresh_internal (GNCLedgerDisplay* ld, GList* splits)
                              gnc_ledger_display_leader (ld));
 
     ld->loading = FALSE;
+    ld->needs_reload = FALSE;
 }
 
 void
 gnc_ledger_display_refresh (GNCLedgerDisplay* ld)
 {
+    GList* splits;
+
     ENTER ("ld=%p", ld);
 
     if (!ld)
@@ -939,7 +1015,9 @@ gnc_ledger_display_refresh (GNCLedgerDisplay* ld)
     if (!ld->reg->is_template && (ld->reg->type == SEARCH_LEDGER || ld->ld_type == LD_GL))
         exclude_template_accounts (ld->query, ld->excluded_template_acc_hash);
 
-    gnc_ledger_display_refresh_internal (ld, qof_query_run (ld->query));
+    splits = qof_query_run (ld->query);
+    gnc_ledger_index_reset (ld->index, ld->query, splits);
+    gnc_ledger_display_refresh_internal (ld, splits);
     LEAVE (" ");
 }
 
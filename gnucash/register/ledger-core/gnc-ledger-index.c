@@ -0,0 +1,361 @@
+/********************************************************************\
+ * gnc-ledger-index.c -- sorted results of a ledger's query         *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+ *                                                                  *
+\********************************************************************/
+
+#include <config.h>
+
+#include "Account.h"
+#include "Transaction.h"
+#include "gnc-component-manager.h"
+#include "gnc-engine.h"
+#include "gnc-event.h"
+#include "gnc-ledger-index.h"
+#include "qofquery-p.h"
+
+
+typedef struct
+{
+    Split* split;
+    /* Copies of the GUIDs, which stay valid after the split or its
+     * transaction has been destroyed. */
+    GncGUID split_guid;
+    GncGUID trans_guid;
+} LedgerRow;
+
+/* Where a row of a changed transaction was before the update. */
+typedef struct
+{
+    guint pos;
+    GncGUID split_guid;
+} LedgerRowPos;
+
+struct gnc_ledger_index
+{
+    /* A copy of the query the rows were built from, NULL if stale. */
+    Query* query;
+    /* LedgerRows in query sort order. */
+    GArray* rows;
+    /* Maps the GUIDs of the transactions that have rows to the number of
+     * splits they had, which journal mode shows a row for each of. */
+    GHashTable* trans_splits;
+};
+
+
+/** GLOBALS *********************************************************/
+static QofLogModule log_module = GNC_MOD_LEDGER;
+
+
+/** Implementations *************************************************/
+
+GNCLedgerIndex*
+gnc_ledger_index_new (void)
+{
+    GNCLedgerIndex* index = g_new0 (GNCLedgerIndex, 1);
+
+    index->rows = g_array_new (FALSE, FALSE, sizeof (LedgerRow));
+    index->trans_splits = g_hash_table_new_full (guid_hash_to_guint,
+                                                 guid_g_hash_table_equal,
+                                                 (GDestroyNotify) guid_free,
+                                                 NULL);
+    return index;
+}
+
+void
+gnc_ledger_index_destroy (GNCLedgerIndex* index)
+{
+    if (!index)
+        return;
+
+    if (index->query)
+        qof_query_destroy (index->query);
+    g_array_free (index->rows, TRUE);
+    g_hash_table_destroy (index->trans_splits);
+    g_free (index);
+}
+
+static guint
+count_splits (Transaction* trans)
+{
+    guint count = 0;
+
+    for (GList* node = xaccTransGetSplitList (trans); node; node = node->next)
+        if (xaccTransStillHasSplit (trans, node->data))
+            count++;
+    return count;
+}
+
+static void
+note_trans (GNCLedgerIndex* index, Transaction* trans)
+{
+    const GncGUID* guid = xaccTransGetGUID (trans);
+
+    if (!g_hash_table_contains (index->trans_splits, guid))
+        g_hash_table_insert (index->trans_splits, guid_copy (guid),
+                             GUINT_TO_POINTER (count_splits (trans)));
+}
+
+void
+gnc_ledger_index_reset (GNCLedgerIndex* index, Query* query, GList* splits)
+{
+    g_return_if_fail (index);
+
+    if (index->query)
+        qof_query_destroy (index->query);
+    index->query = query ? qof_query_copy (query) : NULL;
+
+    g_array_set_size (index->rows, 0);
+    g_hash_table_remove_all (index->trans_splits);
+
+    for (GList* node = splits; node; node = node->next)
+    {
+        Split* split = node->data;
+        Transaction* trans = xaccSplitGetParent (split);
+        LedgerRow row;
+
+        row.split = split;
+        row.split_guid = *xaccSplitGetGUID (split);
+        row.trans_guid = trans ? *xaccTransGetGUID (trans) : *guid_null ();
+        g_array_append_val (index->rows, row);
+
+        if (trans)
+            note_trans (index, trans);
+    }
+}
+
+/* Insert a split after any rows that sort equal to it, as the stable
+ * sort in qof_query_run would place it. */
+static void
+insert_row (GNCLedgerIndex* index, Query* query, Split* split,
+            Transaction* trans)
+{
+    guint lo = 0, hi = index->rows->len;
+    LedgerRow row;
+
+    while (lo < hi)
+    {
+        guint mid = lo + (hi - lo) / 2;
+        Split* other = g_array_index (index->rows, LedgerRow, mid).split;
+
+        if (qof_query_sort_compare (query, split, other) < 0)
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+
+    row.split = split;
+    row.split_guid = *xaccSplitGetGUID (split);
+    row.trans_guid = *xaccTransGetGUID (trans);
+    g_array_insert_val (index->rows, lo, row);
+}
+
+static Transaction*
+lookup_trans (GList* books, const GncGUID* guid)
+{
+    for (GList* node = books; node; node = node->next)
+    {
+        Transaction* trans = xaccTransLookup (guid, node->data);
+        if (trans)
+            return trans;
+    }
+    return NULL;
+}
+
+static gboolean
+is_account (GList* books, const GncGUID* guid)
+{
+    for (GList* node = books; node; node = node->next)
+        if (xaccAccountLookup (guid, node->data))
+            return TRUE;
+    return FALSE;
+}
+
+static gboolean
+rows_in_order (GNCLedgerIndex* index, Query* query)
+{
+    for (guint i = 1; i < index->rows->len; i++)
+    {
+        if (qof_query_sort_compare (query,
+                                    g_array_index (index->rows, LedgerRow, i - 1).split,
+                                    g_array_index (index->rows, LedgerRow, i).split) > 0)
+            return FALSE;
+    }
+    return TRUE;
+}
+
+GNCLedgerIndexUpdate
+gnc_ledger_index_update (GNCLedgerIndex* index, Query* query,
+                         GHashTable* changes)
+{
+    GHashTable* touched;
+    GArray* removed;
+    GHashTableIter iter;
+    gpointer key, value;
+    GList* books;
+    gboolean had_rows = FALSE;
+    gboolean check_order = FALSE;
+    gboolean rows_changed = FALSE;
+    guint kept = 0, n = 0;
+
+    g_return_val_if_fail (index && query, GNC_LEDGER_INDEX_STALE);
+
+    ENTER ("index=%p, query=%p, changes=%p", index, query, changes);
+
+    if (!changes || !index->query ||
+        qof_query_get_max_results (query) >= 0 ||
+        !qof_query_equal (index->query, query))
+    {
+        LEAVE ("stale");
+        return GNC_LEDGER_INDEX_STALE;
+    }
+
+    books = qof_query_get_books (query);
+
+    /* Find the transactions that changed, mapping their GUIDs to the
+     * transaction or to NULL if it has been destroyed. The keys belong to
+     * changes. */
+    touched = guid_hash_table_new ();
+    g_hash_table_iter_init (&iter, changes);
+    while (g_hash_table_iter_next (&iter, &key, &value))
+    {
+        const EventInfo* info = value;
+        Transaction* trans = lookup_trans (books, key);
+
+        if (trans || g_hash_table_contains (index->trans_splits, key))
+        {
+            if (trans && qof_instance_get_destroying (trans))
+                trans = NULL;
+            g_hash_table_insert (touched, key, trans);
+            had_rows |= g_hash_table_contains (index->trans_splits, key);
+        }
+        /* Adding and removing splits doesn't change an account's sort
+         * keys, but renaming or moving it does. */
+        else if (!(info->event_mask &
+                   (GNC_EVENT_ITEM_ADDED | GNC_EVENT_ITEM_REMOVED)) &&
+                 is_account (books, key))
+            check_order = TRUE;
+    }
+
+    /* Take out the rows of the changed transactions, remembering where
+     * they were. */
+    removed = g_array_new (FALSE, FALSE, sizeof (LedgerRowPos));
+    if (had_rows)
+    {
+        for (guint i = 0; i < index->rows->len; i++)
+        {
+            LedgerRow* row = &g_array_index (index->rows, LedgerRow, i);
+
+            if (g_hash_table_contains (touched, &row->trans_guid))
+            {
+                LedgerRowPos pos = { i, row->split_guid };
+                g_array_append_val (removed, pos);
+            }
+            else
+                g_array_index (index->rows, LedgerRow, kept++) = *row;
+        }
+        g_array_set_size (index->rows, kept);
+    }
+
+    /* Put back the splits of the changed transactions that match. */
+    g_hash_table_iter_init (&iter, touched);
+    while (g_hash_table_iter_next (&iter, &key, &value))
+    {
+        Transaction* trans = value;
+        guint old_count = GPOINTER_TO_UINT (g_hash_table_lookup (index->trans_splits,
+                                                                 key));
+        gboolean had_trans = g_hash_table_remove (index->trans_splits, key);
+        gboolean has_trans = FALSE;
+
+        if (!trans)
+            continue;
+
+        for (GList* node = xaccTransGetSplitList (trans); node; node = node->next)
+        {
+            Split* split = node->data;
+
+            if (!xaccTransStillHasSplit (trans, split) ||
+                !qof_query_match_object (query, split))
+                continue;
+
+            insert_row (index, query, split, trans);
+            has_trans = TRUE;
+        }
+
+        if (has_trans)
+        {
+            note_trans (index, trans);
+            if (had_trans && count_splits (trans) != old_count)
+                rows_changed = TRUE;
+        }
+    }
+
+    /* The rows are unchanged if the changed transactions' rows came back
+     * at the same places. */
+    for (guint i = 0; i < index->rows->len && !rows_changed; i++)
+    {
+        LedgerRow* row = &g_array_index (index->rows, LedgerRow, i);
+        LedgerRowPos* pos;
+
+        if (!g_hash_table_contains (touched, &row->trans_guid))
+            continue;
+
+        pos = n < removed->len ? &g_array_index (removed, LedgerRowPos, n) : NULL;
+        if (!pos || pos->pos != i || !guid_equal (&pos->split_guid, &row->split_guid))
+            rows_changed = TRUE;
+        n++;
+    }
+    if (n != removed->len)
+        rows_changed = TRUE;
+
+    g_array_free (removed, TRUE);
+    g_hash_table_destroy (touched);
+
+    if (check_order && !rows_in_order (index, query))
+    {
+        qof_query_destroy (index->query);
+        index->query = NULL;
+        LEAVE ("account change reordered the rows");
+        return GNC_LEDGER_INDEX_STALE;
+    }
+
+    LEAVE ("%s", rows_changed ? "rows changed" : "unchanged");
+    return rows_changed ? GNC_LEDGER_INDEX_ROWS_CHANGED :
+                          GNC_LEDGER_INDEX_UNCHANGED;
+}
+
+guint
+gnc_ledger_index_get_length (GNCLedgerIndex* index)
+{
+    g_return_val_if_fail (index, 0);
+    return index->rows->len;
+}
+
+GList*
+gnc_ledger_index_get_splits (GNCLedgerIndex* index)
+{
+    GList* splits = NULL;
+
+    g_return_val_if_fail (index, NULL);
+
+    for (guint i = index->rows->len; i > 0; i--)
+        splits = g_list_prepend (splits,
+                                 g_array_index (index->rows, LedgerRow, i - 1).split);
+    return splits;
+}
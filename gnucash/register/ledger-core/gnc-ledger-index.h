@@ -0,0 +1,103 @@
+/********************************************************************\
+ * gnc-ledger-index.h -- sorted results of a ledger's query         *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+ *                                                                  *
+\********************************************************************/
+/** @ingroup Register
+ * @addtogroup Gnome
+ * @{
+ */
+/** @file gnc-ledger-index.h
+ *  @brief The splits shown by a ledger, kept up to date as
+ *  transactions change.
+ *
+ *  A ledger display shows the results of a split query. Re-running the
+ *  query visits every split in the book and sorts the matches, which is
+ *  slow for large books and was done on every change. The index keeps
+ *  the results in sort order and, given the set of entities that changed,
+ *  replaces the rows of the changed transactions by re-checking just
+ *  their splits against the query.
+ *
+ *  The index can't be updated when the query has changed since the index
+ *  was built or limits its number of results, because then splits that
+ *  didn't change may enter or leave the results. The caller must then
+ *  re-run the query and reset the index.
+ */
+
+#ifndef GNC_LEDGER_INDEX_H
+#define GNC_LEDGER_INDEX_H
+
+#include <glib.h>
+
+#include "Query.h"
+
+typedef struct gnc_ledger_index GNCLedgerIndex;
+
+typedef enum
+{
+    /** The rows are the same splits in the same order, and the
+     *  transactions changed have the same number of splits. */
+    GNC_LEDGER_INDEX_UNCHANGED,
+    /** Rows were added, removed or moved, or a transaction shown gained
+     *  or lost splits. */
+    GNC_LEDGER_INDEX_ROWS_CHANGED,
+    /** The index couldn't be updated; the query must be re-run. */
+    GNC_LEDGER_INDEX_STALE,
+} GNCLedgerIndexUpdate;
+
+/** Create an empty index. It is stale until reset. */
+GNCLedgerIndex* gnc_ledger_index_new (void);
+
+void gnc_ledger_index_destroy (GNCLedgerIndex* index);
+
+/** Replace the contents of the index with the results of a query.
+ *
+ *  @param query The query that was run. The index keeps a copy of it.
+ *
+ *  @param splits The results of running it, in sort order.
+ */
+void gnc_ledger_index_reset (GNCLedgerIndex* index, Query* query,
+                             GList* splits);
+
+/** Update the index for changed entities.
+ *
+ *  @param query The ledger's query. It must be equal to the one the
+ *  index was last reset with, or the index is stale.
+ *
+ *  @param changes A GncGUID hash table whose keys are the entities that
+ *  changed, such as the one the component manager passes to refresh
+ *  handlers. Keys that aren't transactions are ignored, except that a
+ *  changed account may change the order of the rows, which is then
+ *  checked.
+ *
+ *  @return how the rows changed.
+ */
+GNCLedgerIndexUpdate gnc_ledger_index_update (GNCLedgerIndex* index,
+                                              Query* query,
+                                              GHashTable* changes);
+
+/** @return the number of splits in the index. */
+guint gnc_ledger_index_get_length (GNCLedgerIndex* index);
+
+/** @return the splits in the index in sort order. The list must be
+ *  freed with g_list_free but the splits belong to the engine. */
+GList* gnc_ledger_index_get_splits (GNCLedgerIndex* index);
+
+#endif /* GNC_LEDGER_INDEX_H */
+/** @} */
@@ -813,7 +813,8 @@ gnc_entry_ledger_get_entry_virt_loc (GncEntryLedger *ledger, const GncEntry *ent
             if (!vcell->visible)
                 continue;
 
-            e = gncEntryLookup (ledger->book, vcell->vcell_data);
+            e = gncEntryLookup (ledger->book,
+                                gnc_table_peek_vcell_data (table, vc_loc));
 
             if (e == entry)
             {
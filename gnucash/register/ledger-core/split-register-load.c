@@ -36,6 +36,7 @@
 #include "qof.h"
 #include "gnc-ui-util.h"
 #include "gnc-gui-query.h"
+#include "gnc-trans-quickfill.h"
 #include "numcell.h"
 #include "quickfillcell.h"
 #include "doclinkcell.h"
@@ -55,6 +56,7 @@ static void gnc_split_register_load_xfer_cells (SplitRegister* reg,
                                                 Account* base_account);
 
 static void gnc_split_register_load_desc_cells (SplitRegister* reg);
+static void gnc_split_register_load_completion_cells (SplitRegister* reg);
 static void
 gnc_split_register_load_recn_cells (SplitRegister* reg)
 {
@@ -241,25 +243,121 @@ _find_split_with_parent_txn (gconstpointer a, gconstpointer b)
     return xaccSplitGetParent (split) == txn ? 0 : 1;
 }
 
+/* The notes and memo cells share the book's quickfills, see
+ * gnc_split_register_load_completion_cells, so only the num cell needs
+ * the register's own transactions. */
 static void add_quickfill_completions (TableLayout* layout, Transaction* trans,
                                        Split* split, gboolean has_last_num)
 {
-    gnc_quickfill_cell_add_completion (
-        (QuickFillCell*) gnc_table_layout_get_cell (layout, NOTES_CELL),
-        xaccTransGetNotes (trans));
-
     if (!has_last_num)
         gnc_num_cell_set_last_num (
             (NumCell*) gnc_table_layout_get_cell (layout, NUM_CELL),
             gnc_get_num_action (trans, split));
+}
+
+/* A loaded transaction whose text is still to be added to the cells. */
+typedef struct
+{
+    GncGUID trans_guid;
+    GncGUID split_guid;
+    /* Whether to add its num, as well as its description. */
+    gboolean completions;
+} FillEntry;
+
+/* How many transactions the idle fill handles each time it runs, small
+ * enough not to hold up typing. */
+#define FILL_CHUNK 250
+
+static void
+fill_entry (SplitRegister* reg, const FillEntry* entry)
+{
+    QofBook* book = gnc_get_current_book ();
+    Transaction* trans = xaccTransLookup (&entry->trans_guid, book);
+
+    /* It may have been deleted since it was loaded. */
+    if (!trans)
+        return;
+
+    if (entry->completions)
+        add_quickfill_completions (reg->table->layout, trans,
+                                   xaccSplitLookup (&entry->split_guid, book),
+                                   reg->sr_info->fill_has_last_num);
+
+    gnc_combo_cell_add_menu_item_unique (
+        (ComboCell*) gnc_table_layout_get_cell (reg->table->layout, DESC_CELL),
+        xaccTransGetDescription (trans));
+}
 
-    for (GList *n = xaccTransGetSplitList (trans); n; n = n->next)
+static gboolean
+fill_idle_cb (gpointer user_data)
+{
+    SplitRegister* reg = user_data;
+    SRInfo* info = reg->sr_info;
+    guint end = MIN (info->fill_pos + FILL_CHUNK, info->fill_queue->len);
+
+    for (; info->fill_pos < end; info->fill_pos++)
+        fill_entry (reg, &g_array_index (info->fill_queue, FillEntry,
+                                         info->fill_pos));
+
+    if (info->fill_pos < info->fill_queue->len)
+        return G_SOURCE_CONTINUE;
+
+    g_array_set_size (info->fill_queue, 0);
+    info->fill_pos = 0;
+    info->fill_idle_id = 0;
+    return G_SOURCE_REMOVE;
+}
+
+/* Start a new fill for a load. The descriptions of the previous load's
+ * transactions will be added again, but the completions of a first load
+ * not yet filled are only added once, so keep them. */
+static void
+restart_fill (SRInfo* info)
+{
+    guint kept = 0;
+
+    if (!info->fill_queue)
     {
-        Split *s = n->data;
-        gnc_quickfill_cell_add_completion (
-            (QuickFillCell*) gnc_table_layout_get_cell (layout, MEMO_CELL),
-            xaccSplitGetMemo (s));
+        info->fill_queue = g_array_new (FALSE, FALSE, sizeof (FillEntry));
+        return;
     }
+
+    for (guint i = info->fill_pos; i < info->fill_queue->len; i++)
+    {
+        FillEntry* entry = &g_array_index (info->fill_queue, FillEntry, i);
+
+        if (entry->completions)
+            g_array_index (info->fill_queue, FillEntry, kept++) = *entry;
+    }
+    g_array_set_size (info->fill_queue, kept);
+    info->fill_pos = 0;
+}
+
+static void
+queue_fill (SRInfo* info, Transaction* trans, Split* split,
+            gboolean completions)
+{
+    FillEntry entry;
+
+    entry.trans_guid = *xaccTransGetGUID (trans);
+    entry.split_guid = *xaccSplitGetGUID (split);
+    entry.completions = completions;
+    g_array_append_val (info->fill_queue, entry);
+}
+
+void
+gnc_split_register_cancel_fill (SRInfo* info)
+{
+    g_return_if_fail (info);
+
+    if (info->fill_idle_id)
+        g_source_remove (info->fill_idle_id);
+    info->fill_idle_id = 0;
+
+    if (info->fill_queue)
+        g_array_free (info->fill_queue, TRUE);
+    info->fill_queue = NULL;
+    info->fill_pos = 0;
 }
 
 static Split*
@@ -534,6 +632,7 @@ gnc_split_register_load (SplitRegister* reg, GList* slist,
         /* load up account names into the transfer combobox menus */
         gnc_split_register_load_xfer_cells (reg, default_account);
         gnc_split_register_load_desc_cells (reg);
+        gnc_split_register_load_completion_cells (reg);
         gnc_split_register_load_doclink_cells (reg);
         gnc_split_register_load_recn_cells (reg);
         gnc_split_register_load_type_cells (reg);
@@ -574,6 +673,10 @@ gnc_split_register_load (SplitRegister* reg, GList* slist,
     if (multi_line)
         trans_table = g_hash_table_new (g_direct_hash, g_direct_equal);
 
+    restart_fill (info);
+    if (info->first_pass)
+        info->fill_has_last_num = has_last_num;
+
     /* populate the table */
     for (node = slist; node; node = node->next)
     {
@@ -666,14 +769,9 @@ gnc_split_register_load (SplitRegister* reg, GList* slist,
             }
         }
 
-        /* If this is the first load of the register,
-         * fill up the quickfill cells. */
-        if (info->first_pass)
-            add_quickfill_completions (reg->table->layout, trans, split, has_last_num);
-
-        gnc_combo_cell_add_menu_item_unique (
-            (ComboCell*) gnc_table_layout_get_cell (reg->table->layout, DESC_CELL),
-            xaccTransGetDescription (trans));
+        /* Fill the description menu and, if this is the first load of
+         * the register, the num cell, once the rows are shown. */
+        queue_fill (info, trans, split, info->first_pass);
 
         if (trans == find_trans)
             new_trans_row = vcell_loc.virt_row;
@@ -817,6 +915,9 @@ gnc_split_register_load (SplitRegister* reg, GList* slist,
 
     gnc_split_register_show_trans (reg, table->current_cursor_loc.vcell_loc);
 
+    if (info->fill_queue->len > 0 && !info->fill_idle_id)
+        info->fill_idle_id = g_idle_add (fill_idle_cb, reg);
+
     /* enable callback for cursor user-driven moves */
     gnc_table_control_allow_move (table->control, TRUE);
 
@@ -829,6 +930,7 @@ gnc_split_register_load (SplitRegister* reg, GList* slist,
 /* ===================================================================== */
 
 #define QKEY  "split_reg_shared_quickfill"
+#define TQKEY "split_reg_shared_trans_quickfill"
 
 static gboolean
 skip_cb (Account* account, gpointer x)
@@ -882,4 +984,21 @@ gnc_split_register_load_desc_cells (SplitRegister* reg)
 
     gnc_combo_cell_use_list_store_cache (cell, store);
 }
+
+static void
+gnc_split_register_load_completion_cells (SplitRegister* reg)
+{
+    QofBook* book = gnc_get_current_book ();
+    QuickFillCell* cell;
+
+    cell = (QuickFillCell*)
+           gnc_table_layout_get_cell (reg->table->layout, NOTES_CELL);
+    gnc_quickfill_cell_use_quickfill_cache (
+        cell, gnc_get_shared_trans_notes_quickfill (book, TQKEY));
+
+    cell = (QuickFillCell*)
+           gnc_table_layout_get_cell (reg->table->layout, MEMO_CELL);
+    gnc_quickfill_cell_use_quickfill_cache (
+        cell, gnc_get_shared_split_memo_quickfill (book, TQKEY));
+}
 /* ====================== END OF FILE ================================== */
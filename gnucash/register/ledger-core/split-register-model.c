@@ -2875,6 +2875,7 @@ gnc_split_register_model_new (void)
     model->cell_data_allocator   = gnc_split_register_guid_malloc;
     model->cell_data_deallocator = gnc_split_register_guid_free;
     model->cell_data_copy        = gnc_split_register_guid_copy;
+    model->cell_data_size        = sizeof (GncGUID);
 
     gnc_split_register_model_add_save_handlers (model);
 
@@ -133,6 +133,17 @@ struct sr_info
 
     /** true if the account separator has changed */
     gboolean separator_changed;
+
+    /** transactions loaded whose descriptions, notes and memos are still
+     * to be added to the quickfill cells, from fill_pos on */
+    GArray *fill_queue;
+    guint fill_pos;
+
+    /** the idle source working through fill_queue, or 0 */
+    guint fill_idle_id;
+
+    /** true if the number cell's last number came from the account */
+    gboolean fill_has_last_num;
 };
 
 
@@ -183,6 +194,9 @@ CellBlock * gnc_split_register_get_active_cursor (SplitRegister *reg);
 
 void gnc_split_register_set_last_num (SplitRegister *reg, const char *num);
 
+/** Stop filling the quickfill cells from the transactions last loaded. */
+void gnc_split_register_cancel_fill (SRInfo *info);
+
 Account * gnc_split_register_get_account_by_name(
     SplitRegister *reg, BasicCell * cell, const char *name);
 Account * gnc_split_register_get_account (SplitRegister *reg,
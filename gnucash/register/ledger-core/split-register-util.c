@@ -216,7 +216,9 @@ gnc_split_register_find_split (SplitRegister *reg,
         {
             VirtualCellLocation vc_loc = { v_row, v_col };
 
-            s = gnc_split_register_get_split (reg, vc_loc);
+            /* Peek, so searching doesn't allocate every row's data. */
+            s = xaccSplitLookup (gnc_table_peek_vcell_data (table, vc_loc),
+                                 gnc_get_current_book ());
             t = xaccSplitGetParent(s);
 
             cursor_class = gnc_split_register_get_cursor_class (reg, vc_loc);
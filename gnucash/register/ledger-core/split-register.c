@@ -345,7 +345,8 @@ gnc_split_register_get_split_virt_loc (SplitRegister* reg, Split* split,
             if (!vcell || !vcell->visible)
                 continue;
 
-            s = xaccSplitLookup (vcell->vcell_data, gnc_get_current_book ());
+            s = xaccSplitLookup (gnc_table_peek_vcell_data (table, vc_loc),
+                                 gnc_get_current_book ());
 
             if (s == split)
             {
@@ -2984,6 +2985,8 @@ gnc_split_register_destroy_info (SplitRegister* reg)
     if (!info)
         return;
 
+    gnc_split_register_cancel_fill (info);
+
     g_free (info->tdebit_str);
     g_free (info->tcredit_str);
 
@@ -27,6 +27,8 @@
 #include <TransLog.h>
 
 extern void test_suite_split_register_copy_ops();
+extern void test_suite_gnc_ledger_index();
+extern void test_suite_table_rows();
 
 int
 main (int   argc,
@@ -41,6 +43,8 @@ main (int   argc,
     xaccLogDisable();
 
     test_suite_split_register_copy_ops();
+    test_suite_gnc_ledger_index();
+    test_suite_table_rows();
 
     return g_test_run( );
 }
@@ -0,0 +1,385 @@
+/********************************************************************
+ * utest-gnc-ledger-index.c: GLib g_test test suite for gnc-ledger-index.c. *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, you can retrieve it from        *
+ * https://www.gnu.org/licenses/old-licenses/gpl-2.0.html            *
+ * or contact:                                                      *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+ ********************************************************************/
+#include <config.h>
+#include <glib.h>
+#include <unittest-support.h>
+/* Add specific headers for this class */
+#include "gnc-ledger-index.h"
+#include "gnc-component-manager.h"
+#include "cashobjects.h"
+#include "Account.h"
+#include "Transaction.h"
+
+static const gchar *suitename = "/register/ledger-core/gnc-ledger-index";
+void test_suite_gnc_ledger_index ( void );
+
+#define NUM_TRANS 20
+
+typedef struct
+{
+    QofBook *book;
+    Account *acc1;
+    Account *acc2;
+    gnc_commodity *curr;
+    Query *query;
+    GNCLedgerIndex *index;
+} Fixture;
+
+static Transaction*
+make_trans (Fixture *fixture, gint day, gint64 amount)
+{
+    Transaction *txn = xaccMallocTransaction (fixture->book);
+    Split *split1 = xaccMallocSplit (fixture->book);
+    Split *split2 = xaccMallocSplit (fixture->book);
+
+    xaccTransBeginEdit (txn);
+    xaccTransSetCurrency (txn, fixture->curr);
+    xaccTransSetDatePostedSecsNormalized (txn, gnc_dmy2time64 (1, 1, 2020)
+                                          + (time64)day * 86400);
+    xaccTransSetDescription (txn, "Index test");
+
+    xaccSplitSetAccount (split1, fixture->acc1);
+    xaccSplitSetAmount (split1, gnc_numeric_create (amount, 100));
+    xaccSplitSetValue (split1, gnc_numeric_create (amount, 100));
+    xaccSplitSetParent (split1, txn);
+
+    xaccSplitSetAccount (split2, fixture->acc2);
+    xaccSplitSetAmount (split2, gnc_numeric_create (-amount, 100));
+    xaccSplitSetValue (split2, gnc_numeric_create (-amount, 100));
+    xaccSplitSetParent (split2, txn);
+    xaccTransCommitEdit (txn);
+    return txn;
+}
+
+static void
+setup_size (Fixture *fixture, guint ntrans)
+{
+    fixture->book = qof_book_new ();
+    fixture->curr = gnc_commodity_new (fixture->book, "Gnu Rand", "CURRENCY",
+                                       "GNR", "", 100);
+    fixture->acc1 = xaccMallocAccount (fixture->book);
+    fixture->acc2 = xaccMallocAccount (fixture->book);
+    xaccAccountSetCommodity (fixture->acc1, fixture->curr);
+    xaccAccountSetCommodity (fixture->acc2, fixture->curr);
+
+    for (guint i = 0; i < ntrans; i++)
+        make_trans (fixture, 2 * i, 100 * (i + 1));
+
+    fixture->query = qof_query_create_for (GNC_ID_SPLIT);
+    qof_query_set_book (fixture->query, fixture->book);
+    xaccQueryAddSingleAccountMatch (fixture->query, fixture->acc1,
+                                    QOF_QUERY_AND);
+    qof_query_set_sort_order (fixture->query,
+                              qof_query_build_param_list (QUERY_DEFAULT_SORT,
+                                                          NULL),
+                              NULL, NULL);
+
+    fixture->index = gnc_ledger_index_new ();
+    gnc_ledger_index_reset (fixture->index, fixture->query,
+                            qof_query_run (fixture->query));
+}
+
+static void
+setup (Fixture *fixture, gconstpointer pData)
+{
+    setup_size (fixture, NUM_TRANS);
+}
+
+static void
+teardown (Fixture *fixture, gconstpointer pData)
+{
+    gnc_ledger_index_destroy (fixture->index);
+    qof_query_destroy (fixture->query);
+    qof_book_destroy (fixture->book);
+}
+
+/* A change set as the component manager passes it to refresh handlers. */
+static GHashTable*
+changes_new (void)
+{
+    return g_hash_table_new_full (guid_hash_to_guint, guid_g_hash_table_equal,
+                                  (GDestroyNotify) guid_free, g_free);
+}
+
+static void
+changes_add (GHashTable *changes, const GncGUID *guid, QofEventId event_mask)
+{
+    EventInfo *info = g_new (EventInfo, 1);
+
+    info->event_mask = event_mask;
+    g_hash_table_insert (changes, guid_copy (guid), info);
+}
+
+static GNCLedgerIndexUpdate
+update_for (Fixture *fixture, Transaction *txn, QofEventId event_mask)
+{
+    GHashTable *changes = changes_new ();
+    GNCLedgerIndexUpdate result;
+
+    changes_add (changes, xaccTransGetGUID (txn), event_mask);
+    result = gnc_ledger_index_update (fixture->index, fixture->query, changes);
+    g_hash_table_destroy (changes);
+    return result;
+}
+
+/* The index must hold what re-running the query returns. */
+static void
+assert_index_matches_query (Fixture *fixture)
+{
+    GList *splits = gnc_ledger_index_get_splits (fixture->index);
+    GList *results = qof_query_run (fixture->query);
+    GList *node, *rnode;
+
+    g_assert_cmpuint (g_list_length (splits), ==, g_list_length (results));
+    for (node = splits, rnode = results; node && rnode;
+         node = node->next, rnode = rnode->next)
+        g_assert_true (node->data == rnode->data);
+    g_list_free (splits);
+}
+
+static Transaction*
+nth_trans (Fixture *fixture, guint n)
+{
+    Split *split = g_list_nth_data (xaccAccountGetSplitList (fixture->acc1), n);
+    return xaccSplitGetParent (split);
+}
+
+static void
+test_reset (Fixture *fixture, gconstpointer pData)
+{
+    g_assert_cmpuint (gnc_ledger_index_get_length (fixture->index), ==,
+                      NUM_TRANS);
+    assert_index_matches_query (fixture);
+}
+
+static void
+test_edit_in_place (Fixture *fixture, gconstpointer pData)
+{
+    Transaction *txn = nth_trans (fixture, 5);
+
+    xaccTransBeginEdit (txn);
+    xaccTransSetDescription (txn, "Edited");
+    xaccTransCommitEdit (txn);
+
+    g_assert_cmpint (update_for (fixture, txn, QOF_EVENT_MODIFY), ==,
+                     GNC_LEDGER_INDEX_UNCHANGED);
+    assert_index_matches_query (fixture);
+}
+
+static void
+test_date_moves_row (Fixture *fixture, gconstpointer pData)
+{
+    Transaction *txn = nth_trans (fixture, 0);
+
+    xaccTransBeginEdit (txn);
+    xaccTransSetDatePostedSecsNormalized (txn, gnc_dmy2time64 (1, 1, 2020)
+                                          + (time64)(2 * NUM_TRANS + 1) * 86400);
+    xaccTransCommitEdit (txn);
+
+    g_assert_cmpint (update_for (fixture, txn, QOF_EVENT_MODIFY), ==,
+                     GNC_LEDGER_INDEX_ROWS_CHANGED);
+    assert_index_matches_query (fixture);
+    g_assert_true (g_list_last (qof_query_last_run (fixture->query))->data ==
+                   xaccTransGetSplit (txn, 0));
+}
+
+static void
+test_new_trans (Fixture *fixture, gconstpointer pData)
+{
+    Transaction *txn = make_trans (fixture, 7, 12345);
+
+    g_assert_cmpint (update_for (fixture, txn, QOF_EVENT_CREATE), ==,
+                     GNC_LEDGER_INDEX_ROWS_CHANGED);
+    g_assert_cmpuint (gnc_ledger_index_get_length (fixture->index), ==,
+                      NUM_TRANS + 1);
+    assert_index_matches_query (fixture);
+}
+
+static void
+test_destroy_trans (Fixture *fixture, gconstpointer pData)
+{
+    Transaction *txn = nth_trans (fixture, 3);
+    GncGUID guid = *xaccTransGetGUID (txn);
+    GHashTable *changes = changes_new ();
+
+    xaccTransBeginEdit (txn);
+    xaccTransDestroy (txn);
+    xaccTransCommitEdit (txn);
+
+    changes_add (changes, &guid, QOF_EVENT_DESTROY);
+    g_assert_cmpint (gnc_ledger_index_update (fixture->index, fixture->query,
+                                              changes), ==,
+                     GNC_LEDGER_INDEX_ROWS_CHANGED);
+    g_hash_table_destroy (changes);
+    g_assert_cmpuint (gnc_ledger_index_get_length (fixture->index), ==,
+                      NUM_TRANS - 1);
+    assert_index_matches_query (fixture);
+}
+
+static void
+test_split_moved_out (Fixture *fixture, gconstpointer pData)
+{
+    Transaction *txn = nth_trans (fixture, 8);
+    Split *split = xaccTransFindSplitByAccount (txn, fixture->acc1);
+    Account *acc3 = xaccMallocAccount (fixture->book);
+
+    xaccAccountSetCommodity (acc3, fixture->curr);
+    xaccTransBeginEdit (txn);
+    xaccSplitSetAccount (split, acc3);
+    xaccTransCommitEdit (txn);
+
+    g_assert_cmpint (update_for (fixture, txn, QOF_EVENT_MODIFY), ==,
+                     GNC_LEDGER_INDEX_ROWS_CHANGED);
+    g_assert_cmpuint (gnc_ledger_index_get_length (fixture->index), ==,
+                      NUM_TRANS - 1);
+    assert_index_matches_query (fixture);
+}
+
+static void
+test_split_added (Fixture *fixture, gconstpointer pData)
+{
+    Transaction *txn = nth_trans (fixture, 2);
+    Split *split = xaccMallocSplit (fixture->book);
+
+    xaccTransBeginEdit (txn);
+    xaccSplitSetAccount (split, fixture->acc2);
+    xaccSplitSetParent (split, txn);
+    xaccTransCommitEdit (txn);
+
+    /* Same rows, but journal mode shows one more for the transaction. */
+    g_assert_cmpint (update_for (fixture, txn, QOF_EVENT_MODIFY), ==,
+                     GNC_LEDGER_INDEX_ROWS_CHANGED);
+    assert_index_matches_query (fixture);
+}
+
+static void
+test_unrelated_change (Fixture *fixture, gconstpointer pData)
+{
+    Account *acc3 = xaccMallocAccount (fixture->book);
+    Account *acc4 = xaccMallocAccount (fixture->book);
+    Transaction *txn;
+
+    xaccAccountSetCommodity (acc3, fixture->curr);
+    xaccAccountSetCommodity (acc4, fixture->curr);
+    txn = make_trans (fixture, 3, 500);
+    xaccTransBeginEdit (txn);
+    xaccSplitSetAccount (xaccTransGetSplit (txn, 0), acc3);
+    xaccSplitSetAccount (xaccTransGetSplit (txn, 1), acc4);
+    xaccTransCommitEdit (txn);
+    gnc_ledger_index_reset (fixture->index, fixture->query,
+                            qof_query_run (fixture->query));
+
+    xaccTransBeginEdit (txn);
+    xaccTransSetDescription (txn, "Elsewhere");
+    xaccTransCommitEdit (txn);
+
+    g_assert_cmpint (update_for (fixture, txn, QOF_EVENT_MODIFY), ==,
+                     GNC_LEDGER_INDEX_UNCHANGED);
+    assert_index_matches_query (fixture);
+}
+
+static void
+test_stale (Fixture *fixture, gconstpointer pData)
+{
+    Transaction *txn = nth_trans (fixture, 1);
+    GNCLedgerIndex *fresh = gnc_ledger_index_new ();
+    GHashTable *changes = changes_new ();
+
+    changes_add (changes, xaccTransGetGUID (txn), QOF_EVENT_MODIFY);
+    g_assert_cmpint (gnc_ledger_index_update (fresh, fixture->query, changes),
+                     ==, GNC_LEDGER_INDEX_STALE);
+    gnc_ledger_index_destroy (fresh);
+
+    g_assert_cmpint (gnc_ledger_index_update (fixture->index, fixture->query,
+                                              NULL), ==,
+                     GNC_LEDGER_INDEX_STALE);
+
+    xaccQueryAddClearedMatch (fixture->query, CLEARED_NO, QOF_QUERY_AND);
+    g_assert_cmpint (gnc_ledger_index_update (fixture->index, fixture->query,
+                                              changes), ==,
+                     GNC_LEDGER_INDEX_STALE);
+
+    gnc_ledger_index_reset (fixture->index, fixture->query,
+                            qof_query_run (fixture->query));
+    qof_query_set_max_results (fixture->query, 10);
+    gnc_ledger_index_reset (fixture->index, fixture->query,
+                            qof_query_run (fixture->query));
+    g_assert_cmpint (gnc_ledger_index_update (fixture->index, fixture->query,
+                                              changes), ==,
+                     GNC_LEDGER_INDEX_STALE);
+    g_hash_table_destroy (changes);
+}
+
+/* Time one commit's refresh by re-running the query, as the ledger used
+ * to, and by updating the index, for ledgers of increasing size. The
+ * update should stay roughly flat while the query grows with the book. */
+static void
+test_refresh_cost (void)
+{
+    static const guint sizes[] = { 1000, 4000, 16000 };
+
+    for (guint i = 0; i < G_N_ELEMENTS (sizes); i++)
+    {
+        Fixture fixture;
+        Transaction *txn;
+        gint64 start, query_us, update_us;
+
+        setup_size (&fixture, sizes[i]);
+        txn = nth_trans (&fixture, sizes[i] / 2);
+        xaccTransBeginEdit (txn);
+        xaccTransSetDescription (txn, "Timed");
+        xaccTransCommitEdit (txn);
+
+        start = g_get_monotonic_time ();
+        qof_query_run (fixture.query);
+        query_us = g_get_monotonic_time () - start;
+
+        start = g_get_monotonic_time ();
+        g_assert_cmpint (update_for (&fixture, txn, QOF_EVENT_MODIFY), ==,
+                         GNC_LEDGER_INDEX_UNCHANGED);
+        update_us = g_get_monotonic_time () - start;
+
+        assert_index_matches_query (&fixture);
+        g_test_message ("%u rows: query %" G_GINT64_FORMAT " us, "
+                        "index update %" G_GINT64_FORMAT " us",
+                        sizes[i], query_us, update_us);
+        teardown (&fixture, NULL);
+    }
+}
+
+void
+test_suite_gnc_ledger_index (void)
+{
+    cashobjects_register ();
+
+    GNC_TEST_ADD (suitename, "reset", Fixture, NULL, setup, test_reset, teardown);
+    GNC_TEST_ADD (suitename, "edit in place", Fixture, NULL, setup, test_edit_in_place, teardown);
+    GNC_TEST_ADD (suitename, "date moves row", Fixture, NULL, setup, test_date_moves_row, teardown);
+    GNC_TEST_ADD (suitename, "new transaction", Fixture, NULL, setup, test_new_trans, teardown);
+    GNC_TEST_ADD (suitename, "destroy transaction", Fixture, NULL, setup, test_destroy_trans, teardown);
+    GNC_TEST_ADD (suitename, "split moved out", Fixture, NULL, setup, test_split_moved_out, teardown);
+    GNC_TEST_ADD (suitename, "split added", Fixture, NULL, setup, test_split_added, teardown);
+    GNC_TEST_ADD (suitename, "unrelated change", Fixture, NULL, setup, test_unrelated_change, teardown);
+    GNC_TEST_ADD (suitename, "stale", Fixture, NULL, setup, test_stale, teardown);
+    GNC_TEST_ADD_FUNC (suitename, "refresh cost", test_refresh_cost);
+}
@@ -0,0 +1,306 @@
+/********************************************************************
+ * utest-table-rows.c: GLib g_test test suite for the lazily         *
+ * allocated row data of table-allgui.c.                            *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, you can retrieve it from        *
+ * https://www.gnu.org/licenses/old-licenses/gpl-2.0.html            *
+ * or contact:                                                      *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+ ********************************************************************/
+#include <config.h>
+#include <glib.h>
+#include <unittest-support.h>
+/* Add specific headers for this class */
+#include "table-allgui.h"
+#include "cellblock.h"
+#include "Account.h"
+#include "Transaction.h"
+
+static const gchar *suitename = "/register/ledger-core/table-rows";
+void test_suite_table_rows ( void );
+
+#define NUM_ROWS 10000
+
+/* Allocations made by the table, counted to see how many rows it
+ * allocated data for. */
+static guint allocations;
+
+static gpointer
+guid_alloc (void)
+{
+    GncGUID *guid = guid_malloc ();
+
+    allocations++;
+    *guid = *guid_null ();
+    return guid;
+}
+
+static void
+guid_dealloc (gpointer guid)
+{
+    guid_free (guid);
+}
+
+static void
+guid_copy_data (gpointer to, gconstpointer from)
+{
+    *(GncGUID*)to = from ? *(const GncGUID*)from : *guid_null ();
+}
+
+typedef struct
+{
+    Table *table;
+    CellBlock *cursor;
+    GncGUID *guids;
+} Fixture;
+
+static Table*
+table_new (gboolean lazy)
+{
+    TableModel *model = gnc_table_model_new ();
+
+    model->cell_data_allocator = guid_alloc;
+    model->cell_data_deallocator = guid_dealloc;
+    model->cell_data_copy = guid_copy_data;
+    model->cell_data_size = lazy ? sizeof (GncGUID) : 0;
+
+    return gnc_table_new (gnc_table_layout_new (), model,
+                          gnc_table_control_new ());
+}
+
+static void
+load_rows (Table *table, CellBlock *cursor, const GncGUID *guids, guint n)
+{
+    for (guint i = 0; i < n; i++)
+    {
+        VirtualCellLocation vcell_loc = { i, 0 };
+        gnc_table_set_vcell (table, cursor, &guids[i], TRUE, TRUE, vcell_loc);
+    }
+}
+
+static const GncGUID*
+row_data (Table *table, int row)
+{
+    VirtualCellLocation vcell_loc = { row, 0 };
+    return gnc_table_get_vcell_data (table, vcell_loc);
+}
+
+static void
+setup (Fixture *fixture, gconstpointer pData)
+{
+    fixture->table = table_new (TRUE);
+    fixture->cursor = gnc_cellblock_new (1, 1, "cursor");
+    fixture->guids = g_new (GncGUID, NUM_ROWS);
+    for (guint i = 0; i < NUM_ROWS; i++)
+        guid_replace (&fixture->guids[i]);
+
+    allocations = 0;
+    load_rows (fixture->table, fixture->cursor, fixture->guids, NUM_ROWS);
+}
+
+static void
+teardown (Fixture *fixture, gconstpointer pData)
+{
+    gnc_table_destroy (fixture->table);
+    gnc_cellblock_destroy (fixture->cursor);
+    g_free (fixture->guids);
+}
+
+static void
+test_load_allocates_nothing (Fixture *fixture, gconstpointer pData)
+{
+    g_assert_cmpuint (allocations, ==, 0);
+    g_assert_cmpuint (fixture->table->num_pending, ==, NUM_ROWS);
+    g_assert_cmpint (fixture->table->num_virt_rows, ==, NUM_ROWS);
+}
+
+static void
+test_get_allocates_window (Fixture *fixture, gconstpointer pData)
+{
+    guint pending;
+
+    g_assert_true (guid_equal (row_data (fixture->table, NUM_ROWS / 2),
+                               &fixture->guids[NUM_ROWS / 2]));
+    g_assert_cmpuint (allocations, >, 1);
+    g_assert_cmpuint (allocations, <, NUM_ROWS / 10);
+    g_assert_cmpuint (fixture->table->num_pending, ==, NUM_ROWS - allocations);
+
+    /* The rows around it come with it. */
+    pending = fixture->table->num_pending;
+    g_assert_true (guid_equal (row_data (fixture->table, NUM_ROWS / 2 + 1),
+                               &fixture->guids[NUM_ROWS / 2 + 1]));
+    g_assert_cmpuint (fixture->table->num_pending, ==, pending);
+
+    for (guint i = 0; i < NUM_ROWS; i++)
+        g_assert_true (guid_equal (row_data (fixture->table, i),
+                                   &fixture->guids[i]));
+    g_assert_cmpuint (allocations, ==, NUM_ROWS);
+    g_assert_cmpuint (fixture->table->num_pending, ==, 0);
+}
+
+static void
+test_peek (Fixture *fixture, gconstpointer pData)
+{
+    for (guint i = 0; i < NUM_ROWS; i++)
+    {
+        VirtualCellLocation vcell_loc = { i, 0 };
+        g_assert_true (guid_equal (gnc_table_peek_vcell_data (fixture->table,
+                                                              vcell_loc),
+                                   &fixture->guids[i]));
+    }
+    g_assert_cmpuint (allocations, ==, 0);
+
+    row_data (fixture->table, 0);
+    for (guint i = 0; i < NUM_ROWS; i++)
+    {
+        VirtualCellLocation vcell_loc = { i, 0 };
+        g_assert_true (guid_equal (gnc_table_peek_vcell_data (fixture->table,
+                                                              vcell_loc),
+                                   &fixture->guids[i]));
+    }
+}
+
+static void
+test_reload (Fixture *fixture, gconstpointer pData)
+{
+    guint allocated;
+
+    row_data (fixture->table, 0);
+    allocated = allocations;
+
+    /* Loading the rows in reverse order replaces both the pending and the
+     * allocated data, without allocating any more. */
+    for (guint i = 0; i < NUM_ROWS; i++)
+    {
+        VirtualCellLocation vcell_loc = { i, 0 };
+        gnc_table_set_virt_cell_data (fixture->table, vcell_loc,
+                                      &fixture->guids[NUM_ROWS - 1 - i]);
+    }
+    g_assert_cmpuint (allocations, ==, allocated);
+    g_assert_cmpuint (fixture->table->num_pending, ==, NUM_ROWS - allocated);
+
+    for (guint i = 0; i < NUM_ROWS; i++)
+        g_assert_true (guid_equal (row_data (fixture->table, i),
+                                   &fixture->guids[NUM_ROWS - 1 - i]));
+}
+
+static void
+test_shrink (Fixture *fixture, gconstpointer pData)
+{
+    VirtualCellLocation vcell_loc = { 1, 0 };
+
+    gnc_table_set_size (fixture->table, 2, 1);
+    g_assert_cmpuint (fixture->table->num_pending, ==, 2);
+    g_assert_true (guid_equal (row_data (fixture->table, 1),
+                               &fixture->guids[1]));
+    g_assert_null (row_data (fixture->table, 2));
+    g_assert_cmpuint (fixture->table->num_pending, ==, 0);
+
+    /* Setting NULL data clears it, as the model's copy does. */
+    gnc_table_set_virt_cell_data (fixture->table, vcell_loc, NULL);
+    g_assert_true (guid_equal (row_data (fixture->table, 1), guid_null ()));
+
+    /* Rows that were never set get data when asked for. */
+    gnc_table_set_size (fixture->table, 4, 1);
+    g_assert_true (guid_equal (row_data (fixture->table, 3), guid_null ()));
+}
+
+/* Time loading a large account's splits into a table and getting the
+ * data of its first row, as drawing the register does, with the data
+ * allocated for every row when it's set and only for the rows shown. */
+static void
+test_time_to_first_row (void)
+{
+    static const guint sizes[] = { 10000, 30000, 90000 };
+    QofBook *book = qof_book_new ();
+    gnc_commodity *curr = gnc_commodity_new (book, "Gnu Rand", "CURRENCY",
+                                             "GNR", "", 100);
+    Account *acc1 = xaccMallocAccount (book);
+    Account *acc2 = xaccMallocAccount (book);
+    CellBlock *cursor = gnc_cellblock_new (1, 1, "cursor");
+    guint made = 0;
+
+    xaccAccountSetCommodity (acc1, curr);
+    xaccAccountSetCommodity (acc2, curr);
+
+    for (guint i = 0; i < G_N_ELEMENTS (sizes); i++)
+    {
+        GncGUID *guids;
+        guint n = 0;
+        gint64 times[2];
+
+        xaccAccountBeginEdit (acc1);
+        xaccAccountBeginEdit (acc2);
+        for (; made < sizes[i]; made++)
+        {
+            Transaction *txn = xaccMallocTransaction (book);
+            Split *split1 = xaccMallocSplit (book);
+            Split *split2 = xaccMallocSplit (book);
+
+            xaccTransBeginEdit (txn);
+            xaccTransSetCurrency (txn, curr);
+            xaccTransSetDatePostedSecsNormalized (txn, gnc_dmy2time64 (1, 1, 2020));
+            xaccSplitSetAccount (split1, acc1);
+            xaccSplitSetParent (split1, txn);
+            xaccSplitSetAccount (split2, acc2);
+            xaccSplitSetParent (split2, txn);
+            xaccTransCommitEdit (txn);
+        }
+        xaccAccountCommitEdit (acc2);
+        xaccAccountCommitEdit (acc1);
+
+        guids = g_new (GncGUID, sizes[i]);
+        for (GList *node = xaccAccountGetSplitList (acc1); node; node = node->next)
+            guids[n++] = *xaccSplitGetGUID (node->data);
+
+        for (gint lazy = 0; lazy < 2; lazy++)
+        {
+            Table *table = table_new (lazy);
+            gint64 start = g_get_monotonic_time ();
+
+            allocations = 0;
+            load_rows (table, cursor, guids, n);
+            g_assert_true (xaccSplitLookup (row_data (table, 0), book) != NULL);
+            times[lazy] = g_get_monotonic_time () - start;
+
+            if (lazy)
+                g_assert_cmpuint (allocations, <, 1000);
+            else
+                g_assert_cmpuint (allocations, ==, n);
+            gnc_table_destroy (table);
+        }
+
+        g_test_message ("%u rows: first row after %" G_GINT64_FORMAT " us "
+                        "allocating all rows, %" G_GINT64_FORMAT " us lazily",
+                        n, times[0], times[1]);
+        g_free (guids);
+    }
+
+    gnc_cellblock_destroy (cursor);
+    qof_book_destroy (book);
+}
+
+void
+test_suite_table_rows (void)
+{
+    GNC_TEST_ADD (suitename, "load allocates nothing", Fixture, NULL, setup, test_load_allocates_nothing, teardown);
+    GNC_TEST_ADD (suitename, "get allocates window", Fixture, NULL, setup, test_get_allocates_window, teardown);
+    GNC_TEST_ADD (suitename, "peek", Fixture, NULL, setup, test_peek, teardown);
+    GNC_TEST_ADD (suitename, "reload", Fixture, NULL, setup, test_reload, teardown);
+    GNC_TEST_ADD (suitename, "shrink", Fixture, NULL, setup, test_shrink, teardown);
+    GNC_TEST_ADD_FUNC (suitename, "time to first row", test_time_to_first_row);
+}
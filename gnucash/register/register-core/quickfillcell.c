@@ -165,7 +165,7 @@ gnc_quickfill_cell_modify_verify (BasicCell *_cell,
 {
     QuickFillCell *cell = (QuickFillCell *) _cell;
     const char *match_str;
-    QuickFill *match;
+    QuickFillMatch match;
 
     glong newval_chars;
     newval_chars = g_utf8_strlen(newval, newval_len);
@@ -49,6 +49,11 @@
 
 static TableGUIHandlers default_gui_handlers;
 
+/* How many rows either side of a row being looked at have their data
+ * allocated with it. Enough for a screenful, so drawing the rows shown
+ * allocates their data in one go. */
+#define VCELL_DATA_MARGIN 64
+
 /* This static indicates the debugging module that this .o belongs to. */
 static QofLogModule log_module = GNC_MOD_REGISTER;
 
@@ -111,6 +116,8 @@ gnc_table_init (Table * table)
     /* initialize private data */
 
     table->virt_cells = NULL;
+    table->pending_data = NULL;
+    table->num_pending = 0;
     table->ui_data = NULL;
 }
 
@@ -126,6 +133,8 @@ gnc_table_destroy (Table * table)
 
     /* free the cell tables */
     g_table_destroy (table->virt_cells);
+    if (table->pending_data)
+        g_array_free (table->pending_data, TRUE);
 
     gnc_table_layout_destroy (table->layout);
     table->layout = NULL;
@@ -621,6 +630,15 @@ gnc_virtual_location_init (VirtualLocation *vloc)
     vloc->vcell_loc.virt_col = -1;
 }
 
+static gboolean
+gnc_table_defers_data (Table *table)
+{
+    TableModel *model = table->model;
+
+    return model->cell_data_size > 0 && model->cell_data_allocator &&
+           model->cell_data_copy;
+}
+
 static void
 gnc_virtual_cell_construct (gpointer _vcell, gpointer user_data)
 {
@@ -629,12 +647,34 @@ gnc_virtual_cell_construct (gpointer _vcell, gpointer user_data)
 
     vcell->cellblock = NULL;
 
-    if (table && table->model->cell_data_allocator)
+    /* Tables that defer their data allocate it when it's set or used. */
+    if (table && table->model->cell_data_allocator &&
+        !gnc_table_defers_data (table))
         vcell->vcell_data = table->model->cell_data_allocator ();
     else
         vcell->vcell_data = NULL;
 
     vcell->visible = 1;
+    vcell->data_pending = 0;
+}
+
+static gpointer
+gnc_table_pending_data (Table *table, VirtualCell *vcell)
+{
+    guint index = GPOINTER_TO_UINT (vcell->vcell_data);
+
+    return &table->pending_data->data[index * table->model->cell_data_size];
+}
+
+static void
+gnc_table_release_pending (Table *table, VirtualCell *vcell)
+{
+    vcell->vcell_data = NULL;
+    vcell->data_pending = 0;
+
+    /* Once no cell refers to the array, start it over. */
+    if (--table->num_pending == 0)
+        g_array_set_size (table->pending_data, 0);
 }
 
 static void
@@ -643,12 +683,91 @@ gnc_virtual_cell_destroy (gpointer _vcell, gpointer user_data)
     VirtualCell *vcell = _vcell;
     Table *table = user_data;
 
+    if (vcell->data_pending)
+    {
+        gnc_table_release_pending (table, vcell);
+        return;
+    }
+
     if (vcell->vcell_data && table && table->model->cell_data_deallocator)
         table->model->cell_data_deallocator (vcell->vcell_data);
 
     vcell->vcell_data = NULL;
 }
 
+/* Allocate a cell's data, copying in its pending data if it has any. */
+static void
+gnc_table_materialize_vcell (Table *table, VirtualCell *vcell)
+{
+    gpointer data;
+
+    if (!vcell->data_pending)
+    {
+        if (!vcell->vcell_data && table->model->cell_data_allocator)
+            vcell->vcell_data = table->model->cell_data_allocator ();
+        return;
+    }
+
+    data = table->model->cell_data_allocator ();
+    table->model->cell_data_copy (data, gnc_table_pending_data (table, vcell));
+    gnc_table_release_pending (table, vcell);
+    vcell->vcell_data = data;
+}
+
+/* Allocate the data of the rows around a row, which are likely to be
+ * looked at soon if it is. */
+static void
+gnc_table_materialize_rows (Table *table, int virt_row)
+{
+    int first = MAX (0, virt_row - VCELL_DATA_MARGIN);
+    int last = MIN (table->num_virt_rows - 1, virt_row + VCELL_DATA_MARGIN);
+
+    for (int row = first; row <= last && table->num_pending > 0; row++)
+        for (int col = 0; col < table->num_virt_cols; col++)
+        {
+            VirtualCell *vcell = g_table_index (table->virt_cells, row, col);
+
+            if (vcell && vcell->data_pending)
+                gnc_table_materialize_vcell (table, vcell);
+        }
+}
+
+/* Copy data into a cell. Cells of tables that defer their data which
+ * don't have it allocated yet get it put in the pending array. */
+static void
+gnc_table_copy_vcell_data (Table *table, VirtualCell *vcell,
+                           gconstpointer vcell_data)
+{
+    TableModel *model = table->model;
+
+    if (!model->cell_data_copy)
+    {
+        vcell->vcell_data = (gpointer) vcell_data;
+        return;
+    }
+
+    if (vcell_data && gnc_table_defers_data (table) &&
+        (vcell->data_pending || !vcell->vcell_data))
+    {
+        if (!vcell->data_pending)
+        {
+            if (!table->pending_data)
+                table->pending_data = g_array_new (FALSE, FALSE,
+                                                   model->cell_data_size);
+            g_array_set_size (table->pending_data, table->pending_data->len + 1);
+            vcell->vcell_data = GUINT_TO_POINTER (table->pending_data->len - 1);
+            vcell->data_pending = 1;
+            table->num_pending++;
+        }
+        memcpy (gnc_table_pending_data (table, vcell), vcell_data,
+                model->cell_data_size);
+        return;
+    }
+
+    gnc_table_materialize_vcell (table, vcell);
+    model->cell_data_copy (vcell->vcell_data, vcell_data);
+}
+
 static void
 gnc_table_resize (Table * table, int new_virt_rows, int new_virt_cols)
 {
@@ -687,10 +806,7 @@ gnc_table_set_vcell (Table *table,
     vcell->cellblock = cursor;
 
     /* copy the vcell user data */
-    if (table->model->cell_data_copy)
-        table->model->cell_data_copy (vcell->vcell_data, vcell_data);
-    else
-        vcell->vcell_data = (gpointer) vcell_data;
+    gnc_table_copy_vcell_data (table, vcell, vcell_data);
 
     vcell->visible = visible ? 1 : 0;
     vcell->start_primary_color = start_primary_color ? 1 : 0;
@@ -710,10 +826,7 @@ gnc_table_set_virt_cell_data (Table *table,
     if (vcell == NULL)
         return;
 
-    if (table->model->cell_data_copy)
-        table->model->cell_data_copy (vcell->vcell_data, vcell_data);
-    else
-        vcell->vcell_data = (gpointer) vcell_data;
+    gnc_table_copy_vcell_data (table, vcell, vcell_data);
 }
 
 void
@@ -939,6 +1052,28 @@ gnc_table_get_vcell_data (Table *table, VirtualCellLocation vcell_loc)
     if (vcell == NULL)
         return NULL;
 
+    if (vcell->data_pending)
+        gnc_table_materialize_rows (table, vcell_loc.virt_row);
+    else if (!vcell->vcell_data)
+        gnc_table_materialize_vcell (table, vcell);
+
+    return vcell->vcell_data;
+}
+
+gconstpointer
+gnc_table_peek_vcell_data (Table *table, VirtualCellLocation vcell_loc)
+{
+    VirtualCell *vcell;
+
+    if (!table) return NULL;
+
+    vcell = gnc_table_get_virtual_cell (table, vcell_loc);
+    if (vcell == NULL)
+        return NULL;
+
+    if (vcell->data_pending)
+        return gnc_table_pending_data (table, vcell);
+
     return vcell->vcell_data;
 }
 
@@ -132,11 +132,13 @@ physical row 11   virtual row 9   B
 typedef struct
 {
     CellBlock *cellblock;  /** Array of physical cells */
-    gpointer   vcell_data; /** Used by higher-level code */
+    gpointer   vcell_data; /** Used by higher-level code, which should
+                            *  read it with gnc_table_get_vcell_data */
 
     /* flags */
     unsigned int visible : 1;             /** visible in the GUI */
     unsigned int start_primary_color : 1; /** color usage flag */
+    unsigned int data_pending : 1;        /** vcell_data not yet allocated */
 } VirtualCell;
 
 typedef struct table Table;
@@ -174,6 +176,11 @@ struct table
     /* The virtual cell table */
     GTable *virt_cells;
 
+    /* Data of the virtual cells whose vcell_data hasn't been allocated
+     * yet. A pending cell's vcell_data is its index in the array. */
+    GArray *pending_data;
+    guint num_pending;
+
     TableGUIHandlers gui_handlers;
     gpointer ui_data;
 };
@@ -317,10 +324,22 @@ gboolean    gnc_table_verify_cursor_position (Table *table,
         VirtualLocation virt_loc);
 
 /** returns the virtual cell data associated with a cursor located at the given
- * virtual coords, or NULL if the coords are out of bounds. */
+ * virtual coords, or NULL if the coords are out of bounds.
+ *
+ * If the model sets cell_data_size, the data of a row is only allocated
+ * when it is first asked for, together with the rows around it, so that
+ * loading a large table only allocates the data of the rows shown. Code
+ * must therefore use this function rather than reading vcell_data. */
 gpointer    gnc_table_get_vcell_data (Table *table,
                                       VirtualCellLocation vcell_loc);
 
+/** returns the virtual cell data at the given coords like
+ * gnc_table_get_vcell_data, but without allocating it, for looking
+ * through many rows. The data is only valid until the table is next
+ * changed. */
+gconstpointer gnc_table_peek_vcell_data (Table *table,
+                                         VirtualCellLocation vcell_loc);
+
 /** Find a close valid cell. If exact_cell is true, cells that must
  * be explicitly selected by the user (as opposed to just tabbing
  * into), are considered valid cells. */
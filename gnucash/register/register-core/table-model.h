@@ -142,6 +142,11 @@ typedef struct
     VirtCellDataAllocator cell_data_allocator;
     VirtCellDataDeallocator cell_data_deallocator;
     VirtCellDataCopy cell_data_copy;
+
+    /* If positive, the cell data is this many bytes that can be copied
+     * with memcpy, and the table keeps the data of rows that haven't been
+     * looked at yet in one array instead of allocating it for each row. */
+    gsize cell_data_size;
 } TableModel;
 
 
@@ -659,7 +659,7 @@ gnc_combo_cell_type_ahead_search (const gchar* newval,
 static char*
 quickfill_match (QuickFill *qf, const char *string)
 {
-    QuickFill *match = gnc_quickfill_get_string_match (qf, string);
+    QuickFillMatch match = gnc_quickfill_get_string_match (qf, string);
     return g_strdup (gnc_quickfill_string (match));
 }
 
@@ -776,7 +776,7 @@ gnc_combo_cell_direct_update (BasicCell* bcell,
     gboolean keep_on_going = FALSE;
     gboolean extra_colon;
     gunichar unicode_value;
-    QuickFill* match;
+    QuickFillMatch match;
     const char* match_str;
     int prefix_len;
     int find_pos;
@@ -814,12 +814,12 @@ gnc_combo_cell_direct_update (BasicCell* bcell,
 
         match = gnc_quickfill_get_string_len_match
                 (box->qf, bcell->value, *cursor_position);
-        if (match == NULL)
+        if (match.node == NULL)
             return TRUE;
 
         match = gnc_quickfill_get_unique_len_match
                 (match, &prefix_len);
-        if (match == NULL)
+        if (match.node == NULL)
             return TRUE;
 
         match_str = gnc_quickfill_string (match);
@@ -897,14 +897,14 @@ gnc_combo_cell_direct_update (BasicCell* bcell,
 
     match = gnc_quickfill_get_string_len_match (box->qf,
                                                 bcell->value, new_pos);
-    if (match == NULL)
+    if (match.node == NULL)
         return FALSE;
 
     if (extra_colon)
     {
         match = gnc_quickfill_get_char_match (match,
                                               box->complete_char);
-        if (match == NULL)
+        if (match.node == NULL)
             return FALSE;
 
         new_pos++;
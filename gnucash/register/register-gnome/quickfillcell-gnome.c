@@ -46,7 +46,7 @@ gnc_quickfill_cell_direct_update (BasicCell *bcell,
     QuickFillCell *cell = (QuickFillCell *) bcell;
     GdkEventKey *event = gui_data;
     const char *match_str;
-    QuickFill *match;
+    QuickFillMatch match;
     int prefix_len;
 
     if (event->type != GDK_KEY_PRESS)
@@ -77,11 +77,11 @@ gnc_quickfill_cell_direct_update (BasicCell *bcell,
     match = gnc_quickfill_get_string_len_match (cell->qf, bcell->value,
             *cursor_position);
 
-    if (match == NULL)
+    if (match.node == NULL)
         return TRUE;
 
     match = gnc_quickfill_get_unique_len_match (match, &prefix_len);
-    if (match == NULL)
+    if (match.node == NULL)
         return TRUE;
 
     match_str = gnc_quickfill_string (match);
@@ -36,11 +36,20 @@
 #include <string.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <locale.h>
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
 
 #include <gfec.h>
 #include <gnc-filepath-utils.h>
 #include <gnc-guile-utils.h>
 #include <gnc-engine.h>
+#include <gnc-prefs.h>
+#include <gnc-session.h>
+#include <gnc-ui-util.h>
+#include <gnc-uri-utils.h>
 #include "gnc-report.h"
 
 extern "C" SCM scm_init_sw_report_module(void);
@@ -51,6 +60,23 @@ static QofLogModule log_module = GNC_MOD_GUI;
 static GHashTable *reports = NULL;
 static gint report_next_serial_id = 0;
 
+#define GNC_PREF_REPORT_CACHE_ON_DISK "cache-on-disk"
+
+/* Rendered report output, so that running a report again when neither its
+ * options nor the book have changed doesn't evaluate it again. Entries are
+ * keyed by a digest of the caller's key, the book's GUID, today's date
+ * (options may be relative to today) and the display preferences, and hold
+ * the book's mutation count at the time they were stored.
+ */
+struct ReportCacheEntry
+{
+    guint64 mutation_count;
+    std::string html;
+};
+
+static std::unordered_map<std::string, ReportCacheEntry> report_cache;
+static constexpr size_t REPORT_CACHE_MAX_ENTRIES = 64;
+
 static gboolean
 try_load_config_array(const gchar *fns[])
 {
@@ -207,6 +233,220 @@ gnc_reports_get_global(void)
     return reports;
 }
 
+/* The preferences reports format their output with, which the options in
+ * the caller's key don't cover. */
+static std::string
+report_cache_settings (void)
+{
+    static const char* prefs[] =
+    {
+        GNC_PREF_NEGATIVE_IN_RED, GNC_PREF_ACCOUNTING_LABELS,
+        GNC_PREF_REVERSED_ACCTS_CREDIT, GNC_PREF_REVERSED_ACCTS_INC_EXP,
+        GNC_PREF_PRICES_FORCE_DECIMAL
+    };
+    auto locale = setlocale (LC_ALL, NULL);
+    std::string settings{locale ? locale : ""};
+
+    settings += "\n" + std::to_string (qof_date_format_get ()) + "\n";
+    settings += gnc_get_account_separator_string ();
+    settings += "\n";
+    for (auto pref : prefs)
+        settings += gnc_prefs_get_bool (GNC_PREFS_GROUP_GENERAL, pref) ? '1' : '0';
+    return settings;
+}
+
+static std::string
+report_cache_digest (QofBook *book, const gchar *key)
+{
+    auto checksum = g_checksum_new (G_CHECKSUM_SHA256);
+    auto guid = qof_entity_get_guid (QOF_INSTANCE (book));
+    auto today = gnc_time64_get_today_start ();
+    auto settings = report_cache_settings ();
+
+    g_checksum_update (checksum, guid->reserved, GUID_DATA_SIZE);
+    g_checksum_update (checksum, reinterpret_cast<const guchar*>(&today),
+                       sizeof (today));
+    g_checksum_update (checksum,
+                       reinterpret_cast<const guchar*>(settings.c_str ()),
+                       settings.size ());
+    g_checksum_update (checksum, reinterpret_cast<const guchar*>(key), -1);
+
+    std::string digest{g_checksum_get_string (checksum)};
+    g_checksum_free (checksum);
+    return digest;
+}
+
+/* The mutation count starts again from zero each time a book is loaded, so
+ * on-disk entries are instead tied to the size and modification time of the
+ * data file and are only used while the book has no unsaved changes. The XML
+ * backend's autosave appends to a journal beside the data file and marks the
+ * book saved without touching the file, so the journal is stamped too; it's
+ * left zeroed when there isn't one.
+ * Returns the cache directory, or NULL if the disk cache can't be used.
+ */
+static gchar*
+report_cache_dir (QofBook *book, GStatBuf *book_stat, GStatBuf *journal_stat)
+{
+    if (!gnc_prefs_get_bool (GNC_PREFS_GROUP_GENERAL_REPORT,
+                             GNC_PREF_REPORT_CACHE_ON_DISK))
+        return NULL;
+    if (!gnc_current_session_exist () || qof_book_session_not_saved (book))
+        return NULL;
+
+    auto url = qof_session_get_url (gnc_get_current_session ());
+    if (!url || !gnc_uri_targets_local_fs (url))
+        return NULL;
+
+    auto path = gnc_uri_get_path (url);
+    gchar *dir = NULL;
+    if (path && g_stat (path, book_stat) == 0)
+    {
+        auto journal = g_strconcat (path, ".journal", NULL);
+        if (g_stat (journal, journal_stat) != 0)
+            memset (journal_stat, 0, sizeof (*journal_stat));
+        g_free (journal);
+        dir = g_strconcat (path, ".reports-cache", NULL);
+    }
+    g_free (path);
+    return dir;
+}
+
+static std::string
+report_cache_stamp (const GStatBuf& book_stat, const GStatBuf& journal_stat)
+{
+    return std::to_string (book_stat.st_size) + " " +
+        std::to_string (book_stat.st_mtime) + " " +
+        std::to_string (journal_stat.st_size) + " " +
+        std::to_string (journal_stat.st_mtime) + "\n";
+}
+
+/* Entries written before the data file or its journal last changed can't
+ * match them any more, so remove them rather than let the directory grow. */
+static void
+report_cache_prune_dir (const gchar *dir, const GStatBuf& book_stat,
+                        const GStatBuf& journal_stat)
+{
+    auto saved = std::max (book_stat.st_mtime, journal_stat.st_mtime);
+    auto gdir = g_dir_open (dir, 0, NULL);
+    if (!gdir)
+        return;
+
+    while (auto name = g_dir_read_name (gdir))
+    {
+        if (!g_str_has_suffix (name, ".html"))
+            continue;
+        auto filename = g_build_filename (dir, name, NULL);
+        GStatBuf entry_stat;
+        if (g_stat (filename, &entry_stat) == 0 &&
+            entry_stat.st_mtime < saved)
+            g_unlink (filename);
+        g_free (filename);
+    }
+    g_dir_close (gdir);
+}
+
+gchar*
+gnc_report_cache_lookup (const gchar *key)
+{
+    g_return_val_if_fail (key, NULL);
+
+    auto book = gnc_get_current_book ();
+    auto digest = report_cache_digest (book, key);
+    auto mutation_count = qof_book_get_mutation_count (book);
+
+    auto iter = report_cache.find (digest);
+    if (iter != report_cache.end ())
+    {
+        if (iter->second.mutation_count == mutation_count)
+            return g_strdup (iter->second.html.c_str ());
+        report_cache.erase (iter);
+    }
+
+    GStatBuf book_stat, journal_stat;
+    auto dir = report_cache_dir (book, &book_stat, &journal_stat);
+    if (!dir)
+        return NULL;
+
+    auto filename = g_build_filename (dir, (digest + ".html").c_str (), NULL);
+    gchar *contents = NULL, *html = NULL;
+    if (g_file_get_contents (filename, &contents, NULL, NULL))
+    {
+        auto stamp = report_cache_stamp (book_stat, journal_stat);
+        if (g_str_has_prefix (contents, stamp.c_str ()))
+        {
+            html = g_strdup (contents + stamp.size ());
+            report_cache[digest] = { mutation_count, html };
+        }
+    }
+    g_free (contents);
+    g_free (filename);
+    g_free (dir);
+    return html;
+}
+
+void
+gnc_report_cache_store (const gchar *key, const gchar *html)
+{
+    g_return_if_fail (key && html);
+
+    auto book = gnc_get_current_book ();
+    auto digest = report_cache_digest (book, key);
+
+    if (report_cache.size () >= REPORT_CACHE_MAX_ENTRIES)
+        report_cache.clear ();
+    report_cache[digest] = { qof_book_get_mutation_count (book), html };
+
+    GStatBuf book_stat, journal_stat;
+    auto dir = report_cache_dir (book, &book_stat, &journal_stat);
+    if (!dir)
+        return;
+
+    if (g_mkdir_with_parents (dir, 0700) == 0)
+    {
+        report_cache_prune_dir (dir, book_stat, journal_stat);
+
+        auto filename = g_build_filename (dir, (digest + ".html").c_str (),
+                                          NULL);
+        auto contents = report_cache_stamp (book_stat, journal_stat) + html;
+        GError *error = NULL;
+        if (!g_file_set_contents (filename, contents.c_str (),
+                                  contents.size (), &error))
+        {
+            PWARN ("Unable to write report cache file %s: %s", filename,
+                   error->message);
+            g_error_free (error);
+        }
+        g_free (filename);
+    }
+    g_free (dir);
+}
+
+void
+gnc_report_cache_remove (const gchar *key)
+{
+    g_return_if_fail (key);
+
+    auto book = gnc_get_current_book ();
+    auto digest = report_cache_digest (book, key);
+    report_cache.erase (digest);
+
+    GStatBuf book_stat, journal_stat;
+    auto dir = report_cache_dir (book, &book_stat, &journal_stat);
+    if (!dir)
+        return;
+
+    auto filename = g_build_filename (dir, (digest + ".html").c_str (), NULL);
+    g_unlink (filename);
+    g_free (filename);
+    g_free (dir);
+}
+
+void
+gnc_report_cache_clear (void)
+{
+    report_cache.clear ();
+}
+
 gboolean
 gnc_run_report_with_error_handling (gint report_id, gchar ** data, gchar **errmsg)
 {
@@ -50,6 +50,37 @@ gboolean gnc_run_report_id_string_with_error_handling(const char* id_string,
                                                       char** data,
                                                       gchar** errmsg);
 
+/** Look up the cached output of a report.
+ *
+ *  An entry is only returned while nothing in the current book has been
+ *  committed since it was stored, only on the day it was stored and only
+ *  while the preferences reports format their output with are unchanged.
+ *
+ *  @param key Text identifying the report and all of its option values.
+ *  @return a caller-owned copy of the html, or NULL if there is none.
+ */
+gchar* gnc_report_cache_lookup(const gchar* key);
+
+/** Store the output of a report in the cache.
+ *
+ *  If the cache-on-disk preference is set and the book has no unsaved
+ *  changes the output is also written next to the book's data file.
+ *
+ *  @param key Text identifying the report and all of its option values.
+ *  @param html The rendered report.
+ */
+void gnc_report_cache_store(const gchar* key, const gchar* html);
+
+/** Discard the cached output of a report, in memory and on disk, so that
+ *  it's run again the next time, as an explicit reload asks.
+ *
+ *  @param key Text identifying the report and all of its option values.
+ */
+void gnc_report_cache_remove(const gchar* key);
+
+/** Discard all cached report output held in memory. */
+void gnc_report_cache_clear(void);
+
 /**
  * @param report The SCM version of the report.
  * @return a caller-owned copy of the name of the report, or NULL if report
@@ -118,6 +118,7 @@
 (export gnc:report-to-template-new)
 (export gnc:report-to-template-update)
 (export gnc:report-type)
+(export gnc:report-uncache!)
 (export gnc:restore-report-by-guid-with-custom-template)
 
 ;; Terminology in this file:
@@ -734,20 +735,52 @@ not found.")))
 ;; returns the html string.
 ;; Now accepts either an html-doc or finished HTML from the renderer -
 ;; the former requires further processing, the latter is just returned.
+(define (gnc:report-cache-key report headers?)
+  ;; text identifying everything the rendered report depends on other
+  ;; than the book and today's date, or #f if it can't be cached. reports
+  ;; embedding other reports aren't cached because their output also
+  ;; depends on the options of the embedded reports.
+  (let ((options (gnc:report-options report))
+        (stylesheet (gnc:report-stylesheet report)))
+    (and (null? (or (gnc:report-embedded-list options) '()))
+         (string-append
+          (gnc:report-type report) (if headers? "\n#t\n" "\n#f\n")
+          (gnc:generate-restore-forms options "options")
+          (if stylesheet
+              (gnc:generate-restore-forms
+               (gnc:html-style-sheet-options stylesheet) "options")
+              "")))))
+
+(define (gnc:report-uncache! report)
+  ;; drops the stored output of the report so that it's run again, as an
+  ;; explicit reload asks.
+  (for-each
+   (lambda (headers?)
+     (let ((cache-key (gnc:report-cache-key report headers?)))
+       (if cache-key (gnc-report-cache-remove cache-key))))
+   '(#t #f)))
+
 (define (gnc:report-render-html report headers?)
   (if (and (not (gnc:report-dirty? report))
            (gnc:report-ctext report))
       (gnc:report-ctext report)
       (let ((template (hash-ref *gnc:_report-templates_* (gnc:report-type report))))
         (and template
-             (let* ((renderer (gnc:report-template-renderer template))
+             (let* ((cache-key (gnc:report-cache-key report headers?))
+                    (cached (and cache-key (gnc-report-cache-lookup cache-key)))
+                    (renderer (gnc:report-template-renderer template))
                     (stylesheet (gnc:report-stylesheet report))
-                    (doc (renderer report))
                     (html (cond
-                           ((string? doc) doc)
+                           ((and cached (not (string-null? cached))) cached)
                            (else
-                            (gnc:html-document-set-style-sheet! doc stylesheet)
-                            (gnc:html-document-render doc headers?)))))
+                            (let ((doc (renderer report)))
+                              (cond
+                               ((string? doc) doc)
+                               (else
+                                (gnc:html-document-set-style-sheet! doc stylesheet)
+                                (gnc:html-document-render doc headers?))))))))
+               (if (and cache-key (not (eq? html cached)))
+                   (gnc-report-cache-store cache-key html))
                (gnc:report-set-ctext! report html) ;; cache the html
                (gnc:report-set-dirty?! report #f)  ;; mark it clean
                html)))))
@@ -56,6 +56,7 @@
 (export gnc:account-accumulate-at-dates)
 (export gnc:account-get-balance-at-date)
 (export gnc:account-get-balances-at-dates)
+(export gnc:accounts-get-balances-at-dates)
 (export gnc:account-get-comm-balance-at-date)
 (export gnc:account-get-comm-value-interval)
 (export gnc:account-get-comm-value-at-date)
@@ -445,12 +446,33 @@
   (define (amount->monetary bal)
     (gnc:make-gnc-monetary (xaccAccountGetCommodity account) (or bal 0)))
   (define balance 0)
-  (map amount->monetary
-       (gnc:account-accumulate-at-dates
-        account dates-list #:split->elt
-        (lambda (s)
-          (if s (set! balance (+ balance (or (split->amount s) 0))))
-          balance))))
+  (if (eq? split->amount xaccSplitGetAmount)
+      (car (gnc:accounts-get-balances-at-dates (list account) dates-list))
+      (map amount->monetary
+           (gnc:account-accumulate-at-dates
+            account dates-list #:split->elt
+            (lambda (s)
+              (if s (set! balance (+ balance (or (split->amount s) 0))))
+              balance)))))
+
+;; the native batch version of gnc:account-get-balances-at-dates. the
+;; engine computes all balances in one pass per account.
+;; in:  accounts - list of accounts
+;;      dates-list (list of time64) - NOTE: IT WILL BE SORTED
+;;      include-closing? - #f to skip closing transactions
+;;      report-commodity - if set, balances are converted to this
+;;      commodity with the price nearest before each date
+;; out: (list (list acc0-bal0 acc0-bal1 ...) (list acc1-bal0 ...) ...),
+;;      each entry is a gnc-monetary object
+(define* (gnc:accounts-get-balances-at-dates
+          accounts dates-list #:key (include-closing? #t) (report-commodity #f))
+  (map
+   (lambda (acc balances)
+     (let ((comm (or report-commodity (xaccAccountGetCommodity acc))))
+       (map (lambda (bal) (gnc:make-gnc-monetary comm (or bal 0))) balances)))
+   accounts
+   (gnc-scm-accounts-get-balances-at-dates
+    accounts (sort dates-list <) include-closing? report-commodity)))
 
 
 ;; this function will scan through account splitlist, building a list
@@ -517,12 +539,13 @@
                         (if include-children?
                             (gnc-account-get-descendants account)
                             '()))))
+    ;; xaccAccountGetBalanceAsOfDate excludes splits posted at date
     (for-each
-     (lambda (acct)
-       (balance-collector 'add
-                          (xaccAccountGetCommodity acct)
-                          (xaccAccountGetBalanceAsOfDate acct date)))
-     accounts)
+     (match-lambda
+       ((mon) (balance-collector 'add
+                                 (gnc:gnc-monetary-commodity mon)
+                                 (gnc:gnc-monetary-amount mon))))
+     (gnc:accounts-get-balances-at-dates accounts (list (1- date))))
     balance-collector))
 
 ;; Calculate the increase in the balance of the account in terms of
@@ -40,5 +40,11 @@ gint gnc_report_add(SCM report);
 %newobject gnc_get_default_report_font_family;
 gchar* gnc_get_default_report_font_family();
 
+%newobject gnc_report_cache_lookup;
+gchar* gnc_report_cache_lookup (const gchar* key);
+void gnc_report_cache_store (const gchar* key, const gchar* html);
+void gnc_report_cache_remove (const gchar* key);
+void gnc_report_cache_clear (void);
+
 void gnc_saved_reports_backup (void);
 gboolean gnc_saved_reports_write_to_file (const gchar* report_def, gboolean overwrite);
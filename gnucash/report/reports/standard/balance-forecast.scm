@@ -169,10 +169,7 @@ date point, a projected minimum balance including scheduled transactions."))
                         to-date #f #f))
           (iso-date (qof-date-format-get-string QOF-DATE-FORMAT-ISO))
           (accounts-balancelist
-           (map
-            (lambda (acc)
-              (gnc:account-get-balances-at-dates acc (map cadr intervals)))
-            accounts)))
+           (gnc:accounts-get-balances-at-dates accounts (map cadr intervals))))
 
     (cond
      ((null? accounts)
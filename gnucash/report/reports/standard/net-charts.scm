@@ -217,17 +217,12 @@
                  GNC-RND-ROUND)))
        0 (c 'format gnc:make-gnc-monetary #f)))
 
-    ;; gets an account alist balances
-    ;; output: (list acc bal0 bal1 bal2 ...)
-    (define (account->balancelist account)
-      (let ((comm (xaccAccountGetCommodity account)))
-        (cons account
-              (gnc:account-accumulate-at-dates
-               account dates-list
-               #:split->elt (lambda (s)
-                              (gnc:make-gnc-monetary
-                               comm (xaccSplitGetNoclosingBalance s)))
-               #:nosplit->elt (gnc:make-gnc-monetary comm 0)))))
+    ;; gets the accounts' alist balances
+    ;; output: (list (list acc bal0 bal1 bal2 ...) ...)
+    (define (accounts->balancelists accounts)
+      (map cons accounts
+           (gnc:accounts-get-balances-at-dates
+            accounts dates-list #:include-closing? #f)))
 
     ;; This calculates the balances for all the 'account-balances' for
     ;; each element of the list 'dates'. Uses the collector->report-currency-amount
@@ -289,7 +284,7 @@
 
     (if
      (not (null? accounts))
-     (let* ((account-balancelist (map account->balancelist accounts))
+     (let* ((account-balancelist (accounts->balancelists accounts))
             (dummy (gnc:report-percent-done 60))
 
             (minuend-balances (process-datelist account-balancelist dates-list #t))
@@ -657,6 +657,20 @@
         '(("USD" . 0) ("USD" . 18) ("USD" . 18) ("USD" . 18))
         (map monetary->pair (gnc:account-get-balances-at-dates bank4 dates)))
 
+      (test-equal "gnc:accounts-get-balances-at-dates"
+        '((("USD" . 0) ("USD" . 10) ("USD" . 30) ("USD" . 150))
+          (("USD" . 32) ("USD" . 32) ("USD" . 73) ("USD" . 73))
+          (("USD" . 0) ("USD" . 0) ("USD" . 0) ("USD" . 14)))
+        (map (lambda (l) (map monetary->pair l))
+             (gnc:accounts-get-balances-at-dates
+              (list bank1 bank2 bank3) (reverse dates))))
+
+      (test-equal "gnc:accounts-get-balances-at-dates, excluding closing"
+        '((("USD" . 0) ("USD" . 10) ("USD" . 30) ("USD" . 70)))
+        (map (lambda (l) (map monetary->pair l))
+             (gnc:accounts-get-balances-at-dates
+              (list bank1) dates #:include-closing? #f)))
+
       (test-equal "1 txn in each slot"
         '(#f 10 30 150)
         (gnc:account-accumulate-at-dates bank1 dates))
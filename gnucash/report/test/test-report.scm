@@ -1,3 +1,4 @@
+(use-modules (gnucash engine))
 (use-modules (gnucash app-utils))
 (use-modules (gnucash report))
 (use-modules (srfi srfi-64))
@@ -18,6 +19,7 @@
   (test-report-template-getters)
   (test-make-report)
   (test-report)
+  (test-report-cache)
   (test-end "Testing/Temporary/test-report"))
 
 (define test4-guid "54c2fc051af64a08ba2334c2e9179e24")
@@ -232,3 +234,49 @@
     (test-assert "gnc:report-serialize = string"
       (string?
        (gnc:report-serialize report)))))
+
+(define (test-report-cache)
+  (define test-uuid "cached-report-guid")
+  (define renders 0)
+  (test-begin "test-report-cache")
+  (gnc:define-report
+   'version 1
+   'name "cached report"
+   'report-guid test-uuid
+   'options-generator gnc:new-options
+   'renderer (lambda (obj)
+               (set! renders (1+ renders))
+               (format #f "render ~a" renders)))
+  (let* ((constructor (record-constructor <report>))
+         (options (gnc:make-report-options test-uuid))
+         (report (constructor test-uuid "bar" options #t #t #f #f ""))
+         (render (lambda ()
+                   (gnc:report-set-dirty?! report #t)
+                   (gnc:report-render-html report #t))))
+    (gnc-report-cache-clear)
+    (test-equal "first render runs the report"
+      "render 1"
+      (render))
+    (test-equal "unchanged book hits the cache"
+      "render 1"
+      (render))
+    (test-equal "cache hit doesn't run the report"
+      1
+      renders)
+    (env-create-root-account (create-test-env) ACCT-TYPE-ASSET
+                             (gnc-default-report-currency))
+    (test-equal "changed book misses the cache"
+      "render 2"
+      (render))
+    (test-equal "and is stored again"
+      "render 2"
+      (render))
+    (gnc:report-uncache! report)
+    (test-equal "reload misses the cache"
+      "render 3"
+      (render))
+    (gnc-report-cache-clear)
+    (test-equal "cleared cache misses"
+      "render 4"
+      (render)))
+  (test-end "test-report-cache"))
@@ -23,8 +23,10 @@
  *                                                                  *
 \********************************************************************/
 
+
 #include <config.h>
 
+#include <stdlib.h>
 #include <string.h>
 
 #include "QuickFill.h"
@@ -32,20 +34,30 @@
 #include "gnc-ui-util.h"
 
 
+/* The quickfill is a radix tree over the upper-cased characters of
+ * its strings.  Each node stands for the prefix spelt out by the
+ * edges from the root to it, and chains of nodes that would each
+ * have a single child are collapsed into one edge.  Edges always
+ * start and end on a character.  A prefix that ends inside an edge
+ * is matched by the node below it and its offset into the edge, so
+ * looking one up never changes the tree; only inserting splits an
+ * edge. */
 struct _QuickFill
 {
-    char *text;          /* the first matching text string     */
-    int len;             /* number of chars in text string     */
-    GHashTable *matches; /* array of children in the tree      */
+    const char *text;    /* the first matching text string, cached */
+    QuickFill *child;    /* first child, ordered by their edges    */
+    QuickFill *next;     /* next sibling                           */
+    guint edge_len;      /* number of bytes in the edge            */
+    char edge[];         /* the edge from the parent to this node  */
 };
 
-
-/** PROTOTYPES ******************************************************/
-static void quickfill_insert_recursive (QuickFill *qf, const char *text, int len,
-                                        const char* next_char, QuickFillSort sort);
-
-static void gnc_quickfill_remove_recursive (QuickFill *qf, const gchar *text,
-        gint depth, QuickFillSort sort);
+/* One of the strings given to gnc_quickfill_insert_list(). */
+typedef struct
+{
+    char *key;
+    guint len;
+    const char *text;
+} QuickFillItem;
 
 /* This static indicates the debugging module that this .o belongs to.  */
 static QofLogModule log_module = GNC_MOD_REGISTER;
@@ -53,52 +65,217 @@ static QofLogModule log_module = GNC_MOD_REGISTER;
 /********************************************************************\
 \********************************************************************/
 
-QuickFill *
-gnc_quickfill_new (void)
+static QuickFill *
+quickfill_node_new (const char *edge, guint edge_len)
 {
-    QuickFill *qf;
+    QuickFill *qf = g_malloc (sizeof (QuickFill) + edge_len);
 
-    if (sizeof (guint) < sizeof (gunichar))
+    qf->text = NULL;
+    qf->child = NULL;
+    qf->next = NULL;
+    qf->edge_len = edge_len;
+    if (edge)
+        memcpy (qf->edge, edge, edge_len);
+
+    return qf;
+}
+
+static void
+quickfill_set_text (QuickFill *qf, const char *text)
+{
+    const char *cached = text ? CACHE_INSERT (text) : NULL;
+
+    if (qf->text)
+        CACHE_REMOVE (qf->text);
+    qf->text = cached;
+}
+
+static void
+quickfill_free_children (QuickFill *qf)
+{
+    QuickFill *child = qf->child;
+
+    while (child)
     {
-        PWARN ("Can't use quickfill");
-        return NULL;
+        QuickFill *next = child->next;
+
+        quickfill_free_children (child);
+        quickfill_set_text (child, NULL);
+        g_free (child);
+        child = next;
     }
+    qf->child = NULL;
+}
 
-    qf = g_new (QuickFill, 1);
+/* The key of the first 'len' characters of 'str': the characters
+ * upper-cased, so that matching ignores case.  A negative 'len' takes
+ * all of 'str'. */
+static char *
+quickfill_key (const char *str, glong len, guint *key_len)
+{
+    GString *key = g_string_sized_new (strlen (str) + 8);
 
-    qf->text = NULL;
-    qf->len = 0;
+    for (; *str && len != 0; str = g_utf8_next_char (str), len--)
+        g_string_append_unichar (key, g_unichar_toupper (g_utf8_get_char (str)));
 
-    qf->matches = g_hash_table_new (g_direct_hash, g_direct_equal);
+    *key_len = key->len;
+    return g_string_free (key, FALSE);
+}
+
+/* Return the link to the child of 'qf' whose edge starts with the
+ * same character as 'key', or, if there's none, the link a new child
+ * for it should be put at. */
+static QuickFill **
+quickfill_child_link (QuickFill *qf, const char *key, gboolean *found)
+{
+    guchar lead = *key;
+    QuickFill **link;
 
+    for (link = &qf->child; *link; link = &(*link)->next)
+    {
+        guchar child_lead = (*link)->edge[0];
+        int cmp;
+
+        if (child_lead != lead)
+            cmp = child_lead < lead ? -1 : 1;
+        else
+            cmp = memcmp ((*link)->edge, key, g_utf8_skip[lead]);
+
+        if (cmp >= 0)
+        {
+            *found = (cmp == 0);
+            return link;
+        }
+    }
+
+    *found = FALSE;
+    return link;
+}
+
+/* The number of bytes 'key' and the edge of 'qf' from 'offset' on
+ * have in common, backed off to the start of a character. */
+static guint
+quickfill_common_len (const QuickFill *qf, guint offset, const char *key,
+                      guint len)
+{
+    const char *edge = qf->edge + offset;
+    guint max = MIN (qf->edge_len - offset, len);
+    guint n = 0;
+
+    while (n < max && edge[n] == key[n])
+        n++;
+
+    if (n < max)
+        while (n > 0 && (edge[n] & 0xC0) == 0x80)
+            n--;
+
+    return n;
+}
+
+/* Give the first 'offset' bytes of the edge of the node at 'link' a
+ * node of their own, and return it. */
+static QuickFill *
+quickfill_split (QuickFill **link, guint offset)
+{
+    QuickFill *child = *link;
+    QuickFill *qf = quickfill_node_new (child->edge, offset);
+
+    quickfill_set_text (qf, child->text);
+    qf->child = child;
+    qf->next = child->next;
+    child->next = NULL;
+
+    child->edge_len -= offset;
+    memmove (child->edge, child->edge + offset, child->edge_len);
+
+    *link = qf;
     return qf;
 }
 
+/* Fold the node at 'link' into its only child, if they show the same
+ * text.  The reverse of quickfill_split(). */
+static void
+quickfill_merge (QuickFill **link)
+{
+    QuickFill *qf = *link;
+    QuickFill *child = qf->child;
+    QuickFill *merged;
+
+    if (!child || child->next || child->text != qf->text)
+        return;
+
+    merged = quickfill_node_new (NULL, qf->edge_len + child->edge_len);
+    memcpy (merged->edge, qf->edge, qf->edge_len);
+    memcpy (merged->edge + qf->edge_len, child->edge, child->edge_len);
+    merged->text = child->text;
+    merged->child = child->child;
+    merged->next = qf->next;
+    *link = merged;
+
+    quickfill_set_text (qf, NULL);
+    g_free (qf);
+    g_free (child);
+}
+
+/* Return the match for the key 'key' following 'match', which has no
+ * node if no string continues with it. */
+static QuickFillMatch
+quickfill_find (QuickFillMatch match, const char *key, guint len)
+{
+    QuickFill *qf = match.node;
+    guint offset = match.offset;
+
+    while (len > 0)
+    {
+        guint n;
+
+        if (offset == qf->edge_len)
+        {
+            gboolean found;
+
+            qf = *quickfill_child_link (qf, key, &found);
+            if (!found)
+                return (QuickFillMatch) { NULL, 0 };
+            offset = 0;
+        }
+
+        n = quickfill_common_len (qf, offset, key, len);
+        if (n < len && offset + n < qf->edge_len)
+            return (QuickFillMatch) { NULL, 0 };
+
+        offset += n;
+        key += n;
+        len -= n;
+    }
+
+    return (QuickFillMatch) { qf, offset };
+}
+
 /********************************************************************\
 \********************************************************************/
 
-static gboolean
-destroy_helper (gpointer key, gpointer value, gpointer data)
+QuickFill *
+gnc_quickfill_new (void)
 {
-    gnc_quickfill_destroy (value);
-    return TRUE;
+    if (sizeof (guint) < sizeof (gunichar))
+    {
+        PWARN ("Can't use quickfill");
+        return NULL;
+    }
+
+    return quickfill_node_new (NULL, 0);
 }
 
+/********************************************************************\
+\********************************************************************/
+
 void
 gnc_quickfill_destroy (QuickFill *qf)
 {
     if (qf == NULL)
         return;
 
-    g_hash_table_foreach (qf->matches, (GHFunc)destroy_helper, NULL);
-    g_hash_table_destroy (qf->matches);
-    qf->matches = NULL;
-
-    if (qf->text)
-        g_free(qf->text);
-    qf->text = NULL;
-    qf->len = 0;
-
+    gnc_quickfill_purge (qf);
     g_free (qf);
 }
 
@@ -108,78 +285,69 @@ gnc_quickfill_purge (QuickFill *qf)
     if (qf == NULL)
         return;
 
-    g_hash_table_foreach_remove (qf->matches, destroy_helper, NULL);
-
-    if (qf->text)
-        g_free (qf->text);
-    qf->text = NULL;
-    qf->len = 0;
+    quickfill_free_children (qf);
+    quickfill_set_text (qf, NULL);
 }
 
 /********************************************************************\
 \********************************************************************/
 
 const char *
-gnc_quickfill_string (QuickFill *qf)
+gnc_quickfill_string (QuickFillMatch match)
 {
-    if (qf == NULL)
+    if (match.node == NULL)
         return NULL;
 
-    return qf->text;
+    return match.node->text;
 }
 
 /********************************************************************\
 \********************************************************************/
 
-QuickFill *
-gnc_quickfill_get_char_match (QuickFill *qf, gunichar uc)
+QuickFillMatch
+gnc_quickfill_get_char_match (QuickFillMatch match, gunichar uc)
 {
-    guint key = g_unichar_toupper (uc);
+    char key[6];
+    guint key_len;
+
+    if (NULL == match.node) return match;
 
-    if (NULL == qf) return NULL;
+    key_len = g_unichar_to_utf8 (g_unichar_toupper (uc), key);
 
-    DEBUG ("xaccGetQuickFill(): index = %u\n", key);
+    DEBUG ("xaccGetQuickFill(): index = %u\n", g_unichar_toupper (uc));
 
-    return g_hash_table_lookup (qf->matches, GUINT_TO_POINTER (key));
+    return quickfill_find (match, key, key_len);
 }
 
 /********************************************************************\
 \********************************************************************/
 
-QuickFill *
+QuickFillMatch
 gnc_quickfill_get_string_len_match (QuickFill *qf,
                                     const char *str, int len)
 {
-    const char *c;
-    gunichar uc;
+    QuickFillMatch match = { NULL, 0 };
+    char *key;
+    guint key_len;
 
-    if (NULL == qf) return NULL;
-    if (NULL == str) return NULL;
+    if (NULL == qf) return match;
+    if (NULL == str) return match;
 
-    c = str;
-    while (*c && (len > 0))
-    {
-        if (qf == NULL)
-            return NULL;
+    key = quickfill_key (str, MAX (len, 0), &key_len);
+    match = quickfill_find ((QuickFillMatch) { qf, qf->edge_len }, key,
+                            key_len);
+    g_free (key);
 
-        uc = g_utf8_get_char (c);
-        qf = gnc_quickfill_get_char_match (qf, uc);
-
-        c = g_utf8_next_char (c);
-        len--;
-    }
-
-    return qf;
+    return match;
 }
 
 /********************************************************************\
 \********************************************************************/
 
-QuickFill *
+QuickFillMatch
 gnc_quickfill_get_string_match (QuickFill *qf, const char *str)
 {
-    if (NULL == qf) return NULL;
-    if (NULL == str) return NULL;
+    if (NULL == str) return (QuickFillMatch) { NULL, 0 };
 
     return gnc_quickfill_get_string_len_match (qf, str, g_utf8_strlen (str, -1));
 }
@@ -187,215 +355,329 @@ gnc_quickfill_get_string_match (QuickFill *qf, const char *str)
 /********************************************************************\
 \********************************************************************/
 
-static void
-unique_len_helper (gpointer key, gpointer value, gpointer data)
+QuickFillMatch
+gnc_quickfill_get_unique_len_match (QuickFillMatch match, int *length)
 {
-    QuickFill **qf_p = data;
+    QuickFill *qf = match.node;
 
-    *qf_p = value;
-}
-
-QuickFill *
-gnc_quickfill_get_unique_len_match (QuickFill *qf, int *length)
-{
     if (length != NULL)
         *length = 0;
 
     if (qf == NULL)
-        return NULL;
-
-    while (1)
-    {
-        guint count;
-
-        count = g_hash_table_size (qf->matches);
+        return match;
 
-        if (count != 1)
-            break;
+    /* The rest of the edge is the only way on. */
+    if (length != NULL)
+        *length = g_utf8_strlen (qf->edge + match.offset,
+                                 qf->edge_len - match.offset);
 
-        g_hash_table_foreach (qf->matches, unique_len_helper, &qf);
+    while (qf->child && !qf->child->next)
+    {
+        qf = qf->child;
 
         if (length != NULL)
-            (*length)++;
+            *length += g_utf8_strlen (qf->edge, qf->edge_len);
     }
 
-    return qf;
+    return (QuickFillMatch) { qf, qf->edge_len };
 }
 
 /********************************************************************\
 \********************************************************************/
 
+/* Whether 'text' should replace 'old_text' as the text of a node. */
+static gboolean
+quickfill_better_text (const char *text, const char *old_text,
+                       QuickFillSort sort)
+{
+    if (old_text == NULL)
+        return TRUE;
+
+    switch (sort)
+    {
+    case QUICKFILL_ALPHA:
+        if (g_utf8_collate (text, old_text) >= 0)
+            return FALSE;
+    /* fall through */
+
+    case QUICKFILL_LIFO:
+    default:
+        /* Leave prefixes in place */
+        return !g_str_has_prefix (text, old_text);
+    }
+}
+
+static void
+quickfill_update_text (QuickFill *qf, const char *text, QuickFillSort sort)
+{
+    if (quickfill_better_text (text, qf->text, sort))
+        quickfill_set_text (qf, text);
+}
+
+static void
+quickfill_insert_key (QuickFill *qf, const char *key, guint len,
+                      const char *text, QuickFillSort sort)
+{
+    while (len > 0)
+    {
+        QuickFill **link;
+        QuickFill *child;
+        gboolean found;
+        guint n;
+
+        link = quickfill_child_link (qf, key, &found);
+        if (!found)
+        {
+            child = quickfill_node_new (key, len);
+            child->next = *link;
+            *link = child;
+            quickfill_set_text (child, text);
+            return;
+        }
+
+        n = quickfill_common_len (*link, 0, key, len);
+        if (n < (*link)->edge_len)
+            child = quickfill_split (link, n);
+        else
+            child = *link;
+
+        quickfill_update_text (child, text, sort);
+
+        qf = child;
+        key += n;
+        len -= n;
+    }
+}
+
 void
 gnc_quickfill_insert (QuickFill *qf, const char *text, QuickFillSort sort)
 {
     gchar *normalized_str;
-    int len;
+    const char *cached;
+    char *key;
+    guint key_len;
 
     if (NULL == qf) return;
     if (NULL == text) return;
 
-
     normalized_str = g_utf8_normalize (text, -1, G_NORMALIZE_NFC);
-    len = g_utf8_strlen (text, -1);
-    quickfill_insert_recursive (qf, normalized_str, len, normalized_str, sort);
+    key = quickfill_key (normalized_str, -1, &key_len);
+    cached = CACHE_INSERT (normalized_str);
+
+    quickfill_insert_key (qf, key, key_len, cached, sort);
+
+    CACHE_REMOVE (cached);
+    g_free (key);
     g_free (normalized_str);
 }
 
 /********************************************************************\
 \********************************************************************/
 
-static void
-quickfill_insert_recursive (QuickFill *qf, const char *text, int len,
-                            const char *next_char, QuickFillSort sort)
+static gint
+quickfill_item_compare (gconstpointer a, gconstpointer b)
 {
-    guint key;
-    char *old_text;
-    QuickFill *match_qf;
-    gunichar key_char_uc;
+    const QuickFillItem *item_a = *(QuickFillItem * const *) a;
+    const QuickFillItem *item_b = *(QuickFillItem * const *) b;
+    int cmp = strcmp (item_a->key, item_b->key);
 
-    if (qf == NULL)
-        return;
+    if (cmp != 0)
+        return cmp;
 
-    if ((text == NULL) || (*next_char == '\0'))
-        return;
+    /* Keep the order they were given in. */
+    return (item_a < item_b) ? -1 : (item_a > item_b);
+}
 
+/* Build the nodes under 'qf' for the items, all of whose keys start
+ * with the 'depth' bytes that lead to 'qf', sorted by key. */
+static void
+quickfill_build (QuickFill *qf, QuickFillItem **items, guint count,
+                 guint depth)
+{
+    QuickFill **link = &qf->child;
+    guint i = 0;
 
-    key_char_uc = g_utf8_get_char (next_char);
-    key = g_unichar_toupper (key_char_uc);
+    /* The keys that end here sort first. */
+    while (i < count && items[i]->len == depth)
+        i++;
 
-    match_qf = g_hash_table_lookup (qf->matches, GUINT_TO_POINTER (key));
-    if (match_qf == NULL)
+    while (i < count)
     {
-        match_qf = gnc_quickfill_new ();
-        g_hash_table_insert (qf->matches, GUINT_TO_POINTER (key), match_qf);
+        const char *first = items[i]->key + depth;
+        guint char_len = g_utf8_skip[(guchar) * first];
+        const char *last;
+        guint j = i + 1;
+        guint common;
+
+        while (j < count && strncmp (items[j]->key + depth, first, char_len) == 0)
+            j++;
+
+        /* The keys are sorted, so what the first and last of them
+         * have in common all of them have. */
+        last = items[j - 1]->key + depth;
+        common = 0;
+        while (first[common] && first[common] == last[common])
+            common++;
+        while ((first[common] & 0xC0) == 0x80)
+            common--;
+
+        *link = quickfill_node_new (first, common);
+        quickfill_build (*link, items + i, j - i, depth + common);
+        link = &(*link)->next;
+        i = j;
     }
+}
 
-    old_text = match_qf->text;
-
-    switch (sort)
+/* Choose the texts of the nodes on the path of a key that's known to
+ * end on a node.  The texts are only borrowed from the items here;
+ * quickfill_ref_texts() takes the references once they're settled. */
+static void
+quickfill_choose_path (QuickFill *qf, const char *key, guint len,
+                       const char *text, QuickFillSort sort)
+{
+    while (len > 0)
     {
-    case QUICKFILL_ALPHA:
-        if (old_text && (g_utf8_collate (text, old_text) >= 0))
-            break;
-        /* fall through */
+        gboolean found;
 
-    case QUICKFILL_LIFO:
-    default:
-        /* If there's no string there already, just put the new one in. */
-        if (old_text == NULL)
-        {
-            match_qf->text = g_strdup(text);
-            match_qf->len = len;
-            break;
-        }
+        qf = *quickfill_child_link (qf, key, &found);
+        g_assert (found);
 
-        /* Leave prefixes in place */
-        if ((len > match_qf->len) &&
-                (strncmp(text, old_text, strlen(old_text)) == 0))
-            break;
-
-        g_free(old_text);
-        match_qf->text = g_strdup(text);
-        match_qf->len = len;
-        break;
+        if (quickfill_better_text (text, qf->text, sort))
+            qf->text = text;
+        key += qf->edge_len;
+        len -= qf->edge_len;
     }
-
-    quickfill_insert_recursive (match_qf, text, len, g_utf8_next_char (next_char), sort);
 }
 
-/********************************************************************\
-\********************************************************************/
-
-void
-gnc_quickfill_remove (QuickFill *qf, const gchar *text, QuickFillSort sort)
+static void
+quickfill_ref_texts (QuickFill *qf)
 {
-    gchar *normalized_str;
-
-    if (qf == NULL) return;
-    if (text == NULL) return;
-
-    normalized_str = g_utf8_normalize (text, -1, G_NORMALIZE_NFC);
-    gnc_quickfill_remove_recursive (qf, normalized_str, 0, sort);
-    g_free (normalized_str);
+    for (QuickFill *child = qf->child; child; child = child->next)
+    {
+        child->text = CACHE_INSERT (child->text);
+        quickfill_ref_texts (child);
+    }
 }
 
-/********************************************************************\
-\********************************************************************/
-
-struct _BestText
+void
+gnc_quickfill_insert_list (QuickFill *qf, GList *texts, QuickFillSort sort)
 {
-    gchar *text;
-    QuickFillSort sort;
-};
+    QuickFillItem *items;
+    QuickFillItem **sorted;
+    guint count = 0;
+    guint i;
 
-static void
-best_text_helper (gpointer key, gpointer value, gpointer user_data)
-{
-    QuickFill *qf = value;
-    struct _BestText *best = user_data;
+    if (NULL == qf) return;
 
-    if (best->text == NULL)
+    if (qf->child != NULL)
     {
-        /* start with the first text */
-        best->text = qf->text;
-
+        for (GList *node = texts; node; node = node->next)
+            gnc_quickfill_insert (qf, node->data, sort);
+        return;
     }
-    else if (best->text == QUICKFILL_LIFO)
+
+    items = g_new (QuickFillItem, g_list_length (texts));
+    for (GList *node = texts; node; node = node->next)
     {
-        /* we do not track history, so ignore it */
-        return;
+        gchar *normalized_str;
+        QuickFillItem *item;
 
+        if (!node->data || !*(const char *) node->data)
+            continue;
+
+        item = &items[count++];
+        normalized_str = g_utf8_normalize (node->data, -1, G_NORMALIZE_NFC);
+        item->key = quickfill_key (normalized_str, -1, &item->len);
+        item->text = CACHE_INSERT (normalized_str);
+        g_free (normalized_str);
     }
-    else if (g_utf8_collate (qf->text, best->text) < 0)
+
+    sorted = g_new (QuickFillItem *, count);
+    for (i = 0; i < count; i++)
+        sorted[i] = &items[i];
+    if (count > 1)
+        qsort (sorted, count, sizeof (QuickFillItem *), quickfill_item_compare);
+
+    quickfill_build (qf, sorted, count, 0);
+
+    /* Each text goes where it would have gone had the strings been
+     * inserted one at a time, in the order they were given. */
+    for (i = 0; i < count; i++)
+        quickfill_choose_path (qf, items[i].key, items[i].len,
+                               items[i].text, sort);
+    quickfill_ref_texts (qf);
+
+    for (i = 0; i < count; i++)
     {
-        /* even better text */
-        best->text = qf->text;
+        CACHE_REMOVE (items[i].text);
+        g_free (items[i].key);
     }
-}
 
+    g_free (sorted);
+    g_free (items);
+}
 
+/********************************************************************\
+\********************************************************************/
 
-static void
-gnc_quickfill_remove_recursive (QuickFill *qf, const gchar *text, gint depth,
-                                QuickFillSort sort)
+static const char *
+quickfill_best_child_text (QuickFill *qf, QuickFillSort sort)
 {
-    QuickFill *match_qf;
-    gchar *child_text;
-    gint child_len;
-
-    child_text = NULL;
-    child_len = 0;
+    const char *best = NULL;
 
-    if (depth < g_utf8_strlen (text, -1))
+    for (QuickFill *child = qf->child; child; child = child->next)
     {
-        /* process next letter */
+        /* we do not track history, so LIFO takes the first */
+        if (best == NULL)
+            best = child->text;
+        else if (sort == QUICKFILL_ALPHA &&
+                 g_utf8_collate (child->text, best) < 0)
+            best = child->text;
+    }
 
-        gchar *key_char;
-        gunichar key_char_uc;
-        guint key;
+    return best;
+}
+
+static void
+quickfill_remove_key (QuickFill *qf, const char *key, guint len,
+                          const char *text, QuickFillSort sort)
+{
+    const char *child_text = NULL;
 
-        key_char = g_utf8_offset_to_pointer (text, depth);
-        key_char_uc = g_utf8_get_char (key_char);
-        key = g_unichar_toupper (key_char_uc);
+    if (len > 0)
+    {
+        QuickFill **link;
+        gboolean found;
 
-        match_qf = g_hash_table_lookup (qf->matches, GUINT_TO_POINTER (key));
-        if (match_qf)
+        link = quickfill_child_link (qf, key, &found);
+        if (found)
         {
-            /* remove text from child qf */
-            gnc_quickfill_remove_recursive (match_qf, text, depth + 1, sort);
+            QuickFill *match_qf = *link;
+            guint n = quickfill_common_len (match_qf, 0, key, len);
 
-            if (match_qf->text == NULL)
+            if (n == match_qf->edge_len)
             {
-                /* text was the only word with a prefix up to match_qf */
-                g_hash_table_remove (qf->matches, GUINT_TO_POINTER (key));
-                gnc_quickfill_destroy (match_qf);
-
+                /* remove text from child qf */
+                quickfill_remove_key (match_qf, key + n, len - n, text, sort);
+
+                if (match_qf->text == NULL)
+                {
+                    /* text was the only word with a prefix up to match_qf */
+                    *link = match_qf->next;
+                    quickfill_free_children (match_qf);
+                    g_free (match_qf);
+                }
+                else
+                {
+                    /* remember remaining best child string */
+                    quickfill_merge (link);
+                    child_text = (*link)->text;
+                }
             }
-            else
+            else if (n == len)
             {
-                /* remember remaining best child string */
+                /* the key ends inside the edge, which text can't */
                 child_text = match_qf->text;
-                child_len = match_qf->len;
             }
         }
     }
@@ -405,46 +687,30 @@ gnc_quickfill_remove_recursive (QuickFill *qf, const gchar *text, gint depth,
 
     if (strcmp (text, qf->text) == 0)
     {
-        /* the currently best text is about to be removed */
+        /* the currently best text is about to be removed, other
+         * children are pretty good as well */
+        if (child_text == NULL)
+            child_text = quickfill_best_child_text (qf, sort);
 
-        gchar *best_text = NULL;
-        gint best_len = 0;
+        quickfill_set_text (qf, child_text);
+    }
+}
 
-        if (child_text != NULL)
-        {
-            /* other children are pretty good as well */
-            best_text = child_text;
-            best_len = child_len;
+void
+gnc_quickfill_remove (QuickFill *qf, const gchar *text, QuickFillSort sort)
+{
+    gchar *normalized_str;
+    char *key;
+    guint key_len;
 
-        }
-        else
-        {
-            if (g_hash_table_size (qf->matches) != 0)
-            {
-                /* otherwise search for another good text */
-                struct _BestText bts;
-                bts.text = NULL;
-                bts.sort = sort;
-
-                g_hash_table_foreach (qf->matches, (GHFunc) best_text_helper, &bts);
-                best_text = bts.text;
-                best_len = (best_text == NULL) ? 0 : g_utf8_strlen (best_text, -1);
-            }
-        }
+    if (qf == NULL) return;
+    if (text == NULL) return;
 
-        /* now replace or clear text */
-        g_free(qf->text);
-        if (best_text != NULL)
-        {
-            qf->text = g_strdup(best_text);
-            qf->len = best_len;
-        }
-        else
-        {
-            qf->text = NULL;
-            qf->len = 0;
-        }
-    }
+    normalized_str = g_utf8_normalize (text, -1, G_NORMALIZE_NFC);
+    key = quickfill_key (normalized_str, -1, &key_len);
+    quickfill_remove_key (qf, key, key_len, normalized_str, sort);
+    g_free (key);
+    g_free (normalized_str);
 }
 
 /********************** END OF FILE *********************************   \
@@ -30,11 +30,20 @@
    of partial matching strings.  The root of the tree contains
    all of the strings that user input should be matched to.
    Then, given a short string segment, QuickFill will return
-   a subtree containing only those strings that start with desired
+   a match standing for only those strings that start with desired
    substring.  As additional letters are added to the substring,
    QuickFill will thus narrow down to the unique matching string
    (or to nothing if no match).
 
+   The tree is path-compressed: runs of letters that only one branch
+   continues share a single node, and the strings shown by the nodes
+   are kept in the engine's string cache, so a node costs little more
+   than its letters however many there are.  A match is a node and
+   how far along that node's letters the substring reaches, so the
+   lookups only read the tree.  A large quickfill is best filled with
+   gnc_quickfill_insert_list(), and one quickfill can serve every
+   register on a book, as the ones in gnc-trans-quickfill.c do.
+
    QuickFill works with national-language i18n'ed/l10n'ed multi-byte
    and wide-char strings, as well as plain-old C-locale strings.
    @{
@@ -64,6 +73,14 @@ typedef enum
 
 typedef struct _QuickFill QuickFill;
 
+/** The strings of a quickfill that start with some substring.  A
+ *  match is only good until the quickfill is next changed. */
+typedef struct
+{
+    QuickFill *node;    /**< NULL if no string starts with the substring */
+    guint offset;       /**< bytes of the node's letters the substring holds */
+} QuickFillMatch;
+
 
 /* PROTOTYPES ******************************************************/
 
@@ -71,41 +88,38 @@ QuickFill *  gnc_quickfill_new (void);
 void         gnc_quickfill_destroy (QuickFill *qf);
 void         gnc_quickfill_purge (QuickFill *qf);
 
-/** For the given node 'qf', return the best-guess matching string.
+/** For the given match, return the best-guess matching string,
+ *  or NULL if nothing matched.
  */
-const char * gnc_quickfill_string (QuickFill *qf);
+const char * gnc_quickfill_string (QuickFillMatch match);
 
-/** Return the subnode of the tree whose strings all hold 'c' as
- *  the next letter.  That is, if 'qf' holds all strings starting
- *  with the letter 'a', and we ask for the letter 'b', then this
- *  routine will return the node holding all strings that start
- *  with "ab".
+/** Return the match whose strings all hold 'c' as the next letter
+ *  after those of 'match'.  That is, if 'match' holds all strings
+ *  starting with the letter 'a', and we ask for the letter 'b',
+ *  then this routine will return the match holding all strings
+ *  that start with "ab".
  *
  *  The best-guess matching string can be retrieved with
  *  gnc_quickfill_string().
  */
-QuickFill *  gnc_quickfill_get_char_match (QuickFill *qf, gunichar c);
+QuickFillMatch gnc_quickfill_get_char_match (QuickFillMatch match,
+                                             gunichar c);
 
-/** Return a subnode in the tree whose strings all match the
- *  string 'str' as the next substring.  Thus, for example, if
- *  the argument 'qf' holds strings that start with "abc", and
- *  this routine is called with "def", then the returned node
- *  will hold strings that start with "abcdef".
+/** Return the match of the strings in the quickfill 'qf' that start
+ *  with the string 'str'.  The empty string matches all of them.
  *
  *  The best-guess matching string can be retrieved with
  *  gnc_quickfill_string().
- *
- *  To convert a plain C-locale char * string to GdkWChar *,
- *  use the gnc_mbstowcs() routine.
  */
-QuickFill *  gnc_quickfill_get_string_match (QuickFill *qf,
-        const char *str);
+QuickFillMatch gnc_quickfill_get_string_match (QuickFill *qf,
+                                               const char *str);
 
 /** Same as gnc_quickfill_get_string_match(), except that the
  *  string length is explicitly specified.
  */
-QuickFill *  gnc_quickfill_get_string_len_match (QuickFill *qf,
-        const char *str, int len);
+QuickFillMatch gnc_quickfill_get_string_len_match (QuickFill *qf,
+                                                   const char *str,
+                                                   int len);
 
 /** Walk a 'unique' part of the QuickFill tree.  This routine is
  *  typically used to assist in the tab-completion of strings.
@@ -114,18 +128,28 @@ QuickFill *  gnc_quickfill_get_string_len_match (QuickFill *qf,
  *  part of the string.  If len is non-NULL, then *len will be set
  *  to the length of the unique portion of the string.
  *
- *  Thus, for example, if the root node contains the strings
- *  "The Book" and "The Movie", then the returned len will be 4,
- *  and the returned node will distinguish "Book" and "Movie".
- *  Thus, for example, gnc_quickfill_get_char_match(.., 'B') on
- *  the result will identify "The Book".
+ *  Thus, for example, if the quickfill contains the strings
+ *  "The Book" and "The Movie", then from the match of "" the
+ *  returned len will be 4, and the returned match will distinguish
+ *  "Book" and "Movie".  Thus, for example,
+ *  gnc_quickfill_get_char_match(.., 'B') on the result will
+ *  identify "The Book".
  */
-QuickFill *  gnc_quickfill_get_unique_len_match (QuickFill *qf, int *len);
+QuickFillMatch gnc_quickfill_get_unique_len_match (QuickFillMatch match,
+                                                   int *len);
 
 /** Add the string "text" to the collection of searchable strings. */
 void         gnc_quickfill_insert (QuickFill *root, const char *text,
                                    QuickFillSort sort_code);
 
+/** Add all of the strings in the list "texts" to the collection of
+ *  searchable strings.  The result is the same as inserting them one
+ *  at a time, in order, but when the quickfill is empty it is built
+ *  in a single pass over the sorted strings, without splitting the
+ *  nodes that inserting them one at a time takes. */
+void         gnc_quickfill_insert_list (QuickFill *root, GList *texts,
+                                        QuickFillSort sort_code);
+
 void         gnc_quickfill_remove (QuickFill *root, const gchar *text,
                                    QuickFillSort sort_code);
 
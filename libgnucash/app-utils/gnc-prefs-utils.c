@@ -27,6 +27,7 @@
 #include "gnc-prefs-utils.h"
 #include "gnc-prefs.h"
 #include "xml/gnc-backend-xml.h"
+#include "TransLog.h"
 
 static QofLogModule log_module = G_LOG_DOMAIN;
 
@@ -36,6 +37,9 @@ static QofLogModule log_module = G_LOG_DOMAIN;
 #define GNC_PREF_RETAIN_TYPE_DAYS    "retain-type-days"
 #define GNC_PREF_RETAIN_TYPE_FOREVER "retain-type-forever"
 #define GNC_PREF_RETAIN_DAYS         "retain-days"
+#define GNC_PREF_JOURNAL_BINARY      "journal-binary"
+#define GNC_PREF_JOURNAL_SYNC_INTERVAL "journal-sync-interval"
+#define GNC_PREF_JOURNAL_SYNC_COUNT  "journal-sync-count"
 
 /***************************************************************
  * Initialization                                              *
@@ -78,6 +82,33 @@ file_compression_changed_cb(gpointer gsettings, gchar *key, gpointer user_data)
     }
 }
 
+static void
+journal_format_changed_cb(gpointer gsettings, gchar *key, gpointer user_data)
+{
+    if (gnc_prefs_is_set_up())
+    {
+        gboolean binary = gnc_prefs_get_bool(GNC_PREFS_GROUP_GENERAL, GNC_PREF_JOURNAL_BINARY);
+        xaccLogSetFormat (binary ? XACC_LOG_BINARY : XACC_LOG_TEXT);
+    }
+}
+
+static void
+journal_sync_changed_cb(gpointer gsettings, gchar *key, gpointer user_data)
+{
+    if (gnc_prefs_is_set_up())
+    {
+        gint count = (int)gnc_prefs_get_float(GNC_PREFS_GROUP_GENERAL, GNC_PREF_JOURNAL_SYNC_COUNT);
+        gint interval = (int)gnc_prefs_get_float(GNC_PREFS_GROUP_GENERAL, GNC_PREF_JOURNAL_SYNC_INTERVAL);
+
+        if (count > 0)
+            xaccLogSetSync (XACC_LOG_SYNC_COUNT, count);
+        else if (interval > 0)
+            xaccLogSetSync (XACC_LOG_SYNC_INTERVAL, interval);
+        else
+            xaccLogSetSync (XACC_LOG_SYNC_NONE, 0);
+    }
+}
+
 
 void gnc_prefs_init (void)
 {
@@ -89,6 +120,8 @@ void gnc_prefs_init (void)
     file_retain_changed_cb (NULL, NULL, NULL);
     file_retain_type_changed_cb (NULL, NULL, NULL);
     file_compression_changed_cb (NULL, NULL, NULL);
+    journal_format_changed_cb (NULL, NULL, NULL);
+    journal_sync_changed_cb (NULL, NULL, NULL);
 
     /* Check for invalid retain_type (days)/retain_days (0) combo.
      * This can happen either because a user changed the preferences
@@ -122,6 +155,12 @@ void gnc_prefs_init (void)
                            file_retain_type_changed_cb, NULL);
     gnc_prefs_register_cb (GNC_PREFS_GROUP_GENERAL, GNC_PREF_FILE_COMPRESSION,
                            file_compression_changed_cb, NULL);
+    gnc_prefs_register_cb (GNC_PREFS_GROUP_GENERAL, GNC_PREF_JOURNAL_BINARY,
+                           journal_format_changed_cb, NULL);
+    gnc_prefs_register_cb (GNC_PREFS_GROUP_GENERAL, GNC_PREF_JOURNAL_SYNC_INTERVAL,
+                           journal_sync_changed_cb, NULL);
+    gnc_prefs_register_cb (GNC_PREFS_GROUP_GENERAL, GNC_PREF_JOURNAL_SYNC_COUNT,
+                           journal_sync_changed_cb, NULL);
 
 }
 
@@ -139,4 +178,10 @@ gnc_prefs_remove_registered (void)
                            file_retain_type_changed_cb, NULL);
     gnc_prefs_remove_cb_by_func (GNC_PREFS_GROUP_GENERAL, GNC_PREF_FILE_COMPRESSION,
                            file_compression_changed_cb, NULL);
+    gnc_prefs_remove_cb_by_func (GNC_PREFS_GROUP_GENERAL, GNC_PREF_JOURNAL_BINARY,
+                           journal_format_changed_cb, NULL);
+    gnc_prefs_remove_cb_by_func (GNC_PREFS_GROUP_GENERAL, GNC_PREF_JOURNAL_SYNC_INTERVAL,
+                           journal_sync_changed_cb, NULL);
+    gnc_prefs_remove_cb_by_func (GNC_PREFS_GROUP_GENERAL, GNC_PREF_JOURNAL_SYNC_COUNT,
+                           journal_sync_changed_cb, NULL);
 }
@@ -23,7 +23,9 @@
 #include <config.h>
 
 #include <algorithm>
+#include <atomic>
 #include <stdexcept>
+#include <thread>
 #include <vector>
 #include <string>
 #include <iostream>
@@ -66,6 +68,12 @@ namespace bio = boost::iostreams;
 
 using QuoteResult = std::tuple<int, StrVec, StrVec>;
 
+/* Fetches of more commodities than this are split into batches of this
+ * size, which are fetched at the same time by up to c_max_fq_workers
+ * finance-quote-wrappers. */
+static constexpr size_t c_quote_batch_size{50};
+static constexpr size_t c_max_fq_workers{4};
+
 struct GncQuoteSourceError : public std::runtime_error
 {
     GncQuoteSourceError(const std::string& err) : std::runtime_error(err) {}
@@ -81,8 +89,19 @@ public:
     virtual const StrVec& get_sources() const noexcept = 0;
     virtual const std::string & get_version() const noexcept = 0;
     virtual QuoteResult get_quotes(const std::string& json_str) const = 0;
+    /* Run several requests, by default one after the other. */
+    virtual std::vector<QuoteResult> get_quote_batches(const StrVec& json_strs) const;
 };
 
+std::vector<QuoteResult>
+GncQuoteSource::get_quote_batches(const StrVec& json_strs) const
+{
+    std::vector<QuoteResult> results;
+    for (const auto& json_str : json_strs)
+        results.push_back(get_quotes(json_str));
+    return results;
+}
+
 
 class GncQuotesImpl
 {
@@ -106,7 +125,7 @@ public:
 
 private:
     std::string query_fq (const char* source, const StrVec& commoditites);
-    std::string query_fq (const CommVec&);
+    bpt::ptree query_fq (const CommVec&);
     bpt::ptree parse_quotes (const std::string& quote_str);
     void create_quotes(const bpt::ptree& pt, const CommVec& comm_vec);
     std::string comm_vec_to_json_string(const CommVec&) const;
@@ -119,6 +138,28 @@ private:
     gnc_commodity *m_dflt_curr;
 };
 
+/* A finance-quote-wrapper left running in stream mode. It answers each
+ * request, written to it on a line of its own, with a line of JSON or an
+ * error, so Finance::Quote is loaded once however many are made. */
+class GncFQWorker
+{
+    const bfs::path c_cmd;
+    const std::string c_fq_wrapper;
+    const std::string c_api_key;
+    std::unique_ptr<bp::opstream> m_in;
+    std::unique_ptr<bp::ipstream> m_out;
+    bp::child m_process;
+public:
+    GncFQWorker(const bfs::path& cmd, const std::string& fq_wrapper,
+                const std::string& api_key) :
+        c_cmd{cmd}, c_fq_wrapper{fq_wrapper}, c_api_key{api_key} {}
+    ~GncFQWorker() { stop(); }
+    QuoteResult request(const std::string& json_str);
+private:
+    void start();
+    void stop();
+};
+
 class GncFQQuoteSource final : public GncQuoteSource
 {
     const bfs::path c_cmd;
@@ -126,12 +167,16 @@ class GncFQQuoteSource final : public GncQuoteSource
     std::string m_version;
     StrVec m_sources;
     std::string m_api_key;
+    /* Started as they're needed and kept until the source is destroyed. */
+    mutable std::vector<std::unique_ptr<GncFQWorker>> m_workers;
 public:
     GncFQQuoteSource();
+    explicit GncFQQuoteSource(const std::string& fq_wrapper);
     ~GncFQQuoteSource() = default;
     const std::string& get_version() const noexcept override { return m_version; }
     const StrVec& get_sources() const noexcept override { return m_sources; }
     QuoteResult get_quotes(const std::string&) const override;
+    std::vector<QuoteResult> get_quote_batches(const StrVec& json_strs) const override;
 private:
     QuoteResult run_cmd (const StrVec& args, const std::string& json_string) const;
 
@@ -144,8 +189,13 @@ static std::string parse_quotesource_error(const std::string& line);
 static const std::string empty_string{};
 
 GncFQQuoteSource::GncFQQuoteSource() :
+GncFQQuoteSource{std::string(gnc_path_get_bindir()) + "/finance-quote-wrapper"}
+{
+}
+
+GncFQQuoteSource::GncFQQuoteSource(const std::string& fq_wrapper) :
 c_cmd{bp::search_path("perl")},
-c_fq_wrapper{std::string(gnc_path_get_bindir()) + "/finance-quote-wrapper"},
+c_fq_wrapper{fq_wrapper},
 m_version{}, m_sources{}, m_api_key{}
 {
     StrVec args{"-w", c_fq_wrapper, "-v"};
@@ -195,8 +245,110 @@ m_version{}, m_sources{}, m_api_key{}
 QuoteResult
 GncFQQuoteSource::get_quotes(const std::string& json_str) const
 {
-    StrVec args{"-w", c_fq_wrapper, "-f" };
-    return run_cmd(args, json_str);
+    return get_quote_batches(StrVec{json_str}).front();
+}
+
+/* Each worker takes the next request nobody has started on until there are
+ * none left, the first on this thread and the others on threads of their
+ * own. */
+std::vector<QuoteResult>
+GncFQQuoteSource::get_quote_batches(const StrVec& json_strs) const
+{
+    std::vector<QuoteResult> results(json_strs.size());
+    auto n_workers{std::min(json_strs.size(), c_max_fq_workers)};
+    while (m_workers.size() < n_workers)
+        m_workers.push_back(std::make_unique<GncFQWorker>(c_cmd, c_fq_wrapper,
+                                                          m_api_key));
+
+    std::atomic<size_t> next{0};
+    auto run_worker{[&json_strs, &results, &next](GncFQWorker* worker)
+                    {
+                        for (auto index{next++}; index < json_strs.size();
+                             index = next++)
+                            results[index] = worker->request(json_strs[index]);
+                    }};
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < n_workers; ++i)
+        threads.emplace_back(run_worker, m_workers[i].get());
+    if (n_workers)
+        run_worker(m_workers[0].get());
+    for (auto& thread : threads)
+        thread.join();
+    return results;
+}
+
+void
+GncFQWorker::start()
+{
+    StrVec args{"-w", c_fq_wrapper, "-s"};
+    m_in = std::make_unique<bp::opstream>();
+    m_out = std::make_unique<bp::ipstream>();
+    if (c_api_key.empty())
+        m_process = bp::child(c_cmd, args,
+                              bp::std_out > *m_out,
+                              bp::std_in < *m_in);
+    else
+        m_process = bp::child(c_cmd, args,
+                              bp::std_out > *m_out,
+                              bp::std_in < *m_in,
+                              bp::env["ALPHAVANTAGE_API_KEY"] = c_api_key);
+}
+
+/* Closing its input tells the wrapper to exit. */
+void
+GncFQWorker::stop()
+{
+    if (!m_in)
+        return;
+    m_in->pipe().close();
+    std::error_code ec;
+    if (m_process.valid())
+        m_process.wait(ec);
+    m_process = bp::child();
+    m_in.reset();
+    m_out.reset();
+}
+
+QuoteResult
+GncFQWorker::request(const std::string& json_str)
+{
+    /* JSON doesn't need the line breaks and strings can't contain raw
+     * ones, so the request can be sent as one line. */
+    auto request{json_str};
+    std::replace_if(request.begin(), request.end(),
+                    [](char c){ return c == '\n' || c == '\r'; }, ' ');
+
+    std::string error;
+    /* A wrapper that has died is replaced once. */
+    for (auto attempt = 0; attempt < 2; ++attempt)
+    {
+        try
+        {
+            if (!m_in || !m_process.running())
+            {
+                stop();
+                start();
+            }
+            std::string line;
+            if (*m_in << request << std::endl && std::getline(*m_out, line))
+            {
+#ifdef __WIN32
+                if (!line.empty() && line.back() == '\r')
+                    line.pop_back();
+#endif
+                if (!line.empty() && line.front() == '{')
+                    return QuoteResult{0, {std::move(line)}, {}};
+                return QuoteResult{1, {}, {std::move(line)}};
+            }
+            error = "finance-quote-wrapper exited while fetching quotes";
+        }
+        catch (const std::exception& e)
+        {
+            error = e.what();
+        }
+        stop();
+    }
+    return QuoteResult{-1, {}, {error}};
 }
 
 QuoteResult
@@ -318,8 +470,7 @@ GncQuotesImpl::fetch (CommVec& commodities)
     m_failures.clear();
     if (commodities.empty())
         throw (GncQuoteException(bl::translate("GncQuotes::Fetch called with no commodities.")));
-    auto quote_str{query_fq (commodities)};
-    auto ptree{parse_quotes (quote_str)};
+    auto ptree{query_fq (commodities)};
     create_quotes(ptree, commodities);
 }
 
@@ -439,10 +590,10 @@ GncQuotesImpl::comm_vec_to_json_string (const CommVec& comm_vec) const
     return result.str();
 }
 
-static inline std::string
-get_quotes(const std::string& json_str, const std::unique_ptr<GncQuoteSource>& qs)
+static std::string
+quote_answer(const QuoteResult& result, const std::string& json_str)
 {
-    auto [rv, quotes, errors] = qs->get_quotes(json_str);
+    const auto& [rv, quotes, errors] = result;
     std::string answer;
 
     if (rv == 0)
@@ -466,6 +617,12 @@ get_quotes(const std::string& json_str, const std::unique_ptr<GncQuoteSource>& q
     return answer;
 }
 
+static inline std::string
+get_quotes(const std::string& json_str, const std::unique_ptr<GncQuoteSource>& qs)
+{
+    return quote_answer(qs->get_quotes(json_str), json_str);
+}
+
 std::string
 GncQuotesImpl::query_fq (const char* source, const StrVec& commodities)
 {
@@ -494,11 +651,43 @@ GncQuotesImpl::query_fq (const char* source, const StrVec& commodities)
     return get_quotes(result.str(), m_quotesource);
 }
 
-std::string
+/* The batches are fetched together and their results merged. A batch that
+ * fails leaves its commodities without a result; only if every one fails
+ * is the fetch a failure. */
+bpt::ptree
 GncQuotesImpl::query_fq (const CommVec& comm_vec)
 {
-    auto json_str{comm_vec_to_json_string(comm_vec)};
-    return get_quotes(json_str, m_quotesource);
+    StrVec json_strs;
+    for (auto batch{comm_vec.cbegin()}; batch != comm_vec.cend();)
+    {
+        auto batch_end{static_cast<size_t>(comm_vec.cend() - batch) > c_quote_batch_size ?
+                       batch + c_quote_batch_size : comm_vec.cend()};
+        json_strs.push_back(comm_vec_to_json_string(CommVec(batch, batch_end)));
+        batch = batch_end;
+    }
+
+    auto results{m_quotesource->get_quote_batches(json_strs)};
+    bpt::ptree pt;
+    std::string err_str;
+    size_t failed{0};
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        try
+        {
+            auto batch_pt{parse_quotes(quote_answer(results[i], json_strs[i]))};
+            for (auto& quote : batch_pt)
+                pt.push_back(std::move(quote));
+        }
+        catch (const GncQuoteException& err)
+        {
+            PWARN("A batch of quotes failed: %s", err.what());
+            err_str = err.what();
+            ++failed;
+        }
+    }
+    if (failed == results.size())
+        throw(GncQuoteException(err_str));
+    return pt;
 }
 
 struct PriceParams
@@ -754,20 +943,54 @@ GncQuotesImpl::parse_quotes (const std::string& quote_str)
     return pt;
 }
 
+/* In bulk update the pricedb doesn't look for a price already there for the
+ * same day, so that's done here: the quote replaces it unless it's from a
+ * better source. */
+static bool
+replace_same_day_price (GNCPriceDB* pricedb, GNCPrice* price)
+{
+    auto old_price{gnc_pricedb_lookup_day_t64(pricedb,
+                                              gnc_price_get_commodity(price),
+                                              gnc_price_get_currency(price),
+                                              gnc_price_get_time64(price))};
+    if (!old_price)
+        return true;
+    auto keep_old{gnc_price_get_source(price) > gnc_price_get_source(old_price)};
+    if (!keep_old)
+        gnc_pricedb_remove_price(pricedb, old_price);
+    gnc_price_unref(old_price);
+    return !keep_old;
+}
+
+/* The quotes are all parsed first and then added in one pricedb edit, so
+ * the pricedb is committed once and the events for the new prices come
+ * together. */
 void
 GncQuotesImpl::create_quotes (const bpt::ptree& pt, const CommVec& comm_vec)
 {
     auto pricedb{gnc_pricedb_get_db(m_book)};
+    std::vector<GNCPrice*> prices;
     for (auto comm : comm_vec)
     {
         auto price{parse_one_quote(pt, comm)};
-        if (!price)
-            continue;
-        gnc_price_begin_edit (price);
-        gnc_pricedb_add_price(pricedb, price);
-        gnc_price_commit_edit(price);
+        if (price)
+            prices.push_back(price);
+    }
+
+    gnc_pricedb_begin_edit(pricedb);
+    gnc_pricedb_set_bulk_update(pricedb, TRUE);
+    for (auto price : prices)
+    {
+        if (replace_same_day_price(pricedb, price))
+        {
+            gnc_price_begin_edit (price);
+            gnc_pricedb_add_price(pricedb, price);
+            gnc_price_commit_edit(price);
+        }
         gnc_price_unref (price);
     }
+    gnc_pricedb_set_bulk_update(pricedb, FALSE);
+    gnc_pricedb_commit_edit(pricedb);
 }
 
 static void
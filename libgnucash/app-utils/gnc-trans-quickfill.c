@@ -0,0 +1,173 @@
+/********************************************************************\
+ * gnc-trans-quickfill.c -- Create transaction notes and split memo *
+ *                          quick-fills                             *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+ *                                                                  *
+\********************************************************************/
+
+#include <config.h>
+#include "gnc-trans-quickfill.h"
+#include "gnc-event.h"
+#include "gnc-engine.h"
+#include "Transaction.h"
+
+/* This static indicates the debugging module that this .o belongs to. */
+G_GNUC_UNUSED static QofLogModule log_module = GNC_MOD_REGISTER;
+
+typedef struct
+{
+    QuickFill *qf_notes;
+    QuickFill *qf_memo;
+    QuickFillSort qf_sort;
+    QofBook *book;
+    gint  listener;
+} TransQF;
+
+static void
+listen_for_trans_events (QofInstance *entity,  QofEventId event_type,
+                         gpointer user_data, gpointer event_data)
+{
+    TransQF *qfb = user_data;
+    Transaction *trans;
+    const char *notes;
+
+    /* We only listen for Transaction events */
+    if (!GNC_IS_TRANSACTION (entity))
+        return;
+
+    /* A transaction is modified when it's committed, which is when new
+     * notes or memos must be added. */
+    if (0 == (event_type & QOF_EVENT_MODIFY))
+        return;
+
+    trans = GNC_TRANSACTION (entity);
+    if (qof_instance_get_book (trans) != qfb->book)
+        return;
+
+    notes = xaccTransGetNotes (trans);
+    if (notes && *notes)
+        gnc_quickfill_insert (qfb->qf_notes, notes, qfb->qf_sort);
+
+    for (GList *node = xaccTransGetSplitList (trans); node; node = node->next)
+    {
+        const char *memo = xaccSplitGetMemo (node->data);
+
+        if (memo && *memo)
+            gnc_quickfill_insert (qfb->qf_memo, memo, qfb->qf_sort);
+    }
+}
+
+static void
+shared_quickfill_destroy (QofBook *book, gpointer key, gpointer user_data)
+{
+    TransQF *qfb = user_data;
+    gnc_quickfill_destroy (qfb->qf_notes);
+    gnc_quickfill_destroy (qfb->qf_memo);
+    qof_event_unregister_handler (qfb->listener);
+    g_free (qfb);
+}
+
+/** Creates a new query that searches for all Transaction items in the
+ * current book. */
+static QofQuery *new_query_for_transactions(QofBook *book)
+{
+    GSList *primary_sort_params = NULL;
+    QofQuery *query = qof_query_create_for (GNC_ID_TRANS);
+    g_assert(book);
+    qof_query_set_book (query, book);
+
+    /* Set the sort order: By DATE_ENTERED, increasing, so that the
+     * latest text is the one left in the quickfill. */
+    primary_sort_params = qof_query_build_param_list(TRANS_DATE_ENTERED, NULL);
+    qof_query_set_sort_order (query, primary_sort_params, NULL, NULL);
+    qof_query_set_sort_increasing (query, TRUE, TRUE, TRUE);
+
+    return query;
+}
+
+static TransQF* build_shared_quickfill (QofBook *book, const char * key)
+{
+    TransQF *result;
+    QofQuery *query = new_query_for_transactions(book);
+    GList *transactions = qof_query_run(query);
+    GList *notes = NULL;
+    GList *memos = NULL;
+
+    result = g_new0(TransQF, 1);
+
+    result->qf_notes = gnc_quickfill_new();
+    result->qf_memo = gnc_quickfill_new();
+    result->qf_sort = QUICKFILL_LIFO;
+    result->book = book;
+
+    /* Collect the texts first, so that each quickfill can be built in
+     * one go. */
+    for (GList *node = transactions; node; node = node->next)
+    {
+        Transaction *trans = node->data;
+
+        notes = g_list_prepend (notes, (gpointer) xaccTransGetNotes (trans));
+        for (GList *snode = xaccTransGetSplitList (trans); snode; snode = snode->next)
+            memos = g_list_prepend (memos, (gpointer) xaccSplitGetMemo (snode->data));
+    }
+    notes = g_list_reverse (notes);
+    memos = g_list_reverse (memos);
+
+    gnc_quickfill_insert_list (result->qf_notes, notes, result->qf_sort);
+    gnc_quickfill_insert_list (result->qf_memo, memos, result->qf_sort);
+
+    g_list_free (notes);
+    g_list_free (memos);
+    qof_query_destroy(query);
+
+    result->listener =
+        qof_event_register_handler (listen_for_trans_events,
+                                    result);
+
+    qof_book_set_data_fin (book, key, result, shared_quickfill_destroy);
+
+    return result;
+}
+
+static TransQF* get_shared_quickfill (QofBook *book, const char * key)
+{
+    TransQF *qfb;
+
+    g_assert(book);
+    g_assert(key);
+
+    qfb = qof_book_get_data (book, key);
+
+    if (!qfb)
+    {
+        qfb = build_shared_quickfill(book, key);
+    }
+
+    return qfb;
+}
+
+QuickFill * gnc_get_shared_trans_notes_quickfill (QofBook *book, const char * key)
+{
+    return get_shared_quickfill (book, key)->qf_notes;
+}
+
+QuickFill * gnc_get_shared_split_memo_quickfill (QofBook *book, const char * key)
+{
+    return get_shared_quickfill (book, key)->qf_memo;
+}
@@ -0,0 +1,70 @@
+/********************************************************************\
+ * gnc-trans-quickfill.h -- Create transaction notes and split memo *
+ *                          quick-fills                             *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+ *                                                                  *
+\********************************************************************/
+/** @addtogroup QuickFill Auto-complete typed user input.
+   @{
+*/
+/** Similar to the @ref Account_QuickFill account name quickfill, we
+ * create cached quickfills with the notes of all transactions and the
+ * memos of all splits, so that the registers of a book can share them
+ * instead of each building its own from the transactions it shows.
+*/
+
+#ifndef GNC_TRANS_QUICKFILL_H
+#define GNC_TRANS_QUICKFILL_H
+
+#include "qof.h"
+#include "QuickFill.h"
+
+/** Create/fetch a quickfill of the notes of the transactions.
+ *
+ *  Multiple, distinct quickfills, for different uses, are allowed.
+ *  Each is identified with the 'key'.  Be sure to use distinct,
+ *  unique keys that don't conflict with other users of QofBook.
+ *
+ *  This code listens to transaction modification events, and adds
+ *  the notes and memos of committed transactions to the quickfills.
+ *  Deleted transactions are not removed from them, as other
+ *  transactions may well share their text.
+ *
+ * \param book The book
+ * \param key The identifier to look up the shared object in the book
+ *
+ * \return The shared QuickFill object which is created on first
+ * calling of this function and subsequently looked up in the book by
+ * using the key.
+ */
+QuickFill * gnc_get_shared_trans_notes_quickfill (QofBook *book,
+        const char * key);
+
+/** Create/fetch a quickfill of the memos of the splits.
+ *
+ * Identical to gnc_get_shared_trans_notes_quickfill(). You should
+ * also use the same key as for the other function because the
+ * internal quickfills are updated simultaneously.
+ */
+QuickFill * gnc_get_shared_split_memo_quickfill (QofBook *book,
+        const char * key);
+
+#endif
+
+/** @} */
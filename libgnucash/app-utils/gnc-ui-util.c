@@ -58,9 +58,6 @@
 #define GNC_PREF_CURRENCY_CHOICE_OTHER  "currency-choice-other"
 #define GNC_PREF_CURRENCY_OTHER         "currency-other"
 #define GNC_PREF_REVERSED_ACCTS_NONE    "reversed-accounts-none"
-#define GNC_PREF_REVERSED_ACCTS_CREDIT  "reversed-accounts-credit"
-#define GNC_PREF_REVERSED_ACCTS_INC_EXP "reversed-accounts-incomeexpense"
-#define GNC_PREF_PRICES_FORCE_DECIMAL   "force-price-decimal"
 
 static QofLogModule log_module = GNC_MOD_GUI;
 
@@ -1101,9 +1098,9 @@ gnc_integral_print_info (void)
 
 /* Utility function for printing non-negative amounts */
 static int
-PrintAmountInternal(char *buf, gnc_numeric val, const GNCPrintAmountInfo *info)
+PrintAmountInternal(char *buf, gnc_numeric val, const GNCPrintAmountInfo *info,
+                    const struct lconv *lc)
 {
-    struct lconv *lc = gnc_localeconv();
     int num_whole_digits;
     static const size_t buf_size = 128;
     char temp_buf[buf_size];
@@ -1429,7 +1426,7 @@ xaccSPrintAmount (char * bufp, gnc_numeric val, GNCPrintAmountInfo info)
     /* Now print the value */
     bufp += PrintAmountInternal(bufp,
                                 print_absolute ? gnc_numeric_abs(val) : val,
-                                &info);
+                                &info, lc);
 
     /* Now see if we print parentheses */
     if (print_sign && (sign_posn == 0))
@@ -1462,6 +1459,288 @@ xaccSPrintAmount (char * bufp, gnc_numeric val, GNCPrintAmountInfo info)
     return (bufp - orig_bufp);
 }
 
+/* Work out the strings xaccSPrintAmount prints around the digits of an
+ * amount of the given sign. */
+static void
+gnc_amount_affixes_init (GNCAmountAffixes *affixes,
+                         const GNCPrintAmountInfo *info,
+                         const struct lconv *lc,
+                         gboolean negative, gboolean zero)
+{
+    const char *currency_symbol = "";
+    const char *sign;
+    char cs_precedes = TRUE;
+    char sep_by_space = TRUE;
+    char sign_posn;
+    gboolean print_sign;
+    int num_prefix = 0, num_suffix = 0;
+
+    memset (affixes, 0, sizeof (*affixes));
+
+    if (info->use_locale)
+    {
+        cs_precedes = negative ? lc->n_cs_precedes : lc->p_cs_precedes;
+        sep_by_space = negative ? lc->n_sep_by_space : lc->p_sep_by_space;
+    }
+
+    if (info->commodity && info->use_symbol)
+    {
+        currency_symbol = gnc_commodity_get_nice_symbol (info->commodity);
+        if (!gnc_commodity_is_iso (info->commodity))
+        {
+            cs_precedes  = FALSE;
+            sep_by_space = TRUE;
+        }
+    }
+
+    sign = negative ? lc->negative_sign : lc->positive_sign;
+    sign_posn = negative ? lc->n_sign_posn : lc->p_sign_posn;
+    print_sign = !zero && sign && sign[0];
+
+    if (print_sign && sign_posn == 1)
+        affixes->prefix[num_prefix++] = sign;
+
+    if (cs_precedes)
+    {
+        if (print_sign && sign_posn == 3)
+            affixes->prefix[num_prefix++] = sign;
+        if (info->use_symbol)
+        {
+            affixes->prefix[num_prefix++] = currency_symbol;
+            if (sep_by_space)
+                affixes->prefix[num_prefix++] = " ";
+        }
+        if (print_sign && sign_posn == 4)
+            affixes->prefix[num_prefix++] = sign;
+    }
+
+    if (print_sign && sign_posn == 0)
+    {
+        affixes->prefix[num_prefix++] = "(";
+        affixes->suffix[num_suffix++] = ")";
+        affixes->print_absolute = TRUE;
+    }
+
+    if (!cs_precedes)
+    {
+        if (print_sign && sign_posn == 3)
+            affixes->suffix[num_suffix++] = sign;
+        if (info->use_symbol)
+        {
+            if (sep_by_space)
+                affixes->suffix[num_suffix++] = " ";
+            affixes->suffix[num_suffix++] = currency_symbol;
+        }
+        if (print_sign && sign_posn == 4)
+            affixes->suffix[num_suffix++] = sign;
+    }
+
+    if (print_sign && sign_posn == 2)
+        affixes->suffix[num_suffix++] = sign;
+}
+
+void
+gnc_amount_formatter_init (GNCAmountFormatter *fmt, GNCPrintAmountInfo info)
+{
+    struct lconv *lc = gnc_localeconv ();
+
+    g_return_if_fail (fmt != NULL);
+
+    fmt->info = info;
+    fmt->lc = lc;
+
+    g_utf8_strncpy (fmt->decimal_point,
+                    info.monetary ? lc->mon_decimal_point : lc->decimal_point, 1);
+    g_utf8_strncpy (fmt->separator,
+                    info.monetary ? lc->mon_thousands_sep : lc->thousands_sep, 1);
+    fmt->grouping = info.monetary ? lc->mon_grouping : lc->grouping;
+
+    gnc_amount_affixes_init (&fmt->affixes[0], &info, lc, FALSE, FALSE);
+    gnc_amount_affixes_init (&fmt->affixes[1], &info, lc, TRUE, FALSE);
+    gnc_amount_affixes_init (&fmt->affixes[2], &info, lc, FALSE, TRUE);
+}
+
+typedef struct
+{
+    char *ptr;
+    size_t left;
+} AmountWriter;
+
+static gboolean
+amount_writer_put (AmountWriter *writer, const char *str, size_t len)
+{
+    if (len >= writer->left)
+        return FALSE;
+    memcpy (writer->ptr, str, len);
+    writer->ptr += len;
+    writer->left -= len;
+    return TRUE;
+}
+
+static gboolean
+amount_writer_put_affixes (AmountWriter *writer, const char * const *affixes)
+{
+    for (int i = 0; i < 4 && affixes[i]; i++)
+        if (!amount_writer_put (writer, affixes[i], strlen (affixes[i])))
+            return FALSE;
+    return TRUE;
+}
+
+/* Print the absolute value of an amount whose denominator is a power of
+ * ten the way PrintAmountInternal does, using integer arithmetic. Returns
+ * -1 without printing anything if the amount isn't one that this can
+ * print, 0 if it didn't fit and 1 if it was printed. */
+static int
+gnc_amount_formatter_print_decimal (const GNCAmountFormatter *fmt,
+                                    gnc_numeric val, AmountWriter *writer)
+{
+    const GNCPrintAmountInfo *info = &fmt->info;
+    /* 20 digits, with a separator of up to 6 bytes between each. */
+    char whole_buf[20 + 19 * 6];
+    char *whole_ptr = whole_buf + sizeof (whole_buf);
+    char frac_buf[G_N_ELEMENTS (pow_10)];
+    const int max_places = G_N_ELEMENTS (pow_10) - 1;
+    guint64 num, whole, frac;
+    int places = 0, frac_digits, max_dp, num_decimal_places;
+
+    if (val.denom <= 0 || val.num == G_MININT64)
+        return -1;
+    while (places < max_places && pow_10[places] < val.denom)
+        places++;
+    if (pow_10[places] != val.denom)
+        return -1;
+
+    num = val.num < 0 ? -val.num : val.num;
+    max_dp = info->force_fit ? info->max_decimal_places : 99;
+
+    /* Rounding at max_dp adds half a unit of the last place printed. */
+    if (info->round && info->force_fit)
+    {
+        if (max_dp >= max_places)
+            return -1;
+        if (places > max_dp)
+        {
+            guint64 half = 5 * pow_10[places - max_dp - 1];
+
+            if (num > G_MAXINT64 - half)
+                return -1;
+            num += half;
+        }
+    }
+
+    whole = num / val.denom;
+    frac = num % val.denom;
+
+    /* The whole part, from its last digit back. */
+    {
+        const char *group = fmt->grouping;
+        size_t separator_len = strlen (fmt->separator);
+        int group_count = 0;
+
+        do
+        {
+            *--whole_ptr = '0' + whole % 10;
+            whole /= 10;
+
+            if (whole && info->use_separators && *group != CHAR_MAX)
+            {
+                group_count++;
+
+                if (group_count == *group)
+                {
+                    whole_ptr -= separator_len;
+                    memcpy (whole_ptr, fmt->separator, separator_len);
+                    group_count = 0;
+
+                    /* A null char means repeat the last group indefinitely */
+                    if (group[1] != '\0')
+                        group++;
+                }
+            }
+        }
+        while (whole);
+    }
+
+    /* The fraction, truncated to max_dp places without trailing zeros. */
+    for (int i = places; i > 0; i--)
+    {
+        frac_buf[i - 1] = '0' + frac % 10;
+        frac /= 10;
+    }
+    frac_digits = MIN (places, max_dp);
+    while (frac_digits > 0 && frac_buf[frac_digits - 1] == '0')
+        frac_digits--;
+    num_decimal_places = MAX (frac_digits, info->min_decimal_places);
+
+    if (!amount_writer_put (writer, whole_ptr,
+                            whole_buf + sizeof (whole_buf) - whole_ptr))
+        return 0;
+    if (num_decimal_places == 0)
+        return 1;
+
+    if (!amount_writer_put (writer, fmt->decimal_point,
+                            strlen (fmt->decimal_point)) ||
+        !amount_writer_put (writer, frac_buf, frac_digits) ||
+        (size_t)(num_decimal_places - frac_digits) >= writer->left)
+        return 0;
+
+    memset (writer->ptr, '0', num_decimal_places - frac_digits);
+    writer->ptr += num_decimal_places - frac_digits;
+    writer->left -= num_decimal_places - frac_digits;
+    return 1;
+}
+
+static gboolean
+gnc_amount_formatter_print_number (const GNCAmountFormatter *fmt,
+                                   gnc_numeric val,
+                                   const GNCAmountAffixes *affixes,
+                                   AmountWriter *writer)
+{
+    /* Enough for any amount with up to 255 decimal places. */
+    char number[512];
+    int printed = gnc_amount_formatter_print_decimal (fmt, val, writer);
+    int len;
+
+    if (printed >= 0)
+        return printed;
+
+    len = PrintAmountInternal (number,
+                               affixes->print_absolute ?
+                               gnc_numeric_abs (val) : val,
+                               &fmt->info, fmt->lc);
+    return amount_writer_put (writer, number, len);
+}
+
+int
+gnc_amount_formatter_print (const GNCAmountFormatter *fmt, gnc_numeric val,
+                            char *buf, size_t size)
+{
+    const GNCAmountAffixes *affixes;
+    AmountWriter writer = { buf, size };
+
+    g_return_val_if_fail (fmt != NULL, 0);
+    if (!buf || size == 0)
+        return 0;
+
+    if (gnc_numeric_negative_p (val))
+        affixes = &fmt->affixes[1];
+    else if (gnc_numeric_zero_p (val))
+        affixes = &fmt->affixes[2];
+    else
+        affixes = &fmt->affixes[0];
+
+    if (amount_writer_put_affixes (&writer, affixes->prefix) &&
+        gnc_amount_formatter_print_number (fmt, val, affixes, &writer) &&
+        amount_writer_put_affixes (&writer, affixes->suffix))
+    {
+        *writer.ptr = '\0';
+        return writer.ptr - buf;
+    }
+
+    *buf = '\0';
+    return 0;
+}
+
 #define BUFLEN 1024
 
 const char *
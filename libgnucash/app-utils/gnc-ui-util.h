@@ -61,6 +61,9 @@ gboolean gnc_using_equity_type_opening_balance_account (QofBook* book);
 #define GNC_PREFS_GROUP_REPORT       "dialogs.report"
 #define GNC_PREF_AUTO_DECIMAL_POINT  "auto-decimal-point"
 #define GNC_PREF_AUTO_DECIMAL_PLACES "auto-decimal-places"
+#define GNC_PREF_REVERSED_ACCTS_CREDIT  "reversed-accounts-credit"
+#define GNC_PREF_REVERSED_ACCTS_INC_EXP "reversed-accounts-incomeexpense"
+#define GNC_PREF_PRICES_FORCE_DECIMAL   "force-price-decimal"
 
 /* Default directories **********************************************/
 
@@ -298,6 +301,9 @@ GNCPrintAmountInfo gnc_integral_print_info (void);
  *
  * The xaccSPrintAmount() routine accepts a pointer to the buffer to be
  *    printed to.  It returns the length of the printed string.
+ *
+ * Code printing many amounts with the same print info, or printing
+ *    from other threads, should use a GNCAmountFormatter instead.
  */
 /**
  * Make a string representation of a gnc_numeric.  Warning, the
@@ -313,6 +319,66 @@ const char * xaccPrintAmount (gnc_numeric val, GNCPrintAmountInfo info);
  */
 int xaccSPrintAmount (char *buf, gnc_numeric val, GNCPrintAmountInfo info);
 
+/** The parts of a formatted amount for one sign: the strings printed
+ *  before and after the digits. */
+typedef struct
+{
+    const char *prefix[4];
+    const char *suffix[4];
+    gboolean print_absolute;
+} GNCAmountAffixes;
+
+/** An amount formatter, which prints gnc_numerics exactly as
+ *  xaccSPrintAmount does for one GNCPrintAmountInfo.
+ *
+ *  The locale settings, currency symbol and sign placement are looked up
+ *  once when the formatter is initialized. Amounts whose denominator is a
+ *  power of ten, as those of accounts and splits are, are then printed
+ *  with integer arithmetic; other amounts go through the same rational
+ *  arithmetic as xaccSPrintAmount.
+ *
+ *  The formatter needs no allocation and may live on the stack. Once
+ *  initialized it is only read, so it may be used from several threads
+ *  at once. It refers to the commodity's symbol, so it must not outlive
+ *  the commodity and should be initialized again if the commodity or the
+ *  print info changes.
+ *
+ *  The members are private.
+ */
+typedef struct
+{
+    GNCPrintAmountInfo info;
+    const struct lconv *lc;
+    char decimal_point[8];
+    char separator[8];
+    const char *grouping;
+    /* Positive, negative and zero amounts. */
+    GNCAmountAffixes affixes[3];
+} GNCAmountFormatter;
+
+/** Initialize a formatter for printing amounts with the given print info.
+ *  This isn't thread safe, as it may read the locale for the first time.
+ */
+void gnc_amount_formatter_init (GNCAmountFormatter *fmt,
+                                GNCPrintAmountInfo info);
+
+/** Print an amount into a buffer.
+ *
+ *  @param fmt An initialized formatter.
+ *
+ *  @param val The amount to print.
+ *
+ *  @param buf The buffer to print into.
+ *
+ *  @param size The size of buf. 64 bytes suffice for any amount with a
+ *  power of ten denominator and short currency symbols and signs.
+ *
+ *  @return The length of the printed string. If it didn't fit buf holds
+ *  an empty string and 0 is returned.
+ */
+int gnc_amount_formatter_print (const GNCAmountFormatter *fmt,
+                                gnc_numeric val, char *buf, size_t size);
+
 const gchar *printable_value(gdouble val, gint denom);
 gchar *number_to_words(gdouble val, gint64 denom);
 gchar *numeric_to_words(gnc_numeric val);
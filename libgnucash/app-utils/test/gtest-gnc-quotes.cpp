@@ -39,6 +39,12 @@ gnc_default_currency(void)
 }
 }
 
+#include <glib/gstdio.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <set>
+
 #include <gtest/gtest.h>
 #include "../gnc-quotes.cpp"
 
@@ -243,6 +249,61 @@ TEST_F(GncQuotesTest, comvec_fetch)
     EXPECT_EQ(2u, gnc_pricedb_get_num_prices(pricedb));
 }
 
+/* fake-finance-quote-wrapper logs its pid and the number of quotes it made
+ * for each request, so the log shows how the commodities were batched and
+ * that the second fetch went to the wrappers started by the first. */
+TEST_F(GncQuotesTest, fq_workers)
+{
+    auto wrapper{g_getenv("FAKE_FQ_WRAPPER")};
+    ASSERT_NE(nullptr, wrapper);
+    char* log_path{nullptr};
+    auto log_fd{g_file_open_tmp("test-gnc-quotes-XXXXXX", &log_path, nullptr)};
+    ASSERT_NE(-1, log_fd);
+    close(log_fd);
+    g_setenv("FAKE_FQ_LOG", log_path, TRUE);
+
+    auto commtable{gnc_commodity_table_get_table(m_book)};
+    auto source{gnc_quote_source_lookup_by_internal("yahoo_json")};
+    CommVec comms;
+    for (auto i = 0; i < 120; ++i)
+    {
+        auto symbol{g_strdup_printf("FQ%03d", i)};
+        auto comm{gnc_commodity_new(m_book, symbol, "NASDAQ", symbol, NULL, 1)};
+        gnc_commodity_begin_edit(comm);
+        gnc_commodity_set_quote_flag(comm, TRUE);
+        gnc_commodity_set_quote_source(comm, source);
+        gnc_commodity_commit_edit(comm);
+        comms.push_back(gnc_commodity_table_insert(commtable, comm));
+        g_free(symbol);
+    }
+
+    auto pricedb{gnc_pricedb_get_db(m_book)};
+    GncQuotesImpl quotes(m_book, std::make_unique<GncFQQuoteSource>(wrapper));
+    quotes.fetch(comms);
+    EXPECT_TRUE(quotes.failures().empty());
+    EXPECT_EQ(120u, gnc_pricedb_get_num_prices(pricedb));
+    quotes.fetch(comms);
+    EXPECT_TRUE(quotes.failures().empty());
+    EXPECT_EQ(120u, gnc_pricedb_get_num_prices(pricedb));
+
+    std::ifstream log{log_path};
+    std::set<std::string> pids;
+    std::string pid;
+    auto requests{0}, quoted{0};
+    for (int count; log >> pid >> count; ++requests)
+    {
+        pids.insert(pid);
+        quoted += count;
+    }
+    EXPECT_EQ(6, requests);
+    EXPECT_EQ(240, quoted);
+    EXPECT_GE(3u, pids.size());
+
+    g_unsetenv("FAKE_FQ_LOG");
+    g_unlink(log_path);
+    g_free(log_path);
+}
+
 TEST_F(GncQuotesTest, fetch_one_commodity)
 {
      StrVec quote_vec{
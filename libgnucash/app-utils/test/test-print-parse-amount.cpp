@@ -23,6 +23,7 @@
 
 #include <config.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "gnc-ui-util.h"
 #include "gnc-numeric.h"
@@ -34,10 +35,20 @@ static void
 test_num_print_info (gnc_numeric n, GNCPrintAmountInfo print_info, int line)
 {
     gnc_numeric n_parsed = gnc_numeric_zero();
+    GNCAmountFormatter fmt;
+    char fmt_buf[256];
     const char *s;
     gboolean ok, print_ok;
 
     s = xaccPrintAmount (n, print_info);
+
+    gnc_amount_formatter_init (&fmt, print_info);
+    gnc_amount_formatter_print (&fmt, n, fmt_buf, sizeof (fmt_buf));
+    ok = (g_strcmp0 (s, fmt_buf) == 0);
+    do_test_args (ok, "formatter differs", __FILE__, __LINE__,
+                  "num: %s, string %s, formatter %s (line %d)",
+                  gnc_numeric_to_string (n), s, fmt_buf, line);
+
     print_ok = (s && s[0] != '\0');
     if (!print_ok)
         return;
@@ -157,10 +168,116 @@ run_tests (void)
     test_clear_error_list();
 }
 
+/* The formatter must print what xaccSPrintAmount prints for the print
+ * infos used for accounts, prices and shares, and for small buffers. */
+static void
+test_formatter (QofBook *book)
+{
+    auto curr = gnc_commodity_new (book, "US Dollar", "CURRENCY", "USD",
+                                   "", 100);
+    auto stock = gnc_commodity_new (book, "Gnu Stock", "NYSE", "GNU",
+                                    "", 10000);
+    GNCPrintAmountInfo infos[] =
+    {
+        gnc_commodity_print_info (curr, TRUE),
+        gnc_commodity_print_info (curr, FALSE),
+        gnc_commodity_print_info (stock, TRUE),
+        gnc_share_print_info_places (4),
+        gnc_integral_print_info (),
+    };
+    gnc_numeric values[] =
+    {
+        gnc_numeric_create (0, 100), gnc_numeric_create (1, 100),
+        gnc_numeric_create (-1, 100), gnc_numeric_create (123456789, 100),
+        gnc_numeric_create (-123456789, 100), gnc_numeric_create (5, 1),
+        gnc_numeric_create (-987654321987, 10000),
+        gnc_numeric_create (123456785, 100000), gnc_numeric_create (1, 3),
+        gnc_numeric_create (-7, 3), gnc_numeric_create (5, 8),
+        gnc_numeric_create (G_MAXINT64, 100),
+        gnc_numeric_create (G_MININT64 + 1, 100),
+    };
+    char buf[256], fmt_buf[256];
+
+    for (auto info : infos)
+    {
+        GNCAmountFormatter fmt;
+        gnc_amount_formatter_init (&fmt, info);
+
+        for (auto val : values)
+        {
+            int len = xaccSPrintAmount (buf, val, info);
+            int fmt_len = gnc_amount_formatter_print (&fmt, val, fmt_buf,
+                                                      sizeof (fmt_buf));
+
+            do_test_args (len == fmt_len && strcmp (buf, fmt_buf) == 0,
+                          "formatter differs", __FILE__, __LINE__,
+                          "num: %s, string %s, formatter %s",
+                          gnc_numeric_to_string (val), buf, fmt_buf);
+
+            /* It prints nothing rather than part of the amount. */
+            fmt_len = gnc_amount_formatter_print (&fmt, val, fmt_buf, len);
+            do_test_args (fmt_len == 0 && fmt_buf[0] == '\0',
+                          "formatter overran", __FILE__, __LINE__,
+                          "string %s, buffer of %d", buf, len);
+            fmt_len = gnc_amount_formatter_print (&fmt, val, fmt_buf, len + 1);
+            do_test_args (fmt_len == len, "formatter didn't fit",
+                          __FILE__, __LINE__, "string %s, buffer of %d",
+                          buf, len + 1);
+        }
+    }
+
+    gnc_commodity_destroy (stock);
+    gnc_commodity_destroy (curr);
+}
+
+/* Time printing a register's worth of split amounts each way. */
+static void
+time_formatter (QofBook *book)
+{
+    const int count = 200000;
+    auto curr = gnc_commodity_new (book, "US Dollar", "CURRENCY", "USD",
+                                   "", 100);
+    auto info = gnc_commodity_print_info (curr, TRUE);
+    GNCAmountFormatter fmt;
+    char buf[64];
+    gint64 start, print_time, fmt_time;
+    size_t total = 0, fmt_total = 0;
+
+    start = g_get_monotonic_time ();
+    for (int i = 0; i < count; i++)
+        total += xaccSPrintAmount (buf, gnc_numeric_create (i * 7919 - count, 100),
+                                   info);
+    print_time = g_get_monotonic_time () - start;
+
+    start = g_get_monotonic_time ();
+    gnc_amount_formatter_init (&fmt, info);
+    for (int i = 0; i < count; i++)
+        fmt_total += gnc_amount_formatter_print (&fmt,
+                                                 gnc_numeric_create (i * 7919 - count, 100),
+                                                 buf, sizeof (buf));
+    fmt_time = g_get_monotonic_time () - start;
+
+    do_test (total == fmt_total, "formatter printed the same lengths");
+    g_printf ("%d amounts: xaccSPrintAmount %" G_GINT64_FORMAT " us, "
+              "formatter %" G_GINT64_FORMAT " us\n", count, print_time, fmt_time);
+
+    gnc_commodity_destroy (curr);
+}
+
 int
 main (int argc, char **argv)
 {
+    QofBook *book;
+
+    qof_init ();
+    book = qof_book_new ();
+
     run_tests ();
+    test_formatter (book);
+    time_formatter (book);
+
+    qof_book_destroy (book);
+    qof_close ();
     print_test_results ();
     exit (get_rv ());
 }
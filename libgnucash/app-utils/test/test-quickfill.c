@@ -0,0 +1,319 @@
+/********************************************************************\
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+ *                                                                  *
+\********************************************************************/
+
+#include <config.h>
+
+#include <glib.h>
+#include <glib/gprintf.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+#include "QuickFill.h"
+#include "cashobjects.h"
+#include "gnc-trans-quickfill.h"
+#include "Transaction.h"
+#include "gnc-commodity.h"
+#include "test-stuff.h"
+
+static const char *words[] =
+{
+    "Groceries", "Rent", "Coffee", "Shop", "Market", "Payment",
+    "Transfer", "Salary", "Insurance", "Électricité", "Wasser", "Straße",
+    "Gas", "Station", "Restaurant", "Book", "Store", "Online", "Card", "Fee",
+    NULL
+};
+
+static const char *
+match_string (QuickFill *qf, const char *str)
+{
+    return gnc_quickfill_string (gnc_quickfill_get_string_match (qf, str));
+}
+
+static gboolean
+string_equal (const char *a, const char *b)
+{
+    return (a && b) ? strcmp (a, b) == 0 : a == b;
+}
+
+static void
+test_matches (void)
+{
+    QuickFill *qf = gnc_quickfill_new ();
+    QuickFillMatch match, again;
+    int len;
+
+    gnc_quickfill_insert (qf, "The Book", QUICKFILL_ALPHA);
+    gnc_quickfill_insert (qf, "The Movie", QUICKFILL_ALPHA);
+    gnc_quickfill_insert (qf, "Électricité", QUICKFILL_ALPHA);
+
+    do_test (string_equal (match_string (qf, "the"), "The Book"),
+             "matches ignore case");
+    do_test (string_equal (match_string (qf, "The M"), "The Movie"),
+             "match after the strings part");
+    do_test (match_string (qf, "The X") == NULL, "no match");
+    do_test (string_equal (match_string (qf, "élec"), "Électricité"),
+             "match of a multi-byte character");
+
+    match = gnc_quickfill_get_unique_len_match
+            (gnc_quickfill_get_string_match (qf, ""), &len);
+    do_test (match.node == qf && len == 0, "root is not unique");
+
+    match = gnc_quickfill_get_unique_len_match
+            (gnc_quickfill_get_string_match (qf, "t"), &len);
+    do_test (len == 3, "unique part of \"The \"");
+    match = gnc_quickfill_get_char_match (match, 'b');
+    do_test (string_equal (gnc_quickfill_string (match), "The Book"),
+             "char match after the unique part");
+
+    match = gnc_quickfill_get_string_len_match (qf, "Électrique", 6);
+    do_test (string_equal (gnc_quickfill_string (match), "Électricité"),
+             "length limited match");
+
+    /* A match inside an edge leaves the tree as it was. */
+    match = gnc_quickfill_get_string_match (qf, "The Bo");
+    again = gnc_quickfill_get_string_match (qf, "the bo");
+    do_test (match.node == again.node && match.offset == again.offset &&
+             match.offset > 0 && match.offset < 4,
+             "lookups don't split edges");
+    match = gnc_quickfill_get_char_match (match, 'o');
+    do_test (string_equal (gnc_quickfill_string (match), "The Book"),
+             "char match inside an edge");
+    match = gnc_quickfill_get_unique_len_match
+            (gnc_quickfill_get_string_match (qf, "The B"), &len);
+    do_test (len == 3 &&
+             string_equal (gnc_quickfill_string (match), "The Book"),
+             "unique part from inside an edge");
+
+    gnc_quickfill_insert (qf, "The Bottle", QUICKFILL_ALPHA);
+    gnc_quickfill_insert (qf, "The Bat", QUICKFILL_ALPHA);
+    do_test (string_equal (match_string (qf, "The Bo"), "The Book"),
+             "alphabetical order");
+    do_test (match_string (qf, "The Bool") == NULL &&
+             match_string (qf, "The Botle") == NULL,
+             "no match inside an edge");
+
+    gnc_quickfill_purge (qf);
+    do_test (match_string (qf, "T") == NULL, "purge");
+
+    gnc_quickfill_insert (qf, "Coffee shop", QUICKFILL_LIFO);
+    gnc_quickfill_insert (qf, "Coffee", QUICKFILL_LIFO);
+    gnc_quickfill_insert (qf, "Coffee shop", QUICKFILL_LIFO);
+    do_test (string_equal (match_string (qf, "C"), "Coffee"),
+             "lifo leaves prefixes in place");
+    do_test (string_equal (match_string (qf, "Coffee "), "Coffee shop"),
+             "lifo past the prefix");
+    gnc_quickfill_insert (qf, "Cinema", QUICKFILL_LIFO);
+    do_test (string_equal (match_string (qf, "C"), "Cinema"), "lifo");
+
+    gnc_quickfill_destroy (qf);
+}
+
+static void
+test_remove (void)
+{
+    QuickFill *qf = gnc_quickfill_new ();
+
+    gnc_quickfill_insert (qf, "abc", QUICKFILL_ALPHA);
+    gnc_quickfill_insert (qf, "abd", QUICKFILL_ALPHA);
+    gnc_quickfill_insert (qf, "ab", QUICKFILL_ALPHA);
+
+    gnc_quickfill_remove (qf, "ab", QUICKFILL_ALPHA);
+    do_test (string_equal (match_string (qf, "a"), "abc"), "remove prefix");
+
+    gnc_quickfill_remove (qf, "abc", QUICKFILL_ALPHA);
+    do_test (string_equal (match_string (qf, "a"), "abd"), "remove best");
+    do_test (match_string (qf, "abc") == NULL, "removed");
+
+    gnc_quickfill_remove (qf, "xyz", QUICKFILL_ALPHA);
+    do_test (string_equal (match_string (qf, "ab"), "abd"), "remove missing");
+
+    gnc_quickfill_remove (qf, "abd", QUICKFILL_ALPHA);
+    do_test (match_string (qf, "a") == NULL, "remove last");
+
+    gnc_quickfill_destroy (qf);
+}
+
+static char *
+random_text (void)
+{
+    return g_strdup_printf ("%s %s %d", get_random_string_in_array (words),
+                            get_random_string_in_array (words),
+                            get_random_int_in_range (0, 999));
+}
+
+static void
+test_insert_list (void)
+{
+    for (int sort = QUICKFILL_LIFO; sort <= QUICKFILL_ALPHA; sort++)
+    {
+        QuickFill *qf = gnc_quickfill_new ();
+        QuickFill *bulk = gnc_quickfill_new ();
+        GList *texts = NULL;
+        gboolean same = TRUE;
+
+        for (int i = 0; i < 2000; i++)
+            texts = g_list_prepend (texts, random_text ());
+
+        for (GList *node = texts; node; node = node->next)
+            gnc_quickfill_insert (qf, node->data, sort);
+        gnc_quickfill_insert_list (bulk, texts, sort);
+
+        for (GList *node = texts; node && same; node = node->next)
+        {
+            const char *text = node->data;
+            glong len = g_utf8_strlen (text, -1);
+
+            for (glong i = 0; i <= len && same; i++)
+            {
+                QuickFillMatch a = gnc_quickfill_get_string_len_match (qf, text, i);
+                QuickFillMatch b = gnc_quickfill_get_string_len_match (bulk, text, i);
+                int a_len, b_len;
+
+                same = string_equal (gnc_quickfill_string (a),
+                                     gnc_quickfill_string (b));
+                a = gnc_quickfill_get_unique_len_match (a, &a_len);
+                b = gnc_quickfill_get_unique_len_match (b, &b_len);
+                same = same && a_len == b_len &&
+                       string_equal (gnc_quickfill_string (a),
+                                     gnc_quickfill_string (b));
+            }
+        }
+        do_test_args (same, "insert list", __FILE__, __LINE__,
+                      "sort %d", sort);
+
+        g_list_free_full (texts, g_free);
+        gnc_quickfill_destroy (qf);
+        gnc_quickfill_destroy (bulk);
+    }
+}
+
+static void
+test_shared (void)
+{
+    QofBook *book = qof_book_new ();
+    gnc_commodity *curr = gnc_commodity_new (book, "Gnu Rand", "CURRENCY",
+                                             "GNR", "", 100);
+    Transaction *trans = xaccMallocTransaction (book);
+    Split *split = xaccMallocSplit (book);
+    QuickFill *notes, *memo;
+
+    xaccTransBeginEdit (trans);
+    xaccTransSetCurrency (trans, curr);
+    xaccTransSetNotes (trans, "Paid in cash");
+    xaccSplitSetMemo (split, "Weekly shop");
+    xaccSplitSetParent (split, trans);
+    xaccTransCommitEdit (trans);
+
+    notes = gnc_get_shared_trans_notes_quickfill (book, "test");
+    memo = gnc_get_shared_split_memo_quickfill (book, "test");
+    do_test (notes == gnc_get_shared_trans_notes_quickfill (book, "test"),
+             "notes quickfill is shared");
+    do_test (string_equal (match_string (notes, "p"), "Paid in cash"),
+             "notes of loaded transaction");
+    do_test (string_equal (match_string (memo, "w"), "Weekly shop"),
+             "memo of loaded split");
+
+    trans = xaccMallocTransaction (book);
+    split = xaccMallocSplit (book);
+    xaccTransBeginEdit (trans);
+    xaccTransSetCurrency (trans, curr);
+    xaccTransSetNotes (trans, "Paid by card");
+    xaccSplitSetMemo (split, "Monthly rent");
+    xaccSplitSetParent (split, trans);
+    xaccTransCommitEdit (trans);
+
+    do_test (string_equal (match_string (notes, "p"), "Paid by card"),
+             "notes of committed transaction");
+    do_test (string_equal (match_string (memo, "m"), "Monthly rent"),
+             "memo of committed split");
+
+    qof_book_destroy (book);
+}
+
+static size_t
+memory_in_use (void)
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+    return mallinfo2 ().uordblks;
+#else
+    return 0;
+#endif
+}
+
+/* Report what it takes to build a quickfill of the size a register of a
+ * large book fills, one string at a time and from the list. */
+static void
+time_quickfill (void)
+{
+    const int count = 50000;
+    GList *texts = NULL;
+    QuickFill *qf;
+    gint64 start, insert_time, list_time;
+    size_t before, insert_memory, list_memory;
+
+    for (int i = 0; i < count; i++)
+        texts = g_list_prepend (texts, random_text ());
+
+    before = memory_in_use ();
+    start = g_get_monotonic_time ();
+    qf = gnc_quickfill_new ();
+    for (GList *node = texts; node; node = node->next)
+        gnc_quickfill_insert (qf, node->data, QUICKFILL_LIFO);
+    insert_time = g_get_monotonic_time () - start;
+    insert_memory = memory_in_use () - before;
+    gnc_quickfill_destroy (qf);
+
+    before = memory_in_use ();
+    start = g_get_monotonic_time ();
+    qf = gnc_quickfill_new ();
+    gnc_quickfill_insert_list (qf, texts, QUICKFILL_LIFO);
+    list_time = g_get_monotonic_time () - start;
+    list_memory = memory_in_use () - before;
+
+    do_test (string_equal (match_string (qf, texts->data), texts->data),
+             "large quickfill");
+    g_printf ("%d strings: inserted in %" G_GINT64_FORMAT " us using %"
+              G_GSIZE_FORMAT " bytes, from the list in %" G_GINT64_FORMAT
+              " us using %" G_GSIZE_FORMAT " bytes\n", count, insert_time,
+              insert_memory, list_time, list_memory);
+
+    gnc_quickfill_destroy (qf);
+    g_list_free_full (texts, g_free);
+}
+
+int
+main (int argc, char **argv)
+{
+    qof_init ();
+    cashobjects_register ();
+
+    test_matches ();
+    test_remove ();
+    test_insert_list ();
+    test_shared ();
+    time_quickfill ();
+
+    qof_close ();
+    print_test_results ();
+    exit (get_rv ());
+}
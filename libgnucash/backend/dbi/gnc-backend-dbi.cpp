@@ -834,6 +834,7 @@ GncDbiBackend<Type>::session_end ()
 {
     ENTER (" ");
 
+    flush_pending ();
     finalize_version_info ();
     connect(nullptr);
 
@@ -34,6 +34,7 @@
 #include <glib/gi18n.h>
 
 #include <qof.h>
+#include <qofinstance-p.h>
 /* For cleaning up the database */
 #include <dbi/dbi.h>
 #include <gnc-uri-utils.h>
@@ -497,6 +498,378 @@ cleanup:
     }
     return;
 }
+/* Commit edits with write-behind on and check that they're held back
+ * until they're flushed or the session ends, and are in the database
+ * after it. */
+static void
+test_dbi_write_behind (Fixture* fixture, gconstpointer pData)
+{
+    auto url = (const gchar*)pData;
+    auto msg = "[GncDbiSqlConnection::unlock_database()] There was no lock entry in the Lock table";
+    auto log_domain = nullptr;
+    auto loglevel = static_cast<GLogLevelFlags> (G_LOG_LEVEL_WARNING |
+                                                 G_LOG_FLAG_FATAL);
+    TestErrorStruct* check = test_error_struct_new (log_domain, loglevel, msg);
+    fixture->hdlrs = test_log_set_fatal_handler (fixture->hdlrs, check,
+                                                 (GLogFunc)test_checked_handler);
+    if (fixture->filename)
+        url = fixture->filename;
+
+    auto session_1 = qof_session_new (qof_book_new());
+    qof_session_begin (session_1, url, SESSION_NEW_OVERWRITE);
+    g_assert_cmpint (qof_session_get_error (session_1), == , ERR_BACKEND_NO_ERR);
+    qof_session_swap_data (fixture->session, session_1);
+    qof_book_mark_session_dirty (qof_session_get_book (session_1));
+    qof_session_save (session_1, NULL);
+    g_assert_cmpint (qof_session_get_error (session_1), == , ERR_BACKEND_NO_ERR);
+    qof_session_end (session_1);
+
+    g_setenv ("GNC_SQL_WRITE_BEHIND", "1000,600000", TRUE);
+    auto session_2 = qof_session_new (qof_book_new());
+    qof_session_begin (session_2, url, SESSION_NORMAL_OPEN);
+    g_unsetenv ("GNC_SQL_WRITE_BEHIND");
+    g_assert_cmpint (qof_session_get_error (session_2), == , ERR_BACKEND_NO_ERR);
+    qof_session_load (session_2, NULL);
+    auto book_2 = qof_session_get_book (session_2);
+    auto acct = gnc_account_lookup_by_name (gnc_book_get_root_account (book_2),
+                                            "Bank 1");
+    g_assert (acct != NULL);
+    for (auto name : {"Bank A", "Bank B", "Bank C"})
+    {
+        xaccAccountBeginEdit (acct);
+        xaccAccountSetName (acct, name);
+        xaccAccountCommitEdit (acct);
+    }
+    g_assert_cmpint (qof_session_get_error (session_2), == , ERR_BACKEND_NO_ERR);
+    g_assert (qof_instance_get_dirty_flag (acct));
+    g_assert (qof_book_session_not_saved (book_2));
+
+    /* An account created under write-behind is inserted by the first
+     * flush and updated by the next. */
+    auto sql_be = reinterpret_cast<GncSqlBackend*>(qof_session_get_backend (session_2));
+    auto new_acct = xaccMallocAccount (book_2);
+    xaccAccountBeginEdit (new_acct);
+    xaccAccountSetName (new_acct, "Bank D");
+    xaccAccountSetType (new_acct, ACCT_TYPE_BANK);
+    xaccAccountSetCommodity (new_acct, xaccAccountGetCommodity (acct));
+    gnc_account_append_child (gnc_book_get_root_account (book_2), new_acct);
+    xaccAccountCommitEdit (new_acct);
+    g_assert (qof_instance_get_infant (QOF_INSTANCE (new_acct)));
+    g_assert (sql_be->flush_pending ());
+    g_assert (!qof_instance_get_infant (QOF_INSTANCE (new_acct)));
+    xaccAccountBeginEdit (new_acct);
+    xaccAccountSetName (new_acct, "Bank E");
+    xaccAccountCommitEdit (new_acct);
+    g_assert (sql_be->flush_pending ());
+    g_assert_cmpint (qof_session_get_error (session_2), == , ERR_BACKEND_NO_ERR);
+    g_assert (!qof_instance_get_dirty_flag (new_acct));
+
+    /* A queued account that's been opened again is left for its commit. */
+    xaccAccountBeginEdit (new_acct);
+    xaccAccountSetName (new_acct, "Bank F");
+    xaccAccountCommitEdit (new_acct);
+    xaccAccountBeginEdit (new_acct);
+    xaccAccountSetName (new_acct, "Bank G");
+    g_assert (sql_be->flush_pending ());
+    g_assert (qof_instance_get_dirty_flag (new_acct));
+    xaccAccountCommitEdit (new_acct);
+    g_assert (sql_be->flush_pending ());
+    g_assert_cmpint (qof_session_get_error (session_2), == , ERR_BACKEND_NO_ERR);
+    g_assert (!qof_instance_get_dirty_flag (new_acct));
+    qof_session_end (session_2);
+    g_assert (!qof_instance_get_dirty_flag (acct));
+
+    auto session_3 = qof_session_new (qof_book_new());
+    qof_session_begin (session_3, url, SESSION_READ_ONLY);
+    g_assert_cmpint (qof_session_get_error (session_3), == , ERR_BACKEND_NO_ERR);
+    qof_session_load (session_3, NULL);
+    auto root_3 = gnc_book_get_root_account (qof_session_get_book (session_3));
+    g_assert (gnc_account_lookup_by_name (root_3, "Bank C") != NULL);
+    g_assert (gnc_account_lookup_by_name (root_3, "Bank G") != NULL);
+    g_assert (gnc_account_lookup_by_name (root_3, "Bank E") == NULL);
+    g_assert (gnc_account_lookup_by_name (root_3, "Bank D") == NULL);
+    qof_session_end (session_3);
+
+    qof_session_destroy (session_3);
+    qof_session_destroy (session_2);
+    qof_session_destroy (session_1);
+}
+
+/* Edit the slots of a saved account a piece at a time, so that the
+ * changed slots are written on their own, and check that what's read back
+ * matches what's in memory. */
+static void
+test_dbi_slot_changes (Fixture* fixture, gconstpointer pData)
+{
+    auto url = (const gchar*)pData;
+    auto msg = "[GncDbiSqlConnection::unlock_database()] There was no lock entry in the Lock table";
+    auto log_domain = nullptr;
+    auto loglevel = static_cast<GLogLevelFlags> (G_LOG_LEVEL_WARNING |
+                                                 G_LOG_FLAG_FATAL);
+    TestErrorStruct* check = test_error_struct_new (log_domain, loglevel, msg);
+    fixture->hdlrs = test_log_set_fatal_handler (fixture->hdlrs, check,
+                                                 (GLogFunc)test_checked_handler);
+    if (fixture->filename)
+        url = fixture->filename;
+
+    auto session_1 = qof_session_new (qof_book_new());
+    qof_session_begin (session_1, url, SESSION_NEW_OVERWRITE);
+    g_assert_cmpint (qof_session_get_error (session_1), == , ERR_BACKEND_NO_ERR);
+    qof_session_swap_data (fixture->session, session_1);
+    qof_book_mark_session_dirty (qof_session_get_book (session_1));
+    qof_session_save (session_1, NULL);
+    g_assert_cmpint (qof_session_get_error (session_1), == , ERR_BACKEND_NO_ERR);
+    qof_session_end (session_1);
+
+    auto session_2 = qof_session_new (qof_book_new());
+    qof_session_begin (session_2, url, SESSION_NORMAL_OPEN);
+    g_assert_cmpint (qof_session_get_error (session_2), == , ERR_BACKEND_NO_ERR);
+    qof_session_load (session_2, NULL);
+    auto root_2 = gnc_book_get_root_account (qof_session_get_book (session_2));
+    auto acct = gnc_account_lookup_by_name (root_2, "Bank 1");
+    g_assert (acct != NULL);
+    auto frame = qof_instance_get_slots (QOF_INSTANCE (acct));
+
+    xaccAccountBeginEdit (acct);
+    delete frame->set ({"string-val"}, new KvpValue (g_strdup ("qrstuvwxyz")));
+    delete frame->set ({"int64-val"}, nullptr);
+    delete frame->set_path ({"nested", "a"}, new KvpValue (INT64_C (1)));
+    delete frame->set_path ({"nested", "b"}, new KvpValue (g_strdup ("b")));
+    qof_instance_set_dirty (QOF_INSTANCE (acct));
+    xaccAccountCommitEdit (acct);
+    g_assert_cmpint (qof_session_get_error (session_2), == , ERR_BACKEND_NO_ERR);
+
+    xaccAccountBeginEdit (acct);
+    delete frame->set_path ({"nested", "a"}, new KvpValue (INT64_C (2)));
+    delete frame->set ({"double-val"}, new KvpValue (g_strdup ("2.71828")));
+    qof_instance_set_dirty (QOF_INSTANCE (acct));
+    xaccAccountCommitEdit (acct);
+    g_assert_cmpint (qof_session_get_error (session_2), == , ERR_BACKEND_NO_ERR);
+
+    auto session_3 = qof_session_new (qof_book_new());
+    qof_session_begin (session_3, url, SESSION_READ_ONLY);
+    g_assert_cmpint (qof_session_get_error (session_3), == , ERR_BACKEND_NO_ERR);
+    qof_session_load (session_3, NULL);
+    auto root_3 = gnc_book_get_root_account (qof_session_get_book (session_3));
+    auto acct_3 = gnc_account_lookup_by_name (root_3, "Bank 1");
+    g_assert (acct_3 != NULL);
+    auto frame_3 = qof_instance_get_slots (QOF_INSTANCE (acct_3));
+    g_assert_cmpint (compare (frame, frame_3), ==, 0);
+    g_assert (frame_3->get_slot ({"int64-val"}) == nullptr);
+    g_assert_cmpint (frame_3->get_slot ({"nested", "a"})->get<int64_t> (), ==, 2);
+    g_assert_cmpstr (frame_3->get_slot ({"double-val"})->get<const char*> (), ==,
+                     "2.71828");
+    qof_session_end (session_3);
+    qof_session_end (session_2);
+
+    qof_session_destroy (session_3);
+    qof_session_destroy (session_2);
+    qof_session_destroy (session_1);
+}
+
+/* Commit a new commodity and objects that refer to it with the existence
+ * cache checked against the database on every lookup. */
+static void
+test_dbi_in_db_cache (Fixture* fixture, gconstpointer pData)
+{
+    auto url = (const gchar*)pData;
+    auto msg = "[GncDbiSqlConnection::unlock_database()] There was no lock entry in the Lock table";
+    auto log_domain = nullptr;
+    auto loglevel = static_cast<GLogLevelFlags> (G_LOG_LEVEL_WARNING |
+                                                 G_LOG_FLAG_FATAL);
+    TestErrorStruct* check = test_error_struct_new (log_domain, loglevel, msg);
+    fixture->hdlrs = test_log_set_fatal_handler (fixture->hdlrs, check,
+                                                 (GLogFunc)test_checked_handler);
+    if (fixture->filename)
+        url = fixture->filename;
+
+    auto session_1 = qof_session_new (qof_book_new());
+    qof_session_begin (session_1, url, SESSION_NEW_OVERWRITE);
+    g_assert_cmpint (qof_session_get_error (session_1), == , ERR_BACKEND_NO_ERR);
+    qof_session_swap_data (fixture->session, session_1);
+    qof_book_mark_session_dirty (qof_session_get_book (session_1));
+    qof_session_save (session_1, NULL);
+    g_assert_cmpint (qof_session_get_error (session_1), == , ERR_BACKEND_NO_ERR);
+    qof_session_end (session_1);
+
+    g_setenv ("GNC_SQL_CHECK_IN_DB", "1", TRUE);
+    auto session_2 = qof_session_new (qof_book_new());
+    qof_session_begin (session_2, url, SESSION_NORMAL_OPEN);
+    g_unsetenv ("GNC_SQL_CHECK_IN_DB");
+    g_assert_cmpint (qof_session_get_error (session_2), == , ERR_BACKEND_NO_ERR);
+    qof_session_load (session_2, NULL);
+    auto book_2 = qof_session_get_book (session_2);
+    auto table_2 = gnc_commodity_table_get_table (book_2);
+
+    auto comm = gnc_commodity_new (book_2, "Gnu Stock", "NASDAQ", "GNU",
+                                   "", 100);
+    comm = gnc_commodity_table_insert (table_2, comm);
+    auto acct = xaccMallocAccount (book_2);
+    xaccAccountBeginEdit (acct);
+    xaccAccountSetType (acct, ACCT_TYPE_STOCK);
+    xaccAccountSetName (acct, "Gnu Shares");
+    xaccAccountSetCommodity (acct, comm);
+    gnc_account_append_child (gnc_book_get_root_account (book_2), acct);
+    xaccAccountCommitEdit (acct);
+    gnc_commodity_begin_edit (comm);
+    gnc_commodity_set_fullname (comm, "Gnu Stock Common");
+    gnc_commodity_commit_edit (comm);
+    g_assert_cmpint (qof_session_get_error (session_2), == , ERR_BACKEND_NO_ERR);
+    qof_session_end (session_2);
+
+    auto session_3 = qof_session_new (qof_book_new());
+    qof_session_begin (session_3, url, SESSION_READ_ONLY);
+    g_assert_cmpint (qof_session_get_error (session_3), == , ERR_BACKEND_NO_ERR);
+    qof_session_load (session_3, NULL);
+    auto book_3 = qof_session_get_book (session_3);
+    auto comm_3 = gnc_commodity_table_lookup (gnc_commodity_table_get_table (book_3),
+                                              "NASDAQ", "GNU");
+    g_assert (comm_3 != NULL);
+    g_assert_cmpstr (gnc_commodity_get_fullname (comm_3), ==, "Gnu Stock Common");
+    auto acct_3 = gnc_account_lookup_by_name (gnc_book_get_root_account (book_3),
+                                              "Gnu Shares");
+    g_assert (acct_3 != NULL);
+    g_assert (xaccAccountGetCommodity (acct_3) == comm_3);
+    qof_session_end (session_3);
+
+    qof_session_destroy (session_3);
+    qof_session_destroy (session_2);
+    qof_session_destroy (session_1);
+}
+
+static void
+count_events (QofInstance* inst, QofEventId event_type, gpointer handler_data,
+              gpointer event_data)
+{
+    if (event_type == QOF_EVENT_CREATE || event_type == QOF_EVENT_MODIFY)
+        ++*static_cast<int*> (handler_data);
+}
+
+/* One session writes to the book while another one, opened read-only on
+ * the same database, picks the changes up from the change log. */
+static void
+test_dbi_poll_changes (Fixture* fixture, gconstpointer pData)
+{
+    auto url = (const gchar*)pData;
+    auto msg = "[GncDbiSqlConnection::unlock_database()] There was no lock entry in the Lock table";
+    auto log_domain = nullptr;
+    auto loglevel = static_cast<GLogLevelFlags> (G_LOG_LEVEL_WARNING |
+                                                 G_LOG_FLAG_FATAL);
+    TestErrorStruct* check = test_error_struct_new (log_domain, loglevel, msg);
+    fixture->hdlrs = test_log_set_fatal_handler (fixture->hdlrs, check,
+                                                 (GLogFunc)test_checked_handler);
+    if (fixture->filename)
+        url = fixture->filename;
+
+    g_setenv ("GNC_SQL_CHANGE_LOG", "1", TRUE);
+    auto session_1 = qof_session_new (qof_book_new());
+    qof_session_begin (session_1, url, SESSION_NEW_OVERWRITE);
+    g_unsetenv ("GNC_SQL_CHANGE_LOG");
+    g_assert_cmpint (qof_session_get_error (session_1), == , ERR_BACKEND_NO_ERR);
+    qof_session_swap_data (fixture->session, session_1);
+    qof_book_mark_session_dirty (qof_session_get_book (session_1));
+    qof_session_save (session_1, NULL);
+    g_assert_cmpint (qof_session_get_error (session_1), == , ERR_BACKEND_NO_ERR);
+    qof_session_end (session_1);
+
+    auto session_2 = qof_session_new (qof_book_new());
+    qof_session_begin (session_2, url, SESSION_NORMAL_OPEN);
+    g_assert_cmpint (qof_session_get_error (session_2), == , ERR_BACKEND_NO_ERR);
+    qof_session_load (session_2, NULL);
+    auto book_2 = qof_session_get_book (session_2);
+    auto root_2 = gnc_book_get_root_account (book_2);
+
+    auto session_3 = qof_session_new (qof_book_new());
+    qof_session_begin (session_3, url, SESSION_READ_ONLY);
+    g_assert_cmpint (qof_session_get_error (session_3), == , ERR_BACKEND_NO_ERR);
+    qof_session_load (session_3, NULL);
+    auto book_3 = qof_session_get_book (session_3);
+    auto root_3 = gnc_book_get_root_account (book_3);
+    auto sql_be = reinterpret_cast<GncSqlBackend*>(qof_session_get_backend (session_3));
+    auto bank_3 = gnc_account_lookup_by_name (root_3, "Bank 1");
+    g_assert (bank_3 != NULL);
+    g_assert_cmpint (sql_be->poll_changes (), ==, 0);
+
+    auto bank_2 = gnc_account_lookup_by_name (root_2, "Bank 1");
+    xaccAccountBeginEdit (bank_2);
+    xaccAccountSetName (bank_2, "Bank 2");
+    xaccAccountCommitEdit (bank_2);
+    auto cash = xaccMallocAccount (book_2);
+    xaccAccountBeginEdit (cash);
+    xaccAccountSetType (cash, ACCT_TYPE_CASH);
+    xaccAccountSetName (cash, "Cash");
+    xaccAccountSetCommodity (cash, xaccAccountGetCommodity (bank_2));
+    gnc_account_append_child (root_2, cash);
+    xaccAccountCommitEdit (cash);
+    auto tx = xaccMallocTransaction (book_2);
+    xaccTransBeginEdit (tx);
+    xaccTransSetCurrency (tx, xaccAccountGetCommodity (bank_2));
+    xaccTransSetDescription (tx, "Withdrawal");
+    auto split = xaccMallocSplit (book_2);
+    xaccSplitSetAccount (split, bank_2);
+    xaccSplitSetParent (split, tx);
+    xaccSplitSetValue (split, gnc_numeric_create (-1000, 100));
+    xaccSplitSetAmount (split, gnc_numeric_create (-1000, 100));
+    split = xaccMallocSplit (book_2);
+    xaccSplitSetAccount (split, cash);
+    xaccSplitSetParent (split, tx);
+    xaccSplitSetValue (split, gnc_numeric_create (1000, 100));
+    xaccSplitSetAmount (split, gnc_numeric_create (1000, 100));
+    xaccTransCommitEdit (tx);
+    g_assert_cmpint (qof_session_get_error (session_2), == , ERR_BACKEND_NO_ERR);
+
+    int events = 0;
+    auto handler = qof_event_register_handler (count_events, &events);
+    g_assert_cmpint (sql_be->poll_changes (), >=, 3);
+    qof_event_unregister_handler (handler);
+    g_assert_cmpint (events, >=, 3);
+    g_assert (gnc_account_lookup_by_name (root_3, "Bank 2") == bank_3);
+    auto cash_3 = gnc_account_lookup_by_name (root_3, "Cash");
+    g_assert (cash_3 != NULL);
+    auto tx_3 = xaccTransLookup (qof_instance_get_guid (tx), book_3);
+    g_assert (tx_3 != NULL);
+    g_assert_cmpint (xaccTransCountSplits (tx_3), ==, 2);
+    g_assert (gnc_numeric_equal (xaccAccountGetBalance (cash_3),
+                                 gnc_numeric_create (1000, 100)));
+
+    xaccTransBeginEdit (tx);
+    xaccTransSetDescription (tx, "Cash withdrawal");
+    xaccTransCommitEdit (tx);
+    g_assert_cmpint (sql_be->poll_changes (), >=, 1);
+    tx_3 = xaccTransLookup (qof_instance_get_guid (tx), book_3);
+    g_assert_cmpstr (xaccTransGetDescription (tx_3), ==, "Cash withdrawal");
+    g_assert (gnc_numeric_equal (xaccAccountGetBalance (cash_3),
+                                 gnc_numeric_create (1000, 100)));
+    g_assert_cmpint (sql_be->poll_changes (), ==, 0);
+
+    /* A transaction that's open here, or has a split with unsaved
+     * changes, isn't read back over the edits. */
+    xaccTransBeginEdit (tx_3);
+    xaccTransBeginEdit (tx);
+    xaccTransSetDescription (tx, "ATM withdrawal");
+    xaccTransCommitEdit (tx);
+    g_assert_cmpint (sql_be->poll_changes (), ==, 0);
+    g_assert (xaccTransLookup (qof_instance_get_guid (tx), book_3) == tx_3);
+    g_assert_cmpstr (xaccTransGetDescription (tx_3), ==, "Cash withdrawal");
+    xaccTransRollbackEdit (tx_3);
+
+    auto split_3 = xaccTransGetSplit (tx_3, 0);
+    qof_instance_set_dirty_flag (split_3, TRUE);
+    xaccTransBeginEdit (tx);
+    xaccTransSetDescription (tx, "Bank withdrawal");
+    xaccTransCommitEdit (tx);
+    g_assert_cmpint (sql_be->poll_changes (), ==, 0);
+    g_assert (xaccTransLookup (qof_instance_get_guid (tx), book_3) == tx_3);
+    g_assert_cmpstr (xaccTransGetDescription (tx_3), ==, "Cash withdrawal");
+    qof_instance_set_dirty_flag (split_3, FALSE);
+
+    qof_session_end (session_3);
+    qof_session_end (session_2);
+    qof_session_destroy (session_3);
+    qof_session_destroy (session_2);
+    qof_session_destroy (session_1);
+}
+
 /* Test the gnc_dbi_load logic that forces a newer database to be
  * opened read-only and an older one to be safe-saved. Again, it would
  * be better to do this starting from a fresh file, but instead we're
@@ -639,6 +1012,14 @@ create_dbi_test_suite (const char* dbm_name, const char* url)
                   test_dbi_store_and_reload, teardown);
     GNC_TEST_ADD (subsuite, "safe_save", Fixture, url, setup_memory,
                   test_dbi_safe_save, teardown);
+    GNC_TEST_ADD (subsuite, "write_behind", Fixture, url, setup_memory,
+                  test_dbi_write_behind, teardown);
+    GNC_TEST_ADD (subsuite, "slot_changes", Fixture, url, setup_memory,
+                  test_dbi_slot_changes, teardown);
+    GNC_TEST_ADD (subsuite, "in_db_cache", Fixture, url, setup_memory,
+                  test_dbi_in_db_cache, teardown);
+    GNC_TEST_ADD (subsuite, "poll_changes", Fixture, url, setup_memory,
+                  test_dbi_poll_changes, teardown);
     GNC_TEST_ADD (subsuite, "version_control", Fixture, url, setup_memory,
                   test_dbi_version_control, teardown);
     GNC_TEST_ADD (subsuite, "business_store_and_reload", Fixture, url,
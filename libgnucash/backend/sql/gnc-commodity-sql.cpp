@@ -165,6 +165,22 @@ GncSqlCommodityBackend::load_all (GncSqlBackend* sql_be)
     gnc_sql_slots_load_for_sql_subquery (sql_be, sql,
 					 (BookLookupFn)gnc_commodity_find_commodity_by_guid);
 }
+QofInstance*
+GncSqlCommodityBackend::reload (GncSqlBackend* sql_be, const GncGUID& guid)
+{
+    auto inst = GncSqlObjectBackend::reload (sql_be, guid);
+    if (inst == nullptr)
+        return nullptr;
+
+    /* A commodity new to this session has to go in the commodity table. */
+    auto comm = GNC_COMMODITY (inst);
+    auto table = gnc_commodity_table_get_table (sql_be->book());
+    if (gnc_commodity_table_lookup (table, gnc_commodity_get_namespace (comm),
+                                    gnc_commodity_get_mnemonic (comm)) == nullptr)
+        comm = gnc_commodity_table_insert (table, comm);
+    return QOF_INSTANCE (comm);
+}
+
 /* ================================================================= */
 static gboolean
 do_commit_commodity (GncSqlBackend* sql_be, QofInstance* inst,
@@ -40,6 +40,7 @@ public:
     GncSqlCommodityBackend();
     void load_all(GncSqlBackend*) override;
     bool commit(GncSqlBackend*, QofInstance*) override;
+    QofInstance* reload(GncSqlBackend*, const GncGUID&) override;
 };
 
 #endif /* GNC_COMMODITY_SQL_H */
@@ -39,6 +39,9 @@
 
 #include <string>
 #include <sstream>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
 
 #include "gnc-sql-connection.hpp"
 #include "gnc-sql-backend.hpp"
@@ -629,6 +632,324 @@ save_slot (const char* key, KvpValue* value, slot_info_t & slot_info)
     }
 }
 
+/* Change tracking: for each object whose slots are known to match the
+ * database we keep a fingerprint of every top-level slot, so that a save
+ * only has to write the slots whose fingerprint changed. Objects without a
+ * fingerprint get their slots rewritten in full, as before.
+ */
+struct SlotPrint
+{
+    std::string key;
+    size_t hash;
+    bool is_container;
+};
+using SlotPrints = std::vector<SlotPrint>;
+
+struct GuidHash
+{
+    size_t operator() (const GncGUID& guid) const noexcept
+    {
+        size_t hash;
+        memcpy (&hash, guid.reserved, sizeof (hash));
+        return hash;
+    }
+};
+
+struct GuidEqual
+{
+    bool operator() (const GncGUID& a, const GncGUID& b) const noexcept
+    {
+        return guid_equal (&a, &b);
+    }
+};
+
+using SlotPrintMap = std::unordered_map<GncGUID, SlotPrints, GuidHash, GuidEqual>;
+
+#define SLOT_PRINTS_KEY "gnc-sql-slot-prints"
+
+static void
+slot_prints_destroy (QofBook* book, gpointer key, gpointer user_data)
+{
+    delete static_cast<SlotPrintMap*> (user_data);
+}
+
+static SlotPrintMap*
+get_slot_prints (GncSqlBackend* sql_be)
+{
+    auto book = sql_be->book();
+    if (book == nullptr)
+        return nullptr;
+    auto prints = static_cast<SlotPrintMap*> (qof_book_get_data (book,
+                                                                 SLOT_PRINTS_KEY));
+    if (prints == nullptr)
+    {
+        prints = new SlotPrintMap;
+        qof_book_set_data_fin (book, SLOT_PRINTS_KEY, prints,
+                               slot_prints_destroy);
+    }
+    return prints;
+}
+
+static inline void
+hash_combine (size_t& hash, size_t value)
+{
+    hash ^= value + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+}
+
+static size_t
+hash_value (const KvpValue* value)
+{
+    size_t hash = 0;
+    if (value == nullptr)
+        return hash;
+
+    auto type = value->get_type ();
+    hash_combine (hash, static_cast<size_t> (type));
+    switch (type)
+    {
+    case KvpValue::Type::INT64:
+        hash_combine (hash, value->get<int64_t> ());
+        break;
+    case KvpValue::Type::DOUBLE:
+    {
+        auto d = value->get<double> ();
+        uint64_t bits;
+        memcpy (&bits, &d, sizeof (bits));
+        hash_combine (hash, bits);
+        break;
+    }
+    case KvpValue::Type::NUMERIC:
+    {
+        auto num = value->get<gnc_numeric> ();
+        hash_combine (hash, num.num);
+        hash_combine (hash, num.denom);
+        break;
+    }
+    case KvpValue::Type::STRING:
+    {
+        auto str = value->get<const char*> ();
+        if (str)
+            hash_combine (hash, std::hash<std::string>{} (str));
+        break;
+    }
+    case KvpValue::Type::GUID:
+    {
+        auto guid = value->get<GncGUID*> ();
+        if (guid)
+        {
+            hash_combine (hash, GuidHash{} (*guid));
+            size_t tail;
+            memcpy (&tail, guid->reserved + sizeof (tail), sizeof (tail));
+            hash_combine (hash, tail);
+        }
+        break;
+    }
+    case KvpValue::Type::TIME64:
+        hash_combine (hash, value->get<Time64> ().t);
+        break;
+    case KvpValue::Type::GDATE:
+    {
+        auto date = value->get<GDate> ();
+        hash_combine (hash, g_date_valid (&date) ? g_date_get_julian (&date) : 0);
+        break;
+    }
+    case KvpValue::Type::GLIST:
+        for (auto cursor = value->get<GList*> (); cursor; cursor = cursor->next)
+            hash_combine (hash, hash_value (static_cast<KvpValue*> (cursor->data)));
+        break;
+    case KvpValue::Type::FRAME:
+        if (auto frame = value->get<KvpFrame*> ())
+            frame->for_each_slot_temp ([&hash](const char* key, KvpValue* child)
+            {
+                hash_combine (hash, std::hash<std::string>{} (key));
+                hash_combine (hash, hash_value (child));
+            });
+        break;
+    default:
+        break;
+    }
+    return hash;
+}
+
+static bool
+is_container (const KvpValue* value)
+{
+    auto type = value->get_type ();
+    return type == KvpValue::Type::FRAME || type == KvpValue::Type::GLIST;
+}
+
+static SlotPrints
+make_slot_prints (KvpFrame* frame)
+{
+    SlotPrints prints;
+    frame->for_each_slot_temp ([&prints](const char* key, KvpValue* value)
+    {
+        if (value != nullptr)
+            prints.push_back ({key, hash_value (value), is_container (value)});
+    });
+    return prints;
+}
+
+/* Deletes the rows of a single top-level slot, including those of the
+ * frames and lists below it. */
+static void
+delete_slot (const std::string& key, slot_info_t& slot_info)
+{
+    if (!slot_info.is_ok)
+        return;
+
+    auto sql_be = slot_info.be;
+    slot_info.path = key;
+
+    PairVec where;
+    col_table[obj_guid_col]->add_to_query (TABLE_NAME, &slot_info, where);
+    col_table[name_col]->add_to_query (TABLE_NAME, &slot_info, where);
+
+    auto sql = std::string{"SELECT "} + col_table[slot_type_col]->name () +
+        "," + col_table[guid_val_col]->name () + " FROM " TABLE_NAME;
+    auto stmt = sql_be->create_statement_from_sql (sql);
+    if (stmt != nullptr)
+    {
+        stmt->add_where_cond (TABLE_NAME, where);
+        auto result = sql_be->execute_select_statement (stmt);
+        for (auto row : *result)
+        {
+            try
+            {
+                auto type = row.get_int_at_col (col_table[slot_type_col]->name ());
+                if (type != KvpValue::Type::FRAME && type != KvpValue::Type::GLIST)
+                    continue;
+                GncGUID child_guid;
+                auto val = row.get_string_at_col (col_table[guid_val_col]->name ());
+                if (string_to_guid (val.c_str (), &child_guid))
+                    gnc_sql_slots_delete (sql_be, &child_guid);
+            }
+            catch (std::invalid_argument&)
+            {
+                continue;
+            }
+        }
+        delete result;
+    }
+
+    stmt = sql_be->create_statement_from_sql ("DELETE FROM " TABLE_NAME);
+    if (stmt == nullptr)
+    {
+        slot_info.is_ok = FALSE;
+        return;
+    }
+    stmt->add_where_cond (TABLE_NAME, where);
+    slot_info.is_ok = sql_be->execute_nonselect_statement (stmt) != -1;
+}
+
+/* Rewrites the row of a top-level slot holding a single value. */
+static void
+update_slot (const std::string& key, KvpValue* value, slot_info_t& slot_info)
+{
+    if (!slot_info.is_ok)
+        return;
+
+    slot_info.pKvpValue = value;
+    slot_info.path = key;
+    slot_info.value_type = value->get_type ();
+
+    PairVec where;
+    col_table[obj_guid_col]->add_to_query (TABLE_NAME, &slot_info, where);
+    col_table[name_col]->add_to_query (TABLE_NAME, &slot_info, where);
+
+    PairVec values;
+    for (int col = slot_type_col; col <= gdate_val_col; ++col)
+        col_table[col]->add_to_query (TABLE_NAME, &slot_info, values);
+
+    std::ostringstream sql;
+    sql << "UPDATE " TABLE_NAME " SET ";
+    for (auto const& col_value : values)
+    {
+        if (col_value != *values.begin())
+            sql << ",";
+        sql << col_value.first << "=" << col_value.second;
+    }
+
+    auto stmt = slot_info.be->create_statement_from_sql (sql.str ());
+    if (stmt == nullptr)
+    {
+        slot_info.is_ok = FALSE;
+        return;
+    }
+    stmt->add_where_cond (TABLE_NAME, where);
+    slot_info.is_ok = slot_info.be->execute_nonselect_statement (stmt) != -1;
+}
+
+/* Writes the difference between the slots as last saved and the frame.
+ * Both lists of prints are in the frame's key order. */
+static void
+save_changed_slots (const SlotPrints& saved, const SlotPrints& current,
+                    KvpFrame* frame, slot_info_t& slot_info)
+{
+    auto old_it = saved.begin ();
+    auto new_it = current.begin ();
+
+    while (slot_info.is_ok && (old_it != saved.end () || new_it != current.end ()))
+    {
+        int order = old_it == saved.end () ? 1 : new_it == current.end () ? -1 :
+            strcmp (old_it->key.c_str (), new_it->key.c_str ());
+        if (order < 0)
+        {
+            delete_slot (old_it->key, slot_info);
+            ++old_it;
+            continue;
+        }
+
+        auto value = frame->get_slot ({new_it->key});
+        if (order > 0)
+            save_slot (new_it->key.c_str (), value, slot_info);
+        else if (old_it->hash != new_it->hash)
+        {
+            if (!old_it->is_container && !new_it->is_container)
+                update_slot (new_it->key, value, slot_info);
+            else
+            {
+                delete_slot (new_it->key, slot_info);
+                save_slot (new_it->key.c_str (), value, slot_info);
+            }
+        }
+        if (order == 0)
+            ++old_it;
+        ++new_it;
+    }
+}
+
+void
+gnc_sql_slots_track (GncSqlBackend* sql_be, QofInstance* inst)
+{
+    g_return_if_fail (sql_be != NULL);
+    g_return_if_fail (inst != NULL);
+
+    /* Only a clean object that is already in the database is known to have
+     * the same slots as the database. */
+    if (sql_be->pristine () || qof_instance_get_infant (inst) ||
+        qof_instance_get_dirty_flag (inst))
+        return;
+
+    auto prints = get_slot_prints (sql_be);
+    auto frame = qof_instance_get_slots (inst);
+    if (prints == nullptr || frame == nullptr)
+        return;
+
+    auto guid = qof_instance_get_guid (inst);
+    if (prints->find (*guid) == prints->end ())
+        prints->emplace (*guid, make_slot_prints (frame));
+}
+
+void
+gnc_sql_slots_forget_changes (GncSqlBackend* sql_be)
+{
+    g_return_if_fail (sql_be != NULL);
+
+    if (auto prints = get_slot_prints (sql_be))
+        prints->clear ();
+}
+
 gboolean
 gnc_sql_slots_save (GncSqlBackend* sql_be, const GncGUID* guid, gboolean is_infant,
                     QofInstance* inst)
@@ -641,16 +962,35 @@ gnc_sql_slots_save (GncSqlBackend* sql_be, const GncGUID* guid, gboolean is_infa
     g_return_val_if_fail (guid != NULL, FALSE);
     g_return_val_if_fail (pFrame != NULL, FALSE);
 
-    // If this is not saving into a new db, clear out the old saved slots first
-    if (!sql_be->pristine() && !is_infant)
+    slot_info.be = sql_be;
+    slot_info.guid = guid;
+
+    auto prints = get_slot_prints (sql_be);
+    auto current = make_slot_prints (pFrame);
+    auto saved = prints ? prints->find (*guid) : SlotPrintMap::iterator{};
+
+    if (sql_be->pristine() || is_infant)
+    {
+        pFrame->for_each_slot_temp (save_slot, slot_info);
+    }
+    else if (prints != nullptr && saved != prints->end ())
     {
+        save_changed_slots (saved->second, current, pFrame, slot_info);
+    }
+    else
+    {
+        // We don't know what was saved before, so clear it all out first
         (void)gnc_sql_slots_delete (sql_be, guid);
+        pFrame->for_each_slot_temp (save_slot, slot_info);
     }
 
-    slot_info.be = sql_be;
-    slot_info.guid = guid;
-    pFrame->for_each_slot_temp (save_slot, slot_info);
-
+    if (prints != nullptr)
+    {
+        if (slot_info.is_ok)
+            (*prints)[*guid] = std::move (current);
+        else
+            prints->erase (*guid);
+    }
     return slot_info.is_ok;
 }
 
@@ -665,6 +1005,9 @@ gnc_sql_slots_delete (GncSqlBackend* sql_be, const GncGUID* guid)
     g_return_val_if_fail (sql_be != NULL, FALSE);
     g_return_val_if_fail (guid != NULL, FALSE);
 
+    if (auto prints = get_slot_prints (sql_be))
+        prints->erase (*guid);
+
     (void)guid_to_string_buff (guid, guid_buf);
 
     buf = g_strdup_printf ("SELECT * FROM %s WHERE obj_guid='%s' and slot_type in ('%d', '%d') and not guid_val is null",
@@ -59,6 +59,28 @@ public:
 gboolean gnc_sql_slots_save (GncSqlBackend* sql_be, const GncGUID* guid,
                              gboolean is_infant, QofInstance* inst);
 
+/**
+ * gnc_sql_slots_track - Starts tracking changes to an object's slots.
+ *
+ * Called when an edit begins; if the object is clean and already in the db
+ * its slots are fingerprinted so that the next save writes only the
+ * top-level slots that changed. Objects which aren't tracked have all of
+ * their slots rewritten on save.
+ *
+ * @param sql_be SQL backend
+ * @param inst The QofInstance owning the slots.
+ */
+void gnc_sql_slots_track (GncSqlBackend* sql_be, QofInstance* inst);
+
+/**
+ * gnc_sql_slots_forget_changes - Drops all change tracking, so that every
+ * object's slots are rewritten in full the next time it is saved. Used
+ * when a db transaction is rolled back.
+ *
+ * @param sql_be SQL backend
+ */
+void gnc_sql_slots_forget_changes (GncSqlBackend* sql_be);
+
 /**
  * gnc_sql_slots_delete - Deletes slots for an object from the db.
  *
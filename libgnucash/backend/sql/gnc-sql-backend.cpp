@@ -30,9 +30,13 @@
 #include <gncTaxTable.h>
 #include <gncInvoice.h>
 #include <gnc-pricedb.h>
+#include <Split.h>
+#include <Transaction.h>
+#include <guid.hpp>
 
 #include <algorithm>
 #include <cassert>
+#include <cstdlib>
 
 #include "gnc-sql-connection.hpp"
 #include "gnc-sql-backend.hpp"
@@ -66,6 +70,17 @@ static QofLogModule log_module = G_LOG_DOMAIN;
 #define MAX_TABLE_NAME_LEN 50
 #define TABLE_COL_NAME "table_name"
 #define VERSION_COL_NAME "table_version"
+#define WRITE_BEHIND_ENV "GNC_SQL_WRITE_BEHIND"
+#define WRITE_BEHIND_DEFAULT_DELAY 2000
+#define CHECK_IN_DB_ENV "GNC_SQL_CHECK_IN_DB"
+#define CHANGE_LOG_ENV "GNC_SQL_CHANGE_LOG"
+#define CHANGES_TABLE_NAME "changes"
+#define CHANGES_TABLE_VERSION 1
+#define CHANGE_SEQ_COL_NAME "seq"
+#define CHANGE_TYPE_COL_NAME "obj_type"
+#define CHANGE_GUID_COL_NAME "obj_guid"
+#define CHANGE_SESSION_COL_NAME "session_guid"
+#define MAX_TYPE_NAME_LEN 50
 
 using StrVec = std::vector<std::string>;
 
@@ -76,13 +91,34 @@ static EntryVec version_table
         TABLE_COL_NAME, MAX_TABLE_NAME_LEN, COL_PKEY | COL_NNUL),
     gnc_sql_make_table_entry<CT_INT>(VERSION_COL_NAME, 0, COL_NNUL)
 };
+static EntryVec changes_table
+{
+    gnc_sql_make_table_entry<CT_INT>(
+        CHANGE_SEQ_COL_NAME, 0, COL_PKEY | COL_NNUL | COL_AUTOINC),
+    gnc_sql_make_table_entry<CT_STRING>(
+        CHANGE_TYPE_COL_NAME, MAX_TYPE_NAME_LEN, COL_NNUL),
+    gnc_sql_make_table_entry<CT_GUID>(CHANGE_GUID_COL_NAME, 0, COL_NNUL),
+    gnc_sql_make_table_entry<CT_GUID>(CHANGE_SESSION_COL_NAME, 0, COL_NNUL)
+};
 
 GncSqlBackend::GncSqlBackend(GncSqlConnection *conn, QofBook* book) :
     QofBackend {}, m_conn{conn}, m_book{book}, m_loading{false},
-    m_in_query{false}, m_is_pristine_db{false}
+    m_in_query{false}, m_is_pristine_db{false},
+    m_session_guid{gnc::GUID::create_random().to_string()}
 {
     if (conn != nullptr)
         connect (conn);
+
+    if (auto setting = g_getenv (WRITE_BEHIND_ENV))
+    {
+        char* end = nullptr;
+        auto max_pending = strtoul (setting, &end, 10);
+        auto max_delay = *end == ',' ? strtoul (end + 1, nullptr, 10) :
+            WRITE_BEHIND_DEFAULT_DELAY;
+        set_write_behind (max_pending, std::chrono::milliseconds (max_delay));
+    }
+    m_check_in_db = g_getenv (CHECK_IN_DB_ENV) != nullptr;
+    m_want_change_log = g_getenv (CHANGE_LOG_ENV) != nullptr;
 }
 
 GncSqlBackend::~GncSqlBackend()
@@ -93,9 +129,12 @@ GncSqlBackend::~GncSqlBackend()
 void
 GncSqlBackend::connect(GncSqlConnection *conn) noexcept
 {
+    if (m_conn != nullptr)
+        flush_pending();
     if (m_conn != nullptr && m_conn != conn)
         delete m_conn;
     finalize_version_info();
+    m_in_db.clear();
     m_conn = conn;
 }
 
@@ -287,6 +326,9 @@ GncSqlBackend::load (QofBook* book, QofBackendLoadType loadType)
     {
         assert (m_book == nullptr);
         m_book = book;
+        /* Before anything is read, so that nothing written meanwhile is
+         * missed by poll_changes(). */
+        init_change_log();
 
         auto num_types = m_backend_registry.size();
         auto num_done = 0;
@@ -348,6 +390,184 @@ GncSqlBackend::load (QofBook* book, QofBackendLoadType loadType)
 
 /* ================================================================= */
 
+void
+GncSqlBackend::set_change_log (bool enable) noexcept
+{
+    m_want_change_log = enable;
+    if (enable && !m_change_log && m_conn != nullptr && m_book != nullptr)
+        create_change_log();
+}
+
+bool
+GncSqlBackend::create_change_log() noexcept
+{
+    if (get_table_version (CHANGES_TABLE_NAME) == 0 &&
+        !create_table (CHANGES_TABLE_NAME, CHANGES_TABLE_VERSION,
+                       changes_table))
+    {
+        PERR ("Unable to create the change log table");
+        return false;
+    }
+    m_change_log = true;
+    return true;
+}
+
+void
+GncSqlBackend::init_change_log() noexcept
+{
+    m_change_log = false;
+    m_last_change = 0;
+    if (get_table_version (CHANGES_TABLE_NAME) == 0 &&
+        !(m_want_change_log && create_change_log()))
+        return;
+
+    m_change_log = true;
+    auto stmt = create_statement_from_sql ("SELECT MAX(" CHANGE_SEQ_COL_NAME
+                                           ") AS " CHANGE_SEQ_COL_NAME
+                                           " FROM " CHANGES_TABLE_NAME);
+    auto result = stmt ? execute_select_statement (stmt) : nullptr;
+    if (result == nullptr)
+        return;
+    for (auto row : *result)
+    {
+        if (!row.is_col_null (CHANGE_SEQ_COL_NAME))
+            m_last_change = row.get_int_at_col (CHANGE_SEQ_COL_NAME);
+    }
+    delete result;
+}
+
+bool
+GncSqlBackend::log_change (QofInstance* inst) noexcept
+{
+    if (!m_change_log)
+        return true;
+
+    /* Splits are read back with their transaction. */
+    if (strcmp (inst->e_type, GNC_ID_SPLIT) == 0)
+    {
+        inst = QOF_INSTANCE (xaccSplitGetParent (GNC_SPLIT (inst)));
+        if (inst == nullptr)
+            return true;
+    }
+
+    std::stringstream sql;
+    sql << "INSERT INTO " CHANGES_TABLE_NAME "(" CHANGE_TYPE_COL_NAME ","
+        CHANGE_GUID_COL_NAME "," CHANGE_SESSION_COL_NAME ") VALUES(" <<
+        quote_string (inst->e_type) << "," <<
+        quote_string (gnc::GUID{*qof_instance_get_guid (inst)}.to_string()) <<
+        "," << quote_string (m_session_guid) << ")";
+    auto stmt = create_statement_from_sql (sql.str());
+    return stmt != nullptr && execute_nonselect_statement (stmt) != -1;
+}
+
+/* Whether 'inst' is open for editing, counting a split as open while its
+ * transaction is. */
+static bool
+open_for_edit (QofInstance* inst)
+{
+    if (qof_instance_get_editlevel (inst) > 0)
+        return true;
+    if (!GNC_IS_SPLIT (inst))
+        return false;
+    auto trans = xaccSplitGetParent (GNC_SPLIT (inst));
+    return trans && qof_instance_get_editlevel (QOF_INSTANCE (trans)) > 0;
+}
+
+int
+GncSqlBackend::poll_changes() noexcept
+{
+    if (!m_change_log || m_conn == nullptr || m_book == nullptr)
+        return 0;
+
+    ENTER ("since %" G_GINT64_FORMAT, m_last_change);
+    std::stringstream sql;
+    sql << "SELECT * FROM " CHANGES_TABLE_NAME " WHERE " CHANGE_SEQ_COL_NAME
+        " > " << m_last_change << " ORDER BY " CHANGE_SEQ_COL_NAME;
+    auto stmt = create_statement_from_sql (sql.str());
+    auto result = stmt ? execute_select_statement (stmt) : nullptr;
+    if (result == nullptr)
+    {
+        LEAVE ("Query failed");
+        return 0;
+    }
+
+    /* Each object once, in the order of its first change, so that objects
+     * are read before those that were changed to refer to them. */
+    std::vector<std::pair<std::string, GncGUID>> changed;
+    std::unordered_set<std::string> seen;
+    for (auto row : *result)
+    {
+        try
+        {
+            m_last_change = std::max<int64_t> (m_last_change,
+                                               row.get_int_at_col (CHANGE_SEQ_COL_NAME));
+            if (row.get_string_at_col (CHANGE_SESSION_COL_NAME) == m_session_guid)
+                continue;
+            GncGUID guid;
+            auto guid_str = row.get_string_at_col (CHANGE_GUID_COL_NAME);
+            if (!string_to_guid (guid_str.c_str(), &guid) ||
+                !seen.insert (guid_str).second)
+                continue;
+            changed.emplace_back (row.get_string_at_col (CHANGE_TYPE_COL_NAME),
+                                  guid);
+        }
+        catch (std::invalid_argument&)
+        {
+            continue;
+        }
+    }
+    delete result;
+
+    /* A transaction is read back with its splits, so theirs count too. */
+    auto changed_here = [this](QofInstance* inst) {
+        return qof_instance_get_dirty_flag (inst) || m_pending_set.count (inst) ||
+            open_for_edit (inst);
+    };
+    auto has_local_changes = [&changed_here](QofInstance* inst) {
+        if (changed_here (inst))
+            return true;
+        if (!GNC_IS_TRANS (inst))
+            return false;
+        for (auto node = xaccTransGetSplitList (GNC_TRANS (inst)); node;
+             node = g_list_next (node))
+            if (changed_here (QOF_INSTANCE (node->data)))
+                return true;
+        return false;
+    };
+
+    int reloaded = 0;
+    m_loading = true;
+    for (const auto& change : changed)
+    {
+        auto obe = m_backend_registry.get_object_backend (change.first);
+        if (obe == nullptr)
+            continue;
+        auto coll = qof_book_get_collection (m_book, change.first.c_str());
+        auto old = qof_collection_lookup_entity (coll, &change.second);
+        /* What's been changed here will be written over the other change;
+         * reloading would throw away edits still being made. */
+        if (old && has_local_changes (old))
+        {
+            PWARN ("%s %s was changed in another session and in this one, "
+                   "keeping this one's changes.", change.first.c_str(),
+                   gnc::GUID{change.second}.to_string().c_str());
+            continue;
+        }
+        auto inst = obe->reload (this, change.second);
+        ++reloaded;
+        if (inst == nullptr)
+            continue;
+        qof_instance_mark_clean (inst);
+        qof_event_gen (inst, inst == old ? QOF_EVENT_MODIFY : QOF_EVENT_CREATE,
+                       nullptr);
+    }
+    m_loading = false;
+    if (reloaded)
+        m_in_db.clear();
+    LEAVE ("%d objects reloaded", reloaded);
+    return reloaded;
+}
+
 bool
 GncSqlBackend::write_account_tree(Account* root)
 {
@@ -469,10 +689,23 @@ GncSqlBackend::sync(QofBook* book)
 
     /* Create new tables */
     m_is_pristine_db = true;
+    m_in_db.clear();
     create_tables();
+    if (m_want_change_log || m_change_log)
+    {
+        m_last_change = 0;
+        create_change_log();
+    }
 
     /* Save all contents */
     m_book = book;
+    /* Queued commits are written with everything else; they stay queued
+     * in case this fails. */
+    if (m_flush_source)
+    {
+        g_source_remove (m_flush_source);
+        m_flush_source = 0;
+    }
     auto is_ok = m_conn->begin_transaction();
 
     // FIXME: should write the set of commodities that are used
@@ -511,6 +744,15 @@ GncSqlBackend::sync(QofBook* book)
     {
         m_is_pristine_db = false;
 
+        while (!m_pending.empty())
+        {
+            auto inst = m_pending.back();
+            qof_instance_mark_clean (inst);
+            qof_instance_clear_infant (inst);
+            forget_pending (inst);
+        }
+        m_flush_error = ERR_BACKEND_NO_ERR;
+
         /* Mark the session as clean -- though it shouldn't ever get
          * marked dirty with this backend
          */
@@ -520,6 +762,8 @@ GncSqlBackend::sync(QofBook* book)
     {
         set_error (ERR_BACKEND_SERVER_ERR);
         m_conn->rollback_transaction ();
+        gnc_sql_slots_forget_changes (this);
+        m_in_db.clear();
     }
     finish_progress();
     LEAVE ("book=%p", book);
@@ -531,10 +775,9 @@ GncSqlBackend::sync(QofBook* book)
 void
 GncSqlBackend::begin(QofInstance* inst)
 {
-    //g_return_if_fail (inst != NULL);
-
-    //ENTER (" ");
-    //LEAVE ("");
+    if (inst == nullptr || m_loading || m_conn == nullptr)
+        return;
+    gnc_sql_slots_track (this, inst);
 }
 
 void
@@ -559,6 +802,170 @@ GncSqlBackend::get_object_backend(const std::string& type) const noexcept
 }
 
 
+void
+GncSqlBackend::set_write_behind(std::size_t max_pending,
+                                 std::chrono::milliseconds max_delay) noexcept
+{
+    flush_pending();
+    m_max_pending = max_pending;
+    m_max_delay = max_delay;
+}
+
+bool
+GncSqlBackend::drop_pending(QofInstance* inst) noexcept
+{
+    if (!m_pending_set.erase (inst))
+        return false;
+    m_pending.erase (std::remove (m_pending.begin(), m_pending.end(), inst),
+                     m_pending.end());
+    return true;
+}
+
+void
+GncSqlBackend::forget_pending(QofInstance* inst) noexcept
+{
+    if (drop_pending (inst))
+        g_object_weak_unref (G_OBJECT (inst), pending_finalized_cb, this);
+}
+
+void
+GncSqlBackend::pending_finalized_cb(gpointer data, GObject* inst)
+{
+    auto sql_be = static_cast<GncSqlBackend*>(data);
+    PWARN ("Queued %p was freed before it was written", inst);
+    sql_be->drop_pending (reinterpret_cast<QofInstance*>(inst));
+}
+
+void
+GncSqlBackend::queue_commit(QofInstance* inst) noexcept
+{
+    if (m_pending_set.insert (inst).second)
+    {
+        m_pending.push_back (inst);
+        g_object_weak_ref (G_OBJECT (inst), pending_finalized_cb, this);
+    }
+    /* The timer isn't running after a flush failed, so a commit of an
+     * object that stayed queued starts it again. */
+    if (m_pending.size() >= m_max_pending)
+        flush_pending();
+    else if (m_flush_source == 0)
+        m_flush_source = g_timeout_add (m_max_delay.count(), flush_pending_cb,
+                                        this);
+}
+
+void
+GncSqlBackend::requeue_pending(std::vector<QofInstance*>&& pending) noexcept
+{
+    /* Anything queued while the batch was being written comes after it. */
+    for (auto inst : m_pending)
+    {
+        g_object_weak_unref (G_OBJECT (inst), pending_finalized_cb, this);
+        pending.push_back (inst);
+    }
+    m_pending.clear();
+    m_pending_set.clear();
+    for (auto inst : pending)
+    {
+        if (!m_pending_set.insert (inst).second)
+            continue;
+        m_pending.push_back (inst);
+        g_object_weak_ref (G_OBJECT (inst), pending_finalized_cb, this);
+    }
+}
+
+gboolean
+GncSqlBackend::flush_pending_cb(gpointer data)
+{
+    auto sql_be = static_cast<GncSqlBackend*>(data);
+    sql_be->m_flush_source = 0;
+    /* Nobody is waiting on the error here, and the engine clears the
+     * backend's error before each commit, so keep it for the next queued
+     * commit to report. */
+    if (!sql_be->flush_pending())
+        sql_be->m_flush_error = sql_be->get_error();
+    return G_SOURCE_REMOVE;
+}
+
+bool
+GncSqlBackend::flush_pending() noexcept
+{
+    if (m_flush_source)
+    {
+        g_source_remove (m_flush_source);
+        m_flush_source = 0;
+    }
+    if (m_pending.empty())
+        return true;
+
+    ENTER ("%zu objects", m_pending.size());
+    /* Take the queue now, as committing may queue more objects. What's
+     * open for editing stays queued until it's committed again. */
+    std::vector<QofInstance*> pending, open;
+    for (auto inst : m_pending)
+    {
+        g_object_weak_unref (G_OBJECT (inst), pending_finalized_cb, this);
+        (open_for_edit (inst) ? open : pending).push_back (inst);
+    }
+    m_pending.clear();
+    m_pending_set.clear();
+    requeue_pending (std::move (open));
+    if (pending.empty())
+    {
+        LEAVE ("All open for editing");
+        return true;
+    }
+
+    if (m_conn == nullptr || !m_conn->begin_transaction ())
+    {
+        PERR ("begin_transaction failed\n");
+        requeue_pending (std::move (pending));
+        set_error (ERR_BACKEND_SERVER_ERR);
+        LEAVE ("Database transaction begin error");
+        return false;
+    }
+
+    bool is_ok = true;
+    for (auto inst : pending)
+    {
+        auto obe = m_backend_registry.get_object_backend(std::string{inst->e_type});
+        if (obe == nullptr)
+        {
+            PERR ("Unknown object type '%s'\n", inst->e_type);
+            continue;
+        }
+        if (!obe->commit(this, inst) || !log_change(inst))
+        {
+            is_ok = false;
+            break;
+        }
+    }
+
+    if (!is_ok || !m_conn->commit_transaction ())
+    {
+        /* Roll the lot back and queue it again to be retried. */
+        (void)m_conn->rollback_transaction();
+        gnc_sql_slots_forget_changes (this);
+        m_in_db.clear();
+        requeue_pending (std::move (pending));
+        set_error (ERR_BACKEND_SERVER_ERR);
+        LEAVE ("Rolled back - database error");
+        return false;
+    }
+
+    /* qof_commit_edit_part2 only clears the infant flag of an instance
+     * written before it returns; without this a new object would be
+     * inserted again the next time it's committed. */
+    for (auto inst : pending)
+    {
+        qof_instance_mark_clean (inst);
+        qof_instance_clear_infant (inst);
+    }
+    m_flush_error = ERR_BACKEND_NO_ERR;
+    qof_book_mark_session_saved(m_book);
+    LEAVE ("");
+    return true;
+}
+
 /* Commit_edit handler - find the correct backend handler for this object
  * type and call its commit handler
  */
@@ -572,19 +979,20 @@ GncSqlBackend::commit (QofInstance* inst)
     g_return_if_fail (inst != NULL);
     g_return_if_fail (m_conn != nullptr);
 
-    if (qof_book_is_readonly(m_book))
-    {
-        set_error (ERR_BACKEND_READONLY);
-        (void)m_conn->rollback_transaction ();
-        return;
-    }
     /* During initial load where objects are being created, don't commit
-    anything, but do mark the object as clean. */
+    anything, but do mark the object as clean. The same goes for objects
+    read back by poll_changes(), which may be in a read-only book. */
     if (m_loading)
     {
         qof_instance_mark_clean (inst);
         return;
     }
+    if (qof_book_is_readonly(m_book))
+    {
+        set_error (ERR_BACKEND_READONLY);
+        (void)m_conn->rollback_transaction ();
+        return;
+    }
 
     // The engine has a PriceDB object but it isn't in the database
     if (strcmp (inst->e_type, "PriceDB") == 0)
@@ -610,6 +1018,29 @@ GncSqlBackend::commit (QofInstance* inst)
         return;
     }
 
+    /* Objects being destroyed are freed as soon as we return, so they
+     * can't wait in the queue; what's queued is written first to keep
+     * the order of commits. */
+    if (m_max_pending && !is_destroying)
+    {
+        queue_commit (inst);
+        /* Report a failed flush made from the timer, which had no one to
+         * report it to. */
+        if (m_flush_error != ERR_BACKEND_NO_ERR)
+        {
+            set_error (m_flush_error);
+            m_flush_error = ERR_BACKEND_NO_ERR;
+        }
+        LEAVE ("Queued");
+        return;
+    }
+    forget_pending (inst);
+    if (!flush_pending())
+    {
+        LEAVE ("Queued commits failed");
+        return;
+    }
+
     if (!m_conn->begin_transaction ())
     {
         PERR ("begin_transaction failed\n");
@@ -621,7 +1052,7 @@ GncSqlBackend::commit (QofInstance* inst)
 
     auto obe = m_backend_registry.get_object_backend(std::string{inst->e_type});
     if (obe != nullptr)
-        is_ok = obe->commit(this, inst);
+        is_ok = obe->commit(this, inst) && log_change(inst);
     else
     {
         PERR ("Unknown object type '%s'\n", inst->e_type);
@@ -637,6 +1068,8 @@ GncSqlBackend::commit (QofInstance* inst)
     {
         // Error - roll it back
         (void)m_conn->rollback_transaction();
+        gnc_sql_slots_forget_changes (this);
+        m_in_db.clear();
 
         // This *should* leave things marked dirty
         LEAVE ("Rolled back - database error");
@@ -816,6 +1249,23 @@ get_object_values (QofIdTypeConst obj_name,
     return vec;
 }
 
+/* The value of the column that object_in_db() identifies rows by, quoted
+ * as for a query. */
+static std::string
+get_key_value (QofIdTypeConst obj_name, gpointer pObject, const EntryVec& table)
+{
+    PairVec values;
+    for (auto const& table_row : table)
+    {
+        if (!(table_row->is_autoincr()))
+        {
+            table_row->add_to_query (obj_name, pObject, values);
+            break;
+        }
+    }
+    return values.empty() ? empty_string : values[0].second;
+}
+
 bool
 GncSqlBackend::object_in_db (const char* table_name, QofIdTypeConst obj_name,
                              const gpointer pObject, const EntryVec& table) const noexcept
@@ -824,6 +1274,40 @@ GncSqlBackend::object_in_db (const char* table_name, QofIdTypeConst obj_name,
     g_return_val_if_fail (obj_name != nullptr, false);
     g_return_val_if_fail (pObject != nullptr, false);
 
+    auto key = get_key_value (obj_name, pObject, table);
+    auto keys = m_in_db.find (table_name);
+    if (keys == m_in_db.end ())
+    {
+        /* Read the keys of the whole table, once. */
+        auto col = std::find_if (table.begin(), table.end(),
+                                 [](const GncSqlColumnTableEntryPtr& entry)
+                                 { return !entry->is_autoincr(); });
+        if (col == table.end())
+            return false;
+        auto sql = std::string{"SELECT "} + (*col)->name() + " FROM " + table_name;
+        auto stmt = create_statement_from_sql(sql.c_str());
+        auto result = stmt ? execute_select_statement (stmt) : nullptr;
+        if (result == nullptr)
+            return false;
+        std::unordered_set<std::string> found;
+        for (auto row : *result)
+        {
+            try
+            {
+                found.insert (quote_string (row.get_string_at_col ((*col)->name())));
+            }
+            catch (std::invalid_argument&)
+            {
+                continue;
+            }
+        }
+        delete result;
+        keys = m_in_db.emplace (table_name, std::move (found)).first;
+    }
+    auto in_db = keys->second.count (key) > 0;
+    if (!m_check_in_db)
+        return in_db;
+
     /* SELECT * FROM */
     auto sql = std::string{"SELECT "} + table[0]->name() + " FROM " + table_name;
     auto stmt = create_statement_from_sql(sql.c_str());
@@ -835,7 +1319,12 @@ GncSqlBackend::object_in_db (const char* table_name, QofIdTypeConst obj_name,
     values.resize(1);
     stmt->add_where_cond(obj_name, values);
     auto result = execute_select_statement (stmt);
-    return (result != nullptr && result->size() > 0);
+    auto found = result != nullptr && result->size() > 0;
+    if (found != in_db)
+        PERR ("%s %s is %sin table %s, but the cache says otherwise",
+              obj_name, key.c_str(), found ? "" : "not ", table_name);
+    assert (found == in_db);
+    return found;
 }
 
 bool
@@ -863,7 +1352,19 @@ GncSqlBackend::do_db_operation (E_DB_OPERATION op, const char* table_name,
     }
     if (stmt == nullptr)
         return false;
-    return (execute_nonselect_statement(stmt) != -1);
+    if (execute_nonselect_statement(stmt) == -1)
+        return false;
+
+    auto keys = m_in_db.find (table_name);
+    if (keys != m_in_db.end() && op != OP_DB_UPDATE)
+    {
+        auto key = get_key_value (obj_name, pObject, table);
+        if (op == OP_DB_INSERT)
+            keys->second.insert (key);
+        else
+            keys->second.erase (key);
+    }
+    return true;
 }
 
 bool
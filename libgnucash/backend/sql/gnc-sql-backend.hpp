@@ -27,9 +27,13 @@
 #include <qof.h>
 #include <Account.h>
 
+#include <chrono>
 #include <memory>
 #include <exception>
 #include <sstream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include <qof-backend.hpp>
 
@@ -95,6 +99,49 @@ public:
      * @param inst Object being edited
      */
     void rollback(QofInstance*) override;
+    /**
+     * Queue commits and write them to the database together.
+     *
+     * Committed objects are kept in a queue, an object committed again
+     * while queued only once, and the queue is written in a single
+     * database transaction once it holds @a max_pending objects, once
+     * the oldest has waited @a max_delay, and before anything else is
+     * written or the connection closes.  Deletions are never delayed.
+     * Objects stay dirty until they are written; a failed write is
+     * reported through the backend error.  The default comes from
+     * the GNC_SQL_WRITE_BEHIND environment variable,
+     * "max_pending[,max_delay_ms]".
+     *
+     * @param max_pending Objects to queue before writing, 0 to write
+     * each commit at once
+     * @param max_delay Longest an object waits in the queue
+     */
+    void set_write_behind(std::size_t max_pending,
+                          std::chrono::milliseconds max_delay) noexcept;
+    /**
+     * Log each commit in the database's change log table, creating it if
+     * need be, so that other sessions on the same database can pick the
+     * changes up with poll_changes(). Once a database has a change log,
+     * every session that opens it keeps it up to date. The default comes
+     * from the GNC_SQL_CHANGE_LOG environment variable.
+     *
+     * @param enable Whether to create the change log
+     */
+    void set_change_log(bool enable) noexcept;
+    /**
+     * Read back the objects other sessions changed since the book was
+     * loaded or last polled, and send the usual QOF events for them.
+     * Objects with unsaved changes in this session are left alone.
+     *
+     * @return The number of objects read back
+     */
+    int poll_changes() noexcept;
+    /**
+     * Write any queued commits to the database.
+     *
+     * @return true if the queue was written or empty
+     */
+    bool flush_pending() noexcept;
     /** Connect the backend to a GncSqlConnection.
      * Sets up version info. Calling with nullptr clears the connection and
      * destroys the version info.
@@ -203,6 +250,11 @@ public:
     /**
      * Checks whether an object is in the database or not.
      *
+     * The keys of a table's rows are read once and then kept up to date by
+     * do_db_operation(), so that only the first check of each table goes to
+     * the database. Setting GNC_SQL_CHECK_IN_DB in the environment makes
+     * every check query the database too and assert that the two agree.
+     *
      * @param table_name DB table name
      * @param obj_name QOF object type name
      * @param pObject Object to be checked
@@ -252,6 +304,15 @@ private:
     bool write_transactions();
     bool write_template_transactions();
     bool write_schedXactions();
+    bool create_change_log() noexcept;
+    void init_change_log() noexcept;
+    bool log_change(QofInstance*) noexcept;
+    void queue_commit(QofInstance*) noexcept;
+    void requeue_pending(std::vector<QofInstance*>&&) noexcept;
+    bool drop_pending(QofInstance*) noexcept;
+    void forget_pending(QofInstance*) noexcept;
+    static gboolean flush_pending_cb(gpointer);
+    static void pending_finalized_cb(gpointer, GObject*);
     GncSqlStatementPtr build_insert_statement (const char* table_name,
                                                QofIdTypeConst obj_name,
                                                gpointer pObject,
@@ -286,6 +347,23 @@ private:
     };
     ObjectBackendRegistry m_backend_registry;
     std::vector<gnc_commodity*> m_postload_commodities;
+    /* Write-behind queue, in the order of first commit. */
+    std::vector<QofInstance*> m_pending;
+    std::unordered_set<QofInstance*> m_pending_set;
+    std::size_t m_max_pending = 0;
+    std::chrono::milliseconds m_max_delay{0};
+    unsigned int m_flush_source = 0;
+    /* The error of a flush made from the timer, for the next commit. */
+    QofBackendError m_flush_error = ERR_BACKEND_NO_ERR;
+    /* Keys of the rows known to be in each table, filled the first time
+     * object_in_db() looks in the table. */
+    mutable std::unordered_map<std::string, std::unordered_set<std::string>> m_in_db;
+    bool m_check_in_db = false;
+    /* Change log shared with other sessions on the database. */
+    bool m_want_change_log = false;
+    bool m_change_log = false;
+    int64_t m_last_change = 0;
+    std::string m_session_guid;
 };
 
 #endif //__GNC_SQL_BACKEND_HPP__
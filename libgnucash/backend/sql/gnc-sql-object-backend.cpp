@@ -27,6 +27,9 @@
 #include "gnc-sql-column-table-entry.hpp"
 #include "gnc-slots-sql.h"
 
+#include <guid.hpp>
+#include <kvp-frame.hpp>
+
 static QofLogModule log_module = G_LOG_DOMAIN;
 
 bool
@@ -85,6 +88,58 @@ GncSqlObjectBackend::create_tables (GncSqlBackend* sql_be)
              "Table creation aborted.", m_table_name.c_str(), m_version, version);
 }
 
+QofInstance*
+GncSqlObjectBackend::reload (GncSqlBackend* sql_be, const GncGUID& guid)
+{
+    g_return_val_if_fail (sql_be != nullptr, nullptr);
+
+    auto book = sql_be->book();
+    auto coll = qof_book_get_collection (book, m_type_name.c_str());
+    auto inst = qof_collection_lookup_entity (coll, &guid);
+
+    auto sql = std::string{"SELECT * FROM "} + m_table_name;
+    auto stmt = sql_be->create_statement_from_sql (sql);
+    if (stmt == nullptr)
+        return nullptr;
+    PairVec key{std::make_pair (std::string{m_col_table[0]->name()},
+                                quote_string (gnc::GUID{guid}.to_string()))};
+    stmt->add_where_cond (m_type_name.c_str(), key);
+    auto result = sql_be->execute_select_statement (stmt);
+    if (result == nullptr)
+        return nullptr;
+
+    auto& row = result->begin();
+    if (row == result->end())
+    {
+        if (inst != nullptr)
+            PWARN ("%s %s was deleted from the database, reopen the book "
+                   "to drop it.", m_type_name.c_str(),
+                   gnc::GUID{guid}.to_string().c_str());
+        delete result;
+        return nullptr;
+    }
+
+    if (inst == nullptr)
+    {
+        inst = static_cast<QofInstance*>(qof_object_new_instance (m_type_name.c_str(),
+                                                                  book));
+        if (inst == nullptr)
+        {
+            delete result;
+            return nullptr;
+        }
+        qof_instance_set_guid (inst, &guid);
+    }
+    gnc_sql_load_object (sql_be, row, m_type_name.c_str(), inst, m_col_table);
+    delete result;
+
+    auto frame = qof_instance_get_slots (inst);
+    for (const auto& key : frame->get_keys())
+        delete frame->set ({key}, nullptr);
+    gnc_sql_slots_load (sql_be, inst);
+    return inst;
+}
+
 bool
 GncSqlObjectBackend::instance_in_db(const GncSqlBackend* sql_be,
                                     QofInstance* inst) const noexcept
@@ -81,6 +81,14 @@ public:
      * @return true if the objects were successfully written, false otherwise.
      */
     virtual bool write (GncSqlBackend* sql_be) { return true; }
+    /**
+     * Read a single object of m_type_name back from the database after
+     * another session changed it, creating it if it isn't loaded yet.
+     * @param sql_be The GncSqlBackend containing the database.
+     * @param guid The GUID of the object.
+     * @return The object, or nullptr if it's no longer in the database.
+     */
+    virtual QofInstance* reload (GncSqlBackend* sql_be, const GncGUID& guid);
     /**
      * Return the m_type_name for the class. This value is created at
      * compilation time and is called QofIdType or QofIdTypeConst in other parts
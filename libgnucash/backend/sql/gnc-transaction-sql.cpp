@@ -723,6 +723,32 @@ GncSqlTransBackend::load_all (GncSqlBackend* sql_be)
                                    nullptr);
 }
 
+/**
+ * Reloads a transaction and its splits. The splits may have changed in any
+ * way, so the old transaction is destroyed and the new one read in full.
+ *
+ * @param sql_be SQL backend
+ * @param guid Transaction GUID
+ */
+QofInstance*
+GncSqlTransBackend::reload (GncSqlBackend* sql_be, const GncGUID& guid)
+{
+    g_return_val_if_fail (sql_be != NULL, nullptr);
+
+    auto pTx = xaccTransLookup (&guid, sql_be->book());
+    if (pTx != nullptr)
+    {
+        xaccTransBeginEdit (pTx);
+        xaccTransDestroy (pTx);
+        xaccTransCommitEdit (pTx);
+    }
+
+    const std::string tpkey(tx_col_table[0]->name());
+    query_transactions (sql_be, tpkey + " = '" +
+                        gnc::GUID(guid).to_string() + "'");
+    return QOF_INSTANCE (xaccTransLookup (&guid, sql_be->book()));
+}
+
 typedef struct
 {
     GncSqlStatementPtr stmt;
@@ -40,6 +40,7 @@ public:
     void load_all(GncSqlBackend*) override;
     void create_tables(GncSqlBackend*) override;
     bool commit (GncSqlBackend* sql_be, QofInstance* inst) override;
+    QofInstance* reload (GncSqlBackend* sql_be, const GncGUID& guid) override;
 };
 
 class GncSqlSplitBackend : public GncSqlObjectBackend
@@ -29,6 +29,8 @@
 #include <string.h>
 #include <AccountP.h>
 #include <Account.h>
+#include <qofinstance-p.h>
+#include <kvp-frame.hpp>
 
 #include "gnc-xml-helper.h"
 #include "sixtp.h"
@@ -549,6 +551,33 @@ dom_tree_to_account (xmlNodePtr node, QofBook* book)
     return accToRet;
 }
 
+/* Reads an account's XML over the account already holding its GUID.
+ * What the XML leaves out is cleared first.  The slots are replaced
+ * wholesale, which is only safe before anything has cached values read
+ * from them, i.e. while the book is being loaded. */
+gboolean
+dom_tree_update_account (xmlNodePtr node, Account* acc, QofBook* book)
+{
+    struct account_pdata act_pdata;
+    gboolean successful;
+
+    xaccAccountBeginEdit (acc);
+    xaccAccountSetCode (acc, "");
+    xaccAccountSetDescription (acc, "");
+    xaccAccountSetNonStdSCU (acc, FALSE);
+    qof_instance_set_slots (QOF_INSTANCE (acc), new KvpFrame);
+
+    act_pdata.account = acc;
+    act_pdata.book = book;
+
+    successful = dom_tree_generic_parse (node, account_handlers_v2,
+                                         &act_pdata);
+    if (!successful)
+        PERR ("failed to parse account tree");
+    xaccAccountCommitEdit (acc);
+    return successful;
+}
+
 sixtp*
 gnc_account_sixtp_parser_create (void)
 {
@@ -150,7 +150,6 @@ price_parse_xml_end_handler (gpointer data_for_children,
 {
     gboolean ok = TRUE;
     xmlNodePtr price_xml = (xmlNodePtr) data_for_children;
-    xmlNodePtr child;
     GNCPrice* p = NULL;
     gxpf_data* gdata = static_cast<decltype (gdata)> (global_data);
     QofBook* book = static_cast<decltype (book)> (gdata->bookdata);
@@ -177,14 +176,25 @@ price_parse_xml_end_handler (gpointer data_for_children,
         goto cleanup_and_exit;
     }
 
-    p = gnc_price_create (book);
+    p = dom_tree_to_price (price_xml, book);
     if (!p)
-    {
         ok = FALSE;
-        goto cleanup_and_exit;
-    }
 
-    for (child = price_xml->xmlChildrenNode; child; child = child->next)
+cleanup_and_exit:
+    *result = p;
+    xmlFreeNode (price_xml);
+    return ok;
+}
+
+GNCPrice*
+dom_tree_to_price (xmlNodePtr node, QofBook* book)
+{
+    GNCPrice* p = gnc_price_create (book);
+    xmlNodePtr child;
+
+    if (!p) return NULL;
+
+    for (child = node->xmlChildrenNode; child; child = child->next)
     {
         switch (child->type)
         {
@@ -194,31 +204,17 @@ price_parse_xml_end_handler (gpointer data_for_children,
         case XML_ELEMENT_NODE:
             if (!price_parse_xml_sub_node (p, child, book))
             {
-                ok = FALSE;
-                goto cleanup_and_exit;
+                gnc_price_unref (p);
+                return NULL;
             }
             break;
         default:
             PERR ("Unknown node type (%d) while parsing gnc-price xml.", child->type);
-            child = NULL;
-            ok = FALSE;
-            goto cleanup_and_exit;
-            break;
+            gnc_price_unref (p);
+            return NULL;
         }
     }
-
-cleanup_and_exit:
-    if (ok)
-    {
-        *result = p;
-    }
-    else
-    {
-        *result = NULL;
-        gnc_price_unref (p);
-    }
-    xmlFreeNode (price_xml);
-    return ok;
+    return p;
 }
 
 static void
@@ -505,6 +501,12 @@ gnc_pricedb_to_dom_tree (const xmlChar* tag, GNCPriceDB* db)
     return db_xml;
 }
 
+xmlNodePtr
+gnc_price_dom_tree_create (GNCPrice* price)
+{
+    return gnc_price_to_dom_tree (BAD_CAST "price", price);
+}
+
 xmlNodePtr
 gnc_pricedb_dom_tree_create (GNCPriceDB* db)
 {
@@ -28,23 +28,130 @@
 #include <fcntl.h>
 #include <sys/stat.h>
 #include <regex.h>
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#endif
 
 #include <gnc-engine.h> //for GNC_MOD_BACKEND
 #include <gnc-uri-utils.h>
 #include <TransLog.h>
 #include <gnc-prefs.h>
 
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
 #include <sstream>
+#include <thread>
 
 #include "gnc-xml-backend.hpp"
 #include "gnc-backend-xml.h"
+#include "gnc-xml-snapshot.hpp"
 #include "io-gncxml-v2.h"
 #include "io-gncxml.h"
 
 #define XML_URI_PREFIX "xml://"
 #define FILE_URI_PREFIX "file://"
+#define SNAPSHOT_EXT ".snapshot"
+#define JOURNAL_EXT ".journal"
+#define JOURNAL_MIN_FOLD size_t{1024 * 1024}
 static QofLogModule log_module = GNC_MOD_BACKEND;
 
+/* Runs the jobs given to it one at a time, in order, on a thread of its
+ * own.  The jobs mustn't touch the backend, which may be saving again
+ * by the time they run.  Setting GNC_XML_SYNC_BACKUPS in the environment
+ * runs them on the saving thread instead, as GnuCash always used to, so
+ * the save times can be compared. */
+class GncXmlBackupQueue
+{
+public:
+    GncXmlBackupQueue() : m_background{g_getenv ("GNC_XML_SYNC_BACKUPS") == nullptr} {}
+    ~GncXmlBackupQueue();
+    bool background () const { return m_background; }
+    void push (std::function<void()> job);
+    void wait ();
+private:
+    void run ();
+
+    const bool m_background;
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    std::deque<std::function<void()>> m_jobs;
+    bool m_busy = false;
+    bool m_stopping = false;
+    std::thread m_thread;
+};
+
+GncXmlBackupQueue::~GncXmlBackupQueue()
+{
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_stopping = true;
+    }
+    m_cond.notify_all();
+    if (m_thread.joinable())
+        m_thread.join();
+}
+
+void
+GncXmlBackupQueue::push (std::function<void()> job)
+{
+    if (!m_background)
+    {
+        job();
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_jobs.push_back (std::move (job));
+        if (!m_thread.joinable())
+            m_thread = std::thread{&GncXmlBackupQueue::run, this};
+    }
+    m_cond.notify_all();
+}
+
+/* Returns once all the jobs pushed so far have finished. */
+void
+GncXmlBackupQueue::wait ()
+{
+    std::unique_lock<std::mutex> lock{m_mutex};
+    m_cond.wait (lock, [this]{ return m_jobs.empty() && !m_busy; });
+}
+
+void
+GncXmlBackupQueue::run ()
+{
+    std::unique_lock<std::mutex> lock{m_mutex};
+    while (true)
+    {
+        m_cond.wait (lock, [this]{ return m_stopping || !m_jobs.empty(); });
+        if (m_jobs.empty())
+            return;
+        auto job = std::move (m_jobs.front());
+        m_jobs.pop_front();
+        m_busy = true;
+        lock.unlock();
+        job();
+        lock.lock();
+        m_busy = false;
+        m_cond.notify_all();
+    }
+}
+
+/* Snapshots are written and used only when GNC_XML_SNAPSHOT is set in
+ * the environment, and autosave only appends to a journal when
+ * GNC_XML_JOURNAL is.  A journal that's there is always replayed.
+ * GNC_XML_COPY_BACKUPS copies backups even where they could be linked,
+ * as they are on filesystems without hard links. */
+GncXmlBackend::GncXmlBackend() :
+    m_backups{std::make_unique<GncXmlBackupQueue>()},
+    m_copy_backups{g_getenv ("GNC_XML_COPY_BACKUPS") != nullptr},
+    m_snapshot{g_getenv ("GNC_XML_SNAPSHOT") != nullptr},
+    m_journal{g_getenv ("GNC_XML_JOURNAL") != nullptr},
+    m_journal_failed{std::make_shared<std::atomic<bool>>(false)} {}
+
 GncXmlBackend::~GncXmlBackend()
 {
     session_end();
@@ -162,6 +269,17 @@ GncXmlBackend::session_end()
         return;
     }
 
+    /* Fold the journal into the data file so that the next load needn't
+     * replay it; a book with unsaved changes is left for the user and a
+     * book opened read-only doesn't hold the lock needed to write. */
+    if (m_book && m_journal_size > 0 && m_lockfd != -1 &&
+        qof_book_get_backend (m_book) == this &&
+        !qof_book_session_not_saved (m_book))
+        sync (m_book);
+
+    /* The backups and pruning must be done while we still hold the lock. */
+    m_backups->wait();
+
     if (!m_linkfile.empty())
         g_unlink (m_linkfile.c_str());
 
@@ -232,19 +350,40 @@ GncXmlBackend::load(QofBook* book, QofBackendLoadType loadType)
 
     error = ERR_BACKEND_NO_ERR;
     m_book = book;
+    m_loading = true;
 
     int rc;
     switch (determine_file_type (m_fullpath))
     {
     case GNC_BOOK_XML2_FILE:
-        rc = qof_session_load_from_xml_file_v2 (this, book,
-                                                     GNC_BOOK_XML2_FILE);
-        if (rc == FALSE)
+    {
+        auto loaded = GNC_XML_SNAPSHOT_UNUSABLE;
+        if (m_snapshot)
         {
-            PWARN ("Syntax error in Xml File %s", m_fullpath.c_str());
-            error = ERR_FILEIO_PARSE_ERROR;
+            auto snapshot = m_fullpath + SNAPSHOT_EXT;
+            loaded = gnc_xml_snapshot_load (book, m_fullpath, snapshot);
+            /* The snapshot is only a cache: a bad one is thrown away and
+             * the book read from the XML file. */
+            if (loaded == GNC_XML_SNAPSHOT_FAILED)
+            {
+                PWARN ("Removing unreadable snapshot %s", snapshot.c_str());
+                g_unlink (snapshot.c_str());
+            }
         }
+        if (loaded != GNC_XML_SNAPSHOT_LOADED)
+        {
+            rc = qof_session_load_from_xml_file_v2 (this, book,
+                                                    GNC_BOOK_XML2_FILE);
+            if (rc == FALSE)
+            {
+                PWARN ("Syntax error in Xml File %s", m_fullpath.c_str());
+                error = ERR_FILEIO_PARSE_ERROR;
+                break;
+            }
+        }
+        error = replay_journal();
         break;
+    }
 
     case GNC_BOOK_XML2_FILE_NO_ENCODING:
         error = ERR_FILEIO_NO_ENCODING;
@@ -290,10 +429,38 @@ GncXmlBackend::load(QofBook* book, QofBackendLoadType loadType)
         set_error(error);
     }
 
+    m_changes.clear();
+    m_loading = false;
     /* We just got done loading, it can't possibly be dirty !! */
     qof_book_mark_session_saved (book);
 }
 
+/* Autosaves carry on appending to a journal that replayed completely. */
+QofBackendError
+GncXmlBackend::replay_journal()
+{
+    size_t size;
+    auto replayed = gnc_xml_journal_replay (m_book, m_fullpath,
+                                            m_fullpath + JOURNAL_EXT, size);
+    if (replayed == GNC_XML_JOURNAL_FAILED)
+    {
+        PERR ("Unable to replay the journal of %s", m_fullpath.c_str());
+        set_message (std::string{"The changes saved in "} + m_fullpath +
+                     JOURNAL_EXT + " couldn't be applied to the book.");
+        return ERR_FILEIO_PARSE_ERROR;
+    }
+
+    GStatBuf statbuf;
+    if (replayed == GNC_XML_JOURNAL_REPLAYED && m_journal &&
+        g_stat (m_fullpath.c_str(), &statbuf) == 0)
+    {
+        m_journal_open = true;
+        m_journal_size = size;
+        m_file_size = statbuf.st_size;
+    }
+    return ERR_BACKEND_NO_ERR;
+}
+
 void
 GncXmlBackend::sync(QofBook* book)
 {
@@ -313,13 +480,162 @@ GncXmlBackend::sync(QofBook* book)
         return;
     }
 
-    write_to_file (true);
+    auto start = g_get_monotonic_time ();
+    if (write_to_file (true))
+    {
+        if (m_snapshot)
+            write_snapshot();
+        start_journal();
+    }
     remove_old_files();
+    PINFO ("Saved %s in %" G_GINT64_FORMAT " ms", m_fullpath.c_str(),
+           (g_get_monotonic_time () - start) / 1000);
+}
+
+/* The image is made here, while the book can't change under it; the
+ * data file's hash is taken and the snapshot written with the backups.
+ * A book that can't have a snapshot loses the one it had. */
+void
+GncXmlBackend::write_snapshot()
+{
+    auto path = m_fullpath + SNAPSHOT_EXT;
+    auto image = std::make_shared<std::string>();
+
+    if (!gnc_xml_snapshot_serialize (m_book, *image))
+    {
+        m_backups->push ([path]{ g_unlink (path.c_str()); });
+        return;
+    }
+
+    int flags = O_RDONLY;
+#ifdef G_OS_WIN32
+    flags |= O_BINARY;
+#endif
+    auto data_fd = g_open (m_fullpath.c_str(), flags, 0);
+    if (data_fd == -1)
+    {
+        PWARN ("Unable to open %s for its snapshot: %s", m_fullpath.c_str(),
+               g_strerror (errno));
+        return;
+    }
+    m_backups->push ([data_fd, image, path]{
+        auto start = g_get_monotonic_time ();
+        if (gnc_xml_snapshot_write (data_fd, *image, path))
+            PINFO ("Wrote %s in %" G_GINT64_FORMAT " ms", path.c_str(),
+                   (g_get_monotonic_time () - start) / 1000);
+        else
+            g_unlink (path.c_str());
+        close (data_fd);
+    });
+}
+
+/* The journal is started with the backups, after the data file's hash is
+ * taken; a book that doesn't keep one loses the one it had. */
+void
+GncXmlBackend::start_journal()
+{
+    auto path = m_fullpath + JOURNAL_EXT;
+
+    m_changes.clear();
+    m_journal_open = false;
+    m_journal_size = 0;
+    if (!m_journal)
+    {
+        m_backups->push ([path]{ g_unlink (path.c_str()); });
+        return;
+    }
+
+    int flags = O_RDONLY;
+#ifdef G_OS_WIN32
+    flags |= O_BINARY;
+#endif
+    GStatBuf statbuf;
+    auto data_fd = g_open (m_fullpath.c_str(), flags, 0);
+    if (data_fd == -1 || fstat (data_fd, &statbuf) != 0)
+    {
+        PWARN ("Unable to open %s for its journal: %s", m_fullpath.c_str(),
+               g_strerror (errno));
+        if (data_fd != -1)
+            close (data_fd);
+        m_backups->push ([path]{ g_unlink (path.c_str()); });
+        return;
+    }
+    m_file_size = statbuf.st_size;
+    m_journal_open = true;
+    m_journal_failed->store (false);
+    m_backups->push ([data_fd, path, failed = m_journal_failed]{
+        if (!gnc_xml_journal_start (data_fd, path))
+        {
+            failed->store (true);
+            g_unlink (path.c_str());
+        }
+        close (data_fd);
+    });
+}
+
+/* Appends the changes since the last save to the journal, or writes the
+ * whole book when they can't be journaled or the journal has grown past
+ * a quarter of the size of the data file, after which replaying it on
+ * load costs more than the full write saves. Small books have a megabyte
+ * of journal before they're written. */
+void
+GncXmlBackend::autosave(QofBook* book)
+{
+    if (m_book == nullptr) m_book = book;
+    if (book != m_book) return;
+
+    if (!m_journal_open || m_changes.empty() || !m_changes.journalable() ||
+        m_journal_size > std::max (m_file_size / 4, JOURNAL_MIN_FOLD))
+    {
+        sync (book);
+        return;
+    }
+
+    if (qof_book_is_readonly (m_book))
+    {
+        set_error(ERR_BACKEND_READONLY);
+        return;
+    }
+
+    auto start = g_get_monotonic_time ();
+    std::string entry;
+    if (!m_changes.make_entry (m_book, entry))
+    {
+        sync (book);
+        return;
+    }
+
+    /* The journal must have been started before it's appended to. */
+    m_backups->wait();
+    if (m_journal_failed->load())
+    {
+        sync (book);
+        return;
+    }
+    if (!entry.empty())
+    {
+        auto path = m_fullpath + JOURNAL_EXT;
+        if (!gnc_xml_journal_append (entry, path))
+        {
+            sync (book);
+            return;
+        }
+        m_journal_size += entry.size();
+    }
+    m_changes.clear();
+    qof_book_mark_session_saved (m_book);
+    PINFO ("Journaled %" G_GSIZE_FORMAT " bytes for %s in %" G_GINT64_FORMAT
+           " ms", entry.size(), m_fullpath.c_str(),
+           (g_get_monotonic_time () - start) / 1000);
 }
 
 void
 GncXmlBackend::commit(QofInstance* instance)
 {
+    if (m_journal && !m_loading &&
+        (qof_instance_is_dirty(instance) ||
+         qof_instance_get_destroying(instance)))
+        m_changes.record (instance);
     if (qof_instance_is_dirty(instance))
         qof_instance_mark_clean(instance);
 }
@@ -449,6 +765,9 @@ GncXmlBackend::write_to_file (bool make_backup)
             }
 #endif
         }
+#ifdef G_OS_WIN32
+        /* Windows won't rename onto an existing file. Elsewhere the
+         * rename replaces the data file in one step. */
         if (g_unlink (m_fullpath.c_str()) != 0 && errno != ENOENT)
         {
             set_error(ERR_BACKEND_READONLY);
@@ -459,25 +778,19 @@ GncXmlBackend::write_to_file (bool make_backup)
             LEAVE ("");
             return FALSE;
         }
-        if (!link_or_make_backup (tmp_name, m_fullpath))
+#endif
+        if (g_rename (tmp_name, m_fullpath.c_str()) != 0)
         {
             set_error(ERR_FILEIO_BACKUP_ERROR);
+            PWARN ("unable to rename %s to %s: %s", tmp_name,
+                   m_fullpath.c_str(),
+                   g_strerror (errno) ? g_strerror (errno) : "");
             std::string msg{"Failed to make backup file "};
             set_message(msg + (m_fullpath.empty() ? "NULL" : m_fullpath));
             g_free (tmp_name);
             LEAVE ("");
             return FALSE;
         }
-        if (g_unlink (tmp_name) != 0)
-        {
-            set_error(ERR_BACKEND_PERM);
-            PWARN ("unable to unlink temp filename %s: %s",
-                   tmp_name ? tmp_name : "(null)",
-                   g_strerror (errno) ? g_strerror (errno) : "");
-            g_free (tmp_name);
-            LEAVE ("");
-            return FALSE;
-        }
         g_free (tmp_name);
 
         /* Since we successfully saved the book,
@@ -526,70 +839,119 @@ GncXmlBackend::write_to_file (bool make_backup)
     return TRUE;
 }
 
+/* Copies into a temporary file beside bkup and renames that into place,
+ * replacing any file already there, so that a copy cut short never
+ * leaves a truncated backup under bkup's name. */
 static bool
-copy_file (const std::string& orig, const std::string& bkup)
+copy_fd (int orig_fd, const std::string& bkup)
 {
-    constexpr size_t buf_size = 1024;
-    char buf[buf_size];
+    constexpr size_t buf_size = 64 * 1024;
+    std::unique_ptr<char[]> buf{new char[buf_size]};
+    auto tmp = bkup + ".tmp";
     int flags = 0;
-    ssize_t count_write = 0;
-    ssize_t count_read = 0;
-
 
 #ifdef G_OS_WIN32
     flags = O_BINARY;
 #endif
 
-    auto orig_fd = g_open (orig.c_str(), O_RDONLY | flags, 0);
-    if (orig_fd == -1)
-    {
+    auto tmp_fd = g_open (tmp.c_str(),
+                          O_WRONLY | O_CREAT | O_TRUNC | flags, 0600);
+    if (tmp_fd == -1)
         return false;
-    }
-    auto bkup_fd = g_open (bkup.c_str(),
-                           O_WRONLY | O_CREAT | O_TRUNC | O_EXCL | flags, 0600);
-    if (bkup_fd == -1)
-    {
-        close (orig_fd);
-        return FALSE;
-    }
 
-    do
+    auto copied = true;
+    while (copied)
     {
-        count_read = read (orig_fd, buf, buf_size);
-        if (count_read == -1 && errno != EINTR)
+        auto count_read = read (orig_fd, buf.get(), buf_size);
+        if (count_read == -1 && errno == EINTR)
+            continue;
+        if (count_read <= 0)
         {
-            close (orig_fd);
-            close (bkup_fd);
-            return FALSE;
+            copied = count_read == 0;
+            break;
         }
 
-        if (count_read > 0)
+        for (ssize_t written = 0; written < count_read;)
         {
-            count_write = write (bkup_fd, buf, count_read);
+            auto count_write = write (tmp_fd, buf.get() + written,
+                                      count_read - written);
+            if (count_write == -1 && errno == EINTR)
+                continue;
             if (count_write == -1)
             {
-                close (orig_fd);
-                close (bkup_fd);
-                return FALSE;
+                copied = false;
+                break;
             }
+            written += count_write;
         }
     }
-    while (count_read > 0);
 
+    if (close (tmp_fd) != 0)
+        copied = false;
+    if (copied && g_rename (tmp.c_str(), bkup.c_str()) == 0)
+        return true;
+
+    auto saved_errno = errno;
+    g_unlink (tmp.c_str());
+    errno = saved_errno;
+    return false;
+}
+
+static bool
+copy_file (const std::string& orig, const std::string& bkup)
+{
+    int flags = 0;
+
+#ifdef G_OS_WIN32
+    flags = O_BINARY;
+#endif
+
+    auto orig_fd = g_open (orig.c_str(), O_RDONLY | flags, 0);
+    if (orig_fd == -1)
+        return false;
+    auto rv = copy_fd (orig_fd, bkup);
     close (orig_fd);
-    close (bkup_fd);
+    return rv;
+}
 
-    return TRUE;
+/* Shares the data blocks of orig with bkup where the filesystem can,
+ * which is as quick as a hard link but leaves two files. */
+static bool
+reflink_file (const std::string& orig, const std::string& bkup)
+{
+#ifdef FICLONE
+    auto orig_fd = g_open (orig.c_str(), O_RDONLY, 0);
+    if (orig_fd == -1)
+        return false;
+    auto bkup_fd = g_open (bkup.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0600);
+    if (bkup_fd == -1)
+    {
+        close (orig_fd);
+        return false;
+    }
+    auto rv = ioctl (bkup_fd, FICLONE, orig_fd);
+    close (orig_fd);
+    close (bkup_fd);
+    if (rv != 0)
+        g_unlink (bkup.c_str());
+    return rv == 0;
+#else
+    return false;
+#endif
 }
 
+/* With in_background the copy, if one is needed, is made after this
+ * returns.  The original is opened first, so that it may be replaced
+ * meanwhile; Windows won't allow that, so it always copies here. */
 bool
 GncXmlBackend::link_or_make_backup (const std::string& orig,
-                                    const std::string& bkup)
+                                    const std::string& bkup,
+                                    bool in_background)
 {
     gboolean copy_success = FALSE;
     int err_ret =
 #ifdef HAVE_LINK
-        link (orig.c_str(), bkup.c_str())
+        m_copy_backups ? -1 : link (orig.c_str(), bkup.c_str())
 #else
         - 1
 #endif
@@ -597,7 +959,7 @@ GncXmlBackend::link_or_make_backup (const std::string& orig,
     if (err_ret != 0)
     {
 #ifdef HAVE_LINK
-        if (errno == EPERM || errno == ENOSYS
+        if (m_copy_backups || errno == EPERM || errno == ENOSYS
 # ifdef EOPNOTSUPP
             || errno == EOPNOTSUPP
 # endif
@@ -610,7 +972,28 @@ GncXmlBackend::link_or_make_backup (const std::string& orig,
            )
 #endif
         {
-            copy_success = copy_file (orig.c_str(), bkup);
+            copy_success = !m_copy_backups && reflink_file (orig, bkup);
+#ifndef G_OS_WIN32
+            if (!copy_success && in_background && m_backups->background())
+            {
+                auto orig_fd = g_open (orig.c_str(), O_RDONLY, 0);
+                copy_success = orig_fd != -1;
+                if (copy_success)
+                    m_backups->push ([orig_fd, bkup]{
+                        auto start = g_get_monotonic_time ();
+                        if (copy_fd (orig_fd, bkup))
+                            PINFO ("Copied backup %s in %" G_GINT64_FORMAT " ms",
+                                   bkup.c_str(),
+                                   (g_get_monotonic_time () - start) / 1000);
+                        else
+                            PERR ("unable to make file backup %s: %s",
+                                  bkup.c_str(), g_strerror (errno));
+                        close (orig_fd);
+                    });
+            }
+#endif
+            if (!copy_success)
+                copy_success = copy_file (orig, bkup);
         }
 
         if (!copy_success)
@@ -681,7 +1064,7 @@ GncXmlBackend::backup_file()
     {
         /* make a more permanent safer backup */
         auto bin_bkup = m_fullpath + "-binfmt.bkup";
-        auto bkup_ret = link_or_make_backup (m_fullpath, bin_bkup);
+        auto bkup_ret = link_or_make_backup (m_fullpath, bin_bkup, true);
         if (!bkup_ret)
         {
             return false;
@@ -692,7 +1075,7 @@ GncXmlBackend::backup_file()
     auto backup = m_fullpath + "." + timestamp + GNC_DATAFILE_EXT;
     g_free (timestamp);
 
-    return link_or_make_backup (datafile, backup);
+    return link_or_make_backup (datafile, backup, true);
 }
 
 /*
@@ -700,15 +1083,14 @@ GncXmlBackend::backup_file()
  * backup and log files.
  */
 
-void
-GncXmlBackend::remove_old_files ()
+static void
+remove_old_files (const std::string& dirname, const std::string& fullpath,
+                  const std::string& linkfile, time_t lock_mtime,
+                  int retention_policy, int retention_days)
 {
-    GStatBuf lockstatbuf, statbuf;
-
-    if (g_stat (m_lockfile.c_str(), &lockstatbuf) != 0)
-        return;
+    GStatBuf statbuf;
 
-    auto dir = g_dir_open (m_dirname.c_str(), 0, NULL);
+    auto dir = g_dir_open (dirname.c_str(), 0, NULL);
     if (!dir)
         return;
 
@@ -722,20 +1104,21 @@ GncXmlBackend::remove_old_files ()
         if (! (g_str_has_suffix (dent, ".LNK") ||
                g_str_has_suffix (dent, ".xac") /* old data file extension */ ||
                g_str_has_suffix (dent, GNC_DATAFILE_EXT) ||
-               g_str_has_suffix (dent, GNC_LOGFILE_EXT)))
+               g_str_has_suffix (dent, GNC_LOGFILE_EXT) ||
+               g_str_has_suffix (dent, ".tmp")))
             continue;
 
-        name = g_build_filename (m_dirname.c_str(), dent, (gchar*)NULL);
+        name = g_build_filename (dirname.c_str(), dent, (gchar*)NULL);
 
         /* Only evaluate files associated with the current data file. */
-        if (!g_str_has_prefix (name, m_fullpath.c_str()))
+        if (!g_str_has_prefix (name, fullpath.c_str()))
         {
             g_free (name);
             continue;
         }
 
         /* Never remove the current data file itself */
-        if (g_strcmp0 (name, m_fullpath.c_str()) == 0)
+        if (g_strcmp0 (name, fullpath.c_str()) == 0)
         {
             g_free (name);
             continue;
@@ -745,10 +1128,10 @@ GncXmlBackend::remove_old_files ()
         if (g_str_has_suffix (name, ".LNK"))
         {
             /* Is a lock file. Skip the active lock file */
-            if ((g_strcmp0 (name, m_linkfile.c_str()) != 0) &&
+            if ((g_strcmp0 (name, linkfile.c_str()) != 0) &&
                 /* Only delete lock files older than the active one */
                 (g_stat (name, &statbuf) == 0) &&
-                (statbuf.st_mtime < lockstatbuf.st_mtime))
+                (statbuf.st_mtime < lock_mtime))
             {
                 PINFO ("remove stale lock file: %s", name);
                 g_unlink (name);
@@ -762,18 +1145,20 @@ GncXmlBackend::remove_old_files ()
          * <fullpath/to/datafile><anything>.gnucash
          * <fullpath/to/datafile><anything>.xac
          * <fullpath/to/datafile><anything>.log
+         * <fullpath/to/datafile><anything>.tmp
          *
          * To be a file generated by GnuCash, the <anything> part should consist
-         * of 1 dot followed by 14 digits (0 to 9). Let's test this with a
-         * regular expression.
+         * of 1 dot followed by 14 digits (0 to 9), and a .tmp one should be a
+         * backup copy left unfinished. Let's test this with a regular
+         * expression.
          */
         {
             /* Find the start of the date stamp. This takes some pointer
              * juggling, but considering the above tests, this should always
              * be safe */
             regex_t pattern;
-            gchar* stamp_start = name + strlen (m_fullpath.c_str());
-            gchar* expression = g_strdup_printf ("^\\.[[:digit:]]{14}(\\%s|\\%s|\\.xac)$",
+            gchar* stamp_start = name + strlen (fullpath.c_str());
+            gchar* expression = g_strdup_printf ("^\\.[[:digit:]]{14}(\\%s|\\%s|\\.xac)(\\.tmp)?$",
                                                  GNC_DATAFILE_EXT, GNC_LOGFILE_EXT);
             gboolean got_date_stamp = FALSE;
 
@@ -792,16 +1177,26 @@ GncXmlBackend::remove_old_files ()
             }
         }
 
+        /* Nothing is copying it now: copies are made on this thread, and
+         * only while the lock is held. */
+        if (g_str_has_suffix (name, ".tmp"))
+        {
+            PINFO ("remove unfinished backup: %s", name);
+            g_unlink (name);
+            g_free (name);
+            continue;
+        }
+
         /* The file is a backup or log file. Check the user's retention preference
          * to determine if we should keep it or not
          */
-        if (gnc_prefs_get_file_retention_policy () == XML_RETAIN_NONE)
+        if (retention_policy == XML_RETAIN_NONE)
         {
             PINFO ("remove stale file: %s  - reason: preference XML_RETAIN_NONE", name);
             g_unlink (name);
         }
-        else if ((gnc_prefs_get_file_retention_policy () == XML_RETAIN_DAYS) &&
-                 (gnc_prefs_get_file_retention_days () > 0))
+        else if ((retention_policy == XML_RETAIN_DAYS) &&
+                 (retention_days > 0))
         {
             int days;
 
@@ -813,8 +1208,8 @@ GncXmlBackend::remove_old_files ()
             }
             days = (int) (difftime (now, statbuf.st_mtime) / 86400);
 
-            PINFO ("file retention = %d days", gnc_prefs_get_file_retention_days ());
-            if (days >= gnc_prefs_get_file_retention_days ())
+            PINFO ("file retention = %d days", retention_days);
+            if (days >= retention_days)
             {
                 PINFO ("remove stale file: %s  - reason: more than %d days old", name, days);
                 g_unlink (name);
@@ -824,3 +1219,23 @@ GncXmlBackend::remove_old_files ()
     }
     g_dir_close (dir);
 }
+
+void
+GncXmlBackend::remove_old_files ()
+{
+    GStatBuf lockstatbuf;
+
+    if (g_stat (m_lockfile.c_str(), &lockstatbuf) != 0)
+        return;
+
+    m_backups->push ([dirname = m_dirname, fullpath = m_fullpath,
+                      linkfile = m_linkfile, lock_mtime = lockstatbuf.st_mtime,
+                      policy = gnc_prefs_get_file_retention_policy (),
+                      days = gnc_prefs_get_file_retention_days ()]{
+        auto start = g_get_monotonic_time ();
+        ::remove_old_files (dirname, fullpath, linkfile, lock_mtime,
+                            policy, days);
+        PINFO ("Removed old files in %" G_GINT64_FORMAT " ms",
+               (g_get_monotonic_time () - start) / 1000);
+    });
+}
@@ -20,13 +20,19 @@
 
 #include <qof.h>
 
+#include <atomic>
+#include <memory>
 #include <string>
 #include <qof-backend.hpp>
 
+#include "gnc-xml-journal.hpp"
+
+class GncXmlBackupQueue;
+
 class GncXmlBackend : public QofBackend
 {
 public:
-    GncXmlBackend() = default;
+    GncXmlBackend();
     GncXmlBackend(const GncXmlBackend&) = delete;
     GncXmlBackend operator=(const GncXmlBackend&) = delete;
     GncXmlBackend(const GncXmlBackend&&) = delete;
@@ -40,6 +46,8 @@ public:
     void export_coa(QofBook*) override;
     void sync(QofBook* book) override;
     void safe_sync(QofBook* book) override { sync(book); } // XML sync is inherently safe.
+    void autosave(QofBook* book) override;
+    bool autosave_pending() const override { return m_journal_size > 0; }
     void commit(QofInstance* instance) override;
     const char * get_filename() { return m_fullpath.c_str(); }
     QofBook* get_book() { return m_book; }
@@ -47,10 +55,14 @@ public:
 private:
     bool save_may_clobber_data();
     void get_file_lock(SessionOpenMode);
-    bool link_or_make_backup(const std::string& orig, const std::string& bkup);
+    bool link_or_make_backup(const std::string& orig, const std::string& bkup,
+                             bool in_background = false);
     bool backup_file();
     bool write_to_file(bool make_backup);
     void remove_old_files();
+    void write_snapshot();
+    void start_journal();
+    QofBackendError replay_journal();
     void write_accounts(QofBook* book);
     bool check_path(const char* fullpath, bool create);
 
@@ -58,6 +70,24 @@ private:
     std::string m_lockfile;
     std::string m_linkfile;
     int m_lockfd = -1;
+    /* Backup copies and pruning of old files, done after sync returns. */
+    std::unique_ptr<GncXmlBackupQueue> m_backups;
+    /* Copy backups instead of linking them. */
+    bool m_copy_backups;
+    /* Keep a binary snapshot of the book beside the data file. */
+    bool m_snapshot;
+    /* Autosave appends the changes to a journal instead of writing the
+     * whole book. */
+    bool m_journal;
+    GncXmlJournalChanges m_changes;
+    bool m_journal_open = false;
+    /* The length of the entries appended and of the data file they follow. */
+    size_t m_journal_size = 0;
+    size_t m_file_size = 0;
+    /* Set by the backup thread if it couldn't start the journal. */
+    std::shared_ptr<std::atomic<bool>> m_journal_failed;
+    /* Commits made while the book loads aren't changes. */
+    bool m_loading = false;
 
     QofBook* m_book = nullptr;  /* The primary, main open book */
 };
@@ -0,0 +1,695 @@
+/********************************************************************
+ * gnc-xml-journal.cpp: Changes to an XML book appended to a file.  *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+\********************************************************************/
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <config.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "gnc-engine.h"
+#include "Account.h"
+#include "SplitP.h"
+#include "Transaction.h"
+#include "TransactionP.h"
+#include "TransLog.h"
+#include "gnc-lot.h"
+#include "gnc-pricedb.h"
+#include "gnc-pricedb-p.h"
+#include "qofinstance-p.h"
+#include <kvp-frame.hpp>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "gnc-xml-journal.hpp"
+#include "gnc-xml.h"
+#include "sixtp.h"
+#include "sixtp-parsers.h"
+#include "sixtp-dom-parsers.h"
+#include "sixtp-dom-generators.h"
+
+static QofLogModule log_module = GNC_MOD_IO;
+
+#define JOURNAL_MAGIC "GNCJOURNAL"
+#define JOURNAL_VERSION 1
+#define JOURNAL_HASH_LENGTH 64
+
+#define JOURNAL_ENTRY_TAG "gnc-journal-entry"
+#define JOURNAL_BOOK_TAG "journal:book"
+#define JOURNAL_LOT_TAG "journal:lot"
+#define JOURNAL_ACCOUNT_TAG "journal:account"
+#define JOURNAL_DELETE_TAG "journal:delete"
+#define JOURNAL_OBJECT_ATTR "object"
+
+/* The types of instance the journal carries, in the order their changes
+ * are replayed; deletions are replayed afterwards in the reverse order.
+ * A split is carried by its transaction. */
+static const char* journal_types[] =
+{
+    QOF_ID_BOOK, GNC_ID_ACCOUNT, GNC_ID_LOT, GNC_ID_TRANS, GNC_ID_PRICE
+};
+
+static bool
+is_type (QofIdTypeConst type, QofIdTypeConst wanted)
+{
+    return g_strcmp0 (type, wanted) == 0;
+}
+
+void
+GncXmlJournalChanges::record (QofInstance* inst)
+{
+    QofIdTypeConst type = inst->e_type;
+
+    if (is_type (type, GNC_ID_SPLIT))
+    {
+        auto trans = xaccSplitGetParent (GNC_SPLIT (inst));
+        if (!trans)
+            return;
+        inst = QOF_INSTANCE (trans);
+        type = GNC_ID_TRANS;
+    }
+    /* The prices are recorded themselves. */
+    if (is_type (type, GNC_ID_PRICEDB))
+        return;
+    if (std::none_of (std::begin (journal_types), std::end (journal_types),
+                      [type](const char* t){ return is_type (type, t); }))
+    {
+        DEBUG ("A %s changed, the book must be written in full", type);
+        m_full_write = true;
+        return;
+    }
+
+    char guid_str[GUID_ENCODING_LENGTH + 1];
+    guid_to_string_buff (qof_instance_get_guid (inst), guid_str);
+    m_changed[type].insert (guid_str);
+}
+
+void
+GncXmlJournalChanges::clear ()
+{
+    m_changed.clear ();
+    m_full_write = false;
+}
+
+/* Returns the instance if it's still part of what the data file holds. */
+static QofInstance*
+lookup_live (QofBook* book, QofIdTypeConst type, const GncGUID* guid)
+{
+    if (is_type (type, QOF_ID_BOOK))
+        return guid_equal (guid, qof_instance_get_guid (book)) ?
+               QOF_INSTANCE (book) : nullptr;
+
+    auto col = qof_book_get_collection (book, type);
+    auto inst = static_cast<QofInstance*> (qof_collection_lookup_entity (col,
+                                                                         guid));
+    if (!inst || qof_instance_get_destroying (inst))
+        return nullptr;
+    if (is_type (type, GNC_ID_PRICE) && !GNC_PRICE (inst)->db)
+        return nullptr;
+    return inst;
+}
+
+static xmlNodePtr
+instance_dom_tree (QofIdTypeConst type, QofInstance* inst)
+{
+    if (is_type (type, QOF_ID_BOOK))
+    {
+        auto node = xmlNewNode (nullptr, BAD_CAST JOURNAL_BOOK_TAG);
+        xmlAddChild (node, qof_instance_slots_to_dom_tree ("book:slots", inst));
+        return node;
+    }
+    if (is_type (type, GNC_ID_ACCOUNT))
+        return gnc_account_dom_tree_create (GNC_ACCOUNT (inst), TRUE, TRUE);
+    if (is_type (type, GNC_ID_LOT))
+    {
+        auto lot = GNC_LOT (inst);
+        auto node = xmlNewNode (nullptr, BAD_CAST JOURNAL_LOT_TAG);
+        xmlAddChild (node, guid_to_dom_tree (JOURNAL_ACCOUNT_TAG,
+                                             xaccAccountGetGUID (gnc_lot_get_account (lot))));
+        xmlAddChild (node, gnc_lot_dom_tree_create (lot));
+        return node;
+    }
+    if (is_type (type, GNC_ID_TRANS))
+        return gnc_transaction_dom_tree_create (GNC_TRANSACTION (inst));
+    if (is_type (type, GNC_ID_PRICE))
+        return gnc_price_dom_tree_create (GNC_PRICE (inst));
+    return nullptr;
+}
+
+bool
+GncXmlJournalChanges::make_entry (QofBook* book, std::string& entry) const
+{
+    auto root = xmlNewNode (nullptr, BAD_CAST JOURNAL_ENTRY_TAG);
+    std::vector<xmlNodePtr> deleted;
+    bool ok = true;
+
+    entry.clear ();
+    for (auto type : journal_types)
+    {
+        auto changed = m_changed.find (type);
+        if (changed == m_changed.end ())
+            continue;
+
+        std::vector<QofInstance*> live;
+        for (const auto& guid_str : changed->second)
+        {
+            GncGUID guid;
+            string_to_guid (guid_str.c_str (), &guid);
+            auto inst = lookup_live (book, type, &guid);
+            if (inst)
+            {
+                /* A lot outside any account isn't in the data file. */
+                if (!is_type (type, GNC_ID_LOT) || gnc_lot_get_account (GNC_LOT (inst)))
+                    live.push_back (inst);
+                continue;
+            }
+            auto node = guid_to_dom_tree (JOURNAL_DELETE_TAG, &guid);
+            xmlSetProp (node, BAD_CAST JOURNAL_OBJECT_ATTR, BAD_CAST type);
+            deleted.push_back (node);
+        }
+
+        /* New accounts need their parents in place. */
+        if (is_type (type, GNC_ID_ACCOUNT))
+            std::stable_sort (live.begin (), live.end (),
+                              [](QofInstance* a, QofInstance* b)
+                              {
+                                  return gnc_account_get_current_depth (GNC_ACCOUNT (a)) <
+                                         gnc_account_get_current_depth (GNC_ACCOUNT (b));
+                              });
+        for (auto inst : live)
+        {
+            auto node = instance_dom_tree (type, inst);
+            if (!node)
+            {
+                PWARN ("Unable to write a %s to the journal", type);
+                ok = false;
+                continue;
+            }
+            xmlAddChild (root, node);
+        }
+    }
+    std::for_each (deleted.rbegin (), deleted.rend (),
+                   [root](xmlNodePtr node){ xmlAddChild (root, node); });
+
+    if (ok && root->xmlChildrenNode)
+    {
+        auto buf = xmlBufferCreate ();
+        xmlNodeDump (buf, nullptr, root, 0, 0);
+        entry = "<?xml version=\"1.0\" encoding=\"utf-8\" ?>\n";
+        entry.append (reinterpret_cast<const char*> (xmlBufferContent (buf)),
+                      xmlBufferLength (buf));
+        entry += '\n';
+        xmlBufferFree (buf);
+    }
+    xmlFreeNode (root);
+    return ok;
+}
+
+/***********************************************************************/
+
+static std::string
+hash_fd (int fd)
+{
+    constexpr size_t buf_size = 64 * 1024;
+    std::unique_ptr<guchar[]> buf{new guchar[buf_size]};
+    auto checksum = g_checksum_new (G_CHECKSUM_SHA256);
+    std::string digest;
+
+    while (true)
+    {
+        auto len = read (fd, buf.get (), buf_size);
+        if (len == 0)
+        {
+            digest = g_checksum_get_string (checksum);
+            break;
+        }
+        if (len < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        g_checksum_update (checksum, buf.get (), len);
+    }
+    g_checksum_free (checksum);
+    return digest;
+}
+
+static std::string
+hash_file (const std::string& path)
+{
+    int flags = O_RDONLY;
+#ifdef G_OS_WIN32
+    flags |= O_BINARY;
+#endif
+    auto fd = g_open (path.c_str (), flags, 0);
+    if (fd == -1)
+        return {};
+    auto digest = hash_fd (fd);
+    close (fd);
+    return digest;
+}
+
+static std::string
+hash_data (const char* data, size_t len)
+{
+    auto digest = g_compute_checksum_for_data (G_CHECKSUM_SHA256,
+                                               reinterpret_cast<const guchar*> (data),
+                                               len);
+    std::string rv{digest};
+    g_free (digest);
+    return rv;
+}
+
+static std::string
+journal_header (const std::string& data_hash)
+{
+    auto header = g_strdup_printf ("%s %d %s\n", JOURNAL_MAGIC,
+                                   JOURNAL_VERSION, data_hash.c_str ());
+    std::string rv{header};
+    g_free (header);
+    return rv;
+}
+
+static bool
+write_all (int fd, const void* data, size_t len)
+{
+    auto pos = static_cast<const char*> (data);
+    while (len > 0)
+    {
+        auto written = write (fd, pos, len);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        pos += written;
+        len -= written;
+    }
+    return true;
+}
+
+bool
+gnc_xml_journal_start (int data_fd, const std::string& path)
+{
+    int flags = 0;
+
+#ifdef G_OS_WIN32
+    flags = O_BINARY;
+#endif
+
+    auto data_hash = hash_fd (data_fd);
+    if (data_hash.empty ())
+    {
+        PWARN ("Unable to read the data file for %s: %s", path.c_str (),
+               g_strerror (errno));
+        return false;
+    }
+    auto header = journal_header (data_hash);
+
+    auto tmp_name = path + ".tmp-XXXXXX";
+    auto fd = g_mkstemp_full (&tmp_name[0], O_WRONLY | flags, 0600);
+    if (fd == -1)
+    {
+        PWARN ("Unable to create %s: %s", tmp_name.c_str (),
+               g_strerror (errno));
+        return false;
+    }
+    auto ok = write_all (fd, header.data (), header.size ());
+    if (close (fd) != 0)
+        ok = false;
+#ifdef G_OS_WIN32
+    if (ok)
+        g_unlink (path.c_str ());
+#endif
+    if (!ok || g_rename (tmp_name.c_str (), path.c_str ()) != 0)
+    {
+        PWARN ("Unable to write %s: %s", path.c_str (), g_strerror (errno));
+        g_unlink (tmp_name.c_str ());
+        return false;
+    }
+    return true;
+}
+
+bool
+gnc_xml_journal_append (const std::string& entry, const std::string& path)
+{
+    int flags = 0;
+
+#ifdef G_OS_WIN32
+    flags = O_BINARY;
+#endif
+
+    auto line = g_strdup_printf ("ENTRY %" G_GSIZE_FORMAT " %s\n",
+                                 entry.size (),
+                                 hash_data (entry.data (), entry.size ()).c_str ());
+    std::string record{line};
+    g_free (line);
+    record += entry;
+
+    auto fd = g_open (path.c_str (), O_WRONLY | O_APPEND | flags, 0);
+    if (fd == -1)
+    {
+        PWARN ("Unable to open %s: %s", path.c_str (), g_strerror (errno));
+        return false;
+    }
+    auto ok = write_all (fd, record.data (), record.size ());
+    if (close (fd) != 0)
+        ok = false;
+    if (!ok)
+        PWARN ("Unable to append to %s: %s", path.c_str (), g_strerror (errno));
+    return ok;
+}
+
+/***********************************************************************/
+
+static xmlNodePtr
+find_child (xmlNodePtr node, const char* tag)
+{
+    for (auto child = node->xmlChildrenNode; child; child = child->next)
+        if (g_strcmp0 (reinterpret_cast<const char*> (child->name), tag) == 0)
+            return child;
+    return nullptr;
+}
+
+static bool
+child_guid (xmlNodePtr node, const char* tag, GncGUID& guid)
+{
+    auto child = find_child (node, tag);
+    if (!child)
+        return false;
+    auto gid = dom_tree_to_guid (child);
+    if (!gid)
+        return false;
+    guid = *gid;
+    guid_free (gid);
+    return true;
+}
+
+/* Replaces an instance's slots with those in the child of node named
+ * tag, if there is one. */
+static bool
+replace_slots (QofInstance* inst, xmlNodePtr node, const char* tag)
+{
+    qof_instance_set_slots (inst, new KvpFrame);
+    auto slots = find_child (node, tag);
+    return !slots || dom_tree_create_instance_slots (slots, inst);
+}
+
+/* Its capital gains transactions are in the journal themselves if they
+ * changed, so they mustn't be destroyed along with it. */
+static void
+destroy_transaction (Transaction* trans)
+{
+    for (auto node = xaccTransGetSplitList (trans); node; node = node->next)
+    {
+        auto split = GNC_SPLIT (node->data);
+        split->gains_split = nullptr;
+        split->gains = GAINS_STATUS_CLEAN;
+    }
+    xaccTransClearReadOnly (trans);
+    xaccTransDestroy (trans);
+}
+
+static bool
+replay_book (xmlNodePtr node, QofBook* book)
+{
+    auto ok = replace_slots (QOF_INSTANCE (book), node, "book:slots");
+    book->cached_num_field_source_isvalid = FALSE;
+    book->cached_num_days_autoreadonly_isvalid = FALSE;
+    return ok;
+}
+
+static bool
+replay_account (xmlNodePtr node, QofBook* book)
+{
+    GncGUID guid;
+
+    if (!child_guid (node, "act:id", guid))
+        return false;
+    auto acc = xaccAccountLookup (&guid, book);
+    if (acc)
+        return dom_tree_update_account (node, acc, book);
+    return dom_tree_to_account (node, book) != nullptr;
+}
+
+static bool
+replay_lot (xmlNodePtr node, QofBook* book)
+{
+    GncGUID acc_guid, guid;
+    auto lot_node = find_child (node, "gnc:lot");
+
+    if (!lot_node || !child_guid (node, JOURNAL_ACCOUNT_TAG, acc_guid) ||
+        !child_guid (lot_node, "lot:id", guid))
+        return false;
+
+    auto lot = gnc_lot_lookup (&guid, book);
+    if (lot)
+    {
+        gnc_lot_begin_edit (lot);
+        auto ok = replace_slots (QOF_INSTANCE (lot), lot_node, "lot:slots");
+        gnc_lot_commit_edit (lot);
+        return ok;
+    }
+
+    auto acc = xaccAccountLookup (&acc_guid, book);
+    if (!acc)
+        return false;
+    lot = dom_tree_to_lot (lot_node, book);
+    if (!lot)
+        return false;
+    xaccAccountInsertLot (acc, lot);
+    return true;
+}
+
+static bool
+replay_transaction (xmlNodePtr node, QofBook* book)
+{
+    GncGUID guid;
+
+    if (!child_guid (node, "trn:id", guid))
+        return false;
+    auto trans = xaccTransLookup (&guid, book);
+    if (trans)
+        destroy_transaction (trans);
+    return dom_tree_to_transaction (node, book) != nullptr;
+}
+
+static bool
+replay_price (xmlNodePtr node, QofBook* book)
+{
+    GncGUID guid;
+    auto db = gnc_pricedb_get_db (book);
+
+    if (!child_guid (node, "price:id", guid))
+        return false;
+    auto old_price = gnc_price_lookup (&guid, book);
+    if (old_price)
+        gnc_pricedb_remove_price (db, old_price);
+    auto price = dom_tree_to_price (node, book);
+    if (!price)
+        return false;
+    auto ok = gnc_pricedb_add_price (db, price);
+    gnc_price_unref (price);
+    return ok;
+}
+
+static bool
+replay_delete (xmlNodePtr node, QofBook* book)
+{
+    auto type = xmlGetProp (node, BAD_CAST JOURNAL_OBJECT_ATTR);
+    auto guid = dom_tree_to_guid (node);
+    bool ok = type && guid;
+
+    if (ok)
+    {
+        auto type_str = reinterpret_cast<const char*> (type);
+        auto col = qof_book_get_collection (book, type_str);
+        auto inst = qof_collection_lookup_entity (col, guid);
+
+        /* Deleting an account deletes its children, which are in the
+         * journal too. */
+        if (!inst)
+            ;
+        else if (is_type (type_str, GNC_ID_TRANS))
+            destroy_transaction (GNC_TRANSACTION (inst));
+        else if (is_type (type_str, GNC_ID_PRICE))
+            gnc_pricedb_remove_price (gnc_pricedb_get_db (book),
+                                      GNC_PRICE (inst));
+        else if (is_type (type_str, GNC_ID_LOT))
+            gnc_lot_destroy (GNC_LOT (inst));
+        else if (is_type (type_str, GNC_ID_ACCOUNT))
+        {
+            xaccAccountBeginEdit (GNC_ACCOUNT (inst));
+            xaccAccountDestroy (GNC_ACCOUNT (inst));
+        }
+        else
+            ok = false;
+    }
+    xmlFree (type);
+    guid_free (guid);
+    return ok;
+}
+
+static bool
+replay_entry (xmlNodePtr entry, QofBook* book)
+{
+    for (auto node = entry->xmlChildrenNode; node; node = node->next)
+    {
+        if (node->type != XML_ELEMENT_NODE)
+            continue;
+
+        auto name = reinterpret_cast<const char*> (node->name);
+        bool ok;
+        if (g_strcmp0 (name, JOURNAL_BOOK_TAG) == 0)
+            ok = replay_book (node, book);
+        else if (g_strcmp0 (name, "gnc:account") == 0)
+            ok = replay_account (node, book);
+        else if (g_strcmp0 (name, JOURNAL_LOT_TAG) == 0)
+            ok = replay_lot (node, book);
+        else if (g_strcmp0 (name, "gnc:transaction") == 0)
+            ok = replay_transaction (node, book);
+        else if (g_strcmp0 (name, "price") == 0)
+            ok = replay_price (node, book);
+        else if (g_strcmp0 (name, JOURNAL_DELETE_TAG) == 0)
+            ok = replay_delete (node, book);
+        else
+        {
+            PWARN ("Unknown journal record %s", name);
+            ok = false;
+        }
+        if (!ok)
+            return false;
+    }
+    return true;
+}
+
+static gboolean
+entry_end_handler (gpointer data_for_children,
+                   GSList* data_from_children, GSList* sibling_data,
+                   gpointer parent_data, gpointer global_data,
+                   gpointer* result, const gchar* tag)
+{
+    auto tree = static_cast<xmlNodePtr> (data_for_children);
+
+    /* Only the whole entry is wanted; the end handler is also called
+     * for each node inside it and once more with no tag. */
+    if (parent_data || !tag)
+        return TRUE;
+
+    g_return_val_if_fail (tree, FALSE);
+    *static_cast<xmlNodePtr*> (global_data) = tree;
+    return TRUE;
+}
+
+static GncXmlJournalReplay
+replay_entries (QofBook* book, char* contents, size_t length, size_t start,
+                size_t& size)
+{
+    auto parser = sixtp_dom_parser_new (entry_end_handler, nullptr, nullptr);
+    auto db = gnc_pricedb_get_db (book);
+    auto status = GNC_XML_JOURNAL_REPLAYED;
+
+    xaccLogDisable ();
+    xaccDisableDataScrubbing ();
+    gnc_pricedb_set_bulk_update (db, TRUE);
+
+    for (auto pos = start; pos < length;)
+    {
+        gsize entry_size;
+        char digest[JOURNAL_HASH_LENGTH + 1];
+        auto eol = static_cast<char*> (memchr (contents + pos, '\n',
+                                               length - pos));
+        if (!eol ||
+            sscanf (contents + pos, "ENTRY %" G_GSIZE_FORMAT " %64s",
+                    &entry_size, digest) != 2 ||
+            entry_size > length - (eol + 1 - contents) ||
+            hash_data (eol + 1, entry_size) != digest)
+        {
+            PWARN ("The journal ends with an incomplete entry");
+            status = GNC_XML_JOURNAL_DAMAGED;
+            break;
+        }
+
+        xmlNodePtr tree = nullptr;
+        auto parsed = sixtp_parse_buffer (parser, eol + 1, entry_size,
+                                          nullptr, &tree, nullptr);
+        auto ok = parsed && tree && replay_entry (tree, book);
+        if (tree)
+            xmlFreeNode (tree);
+        if (!ok)
+        {
+            PERR ("A journal entry couldn't be replayed");
+            status = GNC_XML_JOURNAL_FAILED;
+            break;
+        }
+        pos = eol + 1 + entry_size - contents;
+        size = pos - start;
+    }
+
+    gnc_pricedb_set_bulk_update (db, FALSE);
+    xaccEnableDataScrubbing ();
+    xaccLogEnable ();
+    sixtp_destroy (parser);
+    return status;
+}
+
+GncXmlJournalReplay
+gnc_xml_journal_replay (QofBook* book, const std::string& datafile,
+                        const std::string& path, size_t& size)
+{
+    gchar* contents = nullptr;
+    gsize length = 0;
+    auto status = GNC_XML_JOURNAL_NONE;
+
+    g_return_val_if_fail (book, GNC_XML_JOURNAL_NONE);
+
+    size = 0;
+    if (!g_file_get_contents (path.c_str (), &contents, &length, nullptr))
+    {
+        DEBUG ("No journal %s", path.c_str ());
+        return GNC_XML_JOURNAL_NONE;
+    }
+
+    auto start = g_get_monotonic_time ();
+    auto data_hash = hash_file (datafile);
+    auto header = journal_header (data_hash);
+    if (data_hash.empty () || length < header.size () ||
+        memcmp (contents, header.data (), header.size ()) != 0)
+        PINFO ("Journal %s doesn't follow %s as it is now", path.c_str (),
+               datafile.c_str ());
+    else
+    {
+        status = replay_entries (book, contents, length, header.size (), size);
+        PINFO ("Replayed %" G_GSIZE_FORMAT " bytes of %s in %" G_GINT64_FORMAT
+               " ms", size, path.c_str (),
+               (g_get_monotonic_time () - start) / 1000);
+    }
+    g_free (contents);
+    return status;
+}
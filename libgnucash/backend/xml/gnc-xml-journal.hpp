@@ -0,0 +1,104 @@
+/********************************************************************
+ * gnc-xml-journal.hpp: Changes to an XML book appended to a file.  *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+\********************************************************************/
+/** @file gnc-xml-journal.hpp
+ *  @brief The changes made to an XML book since it was last written.
+ *
+ *  Writing out a large book takes long enough to be felt every time
+ *  autosave goes off.  When asked to, the XML backend instead appends
+ *  what changed since the last save to a journal beside the data file:
+ *  the accounts, lots, transactions and prices that were changed, in
+ *  the XML the data file uses for them, and the ones that were deleted.
+ *  The whole book is still written when the user saves, when the book
+ *  is closed, when the journal grows too long and when anything else,
+ *  a scheduled transaction, a budget, a commodity or a business
+ *  object, has changed.
+ *
+ *  The journal starts with the SHA-256 of the data file it follows and
+ *  each entry carries the SHA-256 of its own text.  Loading the book
+ *  replays the entries of a journal that follows the data file in the
+ *  order they were written, and stops at an entry that's incomplete
+ *  because GnuCash stopped while writing it.
+ */
+
+#ifndef GNC_XML_JOURNAL_HPP
+#define GNC_XML_JOURNAL_HPP
+
+#include <qof.h>
+
+#include <map>
+#include <set>
+#include <string>
+
+/** The instances committed since the book was last saved. */
+class GncXmlJournalChanges
+{
+public:
+    /** Note a committed instance that was changed or is being destroyed. */
+    void record (QofInstance* inst);
+    bool empty () const { return m_changed.empty () && !m_full_write; }
+    /** False if something changed that only a full write can save. */
+    bool journalable () const { return !m_full_write; }
+    /** Make the text of a journal entry for the changes.
+     *
+     *  @return false if one of the changes couldn't be written.
+     */
+    bool make_entry (QofBook* book, std::string& entry) const;
+    void clear ();
+
+private:
+    /* The GUIDs, as strings so that entries come out the same for the
+     * same changes, of the changed instances of each type. */
+    std::map<std::string, std::set<std::string>> m_changed;
+    bool m_full_write = false;
+};
+
+enum GncXmlJournalReplay
+{
+    GNC_XML_JOURNAL_NONE,     /**< No journal follows the data file. */
+    GNC_XML_JOURNAL_REPLAYED, /**< All the entries were replayed. */
+    GNC_XML_JOURNAL_DAMAGED,  /**< The entries before an incomplete one
+                               * were replayed; nothing may be appended. */
+    GNC_XML_JOURNAL_FAILED,   /**< An entry couldn't be applied; the book
+                               * is incomplete. */
+};
+
+/** Start an empty journal at path for the data file open on data_fd.
+ *
+ *  The data file is only read, to take its hash, so this can be run on
+ *  another thread.  The journal is written to a temporary file and
+ *  renamed into place.
+ */
+bool gnc_xml_journal_start (int data_fd, const std::string& path);
+
+/** Append an entry made by GncXmlJournalChanges::make_entry. */
+bool gnc_xml_journal_append (const std::string& entry,
+                             const std::string& path);
+
+/** Replay the journal at path on a book just loaded from datafile.
+ *
+ *  @param size Set to the length of the entries replayed.
+ */
+GncXmlJournalReplay gnc_xml_journal_replay (QofBook* book,
+                                            const std::string& datafile,
+                                            const std::string& path,
+                                            size_t& size);
+
+#endif /* GNC_XML_JOURNAL_HPP */
@@ -0,0 +1,1176 @@
+/********************************************************************
+ * gnc-xml-snapshot.cpp: Binary snapshots of XML books.             *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+\********************************************************************/
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <config.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "gnc-engine.h"
+#include "gnc-commodity.h"
+#include "gnc-lot.h"
+#include "gnc-lot-p.h"
+#include "gnc-pricedb.h"
+#include "gnc-pricedb-p.h"
+#include "qofinstance-p.h"
+#include "Scrub.h"
+#include "Transaction.h"
+#include "TransLog.h"
+#include <kvp-frame.hpp>
+
+#include <memory>
+#include <set>
+#include <vector>
+
+#include "gnc-xml-snapshot.hpp"
+
+static QofLogModule log_module = GNC_MOD_IO;
+
+/* A snapshot is a fixed header followed by the payload.  The payload is
+ * written in the machine's own byte order, which the header records;
+ * a snapshot taken on a machine of the other sort is simply not used.
+ *
+ * In the payload, numbers are stored as they are in memory.  Strings
+ * are a 32 bit length and the bytes with their terminating NUL, so they
+ * can be handed to the engine straight out of the mapped file; a length
+ * of NULL_STRING stands for a NULL string.  Counts are 32 bits, GUIDs
+ * their 16 bytes and commodities a namespace and mnemonic.
+ *
+ * The payload holds, in order: the book's GUID and slots; the
+ * commodities; the accounts, each parent before its children, with
+ * their lots; the transactions with their splits; and the prices.  The
+ * fields of each are the ones the XML file has for it, and they're put
+ * back in the same way the XML loader does it.
+ */
+
+#define SNAPSHOT_MAGIC "GNCSNAP"
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_BYTE_ORDER 0x01020304
+#define SNAPSHOT_HASH_SIZE 32
+#define NULL_STRING G_MAXUINT32
+
+struct SnapshotHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint8_t source_hash[SNAPSHOT_HASH_SIZE];  /* SHA-256 of the XML file. */
+    uint8_t payload_hash[SNAPSHOT_HASH_SIZE]; /* SHA-256 of the payload. */
+    uint64_t payload_size;
+};
+
+/* The types of object a snapshot carries.  A book with objects of any
+ * other type in it doesn't get one. */
+static const char* snapshot_types[] =
+{
+    GNC_ID_BOOK, GNC_ID_ACCOUNT, GNC_ID_COMMODITY,
+    GNC_ID_COMMODITY_NAMESPACE, GNC_ID_COMMODITY_TABLE, GNC_ID_LOT,
+    GNC_ID_PRICE, GNC_ID_PRICEDB, GNC_ID_SPLIT, GNC_ID_SXES, GNC_ID_TRANS,
+    nullptr
+};
+
+class SnapshotWriter
+{
+public:
+    SnapshotWriter (std::string& buf) : m_buf{buf} {}
+    void u8 (uint8_t val) { m_buf.push_back (static_cast<char> (val)); }
+    void u32 (uint32_t val) { put (&val, sizeof val); }
+    void i64 (int64_t val) { put (&val, sizeof val); }
+    void dbl (double val) { put (&val, sizeof val); }
+    void str (const char* str);
+    void guid (const GncGUID* guid);
+    void numeric (gnc_numeric num) { i64 (num.num); i64 (num.denom); }
+    void commodity (const gnc_commodity* com);
+    void frame (KvpFrame* frame);
+    void value (const KvpValue* val);
+    /* Counts that aren't known until their items are written are
+     * reserved, then filled in. */
+    size_t reserve_count () { auto pos = m_buf.size (); u32 (0); return pos; }
+    void set_count (size_t pos, uint32_t count)
+    {
+        memcpy (&m_buf[pos], &count, sizeof count);
+    }
+private:
+    void put (const void* data, size_t len)
+    {
+        m_buf.append (static_cast<const char*> (data), len);
+    }
+    std::string& m_buf;
+};
+
+void
+SnapshotWriter::str (const char* str)
+{
+    if (!str)
+    {
+        u32 (NULL_STRING);
+        return;
+    }
+    auto len = strlen (str);
+    u32 (len);
+    put (str, len + 1);
+}
+
+void
+SnapshotWriter::guid (const GncGUID* guid)
+{
+    put (guid ? guid->reserved : guid_null ()->reserved, GUID_DATA_SIZE);
+}
+
+void
+SnapshotWriter::commodity (const gnc_commodity* com)
+{
+    str (com ? gnc_commodity_get_namespace (com) : nullptr);
+    str (com ? gnc_commodity_get_mnemonic (com) : nullptr);
+}
+
+void
+SnapshotWriter::frame (KvpFrame* frame)
+{
+    if (!frame)
+    {
+        u32 (0);
+        return;
+    }
+    auto pos = reserve_count ();
+    uint32_t count = 0;
+    for (const auto& slot : *frame)
+    {
+        if (!slot.second ||
+            slot.second->get_type () == KvpValue::Type::PLACEHOLDER_DONT_USE)
+            continue;
+        str (slot.first);
+        value (slot.second);
+        ++count;
+    }
+    set_count (pos, count);
+}
+
+void
+SnapshotWriter::value (const KvpValue* val)
+{
+    auto type = val->get_type ();
+    u8 (type);
+    switch (type)
+    {
+    case KvpValue::Type::INT64:
+        i64 (val->get<int64_t> ());
+        break;
+    case KvpValue::Type::DOUBLE:
+        dbl (val->get<double> ());
+        break;
+    case KvpValue::Type::NUMERIC:
+        numeric (val->get<gnc_numeric> ());
+        break;
+    case KvpValue::Type::STRING:
+        str (val->get<const char*> ());
+        break;
+    case KvpValue::Type::GUID:
+        guid (val->get<GncGUID*> ());
+        break;
+    case KvpValue::Type::TIME64:
+        i64 (val->get<Time64> ().t);
+        break;
+    case KvpValue::Type::GDATE:
+    {
+        auto date = val->get<GDate> ();
+        u32 (g_date_valid (&date) ? g_date_get_julian (&date) : 0);
+        break;
+    }
+    case KvpValue::Type::GLIST:
+    {
+        auto list = val->get<GList*> ();
+        u32 (g_list_length (list));
+        for (auto node = list; node; node = node->next)
+            value (static_cast<const KvpValue*> (node->data));
+        break;
+    }
+    case KvpValue::Type::FRAME:
+        frame (val->get<KvpFrame*> ());
+        break;
+    default:
+        break;
+    }
+}
+
+class SnapshotReader
+{
+public:
+    SnapshotReader (const char* data, size_t size) :
+        m_pos{data}, m_end{data + size} {}
+    bool ok () const { return m_ok; }
+    bool at_end () const { return m_pos == m_end; }
+    uint8_t u8 () { uint8_t val = 0; take (&val, sizeof val); return val; }
+    uint32_t u32 () { uint32_t val = 0; take (&val, sizeof val); return val; }
+    int64_t i64 () { int64_t val = 0; take (&val, sizeof val); return val; }
+    double dbl () { double val = 0.0; take (&val, sizeof val); return val; }
+    const char* str ();
+    GncGUID guid ();
+    gnc_numeric numeric ()
+    {
+        auto num = i64 ();
+        return gnc_numeric_create (num, i64 ());
+    }
+    gnc_commodity* commodity (QofBook* book);
+    void frame (KvpFrame* frame);
+    KvpValue* value ();
+private:
+    bool take (void* dest, size_t len);
+    const char* m_pos;
+    const char* m_end;
+    bool m_ok = true;
+};
+
+bool
+SnapshotReader::take (void* dest, size_t len)
+{
+    if (!m_ok || static_cast<size_t> (m_end - m_pos) < len)
+    {
+        m_ok = false;
+        return false;
+    }
+    memcpy (dest, m_pos, len);
+    m_pos += len;
+    return true;
+}
+
+/* The string stays in the mapped file, so it lives only as long as the
+ * reader does. */
+const char*
+SnapshotReader::str ()
+{
+    auto len = u32 ();
+    if (!m_ok || len == NULL_STRING)
+        return nullptr;
+    if (static_cast<size_t> (m_end - m_pos) <= len || m_pos[len] != '\0')
+    {
+        m_ok = false;
+        return nullptr;
+    }
+    auto ret = m_pos;
+    m_pos += len + 1;
+    return ret;
+}
+
+GncGUID
+SnapshotReader::guid ()
+{
+    GncGUID guid;
+    if (!take (guid.reserved, GUID_DATA_SIZE))
+        return *guid_null ();
+    return guid;
+}
+
+/* Finds the commodity in the book's table, adding it if it isn't
+ * there, as the XML loader does. */
+gnc_commodity*
+SnapshotReader::commodity (QofBook* book)
+{
+    auto name_space = str ();
+    auto mnemonic = str ();
+    if (!name_space || !mnemonic)
+        return nullptr;
+
+    auto table = gnc_commodity_table_get_table (book);
+    auto com = gnc_commodity_table_lookup (table, name_space, mnemonic);
+    if (!com)
+    {
+        PWARN ("unable to find global commodity for %s::%s adding new",
+               name_space, mnemonic);
+        com = gnc_commodity_new (book, nullptr, name_space, mnemonic,
+                                 nullptr, 0);
+        com = gnc_commodity_table_insert (table, com);
+    }
+    return com;
+}
+
+void
+SnapshotReader::frame (KvpFrame* frame)
+{
+    auto count = u32 ();
+    for (uint32_t i = 0; i < count && m_ok; ++i)
+    {
+        auto key = str ();
+        auto val = value ();
+        if (!key || !val)
+        {
+            delete val;
+            m_ok = false;
+            return;
+        }
+        delete frame->set ({key}, val);
+    }
+}
+
+KvpValue*
+SnapshotReader::value ()
+{
+    auto type = static_cast<KvpValue::Type> (u8 ());
+    if (!m_ok)
+        return nullptr;
+    switch (type)
+    {
+    case KvpValue::Type::INT64:
+        return new KvpValue {i64 ()};
+    case KvpValue::Type::DOUBLE:
+        return new KvpValue {dbl ()};
+    case KvpValue::Type::NUMERIC:
+        return new KvpValue {numeric ()};
+    case KvpValue::Type::STRING:
+    {
+        auto text = str ();
+        return text ? new KvpValue {static_cast<const char*> (g_strdup (text))}
+                    : nullptr;
+    }
+    case KvpValue::Type::GUID:
+    {
+        auto id = guid ();
+        return new KvpValue {guid_copy (&id)};
+    }
+    case KvpValue::Type::TIME64:
+        return new KvpValue {Time64 {i64 ()}};
+    case KvpValue::Type::GDATE:
+    {
+        GDate date;
+        auto julian = u32 ();
+        g_date_clear (&date, 1);
+        if (g_date_valid_julian (julian))
+            g_date_set_julian (&date, julian);
+        return new KvpValue {date};
+    }
+    case KvpValue::Type::GLIST:
+    {
+        GList* list = nullptr;
+        auto count = u32 ();
+        for (uint32_t i = 0; i < count && m_ok; ++i)
+        {
+            auto val = value ();
+            if (val)
+                list = g_list_prepend (list, val);
+        }
+        return new KvpValue {g_list_reverse (list)};
+    }
+    case KvpValue::Type::FRAME:
+    {
+        auto child = new KvpFrame;
+        frame (child);
+        return new KvpValue {child};
+    }
+    default:
+        m_ok = false;
+        return nullptr;
+    }
+}
+
+/***********************************************************************/
+
+static void
+check_collection (QofCollection* col, gpointer data)
+{
+    auto supported = static_cast<bool*> (data);
+    auto type = qof_collection_get_type (col);
+
+    if (!*supported || qof_collection_count (col) == 0)
+        return;
+    for (auto name = snapshot_types; *name; ++name)
+        if (g_strcmp0 (type, *name) == 0)
+            return;
+    DEBUG ("The book has objects of type %s", type);
+    *supported = false;
+}
+
+/* Writes them as gnc_commodity_dom_tree_create does, currencies without
+ * quotes or slots being left to the table every book starts with. */
+static void
+write_commodities (SnapshotWriter& out, QofBook* book)
+{
+    auto table = gnc_commodity_table_get_table (book);
+    auto namespaces = gnc_commodity_table_get_namespaces (table);
+    auto pos = out.reserve_count ();
+    uint32_t count = 0;
+
+    for (auto ns = namespaces; ns; ns = ns->next)
+    {
+        auto comms = gnc_commodity_table_get_commodities
+                     (table, static_cast<const char*> (ns->data));
+        for (auto node = comms; node; node = node->next)
+        {
+            auto com = static_cast<gnc_commodity*> (node->data);
+            auto slots = qof_instance_get_slots (QOF_INSTANCE (com));
+            auto currency = gnc_commodity_is_iso (com);
+            auto quotes = gnc_commodity_get_quote_flag (com);
+            const char* cusip = gnc_commodity_get_cusip (com);
+
+            if (currency && !quotes && (!slots || slots->empty ()))
+                continue;
+
+            out.str (gnc_commodity_get_namespace (com));
+            out.str (gnc_commodity_get_mnemonic (com));
+            out.str (currency ? nullptr : gnc_commodity_get_fullname (com));
+            out.str (currency || !cusip || !*cusip ? nullptr : cusip);
+            out.u32 (currency ? 0 : gnc_commodity_get_fraction (com));
+            out.u8 (quotes);
+            if (quotes)
+            {
+                auto source = gnc_commodity_get_quote_source (com);
+                out.str (source ? gnc_quote_source_get_internal_name (source)
+                         : nullptr);
+                out.str (gnc_commodity_get_quote_tz (com));
+            }
+            else
+            {
+                out.str (nullptr);
+                out.str (nullptr);
+            }
+            out.frame (slots);
+            ++count;
+        }
+        g_list_free (comms);
+    }
+    g_list_free (namespaces);
+    out.set_count (pos, count);
+}
+
+static void
+write_account (SnapshotWriter& out, Account* acc)
+{
+    auto code = xaccAccountGetCode (acc);
+    auto description = xaccAccountGetDescription (acc);
+    auto commodity = xaccAccountGetCommodity (acc);
+    auto parent = gnc_account_get_parent (acc);
+    auto lots = xaccAccountGetLotList (acc);
+
+    out.guid (xaccAccountGetGUID (acc));
+    out.str (xaccAccountGetName (acc));
+    out.u32 (xaccAccountGetType (acc));
+    out.commodity (commodity);
+    out.u32 (commodity ? xaccAccountGetCommoditySCUi (acc) : 0);
+    out.u8 (commodity && xaccAccountGetNonStdSCU (acc));
+    out.str (code && *code ? code : nullptr);
+    out.str (description && *description ? description : nullptr);
+    out.frame (qof_instance_get_slots (QOF_INSTANCE (acc)));
+    /* Children of the root account are found without being told. */
+    out.u8 (parent && !gnc_account_is_root (parent));
+    if (parent && !gnc_account_is_root (parent))
+        out.guid (xaccAccountGetGUID (parent));
+
+    out.u32 (g_list_length (lots));
+    for (auto node = lots; node; node = node->next)
+    {
+        auto lot = static_cast<GNCLot*> (node->data);
+        out.guid (gnc_lot_get_guid (lot));
+        out.frame (qof_instance_get_slots (QOF_INSTANCE (lot)));
+    }
+    g_list_free (lots);
+}
+
+static void
+write_accounts (SnapshotWriter& out, Account* root)
+{
+    auto descendants = gnc_account_get_descendants (root);
+
+    out.u32 (g_list_length (descendants) + 1);
+    write_account (out, root);
+    for (auto node = descendants; node; node = node->next)
+        write_account (out, static_cast<Account*> (node->data));
+    g_list_free (descendants);
+}
+
+struct ItemCount
+{
+    SnapshotWriter& out;
+    uint32_t count;
+};
+
+static int
+write_transaction (Transaction* trans, void* data)
+{
+    auto counter = static_cast<ItemCount*> (data);
+    auto& out = counter->out;
+    auto num = xaccTransGetNum (trans);
+
+    out.guid (xaccTransGetGUID (trans));
+    out.commodity (xaccTransGetCurrency (trans));
+    out.str (num && *num ? num : nullptr);
+    out.i64 (xaccTransRetDatePosted (trans));
+    out.i64 (xaccTransRetDateEntered (trans));
+    out.str (xaccTransGetDescription (trans));
+    out.frame (qof_instance_get_slots (QOF_INSTANCE (trans)));
+
+    auto splits = xaccTransGetSplitList (trans);
+    out.u32 (g_list_length (splits));
+    for (auto node = splits; node; node = node->next)
+    {
+        auto split = static_cast<Split*> (node->data);
+        auto memo = xaccSplitGetMemo (split);
+        auto action = xaccSplitGetAction (split);
+        auto lot = xaccSplitGetLot (split);
+
+        out.guid (xaccSplitGetGUID (split));
+        out.str (memo && *memo ? memo : nullptr);
+        out.str (action && *action ? action : nullptr);
+        out.u8 (xaccSplitGetReconcile (split));
+        out.i64 (xaccSplitGetDateReconciled (split));
+        out.numeric (xaccSplitGetValue (split));
+        out.numeric (xaccSplitGetAmount (split));
+        out.guid (xaccAccountGetGUID (xaccSplitGetAccount (split)));
+        out.u8 (lot != nullptr);
+        if (lot)
+            out.guid (gnc_lot_get_guid (lot));
+        out.frame (qof_instance_get_slots (QOF_INSTANCE (split)));
+    }
+    ++counter->count;
+    return 0;
+}
+
+static gboolean
+write_price (GNCPrice* price, gpointer data)
+{
+    auto counter = static_cast<ItemCount*> (data);
+    auto& out = counter->out;
+
+    out.guid (gnc_price_get_guid (price));
+    out.commodity (gnc_price_get_commodity (price));
+    out.commodity (gnc_price_get_currency (price));
+    out.i64 (gnc_price_get_time64 (price));
+    out.str (gnc_price_get_source_string (price));
+    out.str (gnc_price_get_typestr (price));
+    out.numeric (gnc_price_get_value (price));
+    ++counter->count;
+    return TRUE;
+}
+
+bool
+gnc_xml_snapshot_serialize (QofBook* book, std::string& image)
+{
+    bool supported = true;
+
+    g_return_val_if_fail (book, false);
+
+    qof_book_foreach_collection (book, check_collection, &supported);
+    if (supported &&
+        gnc_account_n_children (gnc_book_get_template_root (book)) > 0)
+        supported = false;
+    if (!supported)
+    {
+        PINFO ("The book has objects a snapshot can't hold");
+        return false;
+    }
+
+    auto start = g_get_monotonic_time ();
+    auto root = gnc_book_get_root_account (book);
+    SnapshotWriter out{image};
+    image.clear ();
+
+    out.guid (qof_instance_get_guid (QOF_INSTANCE (book)));
+    out.frame (qof_instance_get_slots (QOF_INSTANCE (book)));
+    write_commodities (out, book);
+    write_accounts (out, root);
+
+    ItemCount counter{out, 0};
+    auto pos = out.reserve_count ();
+    xaccAccountTreeForEachTransaction (root, write_transaction, &counter);
+    out.set_count (pos, counter.count);
+
+    counter.count = 0;
+    pos = out.reserve_count ();
+    gnc_pricedb_foreach_price (gnc_pricedb_get_db (book), write_price,
+                               &counter, FALSE);
+    out.set_count (pos, counter.count);
+
+    PINFO ("Made a snapshot of %" G_GSIZE_FORMAT " bytes in %" G_GINT64_FORMAT
+           " ms", image.size (), (g_get_monotonic_time () - start) / 1000);
+    return true;
+}
+
+/***********************************************************************/
+
+static bool
+hash_fd (int fd, uint8_t* digest)
+{
+    constexpr size_t buf_size = 64 * 1024;
+    std::unique_ptr<guchar[]> buf{new guchar[buf_size]};
+    auto checksum = g_checksum_new (G_CHECKSUM_SHA256);
+    bool ok = true;
+
+    while (true)
+    {
+        auto len = read (fd, buf.get (), buf_size);
+        if (len == 0)
+            break;
+        if (len < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            ok = false;
+            break;
+        }
+        g_checksum_update (checksum, buf.get (), len);
+    }
+
+    gsize digest_len = SNAPSHOT_HASH_SIZE;
+    g_checksum_get_digest (checksum, digest, &digest_len);
+    g_checksum_free (checksum);
+    return ok;
+}
+
+static bool
+hash_file (const std::string& path, uint8_t* digest)
+{
+    int flags = O_RDONLY;
+#ifdef G_OS_WIN32
+    flags |= O_BINARY;
+#endif
+    auto fd = g_open (path.c_str (), flags, 0);
+    if (fd == -1)
+        return false;
+    auto ok = hash_fd (fd, digest);
+    close (fd);
+    return ok;
+}
+
+static void
+hash_data (const void* data, size_t len, uint8_t* digest)
+{
+    auto checksum = g_checksum_new (G_CHECKSUM_SHA256);
+    gsize digest_len = SNAPSHOT_HASH_SIZE;
+
+    g_checksum_update (checksum, static_cast<const guchar*> (data), len);
+    g_checksum_get_digest (checksum, digest, &digest_len);
+    g_checksum_free (checksum);
+}
+
+static bool
+write_all (int fd, const void* data, size_t len)
+{
+    auto pos = static_cast<const char*> (data);
+    while (len > 0)
+    {
+        auto written = write (fd, pos, len);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        pos += written;
+        len -= written;
+    }
+    return true;
+}
+
+bool
+gnc_xml_snapshot_write (int data_fd, const std::string& image,
+                        const std::string& path)
+{
+    SnapshotHeader header;
+    int flags = 0;
+
+#ifdef G_OS_WIN32
+    flags = O_BINARY;
+#endif
+
+    memset (&header, 0, sizeof header);
+    memcpy (header.magic, SNAPSHOT_MAGIC, sizeof header.magic);
+    header.version = SNAPSHOT_VERSION;
+    header.byte_order = SNAPSHOT_BYTE_ORDER;
+    header.payload_size = image.size ();
+    if (!hash_fd (data_fd, header.source_hash))
+    {
+        PWARN ("Unable to read the data file for %s: %s", path.c_str (),
+               g_strerror (errno));
+        return false;
+    }
+    hash_data (image.data (), image.size (), header.payload_hash);
+
+    auto tmp_name = path + ".tmp-XXXXXX";
+    auto fd = g_mkstemp_full (&tmp_name[0], O_WRONLY | flags, 0600);
+    if (fd == -1)
+    {
+        PWARN ("Unable to create %s: %s", tmp_name.c_str (),
+               g_strerror (errno));
+        return false;
+    }
+    auto ok = write_all (fd, &header, sizeof header) &&
+              write_all (fd, image.data (), image.size ());
+    if (close (fd) != 0)
+        ok = false;
+#ifdef G_OS_WIN32
+    if (ok)
+        g_unlink (path.c_str ());
+#endif
+    if (!ok || g_rename (tmp_name.c_str (), path.c_str ()) != 0)
+    {
+        PWARN ("Unable to write %s: %s", path.c_str (), g_strerror (errno));
+        g_unlink (tmp_name.c_str ());
+        return false;
+    }
+    return true;
+}
+
+/***********************************************************************/
+
+static bool
+read_commodities (SnapshotReader& in, QofBook* book)
+{
+    auto table = gnc_commodity_table_get_table (book);
+    auto count = in.u32 ();
+
+    for (uint32_t i = 0; i < count && in.ok (); ++i)
+    {
+        auto name_space = in.str ();
+        auto mnemonic = in.str ();
+        auto fullname = in.str ();
+        auto cusip = in.str ();
+        auto fraction = static_cast<int> (in.u32 ());
+        auto quotes = in.u8 ();
+        auto source_name = in.str ();
+        auto quote_tz = in.str ();
+        if (!in.ok () || !name_space || !mnemonic)
+            return false;
+
+        /* As gnc_commodity_end_handler does it: currencies start from
+         * the ones already in the table. */
+        auto com = gnc_commodity_new (book, nullptr, nullptr, nullptr,
+                                      nullptr, 0);
+        if (gnc_commodity_namespace_is_iso (name_space))
+        {
+            auto old_com = gnc_commodity_table_lookup (table, name_space,
+                                                       mnemonic);
+            if (old_com)
+                gnc_commodity_copy (com, old_com);
+        }
+        gnc_commodity_set_namespace (com, name_space);
+        gnc_commodity_set_mnemonic (com, mnemonic);
+        if (fullname)
+            gnc_commodity_set_fullname (com, fullname);
+        if (cusip)
+            gnc_commodity_set_cusip (com, cusip);
+        if (fraction)
+            gnc_commodity_set_fraction (com, fraction);
+        if (quotes)
+            gnc_commodity_set_quote_flag (com, TRUE);
+        if (source_name)
+        {
+            auto source = gnc_quote_source_lookup_by_internal (source_name);
+            if (!source)
+                source = gnc_quote_source_add_new (source_name, FALSE);
+            gnc_commodity_set_quote_source (com, source);
+        }
+        if (quote_tz)
+            gnc_commodity_set_quote_tz (com, quote_tz);
+        in.frame (qof_instance_get_slots (QOF_INSTANCE (com)));
+        if (!in.ok () || gnc_commodity_get_fraction (com) == 0)
+        {
+            gnc_commodity_destroy (com);
+            return false;
+        }
+        gnc_commodity_table_insert (table, com);
+    }
+    return in.ok ();
+}
+
+/* The accounts are left open for editing, as the XML loader leaves
+ * them, to be committed once the transactions are in. */
+static bool
+read_accounts (SnapshotReader& in, QofBook* book)
+{
+    auto count = in.u32 ();
+
+    for (uint32_t i = 0; i < count && in.ok (); ++i)
+    {
+        auto acc = xaccMallocAccount (book);
+        xaccAccountBeginEdit (acc);
+
+        auto guid = in.guid ();
+        xaccAccountSetGUID (acc, &guid);
+        auto name = in.str ();
+        if (name)
+            xaccAccountSetName (acc, name);
+        auto type = static_cast<GNCAccountType> (in.u32 ());
+        xaccAccountSetType (acc, type);
+        auto commodity = in.commodity (book);
+        auto scu = static_cast<int> (in.u32 ());
+        auto non_std_scu = in.u8 ();
+        if (commodity)
+        {
+            xaccAccountSetCommodity (acc, commodity);
+            xaccAccountSetCommoditySCU (acc, scu);
+            if (non_std_scu)
+                xaccAccountSetNonStdSCU (acc, TRUE);
+        }
+        auto code = in.str ();
+        if (code)
+            xaccAccountSetCode (acc, code);
+        auto description = in.str ();
+        if (description)
+            xaccAccountSetDescription (acc, description);
+        in.frame (qof_instance_get_slots (QOF_INSTANCE (acc)));
+
+        Account* parent = nullptr;
+        if (in.u8 ())
+        {
+            auto parent_guid = in.guid ();
+            parent = xaccAccountLookup (&parent_guid, book);
+            if (!parent)
+                return false;
+        }
+
+        auto n_lots = in.u32 ();
+        for (uint32_t j = 0; j < n_lots && in.ok (); ++j)
+        {
+            auto lot = gnc_lot_new (book);
+            auto lot_guid = in.guid ();
+            gnc_lot_set_guid (lot, lot_guid);
+            in.frame (qof_instance_get_slots (QOF_INSTANCE (lot)));
+            xaccAccountInsertLot (acc, lot);
+        }
+        if (!in.ok ())
+            return false;
+
+        xaccAccountScrubCommodity (acc);
+        xaccAccountScrubKvp (acc);
+
+        if (type == ACCT_TYPE_ROOT)
+            gnc_book_set_root_account (book, acc);
+        else if (parent)
+            gnc_account_append_child (parent, acc);
+        else
+            gnc_account_append_child (gnc_book_get_root_account (book), acc);
+    }
+    return in.ok ();
+}
+
+static bool
+read_transactions (SnapshotReader& in, QofBook* book)
+{
+    auto count = in.u32 ();
+
+    for (uint32_t i = 0; i < count && in.ok (); ++i)
+    {
+        auto trans = xaccMallocTransaction (book);
+        xaccTransBeginEdit (trans);
+
+        auto guid = in.guid ();
+        xaccTransSetGUID (trans, &guid);
+        auto currency = in.commodity (book);
+        if (currency)
+            xaccTransSetCurrency (trans, currency);
+        auto num = in.str ();
+        if (num)
+            xaccTransSetNum (trans, num);
+        xaccTransSetDatePostedSecs (trans, in.i64 ());
+        xaccTransSetDateEnteredSecs (trans, in.i64 ());
+        auto description = in.str ();
+        if (description)
+            xaccTransSetDescription (trans, description);
+        in.frame (qof_instance_get_slots (QOF_INSTANCE (trans)));
+
+        auto n_splits = in.u32 ();
+        for (uint32_t j = 0; j < n_splits && in.ok (); ++j)
+        {
+            auto split = xaccMallocSplit (book);
+
+            auto split_guid = in.guid ();
+            xaccSplitSetGUID (split, &split_guid);
+            auto memo = in.str ();
+            if (memo)
+                xaccSplitSetMemo (split, memo);
+            auto action = in.str ();
+            if (action)
+                xaccSplitSetAction (split, action);
+            xaccSplitSetReconcile (split, in.u8 ());
+            auto reconciled = in.i64 ();
+            if (reconciled)
+                xaccSplitSetDateReconciledSecs (split, reconciled);
+            xaccSplitSetValue (split, in.numeric ());
+            xaccSplitSetAmount (split, in.numeric ());
+            auto acc_guid = in.guid ();
+            xaccAccountInsertSplit (xaccAccountLookup (&acc_guid, book), split);
+            if (in.u8 ())
+            {
+                auto lot_guid = in.guid ();
+                gnc_lot_add_split (gnc_lot_lookup (&lot_guid, book), split);
+            }
+            in.frame (qof_instance_get_slots (QOF_INSTANCE (split)));
+            xaccTransAppendSplit (trans, split);
+        }
+
+        xaccTransScrubCurrency (trans);
+        xaccTransScrubPostedDate (trans);
+        xaccTransCommitEdit (trans);
+    }
+    return in.ok ();
+}
+
+static bool
+read_prices (SnapshotReader& in, QofBook* book)
+{
+    auto db = gnc_pricedb_get_db (book);
+    auto count = in.u32 ();
+
+    for (uint32_t i = 0; i < count && in.ok (); ++i)
+    {
+        auto price = gnc_price_create (book);
+
+        gnc_price_begin_edit (price);
+        auto guid = in.guid ();
+        gnc_price_set_guid (price, &guid);
+        gnc_price_set_commodity (price, in.commodity (book));
+        gnc_price_set_currency (price, in.commodity (book));
+        gnc_price_set_time64 (price, in.i64 ());
+        auto source = in.str ();
+        if (source)
+            gnc_price_set_source_string (price, source);
+        auto type = in.str ();
+        if (type)
+            gnc_price_set_typestr (price, type);
+        gnc_price_set_value (price, in.numeric ());
+        gnc_price_commit_edit (price);
+
+        if (in.ok ())
+            gnc_pricedb_add_price (db, price);
+        gnc_price_unref (price);
+    }
+    return in.ok ();
+}
+
+static bool
+read_book (SnapshotReader& in, QofBook* book)
+{
+    auto guid = in.guid ();
+    qof_instance_set_guid (QOF_INSTANCE (book), &guid);
+    in.frame (qof_instance_get_slots (QOF_INSTANCE (book)));
+
+    return in.ok () &&
+           read_commodities (in, book) &&
+           read_accounts (in, book) &&
+           read_transactions (in, book) &&
+           read_prices (in, book) &&
+           in.at_end ();
+}
+
+/* Builds the book as qof_session_load_from_xml_file_v2_full does. */
+static bool
+build_book (SnapshotReader& in, QofBook* book)
+{
+    xaccLogDisable ();
+    xaccDisableDataScrubbing ();
+
+    auto ok = read_book (in, book);
+
+    xaccEnableDataScrubbing ();
+
+    auto root = gnc_book_get_root_account (book);
+    if (ok)
+    {
+        qof_book_mark_session_saved (book);
+        xaccAccountTreeScrubAfterLoad (root,
+                                       gnc_commodity_table_get_table (book));
+    }
+
+    auto template_root = gnc_book_get_template_root (book);
+    gnc_account_foreach_descendant (root, (AccountCb) xaccAccountCommitEdit,
+                                    nullptr);
+    if (qof_instance_get_editlevel (root) != 0)
+        xaccAccountCommitEdit (root);
+    if (qof_instance_get_editlevel (template_root) != 0)
+        xaccAccountCommitEdit (template_root);
+
+    xaccLogEnable ();
+    return ok;
+}
+
+using CommoditySet = std::set<gnc_commodity*>;
+
+static CommoditySet
+table_commodities (QofBook* book)
+{
+    auto table = gnc_commodity_table_get_table (book);
+    auto namespaces = gnc_commodity_table_get_namespaces (table);
+    CommoditySet comms;
+
+    for (auto ns = namespaces; ns; ns = ns->next)
+    {
+        auto list = gnc_commodity_table_get_commodities
+                    (table, static_cast<const char*> (ns->data));
+        for (auto node = list; node; node = node->next)
+            comms.insert (static_cast<gnc_commodity*> (node->data));
+        g_list_free (list);
+    }
+    g_list_free (namespaces);
+    return comms;
+}
+
+static gboolean
+collect_price (GNCPrice* price, gpointer data)
+{
+    static_cast<std::vector<GNCPrice*>*> (data)->push_back (price);
+    return TRUE;
+}
+
+static void
+collect_instance (QofInstance* inst, gpointer data)
+{
+    static_cast<std::vector<QofInstance*>*> (data)->push_back (inst);
+}
+
+static std::vector<QofInstance*>
+book_instances (QofBook* book, QofIdTypeConst type)
+{
+    std::vector<QofInstance*> instances;
+    qof_collection_foreach (qof_book_get_collection (book, type),
+                            collect_instance, &instances);
+    return instances;
+}
+
+/* Takes out whatever a snapshot that couldn't be read put into the book,
+ * so that the XML file can be loaded into it instead.  The commodities
+ * that were in the table before are left; the XML file has them too. */
+static void
+clear_book (QofBook* book, const CommoditySet& old_comms)
+{
+    xaccLogDisable ();
+
+    auto db = gnc_pricedb_get_db (book);
+    std::vector<GNCPrice*> prices;
+    gnc_pricedb_foreach_price (db, collect_price, &prices, FALSE);
+    for (auto price : prices)
+        gnc_pricedb_remove_price (db, price);
+
+    for (auto inst : book_instances (book, GNC_ID_TRANS))
+    {
+        auto trans = GNC_TRANSACTION (inst);
+        xaccTransBeginEdit (trans);
+        xaccTransDestroy (trans);
+        xaccTransCommitEdit (trans);
+    }
+
+    /* Destroying the accounts at the top of each tree takes the rest with
+     * them.  The root has to be unhooked from the book first, and the
+     * template root, which the book had before, is kept. */
+    qof_collection_set_data (qof_book_get_collection (book,
+                                                      GNC_ID_ROOT_ACCOUNT),
+                             nullptr);
+    auto template_root = gnc_book_get_template_root (book);
+    for (auto inst : book_instances (book, GNC_ID_ACCOUNT))
+    {
+        auto acc = GNC_ACCOUNT (inst);
+        if (acc == template_root || gnc_account_get_parent (acc))
+            continue;
+        if (qof_instance_get_editlevel (acc) == 0)
+            xaccAccountBeginEdit (acc);
+        xaccAccountDestroy (acc);
+    }
+
+    auto table = gnc_commodity_table_get_table (book);
+    for (auto com : table_commodities (book))
+    {
+        if (old_comms.count (com))
+            continue;
+        gnc_commodity_table_remove (table, com);
+        gnc_commodity_destroy (com);
+    }
+
+    auto slots = qof_instance_get_slots (QOF_INSTANCE (book));
+    for (const auto& key : slots->get_keys ())
+        delete slots->set ({key}, nullptr);
+
+    xaccLogEnable ();
+}
+
+GncXmlSnapshotLoad
+gnc_xml_snapshot_load (QofBook* book, const std::string& datafile,
+                       const std::string& path)
+{
+    GError* error = nullptr;
+    SnapshotHeader header;
+    uint8_t digest[SNAPSHOT_HASH_SIZE];
+
+    g_return_val_if_fail (book, GNC_XML_SNAPSHOT_UNUSABLE);
+
+    auto mapped = g_mapped_file_new (path.c_str (), FALSE, &error);
+    if (!mapped)
+    {
+        DEBUG ("No snapshot %s: %s", path.c_str (), error->message);
+        g_error_free (error);
+        return GNC_XML_SNAPSHOT_UNUSABLE;
+    }
+
+    auto start = g_get_monotonic_time ();
+    auto data = g_mapped_file_get_contents (mapped);
+    auto size = g_mapped_file_get_length (mapped);
+    auto status = GNC_XML_SNAPSHOT_UNUSABLE;
+
+    if (size < sizeof header)
+    {
+        PWARN ("Snapshot %s is too short", path.c_str ());
+        goto done;
+    }
+    memcpy (&header, data, sizeof header);
+    if (memcmp (header.magic, SNAPSHOT_MAGIC, sizeof header.magic) != 0 ||
+        header.version != SNAPSHOT_VERSION ||
+        header.byte_order != SNAPSHOT_BYTE_ORDER ||
+        header.payload_size != size - sizeof header)
+    {
+        PINFO ("Snapshot %s isn't one this version can read", path.c_str ());
+        goto done;
+    }
+    if (!hash_file (datafile, digest) ||
+        memcmp (digest, header.source_hash, SNAPSHOT_HASH_SIZE) != 0)
+    {
+        PINFO ("Snapshot %s was taken of another version of %s",
+               path.c_str (), datafile.c_str ());
+        goto done;
+    }
+    hash_data (data + sizeof header, header.payload_size, digest);
+    if (memcmp (digest, header.payload_hash, SNAPSHOT_HASH_SIZE) != 0)
+    {
+        PWARN ("Snapshot %s is damaged", path.c_str ());
+        goto done;
+    }
+
+    {
+        SnapshotReader in{data + sizeof header, size - sizeof header};
+        auto old_comms = table_commodities (book);
+        if (build_book (in, book))
+        {
+            status = GNC_XML_SNAPSHOT_LOADED;
+            PINFO ("Loaded %s from its snapshot in %" G_GINT64_FORMAT " ms",
+                   datafile.c_str (), (g_get_monotonic_time () - start) / 1000);
+        }
+        else
+        {
+            PERR ("Snapshot %s couldn't be read", path.c_str ());
+            clear_book (book, old_comms);
+            status = GNC_XML_SNAPSHOT_FAILED;
+        }
+    }
+
+done:
+    g_mapped_file_unref (mapped);
+    return status;
+}
@@ -0,0 +1,76 @@
+/********************************************************************
+ * gnc-xml-snapshot.hpp: Binary snapshots of XML books.             *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+\********************************************************************/
+/** @file gnc-xml-snapshot.hpp
+ *  @brief A binary image of a book kept next to its XML file.
+ *
+ *  Parsing a large XML book takes most of the time it takes to open
+ *  it.  When asked to, the XML backend writes a snapshot of the book
+ *  beside the data file each time it saves: the accounts, lots,
+ *  transactions, splits, prices, commodities and their KVP in a
+ *  compact binary form that is read straight out of a memory mapped
+ *  file.  The snapshot records the SHA-256 of the XML file it was
+ *  taken with, so it's only used while the XML file is unchanged;
+ *  otherwise the XML file is read as it always was.
+ *
+ *  Books holding anything else, scheduled transactions, budgets or
+ *  business objects, don't get a snapshot.
+ */
+
+#ifndef GNC_XML_SNAPSHOT_HPP
+#define GNC_XML_SNAPSHOT_HPP
+
+#include <qof.h>
+
+#include <string>
+
+enum GncXmlSnapshotLoad
+{
+    GNC_XML_SNAPSHOT_LOADED,   /**< The book was built from the snapshot. */
+    GNC_XML_SNAPSHOT_UNUSABLE, /**< Missing, stale or damaged; the book
+                                * wasn't touched. */
+    GNC_XML_SNAPSHOT_FAILED,   /**< Went wrong part way through; what was
+                                * put in the book was taken out again, so
+                                * the snapshot is bad and should go. */
+};
+
+/** Make the snapshot image of a book.
+ *
+ *  @return false if the book holds objects a snapshot can't carry.
+ */
+bool gnc_xml_snapshot_serialize (QofBook* book, std::string& image);
+
+/** Write a snapshot image for the XML file open on data_fd to path.
+ *
+ *  The data file is only read, to take its hash, so this can be run
+ *  on another thread once the image is made.  The snapshot is written
+ *  to a temporary file and renamed into place.
+ */
+bool gnc_xml_snapshot_write (int data_fd, const std::string& image,
+                             const std::string& path);
+
+/** Load a book from the snapshot at path if it was taken of datafile as
+ *  it is now.
+ */
+GncXmlSnapshotLoad gnc_xml_snapshot_load (QofBook* book,
+                                          const std::string& datafile,
+                                          const std::string& path);
+
+#endif /* GNC_XML_SNAPSHOT_HPP */
@@ -50,6 +50,7 @@ sixtp* gnc_freqSpec_sixtp_parser_create (void);
 xmlNodePtr gnc_lot_dom_tree_create (GNCLot*);
 sixtp* gnc_lot_sixtp_parser_create (void);
 
+xmlNodePtr gnc_price_dom_tree_create (GNCPrice* price);
 xmlNodePtr gnc_pricedb_dom_tree_create (GNCPriceDB* db);
 sixtp* gnc_pricedb_sixtp_parser_create (void);
 
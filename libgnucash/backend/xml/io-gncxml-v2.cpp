@@ -409,10 +409,19 @@ gnc_counter_end_handler (gpointer data_for_children,
     else if (g_strcmp0 (type, "transaction") == 0)
     {
         sixdata->counter.transactions_total = val;
+        /* Size the entity tables up front so that loading doesn't
+         * rehash them over and over. Every transaction has at least two
+         * splits. */
+        qof_collection_reserve (qof_book_get_collection (sixdata->book,
+                                                         GNC_ID_TRANS), val);
+        qof_collection_reserve (qof_book_get_collection (sixdata->book,
+                                                         GNC_ID_SPLIT), 2 * val);
     }
     else if (g_strcmp0 (type, "account") == 0)
     {
         sixdata->counter.accounts_total = val;
+        qof_collection_reserve (qof_book_get_collection (sixdata->book,
+                                                         GNC_ID_ACCOUNT), val);
     }
     else if (g_strcmp0 (type, "book") == 0)
     {
@@ -433,6 +442,8 @@ gnc_counter_end_handler (gpointer data_for_children,
     else if (g_strcmp0 (type, "price") == 0)
     {
         sixdata->counter.prices_total = val;
+        qof_collection_reserve (qof_book_get_collection (sixdata->book,
+                                                         GNC_ID_PRICE), val);
     }
     else
     {
@@ -650,7 +661,12 @@ scrub (const GncXmlDataType_t& data, struct file_backend* be_data)
     g_return_if_fail (data.version == GNC_FILE_BACKEND_VERS);
 
     if (data.scrub)
+    {
+        auto start = g_get_monotonic_time ();
         (data.scrub)(be_data->book);
+        DEBUG ("Scrubbed %s in %" G_GINT64_FORMAT " us", data.type_name,
+               g_get_monotonic_time () - start);
+    }
 }
 
 static sixtp_gdv2*
@@ -831,15 +847,10 @@ qof_session_load_from_xml_file_v2_full (
     for (auto data : backend_registry)
         scrub(data, &be_data);
 
-    /* fix price quote sources */
+    /* Fix price quote sources, account and transaction commodities and
+     * split amount/value */
     root = gnc_book_get_root_account (book);
-    xaccAccountTreeScrubQuoteSources (root, gnc_commodity_table_get_table (book));
-
-    /* Fix account and transaction commodities */
-    xaccAccountTreeScrubCommodities (root);
-
-    /* Fix split amount/value */
-    xaccAccountTreeScrubSplits (root);
+    xaccAccountTreeScrubAfterLoad (root, gnc_commodity_table_get_table (book));
 
     /* commit all groups, this completes the BeginEdit started when the
      * account_end_handler finished reading the account.
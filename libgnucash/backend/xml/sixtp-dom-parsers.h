@@ -28,6 +28,7 @@
 #include "gnc-commodity.h"
 #include "qof.h"
 #include "gnc-budget.h"
+#include "gnc-pricedb.h"
 
 #include "gnc-xml-helper.h"
 
@@ -54,10 +55,13 @@ gboolean dom_tree_to_boolean (xmlNodePtr node, gboolean* b);
 
 /* higher level structures */
 Account* dom_tree_to_account (xmlNodePtr node, QofBook* book);
+gboolean dom_tree_update_account (xmlNodePtr node, Account* acc,
+                                  QofBook* book);
 QofBook* dom_tree_to_book (xmlNodePtr node, QofBook* book);
 GNCLot*  dom_tree_to_lot (xmlNodePtr node, QofBook* book);
 Transaction* dom_tree_to_transaction (xmlNodePtr node, QofBook* book);
 GncBudget* dom_tree_to_budget (xmlNodePtr node, QofBook* book);
+GNCPrice* dom_tree_to_price (xmlNodePtr node, QofBook* book);
 
 struct dom_tree_handler
 {
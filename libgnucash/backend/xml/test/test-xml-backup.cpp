@@ -0,0 +1,201 @@
+/********************************************************************
+ * test-xml-backup.cpp -- backups copied after save are complete    *
+ * and old ones are pruned                                          *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+\********************************************************************/
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <config.h>
+#include <stdlib.h>
+#include <string.h>
+#include <utime.h>
+
+#include <cashobjects.h>
+#include <Account.h>
+#include <TransLog.h>
+#include <gnc-date.h>
+#include <gnc-engine.h>
+#include <gnc-prefs.h>
+#include <gnc-uri-utils.h>
+#include <gnc-backend-xml.h>
+
+#include <string>
+
+#include <test-stuff.h>
+
+#define GNC_LIB_NAME "gncmod-backend-xml"
+#define GNC_LIB_REL_PATH "xml"
+
+/* 2000-01-01, long enough ago for any retention. */
+#define OLD_MTIME 946684800
+
+static std::string
+file_contents (const std::string& path)
+{
+    gchar* contents;
+    gsize length;
+
+    if (!g_file_get_contents (path.c_str (), &contents, &length, NULL))
+        return {};
+    std::string rv{contents, length};
+    g_free (contents);
+    return rv;
+}
+
+static void
+make_file (const std::string& path, const char* contents, bool old)
+{
+    g_file_set_contents (path.c_str (), contents, -1, NULL);
+    if (old)
+    {
+        struct utimbuf times{OLD_MTIME, OLD_MTIME};
+        g_utime (path.c_str (), &times);
+    }
+}
+
+static std::string
+backup_name (const std::string& datafile)
+{
+    auto timestamp = gnc_date_timestamp ();
+    auto backup = datafile + "." + timestamp + GNC_DATAFILE_EXT;
+    g_free (timestamp);
+    return backup;
+}
+
+static void
+rename_account (QofSession* session, Account* acc, const char* name)
+{
+    xaccAccountBeginEdit (acc);
+    xaccAccountSetName (acc, name);
+    xaccAccountCommitEdit (acc);
+    qof_session_save (session, NULL);
+}
+
+static void
+test_backups (const std::string& dir)
+{
+    auto datafile = dir + "/backup.gnucash";
+    auto old_backup = datafile + ".20000101000000" GNC_DATAFILE_EXT;
+    auto old_log = datafile + ".20000101000000" GNC_LOGFILE_EXT;
+    auto unfinished = datafile + ".20000102000000" GNC_DATAFILE_EXT ".tmp";
+    auto recent = datafile + ".20000103000000" GNC_DATAFILE_EXT;
+    auto book = qof_book_new ();
+    auto session = qof_session_new (book);
+
+    gnc_prefs_set_file_retention_policy (XML_RETAIN_DAYS);
+    gnc_prefs_set_file_retention_days (30);
+    make_file (old_backup, "old", true);
+    make_file (old_log, "old", true);
+    make_file (unfinished, "unfinished", false);
+    make_file (recent, "recent", false);
+
+    qof_session_begin (session, datafile.c_str (), SESSION_NEW_STORE);
+    auto acc = xaccMallocAccount (book);
+    xaccAccountBeginEdit (acc);
+    xaccAccountSetName (acc, "Checking");
+    xaccAccountSetType (acc, ACCT_TYPE_BANK);
+    gnc_account_append_child (gnc_book_get_root_account (book), acc);
+    xaccAccountCommitEdit (acc);
+    qof_session_save (session, NULL);
+    do_test (qof_session_get_error (session) == ERR_BACKEND_NO_ERR,
+             "first save");
+
+    /* A backup already under the name is replaced by the copy.  The name
+     * has the time to the second, so try again if the save crossed one. */
+    std::string saved, backup;
+    auto replaced = false;
+    for (auto tries = 0; !replaced && tries < 3; ++tries)
+    {
+        saved = file_contents (datafile);
+        backup = backup_name (datafile);
+        make_file (backup, "stale", false);
+        rename_account (session, acc, tries % 2 ? "Checking" : "Savings");
+        do_test (qof_session_get_error (session) == ERR_BACKEND_NO_ERR,
+                 "save copying a backup");
+        replaced = backup_name (datafile) == backup;
+        if (!replaced)
+            g_unlink (backup.c_str ());
+    }
+    do_test (replaced, "saved within a second");
+
+    /* The copies are made in the background, but are done by the end. */
+    qof_session_end (session);
+    do_test (!saved.empty () && file_contents (backup) == saved,
+             "backup is the file as it was before the save");
+    do_test (!g_file_test ((backup + ".tmp").c_str (), G_FILE_TEST_EXISTS),
+             "backup copied into place");
+
+    do_test (!g_file_test (old_backup.c_str (), G_FILE_TEST_EXISTS),
+             "old backup pruned");
+    do_test (!g_file_test (old_log.c_str (), G_FILE_TEST_EXISTS),
+             "old log pruned");
+    do_test (!g_file_test (unfinished.c_str (), G_FILE_TEST_EXISTS),
+             "unfinished backup pruned");
+    do_test (file_contents (recent) == "recent", "recent backup kept");
+
+    qof_book_destroy (book);
+}
+
+static void
+remove_dir (const std::string& dir)
+{
+    auto gdir = g_dir_open (dir.c_str (), 0, NULL);
+    const gchar* entry;
+
+    while (gdir && (entry = g_dir_read_name (gdir)) != NULL)
+    {
+        auto name = g_build_filename (dir.c_str (), entry, (gchar*)NULL);
+        g_unlink (name);
+        g_free (name);
+    }
+    if (gdir)
+        g_dir_close (gdir);
+    g_rmdir (dir.c_str ());
+}
+
+int
+main (int argc, char** argv)
+{
+    g_setenv ("GNC_UNINSTALLED", "1", TRUE);
+    /* Copy the backups on the backup thread, as where links can't be made. */
+    g_setenv ("GNC_XML_COPY_BACKUPS", "1", TRUE);
+    g_unsetenv ("GNC_XML_SYNC_BACKUPS");
+    g_unsetenv ("GNC_XML_JOURNAL");
+    g_unsetenv ("GNC_XML_SNAPSHOT");
+
+    qof_init ();
+    cashobjects_register ();
+    do_test (qof_load_backend_library (GNC_LIB_REL_PATH, GNC_LIB_NAME),
+             " loading gnc-backend-xml GModule failed");
+
+    xaccLogDisable ();
+
+    auto tmpdir = g_dir_make_tmp ("test-xml-backup-XXXXXX", NULL);
+    std::string dir{tmpdir};
+    g_free (tmpdir);
+
+    test_backups (dir);
+
+    remove_dir (dir);
+
+    print_test_results ();
+    qof_close ();
+    exit (get_rv ());
+}
@@ -0,0 +1,328 @@
+/********************************************************************
+ * test-xml-journal.cpp -- autosaves appended to a journal reload   *
+ * as the book that was saved                                       *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+\********************************************************************/
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <config.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <cashobjects.h>
+#include <Account.h>
+#include <Transaction.h>
+#include <TransLog.h>
+#include <gnc-budget.h>
+#include <gnc-engine.h>
+#include <gnc-lot.h>
+#include <gnc-pricedb.h>
+#include <qofinstance-p.h>
+
+#include <string>
+
+#include <test-stuff.h>
+
+#define GNC_LIB_NAME "gncmod-backend-xml"
+#define GNC_LIB_REL_PATH "xml"
+
+/* "GNCJOURNAL 1 " and the data file's hash. */
+#define JOURNAL_HEADER_SIZE 78
+
+static std::string
+file_contents (const std::string& path)
+{
+    gchar* contents;
+    gsize length;
+
+    if (!g_file_get_contents (path.c_str (), &contents, &length, NULL))
+        return {};
+    std::string rv{contents, length};
+    g_free (contents);
+    return rv;
+}
+
+static gnc_commodity*
+currency (QofBook* book, const char* mnemonic)
+{
+    return gnc_commodity_table_lookup (gnc_commodity_table_get_table (book),
+                                       GNC_COMMODITY_NS_CURRENCY, mnemonic);
+}
+
+static Account*
+make_account (QofBook* book, Account* parent, const char* name)
+{
+    auto acc = xaccMallocAccount (book);
+
+    xaccAccountBeginEdit (acc);
+    xaccAccountSetName (acc, name);
+    xaccAccountSetType (acc, ACCT_TYPE_BANK);
+    xaccAccountSetCommodity (acc, currency (book, "USD"));
+    gnc_account_append_child (parent, acc);
+    xaccAccountCommitEdit (acc);
+    return acc;
+}
+
+static Transaction*
+make_transaction (QofBook* book, Account* from, Account* to, gint64 amount,
+                  const char* description)
+{
+    auto trans = xaccMallocTransaction (book);
+    auto value = gnc_numeric_create (amount, 100);
+
+    xaccTransBeginEdit (trans);
+    xaccTransSetCurrency (trans, currency (book, "USD"));
+    xaccTransSetDatePostedSecsNormalized (trans, gnc_time (NULL));
+    xaccTransSetDescription (trans, description);
+    for (auto acc : {from, to})
+    {
+        auto split = xaccMallocSplit (book);
+        xaccSplitSetParent (split, trans);
+        xaccSplitSetAccount (split, acc);
+        xaccSplitSetValue (split, acc == from ? gnc_numeric_neg (value) : value);
+        xaccSplitSetAmount (split, acc == from ? gnc_numeric_neg (value) : value);
+    }
+    xaccTransCommitEdit (trans);
+    return trans;
+}
+
+static QofBook*
+load_book (const std::string& datafile, QofBackendError& error)
+{
+    auto book = qof_book_new ();
+    auto session = qof_session_new (book);
+
+    qof_session_begin (session, datafile.c_str (), SESSION_READ_ONLY);
+    qof_session_load (session, NULL);
+    error = qof_session_get_error (session);
+    qof_session_end (session);
+    return book;
+}
+
+static void
+compare_books (QofBook* book_a, QofBook* book_b, const char* what)
+{
+    do_test_args (qof_instance_compare_kvp (QOF_INSTANCE (book_a),
+                                            QOF_INSTANCE (book_b)) == 0,
+                  "book", __FILE__, __LINE__, "%s", what);
+    do_test_args (xaccAccountEqual (gnc_book_get_root_account (book_a),
+                                    gnc_book_get_root_account (book_b), TRUE),
+                  "accounts and transactions", __FILE__, __LINE__, "%s", what);
+    do_test_args (qof_collection_count (qof_book_get_collection (book_a,
+                                                                 GNC_ID_LOT)) ==
+                  qof_collection_count (qof_book_get_collection (book_b,
+                                                                 GNC_ID_LOT)),
+                  "lots", __FILE__, __LINE__, "%s", what);
+    do_test_args (gnc_pricedb_equal (gnc_pricedb_get_db (book_a),
+                                     gnc_pricedb_get_db (book_b)),
+                  "prices", __FILE__, __LINE__, "%s", what);
+}
+
+static void
+reload_and_compare (QofBook* book, const std::string& datafile,
+                    const char* what)
+{
+    QofBackendError error;
+    auto reloaded = load_book (datafile, error);
+
+    do_test_args (error == ERR_BACKEND_NO_ERR, "reload", __FILE__, __LINE__,
+                  "%s: qof error=%d", what, error);
+    compare_books (book, reloaded, what);
+    qof_book_destroy (reloaded);
+}
+
+/* An autosave appends to the journal and leaves the data file alone. */
+static void
+autosave_journaled (QofSession* session, const std::string& datafile,
+                    const char* what)
+{
+    auto book = qof_session_get_book (session);
+    auto journal = datafile + ".journal";
+    auto data = file_contents (datafile);
+    auto before = file_contents (journal).size ();
+
+    qof_session_autosave (session, NULL);
+    do_test_args (qof_session_get_error (session) == ERR_BACKEND_NO_ERR,
+                  "autosave", __FILE__, __LINE__, "%s", what);
+    do_test_args (file_contents (datafile) == data, "data file untouched",
+                  __FILE__, __LINE__, "%s", what);
+    do_test_args (file_contents (journal).size () > before, "journal grew",
+                  __FILE__, __LINE__, "%s", what);
+    do_test_args (!qof_book_session_not_saved (book), "book saved",
+                  __FILE__, __LINE__, "%s", what);
+}
+
+static void
+test_journal (const std::string& dir)
+{
+    auto datafile = dir + "/journal.gnucash";
+    auto journal = datafile + ".journal";
+    auto book = qof_book_new ();
+    auto session = qof_session_new (book);
+
+    qof_session_begin (session, datafile.c_str (), SESSION_NEW_STORE);
+    auto root = gnc_book_get_root_account (book);
+    auto checking = make_account (book, root, "Checking");
+    auto savings = make_account (book, root, "Savings");
+    auto doomed = make_transaction (book, checking, savings, 1000, "Doomed");
+    auto edited = make_transaction (book, checking, savings, 2000, "Edited");
+    qof_session_save (session, NULL);
+    do_test (qof_session_get_error (session) == ERR_BACKEND_NO_ERR &&
+             file_contents (journal).size () == JOURNAL_HEADER_SIZE,
+             "full save starts the journal");
+
+    /* New, changed and deleted accounts, transactions, lots, prices and
+     * book options. */
+    auto brokerage = make_account (book, checking, "Brokerage");
+    xaccAccountBeginEdit (savings);
+    xaccAccountSetName (savings, "Rainy day");
+    xaccAccountCommitEdit (savings);
+    xaccTransBeginEdit (doomed);
+    xaccTransDestroy (doomed);
+    xaccTransCommitEdit (doomed);
+    xaccTransBeginEdit (edited);
+    xaccTransSetDescription (edited, "Edited twice");
+    xaccTransCommitEdit (edited);
+    auto bought = make_transaction (book, checking, brokerage, 500, "Bought");
+    auto lot = gnc_lot_new (book);
+    xaccAccountInsertLot (brokerage, lot);
+    gnc_lot_set_title (lot, "First lot");
+    gnc_lot_add_split (lot, xaccTransFindSplitByAccount (bought, brokerage));
+    auto price = gnc_price_create (book);
+    gnc_price_begin_edit (price);
+    gnc_price_set_commodity (price, currency (book, "EUR"));
+    gnc_price_set_currency (price, currency (book, "USD"));
+    gnc_price_set_time64 (price, gnc_time (NULL));
+    gnc_price_set_source_string (price, "user:price");
+    gnc_price_set_value (price, gnc_numeric_create (110, 100));
+    gnc_price_commit_edit (price);
+    gnc_pricedb_add_price (gnc_pricedb_get_db (book), price);
+    gnc_price_unref (price);
+    qof_book_set_string_option (book, "Journal test", "first");
+    autosave_journaled (session, datafile, "first autosave");
+    reload_and_compare (book, datafile, "first autosave");
+
+    auto first_size = file_contents (journal).size ();
+    make_account (book, savings, "Holiday");
+    xaccAccountBeginEdit (brokerage);
+    xaccAccountDestroy (brokerage);
+    gnc_pricedb_remove_price (gnc_pricedb_get_db (book), price);
+    qof_book_set_string_option (book, "Journal test", "second");
+    autosave_journaled (session, datafile, "second autosave");
+    reload_and_compare (book, datafile, "second autosave");
+
+    /* A journal cut short by a crash gives the book as it was after the
+     * last complete entry. */
+    auto torn = dir + "/torn.gnucash";
+    auto contents = file_contents (journal);
+    g_file_set_contents (torn.c_str (), file_contents (datafile).c_str (), -1,
+                         NULL);
+    g_file_set_contents ((torn + ".journal").c_str (), contents.data (),
+                         contents.size () - 1, NULL);
+    QofBackendError error;
+    auto torn_book = load_book (torn, error);
+    auto torn_root = gnc_book_get_root_account (torn_book);
+    do_test (error == ERR_BACKEND_NO_ERR &&
+             gnc_account_lookup_by_name (torn_root, "Brokerage") &&
+             !gnc_account_lookup_by_name (torn_root, "Holiday") &&
+             contents.size () > first_size,
+             "torn journal replays the complete entries");
+    qof_book_destroy (torn_book);
+
+    /* An explicit save writes out what the autosaves journaled even though
+     * the book is clean. */
+    auto data = file_contents (datafile);
+    do_test (qof_session_autosave_pending (session),
+             "journaled changes are pending");
+    qof_session_save (session, NULL);
+    do_test (qof_session_get_error (session) == ERR_BACKEND_NO_ERR &&
+             file_contents (datafile) != data &&
+             file_contents (journal).size () == JOURNAL_HEADER_SIZE &&
+             !qof_session_autosave_pending (session),
+             "explicit save writes the journaled changes");
+    reload_and_compare (book, datafile, "explicit save");
+
+    /* Budgets aren't journaled, so the whole book is written. */
+    make_account (book, root, "Petty cash");
+    autosave_journaled (session, datafile, "before budget");
+    data = file_contents (datafile);
+    gnc_budget_new (book);
+    qof_session_autosave (session, NULL);
+    do_test (file_contents (datafile) != data &&
+             file_contents (journal).size () == JOURNAL_HEADER_SIZE,
+             "unjournaled change writes the book");
+
+    /* Closing the book folds the journal into the data file. */
+    make_account (book, root, "Cash");
+    autosave_journaled (session, datafile, "before closing");
+    data = file_contents (datafile);
+    qof_session_end (session);
+    do_test (file_contents (datafile) != data &&
+             file_contents (journal).size () == JOURNAL_HEADER_SIZE,
+             "closing folds the journal");
+    reload_and_compare (book, datafile, "closed");
+    qof_book_destroy (book);
+}
+
+static void
+remove_dir (const std::string& dir)
+{
+    auto gdir = g_dir_open (dir.c_str (), 0, NULL);
+    const gchar* entry;
+
+    while (gdir && (entry = g_dir_read_name (gdir)) != NULL)
+    {
+        auto name = g_build_filename (dir.c_str (), entry, (gchar*)NULL);
+        g_unlink (name);
+        g_free (name);
+    }
+    if (gdir)
+        g_dir_close (gdir);
+    g_rmdir (dir.c_str ());
+}
+
+int
+main (int argc, char** argv)
+{
+    g_setenv ("GNC_UNINSTALLED", "1", TRUE);
+    g_setenv ("GNC_XML_JOURNAL", "1", TRUE);
+    /* Start the journals before save returns so they can be read. */
+    g_setenv ("GNC_XML_SYNC_BACKUPS", "1", TRUE);
+    g_unsetenv ("GNC_XML_SNAPSHOT");
+
+    qof_init ();
+    cashobjects_register ();
+    do_test (qof_load_backend_library (GNC_LIB_REL_PATH, GNC_LIB_NAME),
+             " loading gnc-backend-xml GModule failed");
+
+    xaccLogDisable ();
+
+    auto tmpdir = g_dir_make_tmp ("test-xml-journal-XXXXXX", NULL);
+    std::string dir{tmpdir};
+    g_free (tmpdir);
+
+    test_journal (dir);
+
+    remove_dir (dir);
+
+    print_test_results ();
+    qof_close ();
+    exit (get_rv ());
+}
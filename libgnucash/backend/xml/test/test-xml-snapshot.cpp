@@ -0,0 +1,386 @@
+/********************************************************************
+ * test-xml-snapshot.cpp -- books loaded from snapshots are the     *
+ * books the XML files hold                                         *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+\********************************************************************/
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <config.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <cashobjects.h>
+#include <Account.h>
+#include <TransLog.h>
+#include <gnc-engine.h>
+#include <gnc-lot.h>
+#include <gnc-pricedb.h>
+#include <qofinstance-p.h>
+
+#include <string>
+
+#include "../gnc-xml-snapshot.hpp"
+#include <test-stuff.h>
+
+#define GNC_LIB_NAME "gncmod-backend-xml"
+#define GNC_LIB_REL_PATH "xml"
+
+/* Where the payload's hash and size are in a snapshot's header, and the
+ * header's length. */
+#define PAYLOAD_HASH_OFFSET 48
+#define PAYLOAD_SIZE_OFFSET 80
+#define HEADER_SIZE 88
+
+static QofBook*
+load_xml_book (const char* filename)
+{
+    auto book = qof_book_new ();
+    auto session = qof_session_new (book);
+
+    qof_session_begin (session, filename, SESSION_READ_ONLY);
+    qof_session_load (session, NULL);
+    do_test_args (qof_session_get_error (session) == ERR_BACKEND_NO_ERR,
+                  "load xml", __FILE__, __LINE__, "qof error=%d for file [%s]",
+                  qof_session_get_error (session), filename);
+    qof_session_end (session);
+    return book;
+}
+
+static bool
+commodities_equal (QofBook* book_a, QofBook* book_b)
+{
+    auto table_a = gnc_commodity_table_get_table (book_a);
+    auto table_b = gnc_commodity_table_get_table (book_b);
+    auto namespaces = gnc_commodity_table_get_namespaces (table_a);
+    bool equal = gnc_commodity_table_get_size (table_a) ==
+                 gnc_commodity_table_get_size (table_b);
+
+    for (auto ns = namespaces; ns && equal; ns = ns->next)
+    {
+        auto name_space = static_cast<const char*> (ns->data);
+        auto comms = gnc_commodity_table_get_commodities (table_a, name_space);
+        for (auto node = comms; node && equal; node = node->next)
+        {
+            auto a = static_cast<gnc_commodity*> (node->data);
+            auto b = gnc_commodity_table_lookup (table_b, name_space,
+                                                 gnc_commodity_get_mnemonic (a));
+            equal = b && gnc_commodity_equal (a, b) &&
+                    g_strcmp0 (gnc_commodity_get_cusip (a),
+                               gnc_commodity_get_cusip (b)) == 0 &&
+                    gnc_commodity_get_quote_flag (a) ==
+                    gnc_commodity_get_quote_flag (b) &&
+                    gnc_commodity_get_quote_source (a) ==
+                    gnc_commodity_get_quote_source (b) &&
+                    g_strcmp0 (gnc_commodity_get_quote_tz (a),
+                               gnc_commodity_get_quote_tz (b)) == 0 &&
+                    qof_instance_compare_kvp (QOF_INSTANCE (a),
+                                              QOF_INSTANCE (b)) == 0;
+        }
+        g_list_free (comms);
+    }
+    g_list_free (namespaces);
+    return equal;
+}
+
+struct LotCompare
+{
+    QofBook* book;
+    bool equal;
+};
+
+static void
+compare_lot (QofInstance* inst, gpointer data)
+{
+    auto compare = static_cast<LotCompare*> (data);
+    auto a = GNC_LOT (inst);
+    auto b = gnc_lot_lookup (qof_instance_get_guid (inst), compare->book);
+
+    if (!b || gnc_lot_count_splits (a) != gnc_lot_count_splits (b) ||
+        gnc_lot_get_account (a) == NULL ||
+        qof_instance_guid_compare (gnc_lot_get_account (a),
+                                   gnc_lot_get_account (b)) != 0 ||
+        qof_instance_compare_kvp (inst, QOF_INSTANCE (b)) != 0)
+        compare->equal = false;
+}
+
+static void
+compare_books (QofBook* book_a, QofBook* book_b, const char* filename)
+{
+    LotCompare lots{book_b, true};
+
+    do_test_args (qof_instance_guid_compare (book_a, book_b) == 0 &&
+                  qof_instance_compare_kvp (QOF_INSTANCE (book_a),
+                                            QOF_INSTANCE (book_b)) == 0,
+                  "book", __FILE__, __LINE__, "%s", filename);
+    do_test_args (commodities_equal (book_a, book_b), "commodities",
+                  __FILE__, __LINE__, "%s", filename);
+    do_test_args (xaccAccountEqual (gnc_book_get_root_account (book_a),
+                                    gnc_book_get_root_account (book_b), TRUE),
+                  "accounts and transactions", __FILE__, __LINE__, "%s",
+                  filename);
+    qof_collection_foreach (qof_book_get_collection (book_a, GNC_ID_LOT),
+                            compare_lot, &lots);
+    do_test_args (lots.equal &&
+                  qof_collection_count (qof_book_get_collection (book_a,
+                                                                 GNC_ID_LOT)) ==
+                  qof_collection_count (qof_book_get_collection (book_b,
+                                                                 GNC_ID_LOT)),
+                  "lots", __FILE__, __LINE__, "%s", filename);
+    do_test_args (gnc_pricedb_equal (gnc_pricedb_get_db (book_a),
+                                     gnc_pricedb_get_db (book_b)),
+                  "prices", __FILE__, __LINE__, "%s", filename);
+    do_test_args (qof_instance_get_editlevel (gnc_book_get_root_account (book_b))
+                  == 0, "root account committed", __FILE__, __LINE__, "%s",
+                  filename);
+}
+
+static bool
+write_snapshot (QofBook* book, const char* datafile, const std::string& path)
+{
+    std::string image;
+
+    if (!gnc_xml_snapshot_serialize (book, image))
+        return false;
+    auto fd = g_open (datafile, O_RDONLY, 0);
+    auto written = gnc_xml_snapshot_write (fd, image, path);
+    close (fd);
+    do_test_args (written, "write snapshot", __FILE__, __LINE__, "%s",
+                  datafile);
+    return written;
+}
+
+/* Snapshots of other versions of the file and damaged snapshots are
+ * turned down without touching the book. */
+static void
+test_unusable (const char* filename, const std::string& path,
+               const std::string& dir)
+{
+    auto other = dir + "/other.gnucash";
+    gchar* contents;
+    gsize length;
+
+    g_file_get_contents (filename, &contents, &length, NULL);
+    g_file_set_contents (other.c_str (), contents, length - 1, NULL);
+    auto book = qof_book_new ();
+    do_test_args (gnc_xml_snapshot_load (book, other, path) ==
+                  GNC_XML_SNAPSHOT_UNUSABLE &&
+                  gnc_account_n_children (gnc_book_get_root_account (book)) == 0,
+                  "changed data file", __FILE__, __LINE__, "%s", filename);
+    qof_book_destroy (book);
+    g_free (contents);
+    g_unlink (other.c_str ());
+
+    g_file_get_contents (path.c_str (), &contents, &length, NULL);
+    contents[length - 1] ^= 0x5a;
+    auto damaged = dir + "/damaged.snapshot";
+    g_file_set_contents (damaged.c_str (), contents, length, NULL);
+    book = qof_book_new ();
+    do_test_args (gnc_xml_snapshot_load (book, filename, damaged) ==
+                  GNC_XML_SNAPSHOT_UNUSABLE &&
+                  gnc_account_n_children (gnc_book_get_root_account (book)) == 0,
+                  "damaged snapshot", __FILE__, __LINE__, "%s", filename);
+    qof_book_destroy (book);
+    g_free (contents);
+    g_unlink (damaged.c_str ());
+}
+
+/* Returns whether the book could have a snapshot. */
+static bool
+test_file (const char* filename, const std::string& dir)
+{
+    auto path = dir + "/test.snapshot";
+    auto book_xml = load_xml_book (filename);
+
+    if (!write_snapshot (book_xml, filename, path))
+    {
+        qof_book_destroy (book_xml);
+        return false;
+    }
+
+    auto book_snap = qof_book_new ();
+    do_test_args (gnc_xml_snapshot_load (book_snap, filename, path) ==
+                  GNC_XML_SNAPSHOT_LOADED, "load snapshot", __FILE__, __LINE__,
+                  "%s", filename);
+    compare_books (book_xml, book_snap, filename);
+    qof_book_destroy (book_snap);
+
+    test_unusable (filename, path, dir);
+
+    g_unlink (path.c_str ());
+    qof_book_destroy (book_xml);
+    return true;
+}
+
+/* Cuts the payload of a snapshot in half and hashes what's left, so the
+ * snapshot passes its checks but can't be read. */
+static void
+truncate_snapshot (const std::string& path)
+{
+    gchar* contents;
+    gsize length;
+    gsize digest_len = 32;
+
+    g_file_get_contents (path.c_str (), &contents, &length, NULL);
+    uint64_t payload_size = (length - HEADER_SIZE) / 2;
+    auto checksum = g_checksum_new (G_CHECKSUM_SHA256);
+    g_checksum_update (checksum, (const guchar*)contents + HEADER_SIZE,
+                       payload_size);
+    g_checksum_get_digest (checksum, (guint8*)contents + PAYLOAD_HASH_OFFSET,
+                           &digest_len);
+    g_checksum_free (checksum);
+    memcpy (contents + PAYLOAD_SIZE_OFFSET, &payload_size, sizeof payload_size);
+    g_file_set_contents (path.c_str (), contents, HEADER_SIZE + payload_size,
+                         NULL);
+    g_free (contents);
+}
+
+static QofBook*
+load_session_book (const std::string& datafile, const char* what)
+{
+    auto book = qof_book_new ();
+    auto session = qof_session_new (book);
+
+    qof_session_begin (session, datafile.c_str (), SESSION_READ_ONLY);
+    qof_session_load (session, NULL);
+    do_test_args (qof_session_get_error (session) == ERR_BACKEND_NO_ERR,
+                  "backend load", __FILE__, __LINE__, "%s", what);
+    qof_session_end (session);
+    return book;
+}
+
+/* Saving through the backend leaves a snapshot that the next session
+ * loads the same book from.  A snapshot that can't be read is thrown
+ * away and the book loaded from the XML file. */
+static void
+test_backend (const char* filename, const std::string& dir)
+{
+    auto datafile = dir + "/backend.gnucash";
+    gchar* contents;
+    gsize length;
+
+    g_file_get_contents (filename, &contents, &length, NULL);
+    g_file_set_contents (datafile.c_str (), contents, length, NULL);
+    g_free (contents);
+
+    g_setenv ("GNC_XML_SNAPSHOT", "1", TRUE);
+    auto book = qof_book_new ();
+    auto session = qof_session_new (book);
+    qof_session_begin (session, datafile.c_str (), SESSION_NORMAL_OPEN);
+    qof_session_load (session, NULL);
+    qof_book_mark_session_dirty (book);
+    qof_session_save (session, NULL);
+    qof_session_end (session);
+    qof_book_destroy (book);
+
+    auto snapshot = datafile + ".snapshot";
+    do_test_args (g_file_test (snapshot.c_str (), G_FILE_TEST_EXISTS),
+                  "backend wrote snapshot", __FILE__, __LINE__, "%s", filename);
+
+    book = load_session_book (datafile, filename);
+    truncate_snapshot (snapshot);
+    auto book_bad = load_session_book (datafile, filename);
+    do_test_args (!g_file_test (snapshot.c_str (), G_FILE_TEST_EXISTS),
+                  "unreadable snapshot removed", __FILE__, __LINE__, "%s",
+                  filename);
+    g_unsetenv ("GNC_XML_SNAPSHOT");
+
+    auto book_xml = load_xml_book (datafile.c_str ());
+    compare_books (book_xml, book, filename);
+    compare_books (book_xml, book_bad, filename);
+    qof_book_destroy (book_xml);
+    qof_book_destroy (book_bad);
+    qof_book_destroy (book);
+}
+
+static void
+remove_dir (const std::string& dir)
+{
+    auto gdir = g_dir_open (dir.c_str (), 0, NULL);
+    const gchar* entry;
+
+    while (gdir && (entry = g_dir_read_name (gdir)) != NULL)
+    {
+        auto name = g_build_filename (dir.c_str (), entry, (gchar*)NULL);
+        g_unlink (name);
+        g_free (name);
+    }
+    if (gdir)
+        g_dir_close (gdir);
+    g_rmdir (dir.c_str ());
+}
+
+int
+main (int argc, char** argv)
+{
+    g_setenv ("GNC_UNINSTALLED", "1", TRUE);
+    g_unsetenv ("GNC_XML_SNAPSHOT");
+    const char* location = g_getenv ("GNC_TEST_FILES");
+    int files_tested = 0;
+    GDir* xml2_dir;
+
+    qof_init ();
+    cashobjects_register ();
+    do_test (qof_load_backend_library (GNC_LIB_REL_PATH, GNC_LIB_NAME),
+             " loading gnc-backend-xml GModule failed");
+
+    if (!location)
+        location = "test-files/xml2";
+
+    xaccLogDisable ();
+
+    auto tmpdir = g_dir_make_tmp ("test-xml-snapshot-XXXXXX", NULL);
+    std::string dir{tmpdir};
+    g_free (tmpdir);
+
+    if ((xml2_dir = g_dir_open (location, 0, NULL)) == NULL)
+    {
+        failure ("unable to open xml2 directory");
+    }
+    else
+    {
+        const gchar* entry;
+
+        while ((entry = g_dir_read_name (xml2_dir)) != NULL)
+        {
+            if (!g_str_has_suffix (entry, ".gml2"))
+                continue;
+            gchar* filename = g_build_filename (location, entry, (gchar*)NULL);
+            if (test_file (filename, dir))
+            {
+                if (files_tested == 0)
+                    test_backend (filename, dir);
+                files_tested++;
+            }
+            g_free (filename);
+        }
+        g_dir_close (xml2_dir);
+    }
+
+    remove_dir (dir);
+
+    if (files_tested == 0)
+        failure ("no file could have a snapshot");
+
+    print_test_results ();
+    qof_close ();
+    exit (get_rv ());
+}
@@ -34,6 +34,7 @@
 #include <string.h>
 
 #include "AccountP.h"
+#include "Account.hpp"
 #include "Split.h"
 #include "Transaction.h"
 #include "TransactionP.h"
@@ -43,11 +44,14 @@
 #include "gnc-pricedb.h"
 #include "qofinstance-p.h"
 #include "gnc-features.h"
+#include "gnc-numeric-sum.hpp"
 #include "guid.hpp"
 
+#include <algorithm>
 #include <numeric>
 #include <map>
 #include <unordered_set>
+#include <vector>
 
 static QofLogModule log_module = GNC_MOD_ACCOUNT;
 
@@ -78,6 +82,33 @@ static const std::string KEY_BALANCE_INCLUDE_SUB_ACCTS("inlude-sub-accts");
 
 static gnc_numeric GetBalanceAsOfDate (Account *acc, time64 date, gboolean ignclosing);
 
+/* The balances of an account and its descendants in one commodity. */
+struct SubtreeBalance
+{
+    const gnc_commodity *commodity;
+    gnc_numeric balance;
+    gnc_numeric cleared_balance;
+    gnc_numeric reconciled_balance;
+};
+
+using CommoditySums = std::vector<std::pair<const gnc_commodity*, gnc_numeric>>;
+
+/* The subtree balances of an account for each commodity, its own
+ * commodity first. They are summed when first asked for and dropped when
+ * a balance in the subtree changes. */
+struct SubtreeBalances
+{
+    std::vector<SubtreeBalance> by_commodity;
+    /* Sums of the balances as of a date, by getter and date. */
+    std::map<std::pair<xaccGetBalanceAsOfDateFn, time64>, CommoditySums> as_of_date;
+};
+
+/* Dated sums kept for each account before they are all dropped, enough
+ * for the account tree's columns and a report's periods. */
+static const size_t max_dated_subtree_balances = 16;
+
+static void invalidate_subtree_balances (Account *acc);
+
 using FinalProbabilityVec=std::vector<std::pair<std::string, int32_t>>;
 using ProbabilityVec=std::vector<std::pair<std::string, struct AccountProbability>>;
 using FlatKvpEntry=std::pair<std::string, KvpValue*>;
@@ -1406,6 +1437,9 @@ xaccFreeAccount (Account *acc)
     priv->parent = nullptr;
     priv->children = nullptr;
 
+    delete priv->subtree_balances;
+    priv->subtree_balances = nullptr;
+
     priv->balance  = gnc_numeric_zero();
     priv->noclosing_balance = gnc_numeric_zero();
     priv->cleared_balance = gnc_numeric_zero();
@@ -1878,6 +1912,7 @@ gnc_account_set_sort_dirty (Account *acc)
 
     priv = GET_PRIVATE(acc);
     priv->sort_dirty = TRUE;
+    invalidate_subtree_balances (acc);
 }
 
 void
@@ -1892,6 +1927,7 @@ gnc_account_set_balance_dirty (Account *acc)
 
     priv = GET_PRIVATE(acc);
     priv->balance_dirty = TRUE;
+    invalidate_subtree_balances (acc);
 }
 
 void gnc_account_set_defer_bal_computation (Account *acc, gboolean defer)
@@ -1951,6 +1987,7 @@ gnc_account_insert_split (Account *acc, Split *s)
     qof_event_gen(&acc->inst, GNC_EVENT_ITEM_ADDED, s);
 
     priv->balance_dirty = TRUE;
+    invalidate_subtree_balances (acc);
 //  DRH: Should the below be added? It is present in the delete path.
 //  xaccAccountRecomputeBalance(acc);
     return TRUE;
@@ -2258,6 +2295,98 @@ xaccAccountMoveAllSplits (Account *accfrom, Account *accto)
  * Return: void                                                     *
 \********************************************************************/
 
+/* The running balance of one of the series computed by
+ * xaccAccountRecomputeBalance. Adding even a zero amount gives the sum the
+ * amount's denominator, so the starting balance is returned unchanged
+ * until any amount has been added.
+ */
+static inline gnc_numeric
+running_balance (gnc_numeric start, int64_t num, gint64 denom, bool added)
+{
+    return added ? gnc_numeric_create (num, denom) : start;
+}
+
+/* Recompute the running balances when all of the account's split amounts
+ * share a denominator, which is the usual case, by summing the numerators
+ * with gnc_numeric_prefix_sums. Returns false, having changed nothing, if
+ * they don't or a balance would overflow.
+ */
+static bool
+recompute_balance_same_denom (AccountPrivate *priv)
+{
+    enum { BALANCE, NOCLOSING, CLEARED, RECONCILED, NUM_SERIES };
+
+    if (!priv->splits)
+        return false;
+    auto denom = xaccSplitGetAmount (GNC_SPLIT (priv->splits->data)).denom;
+    if (denom <= 0)
+        return false;
+
+    gnc_numeric starts[NUM_SERIES] =
+    {
+        priv->starting_balance, priv->starting_noclosing_balance,
+        priv->starting_cleared_balance, priv->starting_reconciled_balance
+    };
+    for (const auto& start : starts)
+        if (start.denom <= 0 || (start.denom != denom && start.num != 0))
+            return false;
+
+    /* Series other than the balance leave some splits out; their
+     * numerators are zero there. first[] is the index of the first
+     * amount each series includes. */
+    auto count = g_list_length (priv->splits);
+    std::vector<int64_t> nums (count * NUM_SERIES);
+    size_t first[NUM_SERIES] = { count, count, count, count };
+    auto include = [&](int series, size_t idx, int64_t num) {
+        nums[series * count + idx] = num;
+        first[series] = std::min (first[series], idx);
+    };
+
+    size_t idx = 0;
+    for (auto lp = priv->splits; lp; lp = lp->next, ++idx)
+    {
+        auto split = GNC_SPLIT (lp->data);
+        auto amt = xaccSplitGetAmount (split);
+        if (amt.denom != denom)
+            return false;
+        include (BALANCE, idx, amt.num);
+        if (!xaccTransGetIsClosingTxn (split->parent))
+            include (NOCLOSING, idx, amt.num);
+        if (NREC != split->reconciled)
+            include (CLEARED, idx, amt.num);
+        if (YREC == split->reconciled || FREC == split->reconciled)
+            include (RECONCILED, idx, amt.num);
+    }
+
+    for (auto series = 0; series < NUM_SERIES; ++series)
+    {
+        auto sums = nums.data () + series * count;
+        if (!gnc_numeric_prefix_sums (sums, count, starts[series].num, sums))
+            return false;
+    }
+
+    auto value = [&](int series, size_t idx) {
+        return running_balance (starts[series], nums[series * count + idx],
+                                denom, idx >= first[series]);
+    };
+    idx = 0;
+    for (auto lp = priv->splits; lp; lp = lp->next, ++idx)
+    {
+        auto split = GNC_SPLIT (lp->data);
+        split->balance = value (BALANCE, idx);
+        split->noclosing_balance = value (NOCLOSING, idx);
+        split->cleared_balance = value (CLEARED, idx);
+        split->reconciled_balance = value (RECONCILED, idx);
+    }
+
+    priv->balance = value (BALANCE, count - 1);
+    priv->noclosing_balance = value (NOCLOSING, count - 1);
+    priv->cleared_balance = value (CLEARED, count - 1);
+    priv->reconciled_balance = value (RECONCILED, count - 1);
+    priv->balance_dirty = FALSE;
+    return true;
+}
+
 void
 xaccAccountRecomputeBalance (Account * acc)
 {
@@ -2276,6 +2405,12 @@ xaccAccountRecomputeBalance (Account * acc)
     if (qof_instance_get_destroying(acc)) return;
     if (qof_book_shutting_down(qof_instance_get_book(acc))) return;
 
+    if (recompute_balance_same_denom (priv))
+    {
+        invalidate_subtree_balances (acc);
+        return;
+    }
+
     balance            = priv->starting_balance;
     noclosing_balance  = priv->starting_noclosing_balance;
     cleared_balance    = priv->starting_cleared_balance;
@@ -2317,6 +2452,25 @@ xaccAccountRecomputeBalance (Account * acc)
     priv->cleared_balance = cleared_balance;
     priv->reconciled_balance = reconciled_balance;
     priv->balance_dirty = FALSE;
+    invalidate_subtree_balances (acc);
+}
+
+/* Drop the subtree balances of an account and its ancestors. Summing an
+ * account's balances sums its children's first, so an account without
+ * them has no ancestor with them either. */
+static void
+invalidate_subtree_balances (Account *acc)
+{
+    while (acc)
+    {
+        AccountPrivate *priv = GET_PRIVATE(acc);
+
+        if (!priv->subtree_balances)
+            return;
+        delete priv->subtree_balances;
+        priv->subtree_balances = nullptr;
+        acc = priv->parent;
+    }
 }
 
 /********************************************************************\
@@ -2594,6 +2748,7 @@ xaccAccountSetCommodity (Account * acc, gnc_commodity * com)
     gnc_commodity_increment_usage_count(com);
     priv->commodity_scu = gnc_commodity_get_fraction(com);
     priv->non_standard_scu = FALSE;
+    invalidate_subtree_balances (acc);
 
     /* iterate over splits */
     for (lp = priv->splits; lp; lp = lp->next)
@@ -2790,6 +2945,7 @@ gnc_account_append_child (Account *new_parent, Account *child)
     }
     cpriv->parent = new_parent;
     ppriv->children = g_list_append(ppriv->children, child);
+    invalidate_subtree_balances (new_parent);
     qof_instance_set_dirty(&new_parent->inst);
     qof_instance_set_dirty(&child->inst);
 
@@ -2830,6 +2986,7 @@ gnc_account_remove_child (Account *parent, Account *child)
     ed.idx = g_list_index(ppriv->children, child);
 
     ppriv->children = g_list_remove(ppriv->children, child);
+    invalidate_subtree_balances (parent);
 
     /* Now send the event. */
     qof_event_gen(&child->inst, QOF_EVENT_REMOVE, &ed);
@@ -3585,6 +3742,114 @@ xaccAccountGetReconciledBalanceAsOfDate (Account *acc, time64 date)
     return balance;
 }
 
+/* Fill balances with the account's balance at each of dates by summing
+ * the numerators of each date's splits with gnc_numeric_sum. Returns false
+ * if the amounts and starting balance don't share a denominator or a sum
+ * would overflow, leaving the caller to add them as gnc_numerics.
+ */
+static bool
+balances_at_dates_same_denom (AccountPrivate *priv,
+                              const std::vector<time64>& dates,
+                              bool include_closing, gnc_numeric start,
+                              BalanceVec& balances)
+{
+    if (!priv->splits)
+        return false;
+    auto denom = xaccSplitGetAmount (GNC_SPLIT (priv->splits->data)).denom;
+    if (denom <= 0 || start.denom <= 0 ||
+        (start.denom != denom && start.num != 0))
+        return false;
+
+    std::vector<int64_t> nums;
+    std::vector<time64> times;
+    for (auto node = priv->splits; node; node = node->next)
+    {
+        auto split = GNC_SPLIT (node->data);
+        auto trans = xaccSplitGetParent (split);
+        if (!include_closing && xaccTransGetIsClosingTxn (trans))
+            continue;
+        auto amt = xaccSplitGetAmount (split);
+        if (amt.denom != denom)
+            return false;
+        nums.push_back (amt.num);
+        times.push_back (xaccTransGetDate (trans));
+    }
+
+    /* As in running_balance, the starting balance is returned unchanged
+     * until any amount has been added. */
+    auto sum = start.num;
+    auto added = false;
+    size_t idx = 0;
+    for (auto date : dates)
+    {
+        auto end = idx;
+        while (end < times.size () && times[end] <= date)
+            ++end;
+        added = added || end > idx;
+        if (!gnc_numeric_sum (nums.data () + idx, end - idx, sum, sum))
+            return false;
+        idx = end;
+        balances.push_back (added ? gnc_numeric_create (sum, denom) : start);
+    }
+    return true;
+}
+
+std::vector<BalanceVec>
+gnc_accounts_get_balances_at_dates (const AccountVec& accounts,
+                                    const std::vector<time64>& dates,
+                                    bool include_closing,
+                                    const gnc_commodity *report_commodity)
+{
+    std::vector<BalanceVec> rv;
+    rv.reserve (accounts.size ());
+
+    for (auto acc : accounts)
+    {
+        BalanceVec balances;
+        balances.reserve (dates.size ());
+        if (!GNC_IS_ACCOUNT (acc))
+        {
+            balances.assign (dates.size (), gnc_numeric_zero ());
+            rv.push_back (std::move (balances));
+            continue;
+        }
+
+        auto priv = GET_PRIVATE (acc);
+        xaccAccountSortSplits (acc, TRUE); /* just in case, normally a noop */
+
+        auto balance = include_closing ? priv->starting_balance :
+            priv->starting_noclosing_balance;
+        if (!balances_at_dates_same_denom (priv, dates, include_closing,
+                                           balance, balances))
+        {
+            balances.clear ();
+            auto node = priv->splits;
+            for (auto date : dates)
+            {
+                for (; node; node = node->next)
+                {
+                    auto split = GNC_SPLIT (node->data);
+                    auto trans = xaccSplitGetParent (split);
+                    if (xaccTransGetDate (trans) > date)
+                        break;
+                    if (!include_closing && xaccTransGetIsClosingTxn (trans))
+                        continue;
+                    balance = gnc_numeric_add_fixed (balance,
+                                                     xaccSplitGetAmount (split));
+                }
+                balances.push_back (balance);
+            }
+        }
+        if (report_commodity)
+            for (size_t i = 0; i < dates.size (); ++i)
+                balances[i] = xaccAccountConvertBalanceToCurrencyAsOfDate
+                    (acc, balances[i], priv->commodity, report_commodity,
+                     dates[i]);
+        rv.push_back (std::move (balances));
+    }
+    return rv;
+}
+
 /*
  * Originally gsr_account_present_balance in gnc-split-reg.c
  */
@@ -3756,6 +4021,91 @@ xaccAccountBalanceAsOfDateHelper (Account *acc, gpointer data)
  * If 'report_commodity' is NULL, just use the account's commodity.
  * If 'include_children' is FALSE, this function doesn't recurse at all.
  */
+static const std::vector<SubtreeBalance>&
+get_subtree_balances (const Account *acc)
+{
+    AccountPrivate *priv = GET_PRIVATE(acc);
+
+    if (!priv->subtree_balances)
+    {
+        auto sums = new SubtreeBalances;
+        auto& by_commodity = sums->by_commodity;
+
+        by_commodity.push_back ({ priv->commodity, priv->balance,
+                                  priv->cleared_balance,
+                                  priv->reconciled_balance });
+        for (auto node = priv->children; node; node = node->next)
+        {
+            auto child = static_cast<const Account*>(node->data);
+            for (const auto& child_sum : get_subtree_balances (child))
+            {
+                auto sum = std::find_if (by_commodity.begin (), by_commodity.end (),
+                                         [&child_sum](const SubtreeBalance& s)
+                                         { return s.commodity == child_sum.commodity; });
+                if (sum == by_commodity.end ())
+                {
+                    by_commodity.push_back (child_sum);
+                    continue;
+                }
+                sum->balance = gnc_numeric_add (sum->balance, child_sum.balance,
+                                                GNC_DENOM_AUTO, GNC_HOW_DENOM_EXACT);
+                sum->cleared_balance = gnc_numeric_add (sum->cleared_balance,
+                                                        child_sum.cleared_balance,
+                                                        GNC_DENOM_AUTO,
+                                                        GNC_HOW_DENOM_EXACT);
+                sum->reconciled_balance = gnc_numeric_add (sum->reconciled_balance,
+                                                           child_sum.reconciled_balance,
+                                                           GNC_DENOM_AUTO,
+                                                           GNC_HOW_DENOM_EXACT);
+            }
+        }
+        priv->subtree_balances = sums;
+    }
+    return priv->subtree_balances->by_commodity;
+}
+
+/*
+ * Sum an account's subtree balances of one kind in report_commodity,
+ * converting each commodity's sum once. Returns false if fn isn't one of
+ * the balances summed or a sum overflowed, when the caller must visit
+ * the descendants itself.
+ */
+static bool
+subtree_balance_in_currency (const Account *acc, xaccGetBalanceFn fn,
+                             const gnc_commodity *report_commodity,
+                             gnc_numeric *balance)
+{
+    gnc_numeric SubtreeBalance::*field;
+
+    if (fn == xaccAccountGetBalance)
+        field = &SubtreeBalance::balance;
+    else if (fn == xaccAccountGetClearedBalance)
+        field = &SubtreeBalance::cleared_balance;
+    else if (fn == xaccAccountGetReconciledBalance)
+        field = &SubtreeBalance::reconciled_balance;
+    else
+        return false;
+
+    const auto& sums = get_subtree_balances (acc);
+    if (std::any_of (sums.begin (), sums.end (), [field](const SubtreeBalance& s)
+                     { return gnc_numeric_check (s.*field) != GNC_ERROR_OK; }))
+        return false;
+
+    /* As when visiting the descendants, the account's own balance is
+     * converted without rounding and the rest added to it rounded. */
+    *balance = xaccAccountConvertBalanceToCurrency (acc, sums[0].*field,
+                                                    sums[0].commodity,
+                                                    report_commodity);
+    for (auto sum = sums.begin () + 1; sum != sums.end (); ++sum)
+        *balance = gnc_numeric_add (*balance,
+                                    xaccAccountConvertBalanceToCurrency
+                                    (acc, (*sum).*field, sum->commodity,
+                                     report_commodity),
+                                    gnc_commodity_get_fraction (report_commodity),
+                                    GNC_HOW_RND_ROUND_HALF_UP);
+    return true;
+}
+
 static gnc_numeric
 xaccAccountGetXxxBalanceInCurrencyRecursive (const Account *acc,
         xaccGetBalanceFn fn,
@@ -3770,6 +4120,10 @@ xaccAccountGetXxxBalanceInCurrencyRecursive (const Account *acc,
     if (!report_commodity)
         return gnc_numeric_zero();
 
+    if (include_children &&
+        subtree_balance_in_currency (acc, fn, report_commodity, &balance))
+        return balance;
+
     balance = xaccAccountGetXxxBalanceInCurrency (acc, fn, report_commodity);
 
     /* If needed, sum up the children converting to the *requested*
@@ -3793,6 +4147,52 @@ xaccAccountGetXxxBalanceInCurrencyRecursive (const Account *acc,
     return balance;
 }
 
+/*
+ * Sum the balances as of a date of an account and its descendants for
+ * each commodity, its own commodity first. Getting a balance as of a date
+ * may recompute the account's balances and drop the subtree balances, so
+ * the sums are only stored once all the balances have been got.
+ */
+static CommoditySums
+get_subtree_balances_as_of_date (Account *acc, xaccGetBalanceAsOfDateFn fn,
+                                 time64 date)
+{
+    AccountPrivate *priv = GET_PRIVATE(acc);
+    auto key = std::make_pair (fn, date);
+
+    if (priv->subtree_balances)
+    {
+        auto cached = priv->subtree_balances->as_of_date.find (key);
+        if (cached != priv->subtree_balances->as_of_date.end ())
+            return cached->second;
+    }
+
+    auto own = fn (acc, date);
+    CommoditySums sums { { priv->commodity, own } };
+    for (auto node = priv->children; node; node = node->next)
+    {
+        auto child = static_cast<Account*>(node->data);
+        for (const auto& child_sum : get_subtree_balances_as_of_date (child, fn, date))
+        {
+            auto sum = std::find_if (sums.begin (), sums.end (),
+                                     [&child_sum](const auto& s)
+                                     { return s.first == child_sum.first; });
+            if (sum == sums.end ())
+                sums.push_back (child_sum);
+            else
+                sum->second = gnc_numeric_add (sum->second, child_sum.second,
+                                               GNC_DENOM_AUTO, GNC_HOW_DENOM_EXACT);
+        }
+    }
+
+    get_subtree_balances (acc);
+    auto& dated = priv->subtree_balances->as_of_date;
+    if (dated.size () >= max_dated_subtree_balances)
+        dated.clear ();
+    dated.emplace (key, sums);
+    return sums;
+}
+
 static gnc_numeric
 xaccAccountGetXxxBalanceAsOfDateInCurrencyRecursive (
     Account *acc, time64 date, xaccGetBalanceAsOfDateFn fn,
@@ -3806,6 +4206,26 @@ xaccAccountGetXxxBalanceAsOfDateInCurrencyRecursive (
     if (!report_commodity)
         return gnc_numeric_zero();
 
+    if (include_children)
+    {
+        auto sums = get_subtree_balances_as_of_date (acc, fn, date);
+        if (std::none_of (sums.begin (), sums.end (), [](const auto& s)
+                          { return gnc_numeric_check (s.second) != GNC_ERROR_OK; }))
+        {
+            /* Rounded as when visiting the descendants. */
+            balance = xaccAccountConvertBalanceToCurrencyAsOfDate
+                (acc, sums[0].second, sums[0].first, report_commodity, date);
+            for (auto sum = sums.begin () + 1; sum != sums.end (); ++sum)
+                balance = gnc_numeric_add (balance,
+                                           xaccAccountConvertBalanceToCurrencyAsOfDate
+                                           (acc, sum->second, sum->first,
+                                            report_commodity, date),
+                                           gnc_commodity_get_fraction (report_commodity),
+                                           GNC_HOW_RND_ROUND_HALF_UP);
+            return balance;
+        }
+    }
+
     balance = xaccAccountGetXxxBalanceAsOfDateInCurrency(
                   acc, date, fn, report_commodity);
 
@@ -0,0 +1,70 @@
+/**********************************************************************
+ * Account.hpp -- Account handling public routines (C++ api)          *
+ *                                                                    *
+ * This program is free software; you can redistribute it and/or      *
+ * modify it under the terms of the GNU General Public License as     *
+ * published by the Free Software Foundation; either version 2 of     *
+ * the License, or (at your option) any later version.                *
+ *                                                                    *
+ * This program is distributed in the hope that it will be useful,    *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of     *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the      *
+ * GNU General Public License for more details.                       *
+ *                                                                    *
+ * You should have received a copy of the GNU General Public License  *
+ * along with this program; if not, contact:                          *
+ *                                                                    *
+ * Free Software Foundation           Voice:  +1-617-542-5942         *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652         *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                     *
+ *                                                                    *
+ *********************************************************************/
+
+/** @addtogroup Engine
+    @{ */
+/** @addtogroup Account
+    @{ */
+/** @file Account.hpp
+ *  @brief Account handling public routines (C++ api)
+ */
+
+#ifndef GNC_ACCOUNT_HPP
+#define GNC_ACCOUNT_HPP
+
+#include <vector>
+
+#include <Account.h>
+
+using AccountVec = std::vector<Account*>;
+using BalanceVec = std::vector<gnc_numeric>;
+
+/** Compute the balances of several accounts at several dates in one pass
+ *  over each account's splits.
+ *
+ *  A balance at a date includes every split whose transaction is posted on
+ *  or before that date, like gnc:account-get-balances-at-dates in the
+ *  report system.
+ *
+ *  @param accounts The accounts.
+ *
+ *  @param dates The dates, which must be sorted in ascending order.
+ *
+ *  @param include_closing If false, splits of closing transactions are left
+ *  out of the balances.
+ *
+ *  @param report_commodity If not NULL, each balance is converted to this
+ *  commodity using the price nearest before its date. Otherwise balances are
+ *  in the commodity of their account.
+ *
+ *  @return One BalanceVec per account, in the order of accounts, each
+ *  holding one balance per date in the order of dates.
+ */
+std::vector<BalanceVec>
+gnc_accounts_get_balances_at_dates (const AccountVec& accounts,
+                                    const std::vector<time64>& dates,
+                                    bool include_closing,
+                                    const gnc_commodity *report_commodity);
+
+#endif /* GNC_ACCOUNT_HPP */
+/** @} */
+/** @} */
@@ -62,6 +62,9 @@ typedef enum
     True
 } TriState;
 
+/* Balances of an account and its descendants, see Account.cpp. */
+struct SubtreeBalances;
+
 /** \struct Account */
 typedef struct AccountPrivate
 {
@@ -129,6 +132,10 @@ typedef struct AccountPrivate
  
     gboolean balance_dirty;     /* balances in splits incorrect */
 
+    /* The balances of the account and its descendants summed for each
+     * commodity, or NULL if one of them changed since they were summed. */
+    struct SubtreeBalances *subtree_balances;
+
     GList *splits;              /* list of split pointers */
     gboolean sort_dirty;        /* sort order of splits is bad */
 
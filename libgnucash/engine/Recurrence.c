@@ -195,6 +195,37 @@ static void adjust_for_weekend(PeriodType pt, WeekendAdjust wadj, GDate *date)
     }
 }
 
+/* Move a date to the day of its month on which a monthly or yearly
+   recurrence falls, in one of the three possible ways, then adjust it
+   for weekends. */
+static void
+align_day_in_month(const Recurrence *r, GDate *date)
+{
+    PeriodType pt = r->ptype;
+    guint dim;
+
+    dim = g_date_get_days_in_month(g_date_get_month(date),
+                                   g_date_get_year(date));
+    if (pt == PERIOD_LAST_WEEKDAY || pt == PERIOD_NTH_WEEKDAY)
+    {
+        gint wdresult = nth_weekday_compare(&r->start, date, pt);
+        if (wdresult < 0)
+        {
+            wdresult = -wdresult;
+            g_date_subtract_days(date, wdresult);
+        }
+        else
+            g_date_add_days(date, wdresult);
+    }
+    else if (pt == PERIOD_END_OF_MONTH || g_date_get_day(&r->start) >= dim)
+        g_date_set_day(date, dim);  /* last day in the month */
+    else
+        g_date_set_day(date, g_date_get_day(&r->start)); /*same day as start*/
+
+    /* Adjust for dates on the weekend. */
+    adjust_for_weekend(pt, r->wadj, date);
+}
+
 /* This is the only real algorithm related to recurrences.  It goes:
    Step 1) Go forward one period from the reference date.
    Step 2) Back up to align to the phase of the start date.
@@ -340,34 +371,15 @@ recurrenceNextInstance(const Recurrence *r, const GDate *ref, GDate *next)
     case PERIOD_LAST_WEEKDAY:
     case PERIOD_END_OF_MONTH:
     {
-        guint dim, n_months;
+        guint n_months;
 
         n_months = 12 * (g_date_get_year(next) - g_date_get_year(start)) +
                    (g_date_get_month(next) - g_date_get_month(start));
         g_date_subtract_months(next, n_months % mult);
 
         /* Ok, now we're in the right month, so we just have to align
-           the day in one of the three possible ways. */
-        dim = g_date_get_days_in_month(g_date_get_month(next),
-                                       g_date_get_year(next));
-        if (pt == PERIOD_LAST_WEEKDAY || pt == PERIOD_NTH_WEEKDAY)
-        {
-            gint wdresult = nth_weekday_compare(start, next, pt);
-            if (wdresult < 0)
-            {
-                wdresult = -wdresult;
-                g_date_subtract_days(next, wdresult);
-            }
-            else
-                g_date_add_days(next, wdresult);
-        }
-        else if (pt == PERIOD_END_OF_MONTH || g_date_get_day(start) >= dim)
-            g_date_set_day(next, dim);  /* last day in the month */
-        else
-            g_date_set_day(next, g_date_get_day(start)); /*same day as start*/
-
-        /* Adjust for dates on the weekend. */
-        adjust_for_weekend(pt,wadj,next);
+           the day. */
+        align_day_in_month(r, next);
     }
     break;
     case PERIOD_WEEK:
@@ -380,18 +392,142 @@ recurrenceNextInstance(const Recurrence *r, const GDate *ref, GDate *next)
     }
 }
 
+/* The instances of a recurrence are the (weekend adjusted) start date
+   and the dates an integral number of periods after it, aligned as
+   recurrenceNextInstance aligns them. Stepping with
+   recurrenceNextInstance visits them in order, so the functions below
+   find the nth of them, and the number of them up to a date, directly
+   instead of stepping. */
+
+/* The number of days between instances, or 0 if they are months
+   apart. */
+static guint
+period_days(const Recurrence *r)
+{
+    switch (r->ptype)
+    {
+    case PERIOD_DAY:
+        return r->mult;
+    case PERIOD_WEEK:
+        return 7 * r->mult;
+    default:
+        return 0;
+    }
+}
+
+/* The number of months between instances, or 0 if they are days
+   apart. */
+static guint
+period_months(const Recurrence *r)
+{
+    switch (r->ptype)
+    {
+    case PERIOD_YEAR:
+        return 12 * r->mult;
+    case PERIOD_MONTH:
+    case PERIOD_NTH_WEEKDAY:
+    case PERIOD_LAST_WEEKDAY:
+    case PERIOD_END_OF_MONTH:
+        return r->mult;
+    default:
+        return 0;
+    }
+}
+
+/* Zero-based, counting from the weekend adjusted start date. */
+static void
+instance_from_start(const Recurrence *r, guint n, GDate *date)
+{
+    guint days = period_days(r);
+    guint months = period_months(r);
+
+    *date = r->start;
+    if (n == 0)
+        adjust_for_weekend(r->ptype, r->wadj, date);
+    else if (days)
+        g_date_add_days(date, n * days);
+    else if (months)
+    {
+        g_date_set_day(date, 1);
+        g_date_add_months(date, n * months);
+        align_day_in_month(r, date);
+    }
+    else
+        g_date_clear(date, 1);
+}
+
+/* The number of instances on or before date. */
+static guint
+instances_until(const Recurrence *r, const GDate *date)
+{
+    GDate inst;
+    guint days = period_days(r);
+    guint months = period_months(r);
+    gint n_months;
+    guint n;
+
+    instance_from_start(r, 0, &inst);
+    if (g_date_compare(date, &inst) < 0)
+        return 0;
+    if (days)
+        return (g_date_get_julian(date) - g_date_get_julian(&inst)) / days + 1;
+    if (!months)
+        return 1;
+
+    n_months = 12 * (g_date_get_year(date) - g_date_get_year(&r->start)) +
+               (g_date_get_month(date) - g_date_get_month(&r->start));
+    n = n_months > 0 ? n_months / months : 0;
+
+    /* A weekend adjustment can move an instance into the month before or
+       after, so check the instances around the one in date's month. */
+    instance_from_start(r, n, &inst);
+    while (n > 0 && g_date_compare(&inst, date) > 0)
+        instance_from_start(r, --n, &inst);
+    for (;;)
+    {
+        instance_from_start(r, n + 1, &inst);
+        if (g_date_compare(&inst, date) > 0)
+            break;
+        n++;
+    }
+    return n + 1;
+}
+
 /* Zero-based index */
 void
 recurrenceNthInstance(const Recurrence *r, guint n, GDate *date)
 {
-    GDate ref;
-    guint i;
+    g_return_if_fail(r && date);
+    g_return_if_fail(g_date_valid(&r->start));
 
-    for (*date = ref = r->start, i = 0; i < n; i++)
-    {
-        recurrenceNextInstance(r, &ref, date);
-        ref = *date;
-    }
+    /* Instance 0 is the start date itself, even if it falls on a weekend
+       and the recurrence adjusts for that. */
+    if (n == 0)
+        *date = r->start;
+    else
+        instance_from_start(r, instances_until(r, &r->start) + n - 1, date);
+}
+
+guint
+recurrenceCountInstances(const Recurrence *r, const GDate *ref,
+                         const GDate *end)
+{
+    GDate first;
+
+    g_return_val_if_fail(r && ref && end, 0);
+    g_return_val_if_fail(g_date_valid(&r->start), 0);
+    g_return_val_if_fail(g_date_valid(ref) && g_date_valid(end), 0);
+
+    if (g_date_compare(end, ref) <= 0)
+        return 0;
+
+    /* Take the first step as recurrenceNextInstance would: from a date
+       between a weekend and the weekday an instance was moved forward to,
+       it steps past that instance. */
+    recurrenceNextInstance(r, ref, &first);
+    if (!g_date_valid(&first) || g_date_compare(&first, end) > 0)
+        return 0;
+    return 1 + instances_until(r, end) - instances_until(r, &first);
 }
 
 time64
@@ -135,9 +135,18 @@ WeekendAdjust recurrenceGetWeekendAdjust(const Recurrence *r);
 void recurrenceNextInstance(const Recurrence *r, const GDate *refDate,
                             GDate *nextDate);
 
-/* Zero-based.  n == 1 gets the instance after the start date. */
+/* Zero-based.  n == 1 gets the instance after the start date.  The
+ * instance is computed directly rather than by stepping through the
+ * earlier ones. */
 void recurrenceNthInstance(const Recurrence *r, guint n, GDate *date);
 
+/* Count the occurrences strictly later than refDate and no later than
+ * endDate: the number of times recurrenceNextInstance can step from
+ * refDate without passing endDate.  The count is computed directly,
+ * however many occurrences there are. */
+guint recurrenceCountInstances(const Recurrence *r, const GDate *refDate,
+                               const GDate *endDate);
+
 /* Get a time corresponding to the beginning (or end if 'end' is true)
    of the nth instance of the recurrence. Also zero-based. */
 time64 recurrenceGetPeriodTime(const Recurrence *r, guint n, gboolean end);
@@ -768,6 +768,48 @@ xaccSchedXactionSetRemOccur(SchedXaction *sx, gint num_remain)
     }
 }
 
+/* Count the occurrences in the date range of an SX with a single
+ * recurrence, which can count them without stepping through each one.
+ * This gives the same result as the stepping in
+ * gnc_sx_get_num_occur_daterange, which it is called from. */
+static gint
+num_occur_daterange_direct (const SchedXaction *sx, const Recurrence *r,
+                            const SXTmpStateData *tsd,
+                            const GDate *start_date, const GDate *end_date)
+{
+    GDate ref = tsd->last_date;
+    GDate end = *end_date;
+    guint until, before = 0;
+
+    /* Instances are never looked for before the SX's start date. */
+    if (g_date_valid (&sx->start_date)
+            && g_date_compare (&ref, &sx->start_date) < 0)
+    {
+        ref = sx->start_date;
+        g_date_subtract_days (&ref, 1);
+    }
+
+    if (xaccSchedXactionHasEndDate (sx)
+            && g_date_compare (xaccSchedXactionGetEndDate (sx), &end) < 0)
+        end = *xaccSchedXactionGetEndDate (sx);
+
+    until = recurrenceCountInstances (r, &ref, &end);
+    if (xaccSchedXactionHasOccurDef (sx))
+        until = MIN (until, (guint) tsd->num_occur_rem);
+
+    /* Leave out the occurrences before the range. If the SX last occurred
+     * in the range, the last occurrence is left out anyway. */
+    if (g_date_compare (&tsd->last_date, start_date) < 0)
+    {
+        GDate day_before = *start_date;
+
+        g_date_subtract_days (&day_before, 1);
+        before = recurrenceCountInstances (r, &ref, &day_before);
+    }
+
+    return until > before ? until - before : 0;
+}
+
 gint gnc_sx_get_num_occur_daterange(const SchedXaction *sx, const GDate* start_date, const GDate* end_date)
 {
     gint result = 0;
@@ -785,6 +827,14 @@ gint gnc_sx_get_num_occur_daterange(const SchedXaction *sx, const GDate* start_d
 
     tmpState = gnc_sx_create_temporal_state (sx);
 
+    if (sx->schedule && !sx->schedule->next && g_date_valid (&tmpState->last_date))
+    {
+        result = num_occur_daterange_direct (sx, sx->schedule->data, tmpState,
+                                             start_date, end_date);
+        gnc_sx_destroy_temporal_state (tmpState);
+        return result;
+    }
+
     /* Should we count the first valid date we encounter? Only if the
      * SX has not yet occurred so far, or if its last valid date was
      * before the start date. */
@@ -71,13 +71,13 @@ static Account* xaccScrubUtilityGetOrMakeAccount (Account *root,
 void
 gnc_set_abort_scrub (gboolean abort)
 {
-    abort_now = abort;
+    g_atomic_int_set (&abort_now, abort);
 }
 
 gboolean
 gnc_get_abort_scrub (void)
 {
-    return abort_now;
+    return g_atomic_int_get (&abort_now);
 }
 
 gboolean
@@ -1328,6 +1328,126 @@ xaccAccountTreeScrubQuoteSources (Account *root, gnc_commodity_table *table)
 
 /* ================================================================ */
 
+/* True if none of the checks xaccTransScrubCurrency and xaccSplitScrub
+ * make would change the transaction. */
+static gboolean
+trans_is_clean (const Transaction *trans)
+{
+    gnc_commodity *currency = trans->common_currency;
+    GList *node;
+
+    if (!currency || !gnc_commodity_is_currency (currency))
+        return FALSE;
+
+    for (node = trans->splits; node; node = node->next)
+    {
+        const Split *split = node->data;
+        gnc_commodity *acc_commodity;
+
+        if (!split->acc)
+            return FALSE;
+        if (gnc_numeric_check (split->value) ||
+            gnc_numeric_check (split->amount))
+            return FALSE;
+        acc_commodity = xaccAccountGetCommodity (split->acc);
+        if (!acc_commodity)
+            return FALSE;
+        if (gnc_commodity_equiv (acc_commodity, currency) &&
+            !gnc_numeric_equal (split->amount, split->value))
+            return FALSE;
+    }
+    return TRUE;
+}
+
+typedef struct
+{
+    gint clean;
+    GPtrArray *dirty;
+} ScrubAfterLoad;
+
+/* Scrubs the currency of each transaction that isn't clean and keeps it
+ * for its splits to be scrubbed once the accounts have been.  One that's
+ * clean has no split in an account without a commodity, so the account
+ * scrub can't make it dirty. */
+static int
+scrub_trans_currency_after_load (Transaction *trans, gpointer data)
+{
+    ScrubAfterLoad *scrub = data;
+
+    if (trans_is_clean (trans))
+    {
+        scrub->clean++;
+        return 0;
+    }
+
+    xaccTransScrubCurrency (trans);
+    g_ptr_array_add (scrub->dirty, trans);
+    return abort_now;
+}
+
+static void
+scrub_trans_splits_after_load (Transaction *trans)
+{
+    GList *splits, *node;
+
+    /* Only the splits in an account, as xaccAccountTreeScrubSplits does. */
+    splits = g_list_copy (trans->splits);
+    for (node = splits; node; node = node->next)
+    {
+        Split *split = node->data;
+        if (abort_now) break;
+        if (split->acc)
+            xaccSplitScrub (split);
+    }
+    g_list_free (splits);
+}
+
+void
+xaccAccountTreeScrubAfterLoad (Account *root, gnc_commodity_table *table)
+{
+    ScrubAfterLoad scrub = { 0, NULL };
+    gint64 start, currencies_done;
+    guint i;
+
+    ENTER (" ");
+    if (!root || !table)
+    {
+        LEAVE("Oops");
+        return;
+    }
+    scrub_depth++;
+    start = g_get_monotonic_time ();
+
+    /* The same fixes, in the same order, as xaccAccountTreeScrubQuoteSources,
+     * xaccAccountTreeScrubCommodities and xaccAccountTreeScrubSplits, but
+     * with only the dirty transactions visited after the first walk. */
+    xaccAccountTreeScrubQuoteSources (root, table);
+
+    scrub.dirty = g_ptr_array_new ();
+    gnc_account_tree_begin_staged_transaction_traversals (root);
+    gnc_account_tree_staged_transaction_traversal (root, 42,
+                                                   scrub_trans_currency_after_load,
+                                                   &scrub);
+    currencies_done = g_get_monotonic_time ();
+
+    scrub_account_commodity_helper (root, NULL);
+    gnc_account_foreach_descendant (root, scrub_account_commodity_helper, NULL);
+
+    for (i = 0; i < scrub.dirty->len && !abort_now; i++)
+        scrub_trans_splits_after_load (g_ptr_array_index (scrub.dirty, i));
+
+    DEBUG ("Transactions: Clean: %d, Scrubbed: %u", scrub.clean,
+           scrub.dirty->len);
+    DEBUG ("Scrubbed in %" G_GINT64_FORMAT " us, %" G_GINT64_FORMAT
+           " us of it finding the dirty transactions",
+           g_get_monotonic_time () - start, currencies_done - start);
+    g_ptr_array_free (scrub.dirty, TRUE);
+    scrub_depth--;
+    LEAVE (" ");
+}
+
+/* ================================================================ */
+
 void
 xaccAccountScrubKvp (Account *account)
 {
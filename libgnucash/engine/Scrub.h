@@ -157,6 +157,20 @@ void xaccAccountTreeScrubCommodities (Account *acc);
  */
 void xaccAccountTreeScrubQuoteSources (Account *root, gnc_commodity_table *table);
 
+/** Does the work of xaccAccountTreeScrubQuoteSources(),
+ *  xaccAccountTreeScrubCommodities() and xaccAccountTreeScrubSplits(),
+ *  in that order, walking all the transactions only once: the ones that
+ *  none of them would change are skipped from then on.  Meant for a book
+ *  that has just been read in.
+ *
+ *  @param root A pointer to the root account containing all
+ *  accounts in the current book.
+ *
+ *  @param table A pointer to the commodity table for the current
+ *  book.
+ */
+void xaccAccountTreeScrubAfterLoad (Account *root, gnc_commodity_table *table);
+
 /** Removes empty "notes", "placeholder", and "hbci" KVP slots from Accounts. */
 void xaccAccountScrubKvp (Account *account);
 
@@ -0,0 +1,394 @@
+/********************************************************************\
+ * ScrubBook.c -- check and repair a whole book                     *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+ *                                                                  *
+\********************************************************************/
+
+/* The checks here run on worker threads, so they only read the book
+ * and only through functions that don't cache or sort anything.  They
+ * may say a transaction needs repairing when it doesn't, the repair
+ * then does nothing, but must never miss one the scrubs would fix. */
+
+#include <config.h>
+
+#include <glib.h>
+#include <glib/gi18n.h>
+
+#include "Account.h"
+#include "Scrub.h"
+#include "Scrub3.h"
+#include "ScrubBook.h"
+#include "Transaction.h"
+#include "TransactionP.h"
+#include "cap-gains.h"
+#include "gnc-commodity.h"
+#include "gnc-lot.h"
+
+#undef G_LOG_DOMAIN
+#define G_LOG_DOMAIN "gnc.engine.scrub"
+
+static QofLogModule log_module = G_LOG_DOMAIN;
+
+/* How often the workers look at the abort flag. */
+#define ABORT_CHECK_SPLITS 1000
+
+typedef struct
+{
+    GncScrubFlags flags;
+    gboolean use_trading;
+    gint checked;            /* splits looked at, atomic */
+    GAsyncQueue *done;       /* partitions the workers have finished */
+} ScrubRun;
+
+typedef struct
+{
+    GList *accounts;         /* the accounts to check */
+    GPtrArray *transactions; /* those needing repair, maybe repeated */
+    GPtrArray *lot_accounts; /* accounts needing their lots scrubbed */
+} ScrubPartition;
+
+static void
+report_progress (QofPercentageFunc percentagefunc, const char *message,
+                 guint done, guint total)
+{
+    char *progress_msg;
+
+    if (!percentagefunc)
+        return;
+    progress_msg = g_strdup_printf (message, done, total);
+    (percentagefunc)(progress_msg, total ? (100.0 * done) / total : 0.0);
+    g_free (progress_msg);
+}
+
+/* ================================================================ */
+/* Checks, run on the worker threads */
+
+static gboolean
+trans_needs_scrub (const Transaction *trans, const ScrubRun *run)
+{
+    gnc_commodity *currency = trans->common_currency;
+    gnc_numeric imbal = gnc_numeric_zero ();
+    gnc_numeric imbal_trading = gnc_numeric_zero ();
+    gboolean one_commodity = TRUE;
+    GList *node;
+
+    if ((run->flags & (GNC_SCRUB_CURRENCY | GNC_SCRUB_IMBALANCE)) &&
+        (!currency || !gnc_commodity_is_currency (currency)))
+        return TRUE;
+
+    for (node = trans->splits; node; node = node->next)
+    {
+        const Split *split = node->data;
+        gnc_commodity *acc_commodity;
+
+        if (!split->acc)
+        {
+            if (run->flags & (GNC_SCRUB_ORPHANS | GNC_SCRUB_IMBALANCE))
+                return TRUE;
+            continue;
+        }
+        if (!(run->flags & (GNC_SCRUB_CURRENCY | GNC_SCRUB_IMBALANCE)))
+            continue;
+
+        acc_commodity = xaccAccountGetCommodity (split->acc);
+        if (gnc_commodity_equiv (acc_commodity, currency) &&
+            !gnc_numeric_equal (split->amount, split->value))
+            return TRUE;
+        if (!(run->flags & GNC_SCRUB_IMBALANCE))
+            continue;
+
+        /* What xaccSplitScrub and xaccTransIsBalanced look at. */
+        if (!acc_commodity ||
+            gnc_numeric_check (split->amount) ||
+            gnc_numeric_check (split->value))
+            return TRUE;
+        if (!gnc_commodity_equiv (acc_commodity, currency))
+            one_commodity = FALSE;
+        if (run->use_trading &&
+            xaccAccountGetType (split->acc) == ACCT_TYPE_TRADING)
+            imbal_trading = gnc_numeric_add (imbal_trading, split->value,
+                                             GNC_DENOM_AUTO,
+                                             GNC_HOW_DENOM_EXACT);
+        else
+            imbal = gnc_numeric_add (imbal, split->value,
+                                     GNC_DENOM_AUTO, GNC_HOW_DENOM_EXACT);
+    }
+
+    if (!(run->flags & GNC_SCRUB_IMBALANCE))
+        return FALSE;
+    if (!gnc_numeric_zero_p (imbal) || !gnc_numeric_zero_p (imbal_trading))
+        return TRUE;
+    /* Working out the per-commodity balance of a transaction with
+     * trading splits isn't worth repeating here; let the scrub do it. */
+    return run->use_trading && !one_commodity;
+}
+
+static gboolean
+account_needs_lot_scrub (const Account *acc)
+{
+    GList *lots, *node;
+    gboolean needed = FALSE;
+
+    if (!xaccAccountHasTrades (acc))
+        return FALSE;
+
+    for (node = xaccAccountGetSplitList (acc); node; node = node->next)
+    {
+        const Split *split = node->data;
+        if (!split->lot || split->gains == GAINS_STATUS_UNKNOWN ||
+            (split->gains & (GAINS_STATUS_A_VDIRTY | GAINS_STATUS_DATE_DIRTY)))
+            return TRUE;
+    }
+
+    lots = xaccAccountGetLotList (acc);
+    for (node = lots; node && !needed; node = node->next)
+    {
+        GList *lot_splits = gnc_lot_get_split_list (node->data);
+        gnc_numeric baln = gnc_numeric_zero ();
+        GList *snode;
+
+        for (snode = lot_splits; snode; snode = snode->next)
+        {
+            const Split *split = snode->data;
+            GList *other;
+
+            baln = gnc_numeric_add (baln, split->amount,
+                                    GNC_DENOM_AUTO, GNC_HOW_DENOM_EXACT);
+            /* Subsplits to merge */
+            for (other = snode->next; other && !needed; other = other->next)
+                needed = ((const Split*)other->data)->parent == split->parent;
+        }
+        needed = needed || !gnc_numeric_zero_p (baln);
+    }
+    g_list_free (lots);
+    return needed;
+}
+
+static void
+check_partition (gpointer data, gpointer user_data)
+{
+    ScrubPartition *part = data;
+    ScrubRun *run = user_data;
+    GList *anode;
+
+    for (anode = part->accounts; anode; anode = anode->next)
+    {
+        Account *acc = anode->data;
+        guint count = 0;
+        GList *node;
+
+        if (gnc_get_abort_scrub ())
+            break;
+
+        if (run->flags & (GNC_SCRUB_ORPHANS | GNC_SCRUB_CURRENCY |
+                          GNC_SCRUB_IMBALANCE))
+        {
+            for (node = xaccAccountGetSplitList (acc); node; node = node->next)
+            {
+                Transaction *trans = ((Split*)node->data)->parent;
+
+                if (trans_needs_scrub (trans, run))
+                    g_ptr_array_add (part->transactions, trans);
+                if (++count % ABORT_CHECK_SPLITS == 0)
+                {
+                    g_atomic_int_add (&run->checked, ABORT_CHECK_SPLITS);
+                    if (gnc_get_abort_scrub ())
+                        break;
+                }
+            }
+            g_atomic_int_add (&run->checked, count % ABORT_CHECK_SPLITS);
+        }
+
+        if ((run->flags & GNC_SCRUB_LOTS) && account_needs_lot_scrub (acc))
+            g_ptr_array_add (part->lot_accounts, acc);
+    }
+    g_async_queue_push (run->done, part);
+}
+
+/* ================================================================ */
+/* Partitions */
+
+static guint
+count_splits (Account *acc, GHashTable *sizes)
+{
+    /* Also sorts the split lists, so the workers don't. */
+    guint size = g_list_length (xaccAccountGetSplitList (acc));
+    GList *children = gnc_account_get_children (acc);
+    GList *node;
+
+    for (node = children; node; node = node->next)
+        size += count_splits (node->data, sizes);
+    g_list_free (children);
+    g_hash_table_insert (sizes, acc, GUINT_TO_POINTER (size));
+    return size;
+}
+
+static ScrubPartition *
+partition_new (GList *accounts)
+{
+    ScrubPartition *part = g_new0 (ScrubPartition, 1);
+    part->accounts = accounts;
+    part->transactions = g_ptr_array_new ();
+    part->lot_accounts = g_ptr_array_new ();
+    return part;
+}
+
+static void
+partition_free (ScrubPartition *part)
+{
+    g_list_free (part->accounts);
+    g_ptr_array_free (part->transactions, TRUE);
+    g_ptr_array_free (part->lot_accounts, TRUE);
+    g_free (part);
+}
+
+/* A subtree small enough is one partition; a bigger one is split into
+ * the account itself and its children's subtrees. */
+static void
+add_partitions (Account *acc, GHashTable *sizes, guint target,
+                GPtrArray *parts)
+{
+    GList *children = gnc_account_get_children (acc);
+    GList *node;
+
+    if (!children ||
+        GPOINTER_TO_UINT (g_hash_table_lookup (sizes, acc)) <= target)
+    {
+        g_ptr_array_add (parts, partition_new (
+                             g_list_prepend (gnc_account_get_descendants (acc),
+                                             acc)));
+        g_list_free (children);
+        return;
+    }
+
+    g_ptr_array_add (parts, partition_new (g_list_prepend (NULL, acc)));
+    for (node = children; node; node = node->next)
+        add_partitions (node->data, sizes, target, parts);
+    g_list_free (children);
+}
+
+/* ================================================================ */
+
+guint
+xaccBookScrub (QofBook *book, GncScrubFlags flags, guint n_threads,
+               QofPercentageFunc percentagefunc)
+{
+    const char *check_msg = _("Looking for problems: %u of %u splits");
+    const char *trans_msg = _("Repairing transactions: %u of %u");
+    const char *lots_msg = _("Repairing lots: %u of %u accounts");
+    Account *root;
+    ScrubRun run;
+    GHashTable *sizes, *seen;
+    GPtrArray *parts, *transactions, *lot_accounts;
+    GThreadPool *pool;
+    guint total, i, received = 0, repaired = 0;
+    gint64 start, checked;
+
+    g_return_val_if_fail (book, 0);
+    root = gnc_book_get_root_account (book);
+    if (!root)
+        return 0;
+
+    ENTER ("(book=%p, flags=%d)", book, flags);
+    if (!n_threads)
+        n_threads = g_get_num_processors ();
+    start = g_get_monotonic_time ();
+
+    run.flags = flags;
+    run.use_trading = qof_book_use_trading_accounts (book);
+    run.checked = 0;
+    run.done = g_async_queue_new ();
+
+    sizes = g_hash_table_new (g_direct_hash, g_direct_equal);
+    total = count_splits (root, sizes);
+    parts = g_ptr_array_new_with_free_func ((GDestroyNotify)partition_free);
+    add_partitions (root, sizes, MAX (total / (n_threads * 4), 1), parts);
+    g_hash_table_destroy (sizes);
+
+    pool = g_thread_pool_new (check_partition, &run, n_threads, FALSE, NULL);
+    for (i = 0; i < parts->len; i++)
+        g_thread_pool_push (pool, g_ptr_array_index (parts, i), NULL);
+    while (received < parts->len)
+    {
+        if (g_async_queue_timeout_pop (run.done, 100000))
+            received++;
+        report_progress (percentagefunc, check_msg,
+                         g_atomic_int_get (&run.checked), total);
+    }
+    g_thread_pool_free (pool, FALSE, TRUE);
+    g_async_queue_unref (run.done);
+    checked = g_get_monotonic_time ();
+
+    /* Repeated transactions are dropped; the order is that of the
+     * partitions, so of the accounts. */
+    seen = g_hash_table_new (g_direct_hash, g_direct_equal);
+    transactions = g_ptr_array_new ();
+    lot_accounts = g_ptr_array_new ();
+    for (i = 0; i < parts->len; i++)
+    {
+        ScrubPartition *part = g_ptr_array_index (parts, i);
+        guint j;
+
+        for (j = 0; j < part->transactions->len; j++)
+        {
+            gpointer trans = g_ptr_array_index (part->transactions, j);
+            if (g_hash_table_add (seen, trans))
+                g_ptr_array_add (transactions, trans);
+        }
+        for (j = 0; j < part->lot_accounts->len; j++)
+            g_ptr_array_add (lot_accounts,
+                             g_ptr_array_index (part->lot_accounts, j));
+    }
+    g_hash_table_destroy (seen);
+    g_ptr_array_free (parts, TRUE);
+
+    DEBUG ("%u splits checked in %" G_GINT64_FORMAT " us, "
+           "%u transactions and %u accounts to repair", total,
+           checked - start, transactions->len, lot_accounts->len);
+
+    for (i = 0; i < transactions->len && !gnc_get_abort_scrub (); i++)
+    {
+        Transaction *trans = g_ptr_array_index (transactions, i);
+
+        if (i % 10 == 0)
+            report_progress (percentagefunc, trans_msg, i, transactions->len);
+        if (flags & GNC_SCRUB_ORPHANS)
+            xaccTransScrubOrphans (trans);
+        if (flags & GNC_SCRUB_CURRENCY)
+            xaccTransScrubCurrency (trans);
+        if (flags & GNC_SCRUB_IMBALANCE)
+            xaccTransScrubImbalance (trans, root, NULL);
+        repaired++;
+    }
+
+    for (i = 0; i < lot_accounts->len && !gnc_get_abort_scrub (); i++)
+    {
+        report_progress (percentagefunc, lots_msg, i, lot_accounts->len);
+        xaccAccountScrubLots (g_ptr_array_index (lot_accounts, i));
+        repaired++;
+    }
+
+    g_ptr_array_free (transactions, TRUE);
+    g_ptr_array_free (lot_accounts, TRUE);
+    if (percentagefunc)
+        (percentagefunc)(NULL, -1.0);
+    LEAVE ("%u repaired in %" G_GINT64_FORMAT " us", repaired,
+           g_get_monotonic_time () - start);
+    return repaired;
+}
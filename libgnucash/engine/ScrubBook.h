@@ -0,0 +1,88 @@
+/********************************************************************\
+ * ScrubBook.h -- check and repair a whole book                     *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+ *                                                                  *
+\********************************************************************/
+/** @addtogroup Engine
+    @{ */
+/** @addtogroup Scrub
+    @{ */
+/** @file ScrubBook.h
+ *  @brief Check and repair a whole book, looking for problems on
+ *  several threads.
+ *
+ *  Most of the time taken by the Check & Repair functions in Scrub.h
+ *  and Scrub3.h goes into looking at transactions that are fine.
+ *  xaccBookScrub() does the looking on a pool of threads, each taking
+ *  an account subtree, and only reads the book while doing so.  The
+ *  transactions and accounts found wanting are then repaired on the
+ *  calling thread with the usual functions, so the edit rules of the
+ *  engine hold as they always do.
+ */
+
+#ifndef XACC_SCRUB_BOOK_H
+#define XACC_SCRUB_BOOK_H
+
+#include "gnc-engine.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum
+{
+    GNC_SCRUB_ORPHANS   = 1 << 0, /**< xaccTransScrubOrphans() */
+    GNC_SCRUB_CURRENCY  = 1 << 1, /**< xaccTransScrubCurrency() */
+    GNC_SCRUB_IMBALANCE = 1 << 2, /**< xaccTransScrubImbalance() */
+    GNC_SCRUB_LOTS      = 1 << 3, /**< xaccAccountScrubLots() */
+    GNC_SCRUB_ALL       = (GNC_SCRUB_ORPHANS | GNC_SCRUB_CURRENCY |
+                           GNC_SCRUB_IMBALANCE | GNC_SCRUB_LOTS)
+} GncScrubFlags;
+
+/** Check every transaction and account in the book and repair the ones
+ *  that need the scrubs asked for.
+ *
+ *  The book must not change while the checks run; the percentage
+ *  function is called on the calling thread and must not edit it
+ *  either.  The scrub can be cancelled with gnc_set_abort_scrub(), in
+ *  which case the repairs already made are kept.
+ *
+ *  @param book The book to scrub.
+ *
+ *  @param flags Which scrubs to run.
+ *
+ *  @param n_threads The number of threads to check with, or 0 for one
+ *  per processor.
+ *
+ *  @param percentagefunc Called with a message and a percentage as the
+ *  work proceeds, and with NULL and -1 when it's finished.  May be
+ *  NULL.
+ *
+ *  @return The number of transactions and accounts repaired.
+ */
+guint xaccBookScrub (QofBook *book, GncScrubFlags flags, guint n_threads,
+                     QofPercentageFunc percentagefunc);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* XACC_SCRUB_BOOK_H */
+/** @} */
+/** @} */
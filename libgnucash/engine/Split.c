@@ -1513,17 +1513,18 @@ xaccSplitOrder (const Split *sa, const Split *sb)
         retval = xaccTransOrder (sa->parent, sb->parent);
     if (retval) return retval;
 
-    /* otherwise, sort on memo strings */
+    /* otherwise, sort on memo strings, which being cached are the same
+     * pointer when equal */
     da = sa->memo ? sa->memo : "";
     db = sb->memo ? sb->memo : "";
-    retval = g_utf8_collate (da, db);
+    retval = da == db ? 0 : g_utf8_collate (da, db);
     if (retval)
         return retval;
 
     /* otherwise, sort on action strings */
     da = sa->action ? sa->action : "";
     db = sb->action ? sb->action : "";
-    retval = g_utf8_collate (da, db);
+    retval = da == db ? 0 : g_utf8_collate (da, db);
     if (retval != 0)
         return retval;
 
@@ -26,9 +26,15 @@
 #define __USE_MINGW_ANSI_STDIO 1
 #endif
 #include <errno.h>
+#include <fcntl.h>
 #include <glib.h>
 #include <glib/gstdio.h>
 #include <string.h>
+#ifdef G_OS_WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
 
 #include "Account.h"
 #include "Transaction.h"
@@ -80,14 +86,59 @@ static QofLogModule log_module = "gnc.translog";
  *     occurred at a certain time, it can be located.
  * (-) hack alert -- something better than just the account name
  *     is needed for identifying the account.
+ *
+ * The journal is written out by a thread of its own, so that a commit
+ * only has to format its record and queue it.  The writer gets each
+ * batch of records to the operating system as soon as they arrive, and
+ * to the disk as often as the sync policy asks for.
+ *
+ * For journals that are expected to grow large there is also a binary
+ * format, which is quicker to write and to replay.  It breaks rule (2),
+ * so it has to be asked for.  Each record in it holds one transaction:
+ *
+ *     u32 length of the data, u32 CRC-32 of the data, then the data:
+ *     u8 flag, the transaction guid, i64 time_now, i64 date_entered,
+ *     i64 date_posted, num, description, notes, u32 number of splits,
+ *     and for each split: the split guid, the account guid (all zero
+ *     if there's no account), acc_name, memo, action, u8 reconciled,
+ *     i64 amount num, i64 amount denom, i64 value num, i64 value
+ *     denom, i64 date_reconciled
+ *
+ * Guids are their 16 bytes, integers are little-endian and strings are
+ * a u32 length followed by that many bytes and a nul.  The file starts
+ * with the line TRANS_LOG_BINARY_MAGIC.  A crash can leave a damaged
+ * record at the end of the file; the checksum lets the reader find it.
  */
 /* ------------------------------------------------------------------ */
 
 
+#define TRANS_LOG_BINARY_MAGIC "GnuCash binary journal 1\n"
+#define TRANS_LOG_HEADER_SIZE 8
+/* Anything bigger than this is a damaged length, not a transaction. */
+#define TRANS_LOG_MAX_RECORD (64 * 1024 * 1024)
+
 static int gen_logs = 1;
 static FILE * trans_log = NULL; /**< current log file handle */
 static char * trans_log_name = NULL; /**< current log file name */
 static char * log_base_name = NULL;
+static TransLogFormat log_format = XACC_LOG_TEXT;
+static TransLogSync log_sync = XACC_LOG_SYNC_NONE;
+static guint log_sync_arg = 0;
+
+/* The journal writer thread, which owns trans_log while it runs, and the
+ * queue of records for it.  Besides records, the queue carries the
+ * addresses of log_stop, log_flush and log_wake as messages. */
+static GThread * log_writer = NULL;
+static GAsyncQueue * log_queue = NULL;
+static char log_stop;
+static char log_flush;
+static char log_wake;
+/* The sync policy and the flushes asked for and done, guarded by
+ * log_mutex. */
+static GMutex log_mutex;
+static GCond log_cond;
+static guint64 log_flushes_asked = 0;
+static guint64 log_flushes_done = 0;
 
 /********************************************************************\
 \********************************************************************/
@@ -131,6 +182,31 @@ xaccLogSetBaseName (const char *basepath)
 }
 
 
+void
+xaccLogSetFormat (TransLogFormat format)
+{
+    if (format == log_format) return;
+
+    log_format = format;
+    xaccReopenLog ();
+}
+
+
+/* The writer takes up the new policy; the log carries on in its file. */
+void
+xaccLogSetSync (TransLogSync sync, guint arg)
+{
+    g_mutex_lock (&log_mutex);
+    log_sync = sync;
+    log_sync_arg = arg;
+    g_mutex_unlock (&log_mutex);
+
+    /* It may be waiting out the old interval. */
+    if (trans_log)
+        g_async_queue_push (log_queue, &log_wake);
+}
+
+
 /*
  * See if the provided file name is that of the current log file.
  * Since the filename is generated with a time-stamp we can ignore the
@@ -155,11 +231,104 @@ xaccFileIsCurrentLog (const gchar *name)
 /********************************************************************\
 \********************************************************************/
 
+static void
+log_sync_file (FILE *file)
+{
+#ifdef G_OS_WIN32
+    _commit (_fileno (file));
+#else
+    fsync (fileno (file));
+#endif
+}
+
+static gpointer
+log_writer_thread (gpointer data)
+{
+    gint64 last_sync = g_get_monotonic_time ();
+    guint unsynced = 0;
+    gboolean stop = FALSE;
+
+    while (!stop)
+    {
+        guint64 flushes = 0;
+        TransLogSync sync;
+        guint count;
+        gint64 interval;
+        gpointer item;
+        gint64 now;
+
+        g_mutex_lock (&log_mutex);
+        sync = log_sync;
+        count = log_sync_arg;
+        g_mutex_unlock (&log_mutex);
+        interval = (gint64) count * G_TIME_SPAN_MILLISECOND;
+
+        if (sync == XACC_LOG_SYNC_INTERVAL && unsynced)
+            item = g_async_queue_timeout_pop (log_queue,
+                                              MAX (last_sync + interval -
+                                                   g_get_monotonic_time (), 0));
+        else
+            item = g_async_queue_pop (log_queue);
+
+        /* Write out everything waiting before getting it to the disk. */
+        for (; item; item = g_async_queue_try_pop (log_queue))
+        {
+            if (item == &log_stop)
+            {
+                stop = TRUE;
+            }
+            else if (item == &log_flush)
+            {
+                flushes++;
+            }
+            else if (item == &log_wake)
+            {
+                /* Only to take up a new sync policy. */
+            }
+            else
+            {
+                GString *record = item;
+
+                fwrite (record->str, 1, record->len, trans_log);
+                g_string_free (record, TRUE);
+                unsynced++;
+            }
+        }
+
+        /* get data out to the disk */
+        fflush (trans_log);
+
+        now = g_get_monotonic_time ();
+        if (unsynced &&
+            (stop || flushes ||
+             (sync == XACC_LOG_SYNC_COUNT && unsynced >= count) ||
+             (sync == XACC_LOG_SYNC_INTERVAL && now - last_sync >= interval)))
+        {
+            if (sync != XACC_LOG_SYNC_NONE)
+                log_sync_file (trans_log);
+            last_sync = now;
+            unsynced = 0;
+        }
+
+        if (flushes)
+        {
+            g_mutex_lock (&log_mutex);
+            log_flushes_done += flushes;
+            g_cond_broadcast (&log_cond);
+            g_mutex_unlock (&log_mutex);
+        }
+    }
+
+    return NULL;
+}
+
 void
 xaccOpenLog (void)
 {
     char * filename;
     char * timestamp;
+    time64 now;
+    int fd, flags = 0;
 
     if (!gen_logs)
     {
@@ -170,12 +339,31 @@ xaccOpenLog (void)
 
     if (!log_base_name) log_base_name = g_strdup ("translog");
 
-    /* tag each filename with a timestamp */
-    timestamp = gnc_date_timestamp ();
+#ifdef G_OS_WIN32
+    if (log_format == XACC_LOG_BINARY)
+        flags = O_BINARY;
+#endif
 
-    filename = g_strconcat (log_base_name, ".", timestamp, ".log", NULL);
+    /* Tag each filename with a timestamp.  Each open starts a file of its
+     * own, so one reopened within the same second takes the next second
+     * that's free. */
+    for (now = gnc_time (NULL); ; now++)
+    {
+        timestamp = gnc_print_time64 (now, "%Y%m%d%H%M%S");
+        filename = g_strconcat (log_base_name, ".", timestamp, ".log", NULL);
+        fd = g_open (filename, O_WRONLY | O_CREAT | O_EXCL | flags, 0666);
+        if (fd != -1 || errno != EEXIST)
+            break;
+        g_free (filename);
+        g_free (timestamp);
+    }
 
-    trans_log = g_fopen (filename, "a");
+    if (fd != -1)
+    {
+        trans_log = fdopen (fd, log_format == XACC_LOG_BINARY ? "ab" : "a");
+        if (!trans_log)
+            close (fd);
+    }
     if (!trans_log)
     {
         int norr = errno;
@@ -195,13 +383,24 @@ xaccOpenLog (void)
     g_free (filename);
     g_free (timestamp);
 
-    /*  Note: this must match src/import-export/log-replay/gnc-log-replay.c */
-    fprintf (trans_log, "mod\ttrans_guid\tsplit_guid\ttime_now\t"
-             "date_entered\tdate_posted\t"
-             "acc_guid\tacc_name\tnum\tdescription\t"
-             "notes\tmemo\taction\treconciled\t"
-             "amount\tvalue\tdate_reconciled\n");
-    fprintf (trans_log, "-----------------\n");
+    if (log_format == XACC_LOG_BINARY)
+    {
+        fputs (TRANS_LOG_BINARY_MAGIC, trans_log);
+    }
+    else
+    {
+        /*  Note: this must match src/import-export/log-replay/gnc-log-replay.c */
+        fprintf (trans_log, "mod\ttrans_guid\tsplit_guid\ttime_now\t"
+                 "date_entered\tdate_posted\t"
+                 "acc_guid\tacc_name\tnum\tdescription\t"
+                 "notes\tmemo\taction\treconciled\t"
+                 "amount\tvalue\tdate_reconciled\n");
+        fprintf (trans_log, "-----------------\n");
+    }
+    fflush (trans_log);
+
+    log_queue = g_async_queue_new ();
+    log_writer = g_thread_new ("gnc-translog", log_writer_thread, NULL);
 }
 
 /********************************************************************\
@@ -211,36 +410,158 @@ void
 xaccCloseLog (void)
 {
     if (!trans_log) return;
-    fflush (trans_log);
+
+    g_async_queue_push (log_queue, &log_stop);
+    g_thread_join (log_writer);
+    log_writer = NULL;
+    g_async_queue_unref (log_queue);
+    log_queue = NULL;
+
     fclose (trans_log);
     trans_log = NULL;
 }
 
+void
+xaccLogFlush (void)
+{
+    guint64 asked;
+
+    if (!trans_log) return;
+
+    /* Flushes are done in the order they're queued, so this one is
+     * done once as many have been as were asked for when it was. */
+    g_mutex_lock (&log_mutex);
+    asked = ++log_flushes_asked;
+    g_async_queue_push (log_queue, &log_flush);
+    while (log_flushes_done < asked)
+        g_cond_wait (&log_cond, &log_mutex);
+    g_mutex_unlock (&log_mutex);
+}
+
 /********************************************************************\
 \********************************************************************/
 
-void
-xaccTransWriteLog (Transaction *trans, char flag)
+static guint32 log_crc_table[256];
+
+static guint32
+log_crc32 (const guchar *data, gsize len)
+{
+    static gsize table_ready = 0;
+    guint32 crc = 0xFFFFFFFF;
+
+    if (g_once_init_enter (&table_ready))
+    {
+        for (guint32 n = 0; n < 256; n++)
+        {
+            guint32 c = n;
+
+            for (int k = 0; k < 8; k++)
+                c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+            log_crc_table[n] = c;
+        }
+        g_once_init_leave (&table_ready, 1);
+    }
+
+    while (len--)
+        crc = log_crc_table[(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+
+    return crc ^ 0xFFFFFFFF;
+}
+
+static void
+log_put_uint32 (GString *record, guint32 value)
+{
+    value = GUINT32_TO_LE (value);
+    g_string_append_len (record, (const char *) &value, sizeof (value));
+}
+
+static void
+log_put_int64 (GString *record, gint64 value)
+{
+    guint64 le = GUINT64_TO_LE ((guint64) value);
+    g_string_append_len (record, (const char *) &le, sizeof (le));
+}
+
+static void
+log_put_guid (GString *record, const GncGUID *guid)
+{
+    g_string_append_len (record, (const char *) guid->reserved, GUID_DATA_SIZE);
+}
+
+static void
+log_put_string (GString *record, const char *str)
+{
+    guint32 len = str ? strlen (str) : 0;
+
+    log_put_uint32 (record, len);
+    g_string_append_len (record, str ? str : "", len);
+    g_string_append_c (record, '\0');
+}
+
+static GString *
+log_binary_record (Transaction *trans, char flag)
+{
+    GString *record = g_string_sized_new (512);
+    guint32 header[2];
+    GList *node;
+
+    g_string_set_size (record, TRANS_LOG_HEADER_SIZE);
+
+    g_string_append_c (record, flag);
+    log_put_guid (record, xaccTransGetGUID (trans));
+    log_put_int64 (record, gnc_time (NULL));
+    log_put_int64 (record, trans->date_entered);
+    log_put_int64 (record, trans->date_posted);
+    log_put_string (record, trans->num);
+    log_put_string (record, trans->description);
+    log_put_string (record, xaccTransGetNotes (trans));
+    log_put_uint32 (record, g_list_length (trans->splits));
+
+    for (node = trans->splits; node; node = node->next)
+    {
+        Split *split = node->data;
+        Account *account = xaccSplitGetAccount (split);
+        gnc_numeric amt = xaccSplitGetAmount (split);
+        gnc_numeric val = xaccSplitGetValue (split);
+
+        log_put_guid (record, xaccSplitGetGUID (split));
+        log_put_guid (record, account ? xaccAccountGetGUID (account) : guid_null ());
+        log_put_string (record, account ? xaccAccountGetName (account) : NULL);
+        log_put_string (record, split->memo);
+        log_put_string (record, split->action);
+        g_string_append_c (record, split->reconciled);
+        log_put_int64 (record, gnc_numeric_num (amt));
+        log_put_int64 (record, gnc_numeric_denom (amt));
+        log_put_int64 (record, gnc_numeric_num (val));
+        log_put_int64 (record, gnc_numeric_denom (val));
+        log_put_int64 (record, split->date_reconciled);
+    }
+
+    header[0] = GUINT32_TO_LE (record->len - TRANS_LOG_HEADER_SIZE);
+    header[1] = GUINT32_TO_LE (log_crc32 ((const guchar *) record->str +
+                                          TRANS_LOG_HEADER_SIZE,
+                                          record->len - TRANS_LOG_HEADER_SIZE));
+    memcpy (record->str, header, TRANS_LOG_HEADER_SIZE);
+
+    return record;
+}
+
+static GString *
+log_text_record (Transaction *trans, char flag)
 {
+    GString *record = g_string_sized_new (1024);
     GList *node;
     char trans_guid_str[GUID_ENCODING_LENGTH + 1];
     char split_guid_str[GUID_ENCODING_LENGTH + 1];
     const char *trans_notes;
     char dnow[100], dent[100], dpost[100], drecn[100];
 
-    if (!gen_logs)
-    {
-         PINFO ("Attempt to write disabled transaction log");
-	 return;
-    }
-    if (!trans_log) return;
-
     gnc_time64_to_iso8601_buff (gnc_time(NULL), dnow);
     gnc_time64_to_iso8601_buff (trans->date_entered, dent);
     gnc_time64_to_iso8601_buff (trans->date_posted, dpost);
     guid_to_string_buff (xaccTransGetGUID(trans), trans_guid_str);
     trans_notes = xaccTransGetNotes(trans);
-    fprintf (trans_log, "===== START\n");
+    g_string_append (record, "===== START\n");
 
     for (node = trans->splits; node; node = node->next)
     {
@@ -267,7 +588,7 @@ xaccTransWriteLog (Transaction *trans, char flag)
         val = xaccSplitGetValue (split);
 
         /* use tab-separated fields */
-        fprintf (trans_log,
+        g_string_append_printf (record,
                  "%c\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t"
                  "%s\t%s\t%s\t%s\t%c\t%" G_GINT64_FORMAT "/%" G_GINT64_FORMAT "\t%" G_GINT64_FORMAT "/%" G_GINT64_FORMAT "\t%s\n",
                  flag,
@@ -293,10 +614,242 @@ xaccTransWriteLog (Transaction *trans, char flag)
                  drecn);
     }
 
-    fprintf (trans_log, "===== END\n");
+    g_string_append (record, "===== END\n");
 
-    /* get data out to the disk */
-    fflush (trans_log);
+    return record;
+}
+
+void
+xaccTransWriteLog (Transaction *trans, char flag)
+{
+    if (!gen_logs)
+    {
+         PINFO ("Attempt to write disabled transaction log");
+	 return;
+    }
+    if (!trans_log) return;
+
+    g_async_queue_push (log_queue,
+                        log_format == XACC_LOG_BINARY ?
+                        log_binary_record (trans, flag) :
+                        log_text_record (trans, flag));
+}
+
+/********************************************************************\
+\********************************************************************/
+
+struct _TransLogReader
+{
+    FILE *file;
+    guchar *data;
+    gsize size;
+    GArray *splits;
+    gboolean failed;
+};
+
+/* A cursor over the data of a record being read. */
+typedef struct
+{
+    const guchar *pos;
+    const guchar *end;
+    gboolean ok;
+} LogCursor;
+
+static const guchar *
+log_get_bytes (LogCursor *cursor, gsize len)
+{
+    const guchar *bytes = cursor->pos;
+
+    if (!cursor->ok || (gsize) (cursor->end - cursor->pos) < len)
+    {
+        cursor->ok = FALSE;
+        return NULL;
+    }
+    cursor->pos += len;
+    return bytes;
+}
+
+static guint32
+log_get_uint32 (LogCursor *cursor)
+{
+    const guchar *bytes = log_get_bytes (cursor, sizeof (guint32));
+    guint32 value;
+
+    if (!bytes) return 0;
+    memcpy (&value, bytes, sizeof (value));
+    return GUINT32_FROM_LE (value);
+}
+
+static gint64
+log_get_int64 (LogCursor *cursor)
+{
+    const guchar *bytes = log_get_bytes (cursor, sizeof (guint64));
+    guint64 value;
+
+    if (!bytes) return 0;
+    memcpy (&value, bytes, sizeof (value));
+    return (gint64) GUINT64_FROM_LE (value);
+}
+
+static void
+log_get_guid (LogCursor *cursor, GncGUID *guid)
+{
+    const guchar *bytes = log_get_bytes (cursor, GUID_DATA_SIZE);
+
+    if (bytes)
+        memcpy (guid->reserved, bytes, GUID_DATA_SIZE);
+    else
+        *guid = *guid_null ();
+}
+
+static const char *
+log_get_string (LogCursor *cursor)
+{
+    guint32 len = log_get_uint32 (cursor);
+    const guchar *bytes;
+
+    if (len >= TRANS_LOG_MAX_RECORD)
+        cursor->ok = FALSE;
+    bytes = log_get_bytes (cursor, len + 1);
+    if (!bytes || bytes[len] != '\0')
+    {
+        cursor->ok = FALSE;
+        return "";
+    }
+    return (const char *) bytes;
+}
+
+static gnc_numeric
+log_get_numeric (LogCursor *cursor)
+{
+    gint64 num = log_get_int64 (cursor);
+    gint64 denom = log_get_int64 (cursor);
+
+    return gnc_numeric_create (num, denom);
+}
+
+TransLogReader *
+xaccLogReaderNew (FILE *file)
+{
+    char magic[sizeof (TRANS_LOG_BINARY_MAGIC) - 1];
+    TransLogReader *reader;
+    long start;
+
+    g_return_val_if_fail (file, NULL);
+
+    start = ftell (file);
+    if (fread (magic, 1, sizeof (magic), file) != sizeof (magic) ||
+        memcmp (magic, TRANS_LOG_BINARY_MAGIC, sizeof (magic)) != 0)
+    {
+        fseek (file, start, SEEK_SET);
+        return NULL;
+    }
+
+    reader = g_new0 (TransLogReader, 1);
+    reader->file = file;
+    reader->splits = g_array_new (FALSE, FALSE, sizeof (TransLogSplit));
+    return reader;
+}
+
+gboolean
+xaccLogReaderNext (TransLogReader *reader, TransLogRecord *record)
+{
+    guint32 header[2];
+    guint32 len, count;
+    size_t got;
+    LogCursor cursor;
+    const guchar *flag;
+
+    g_return_val_if_fail (reader && record, FALSE);
+
+    if (reader->failed)
+        return FALSE;
+
+    got = fread (header, 1, TRANS_LOG_HEADER_SIZE, reader->file);
+    if (got == 0 && feof (reader->file))
+        return FALSE;
+
+    len = GUINT32_FROM_LE (header[0]);
+    if (got != TRANS_LOG_HEADER_SIZE || len > TRANS_LOG_MAX_RECORD)
+    {
+        reader->failed = TRUE;
+        return FALSE;
+    }
+
+    if (len > reader->size)
+    {
+        reader->data = g_realloc (reader->data, len);
+        reader->size = len;
+    }
+    if (fread (reader->data, 1, len, reader->file) != len ||
+        log_crc32 (reader->data, len) != GUINT32_FROM_LE (header[1]))
+    {
+        PWARN ("Damaged record in the transaction log");
+        reader->failed = TRUE;
+        return FALSE;
+    }
+
+    cursor.pos = reader->data;
+    cursor.end = reader->data + len;
+    cursor.ok = TRUE;
+
+    flag = log_get_bytes (&cursor, 1);
+    record->flag = flag ? *flag : '\0';
+    log_get_guid (&cursor, &record->trans_guid);
+    record->time_now = log_get_int64 (&cursor);
+    record->date_entered = log_get_int64 (&cursor);
+    record->date_posted = log_get_int64 (&cursor);
+    record->num = log_get_string (&cursor);
+    record->description = log_get_string (&cursor);
+    record->notes = log_get_string (&cursor);
+    count = log_get_uint32 (&cursor);
+
+    g_array_set_size (reader->splits, 0);
+    for (guint32 i = 0; i < count && cursor.ok; i++)
+    {
+        TransLogSplit split;
+        const guchar *reconciled;
+
+        log_get_guid (&cursor, &split.split_guid);
+        log_get_guid (&cursor, &split.acc_guid);
+        split.acc_name = log_get_string (&cursor);
+        split.memo = log_get_string (&cursor);
+        split.action = log_get_string (&cursor);
+        reconciled = log_get_bytes (&cursor, 1);
+        split.reconciled = reconciled ? *reconciled : NREC;
+        split.amount = log_get_numeric (&cursor);
+        split.value = log_get_numeric (&cursor);
+        split.date_reconciled = log_get_int64 (&cursor);
+        g_array_append_val (reader->splits, split);
+    }
+
+    if (!cursor.ok || cursor.pos != cursor.end)
+    {
+        PWARN ("Malformed record in the transaction log");
+        reader->failed = TRUE;
+        return FALSE;
+    }
+
+    record->num_splits = reader->splits->len;
+    record->splits = (TransLogSplit *) reader->splits->data;
+    return TRUE;
+}
+
+gboolean
+xaccLogReaderFailed (const TransLogReader *reader)
+{
+    g_return_val_if_fail (reader, FALSE);
+    return reader->failed;
+}
+
+void
+xaccLogReaderDestroy (TransLogReader *reader)
+{
+    if (!reader) return;
+
+    g_array_free (reader->splits, TRUE);
+    g_free (reader->data);
+    g_free (reader);
 }
 
 /************************ END OF ************************************\
@@ -34,6 +34,10 @@
     There are some simple command-line tools that will read a log
     and replay it.
 
+    Records are written out to the journal by a thread of its own, so
+    committing a transaction doesn't wait on the disk.  How often the
+    journal is synced to the disk is set with xaccLogSetSync().
+
     @{ */
 /** @file TransLog.h
     @brief API for the transaction logger
@@ -43,6 +47,8 @@
 #ifndef XACC_TRANS_LOG_H
 #define XACC_TRANS_LOG_H
 
+#include <stdio.h>
+
 #include "Account.h"
 #include "Transaction.h"
 
@@ -50,10 +56,32 @@
 extern "C" {
 #endif
 
+/** The format of the journal. */
+typedef enum
+{
+    XACC_LOG_TEXT,   /**< tab-separated text, one line per split */
+    XACC_LOG_BINARY, /**< compact checksummed records, see TransLog.c */
+} TransLogFormat;
+
+/** How often the journal is synced to the disk.  Records are always
+ *  handed to the operating system as soon as the writer gets them. */
+typedef enum
+{
+    XACC_LOG_SYNC_NONE,     /**< leave it to the operating system */
+    XACC_LOG_SYNC_INTERVAL, /**< at most the given milliseconds apart */
+    XACC_LOG_SYNC_COUNT,    /**< every given number of transactions */
+} TransLogSync;
+
 void    xaccOpenLog (void);
+/** Closes the journal after everything queued for it is written. */
 void    xaccCloseLog (void);
 void    xaccReopenLog (void);
 
+/** Waits until everything queued for the journal is written to the
+ *  file, and synced to the disk unless the sync setting is
+ *  XACC_LOG_SYNC_NONE. */
+void    xaccLogFlush (void);
+
 /**
  * @param trans The transaction to write out to the log
  * @param flag The engine currently uses the log mechanism with flag char set as
@@ -82,9 +110,70 @@ void    xaccLogDisable (void);
  */
 void    xaccLogSetBaseName (const char *);
 
+/** Sets the format of the journal.  If the journal file is already
+ *  open, it will close it and start a new one in that format.  Each
+ *  journal file opened gets a name of its own, even within the same
+ *  second. */
+void    xaccLogSetFormat (TransLogFormat format);
+
+/** Sets how often the journal is synced to the disk.  @a arg is the
+ *  interval in milliseconds or the number of transactions; it is
+ *  ignored for XACC_LOG_SYNC_NONE.  An open journal carries on in the
+ *  same file with the new setting.  GnuCash takes both settings from
+ *  the general journal-* preferences. */
+void    xaccLogSetSync (TransLogSync sync, guint arg);
+
 /** Test a filename to see if it is the name of the current logfile */
 gboolean xaccFileIsCurrentLog (const gchar *name);
 
+/** @name Reading binary journals
+ @{ */
+typedef struct
+{
+    GncGUID split_guid;
+    GncGUID acc_guid;      /**< all zero if the split had no account */
+    const char *acc_name;
+    const char *memo;
+    const char *action;
+    char reconciled;
+    gnc_numeric amount;
+    gnc_numeric value;
+    time64 date_reconciled;
+} TransLogSplit;
+
+/** One transaction read from a binary journal.  The strings and splits
+ *  belong to the reader and last until the next record is read. */
+typedef struct
+{
+    char flag;
+    GncGUID trans_guid;
+    time64 time_now;
+    time64 date_entered;
+    time64 date_posted;
+    const char *num;
+    const char *description;
+    const char *notes;
+    guint num_splits;
+    TransLogSplit *splits;
+} TransLogRecord;
+
+typedef struct _TransLogReader TransLogReader;
+
+/** Starts reading a binary journal from the current position of @a
+ *  file.  Returns NULL, leaving the position alone, if it isn't one. */
+TransLogReader *xaccLogReaderNew (FILE *file);
+
+/** Reads the next record into @a record.  Returns FALSE at the end of
+ *  the journal or at a damaged record. */
+gboolean xaccLogReaderNext (TransLogReader *reader, TransLogRecord *record);
+
+/** Whether the reader stopped at a damaged record rather than at the
+ *  end of the journal. */
+gboolean xaccLogReaderFailed (const TransLogReader *reader);
+
+void xaccLogReaderDestroy (TransLogReader *reader);
+/** @} */
+
 #ifdef __cplusplus
 }
 #endif
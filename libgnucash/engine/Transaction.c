@@ -1897,8 +1897,13 @@ order_by_int64_or_string (const char* a, const char* b)
 {
      char *end_a = NULL, *end_b = NULL;
      int cmp = 0;
-     uint64_t na = strtoull(a, &end_a, 10);
-     uint64_t nb = strtoull(b, &end_b, 10);
+     uint64_t na, nb;
+
+     /* Cached strings that are equal are the same pointer. */
+     if (a == b)
+          return 0;
+     na = strtoull(a, &end_a, 10);
+     nb = strtoull(b, &end_b, 10);
      if (na && nb)
      {
           if (na != nb)
@@ -1952,7 +1957,7 @@ xaccTransOrder_num_action (const Transaction *ta, const char *actna,
     /* otherwise, sort on description string */
     da = ta->description ? ta->description : "";
     db = tb->description ? tb->description : "";
-    retval = g_utf8_collate (da, db);
+    retval = da == db ? 0 : g_utf8_collate (da, db);
     if (retval)
         return retval;
 
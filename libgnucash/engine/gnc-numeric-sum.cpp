@@ -0,0 +1,204 @@
+/********************************************************************
+ * gnc-numeric-sum.cpp -- Summing numerators with a common denominator *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+ *                                                                  *
+\********************************************************************/
+
+#include <config.h>
+#include "gnc-numeric-sum.hpp"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/* Small enough that a block's numerators stay in L1 between the bound
+ * and the summing passes. */
+static constexpr size_t block_size = 256;
+
+static inline uint64_t
+magnitude (int64_t num) noexcept
+{
+    return num < 0 ? UINT64_C(0) - static_cast<uint64_t>(num) :
+        static_cast<uint64_t>(num);
+}
+
+/* Bitwise or of the magnitudes of the numerators. It is at least the
+ * largest magnitude and less than twice it, which is close enough for
+ * bounding sums and cheaper than a maximum without 64-bit compares.
+ * INT64_MIN's magnitude sets the top bit, so no block holding it is ever
+ * treated as safe.
+ */
+static inline uint64_t
+magnitude_bound (const int64_t *nums, size_t count) noexcept
+{
+    uint64_t bound = 0;
+    size_t i = 0;
+#if defined(__AVX2__)
+    auto acc = _mm256_setzero_si256 ();
+    for (; i + 4 <= count; i += 4)
+    {
+        auto v = _mm256_loadu_si256 (reinterpret_cast<const __m256i*>(nums + i));
+        auto sign = _mm256_cmpgt_epi64 (_mm256_setzero_si256 (), v);
+        acc = _mm256_or_si256 (acc, _mm256_sub_epi64 (_mm256_xor_si256 (v, sign),
+                                                      sign));
+    }
+    alignas(32) uint64_t lanes[4];
+    _mm256_store_si256 (reinterpret_cast<__m256i*>(lanes), acc);
+    bound = lanes[0] | lanes[1] | lanes[2] | lanes[3];
+#elif defined(__SSE2__)
+    auto acc = _mm_setzero_si128 ();
+    for (; i + 2 <= count; i += 2)
+    {
+        auto v = _mm_loadu_si128 (reinterpret_cast<const __m128i*>(nums + i));
+        /* SSE2 has no 64-bit compare; spread each lane's sign bit. */
+        auto sign = _mm_shuffle_epi32 (_mm_srai_epi32 (v, 31),
+                                       _MM_SHUFFLE (3, 3, 1, 1));
+        acc = _mm_or_si128 (acc, _mm_sub_epi64 (_mm_xor_si128 (v, sign), sign));
+    }
+    alignas(16) uint64_t lanes[2];
+    _mm_store_si128 (reinterpret_cast<__m128i*>(lanes), acc);
+    bound = lanes[0] | lanes[1];
+#endif
+    for (; i < count; ++i)
+        bound |= magnitude (nums[i]);
+    return bound;
+}
+
+/* True if no running sum of count numerators, each of magnitude at most
+ * bound, starting from start can leave the int64_t range. */
+static inline bool
+block_is_safe (int64_t start, uint64_t bound, size_t count) noexcept
+{
+    if (magnitude (start) > static_cast<uint64_t>(INT64_MAX))
+        return false;
+    auto headroom = static_cast<uint64_t>(INT64_MAX) - magnitude (start);
+    return headroom / count >= bound;
+}
+
+static inline int64_t
+unchecked_sum (const int64_t *nums, size_t count, int64_t start) noexcept
+{
+    size_t i = 0;
+#if defined(__AVX2__)
+    auto acc = _mm256_setzero_si256 ();
+    for (; i + 4 <= count; i += 4)
+        acc = _mm256_add_epi64 (acc, _mm256_loadu_si256
+                                (reinterpret_cast<const __m256i*>(nums + i)));
+    alignas(32) int64_t lanes[4];
+    _mm256_store_si256 (reinterpret_cast<__m256i*>(lanes), acc);
+    start += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#elif defined(__SSE2__)
+    auto acc = _mm_setzero_si128 ();
+    for (; i + 2 <= count; i += 2)
+        acc = _mm_add_epi64 (acc, _mm_loadu_si128
+                             (reinterpret_cast<const __m128i*>(nums + i)));
+    alignas(16) int64_t lanes[2];
+    _mm_store_si128 (reinterpret_cast<__m128i*>(lanes), acc);
+    start += lanes[0] + lanes[1];
+#endif
+    for (; i < count; ++i)
+        start += nums[i];
+    return start;
+}
+
+static inline int64_t
+unchecked_prefix_sums (const int64_t *nums, size_t count, int64_t start,
+                       int64_t *sums) noexcept
+{
+    size_t i = 0;
+#if defined(__AVX2__)
+    auto carry = _mm256_set1_epi64x (start);
+    auto zero = _mm256_setzero_si256 ();
+    for (; i + 4 <= count; i += 4)
+    {
+        auto v = _mm256_loadu_si256 (reinterpret_cast<const __m256i*>(nums + i));
+        /* [a b c d] + [0 a b c] + [0 0 a a+b] = [a a+b a+b+c a+b+c+d] */
+        v = _mm256_add_epi64 (v, _mm256_blend_epi32
+                              (_mm256_permute4x64_epi64 (v, _MM_SHUFFLE (2, 1, 0, 0)),
+                               zero, 0x03));
+        v = _mm256_add_epi64 (v, _mm256_blend_epi32
+                              (_mm256_permute4x64_epi64 (v, _MM_SHUFFLE (1, 0, 0, 0)),
+                               zero, 0x0f));
+        v = _mm256_add_epi64 (v, carry);
+        _mm256_storeu_si256 (reinterpret_cast<__m256i*>(sums + i), v);
+        carry = _mm256_permute4x64_epi64 (v, _MM_SHUFFLE (3, 3, 3, 3));
+    }
+    if (i)
+        start = sums[i - 1];
+#elif defined(__SSE2__)
+    auto carry = _mm_set1_epi64x (start);
+    for (; i + 2 <= count; i += 2)
+    {
+        auto v = _mm_loadu_si128 (reinterpret_cast<const __m128i*>(nums + i));
+        v = _mm_add_epi64 (v, _mm_slli_si128 (v, 8));
+        v = _mm_add_epi64 (v, carry);
+        _mm_storeu_si128 (reinterpret_cast<__m128i*>(sums + i), v);
+        carry = _mm_unpackhi_epi64 (v, v);
+    }
+    if (i)
+        start = sums[i - 1];
+#endif
+    for (; i < count; ++i)
+        sums[i] = start += nums[i];
+    return start;
+}
+
+bool
+gnc_numeric_prefix_sums (const int64_t *nums, size_t count, int64_t start,
+                         int64_t *sums) noexcept
+{
+    for (size_t pos = 0; pos < count; pos += block_size)
+    {
+        auto len = count - pos < block_size ? count - pos : block_size;
+        if (block_is_safe (start, magnitude_bound (nums + pos, len), len))
+        {
+            start = unchecked_prefix_sums (nums + pos, len, start, sums + pos);
+            continue;
+        }
+        for (auto i = pos; i < pos + len; ++i)
+        {
+            if (__builtin_add_overflow (start, nums[i], &start))
+                return false;
+            sums[i] = start;
+        }
+    }
+    return true;
+}
+
+bool
+gnc_numeric_sum (const int64_t *nums, size_t count, int64_t start,
+                 int64_t& total) noexcept
+{
+    for (size_t pos = 0; pos < count; pos += block_size)
+    {
+        auto len = count - pos < block_size ? count - pos : block_size;
+        if (block_is_safe (start, magnitude_bound (nums + pos, len), len))
+        {
+            start = unchecked_sum (nums + pos, len, start);
+            continue;
+        }
+        for (auto i = pos; i < pos + len; ++i)
+            if (__builtin_add_overflow (start, nums[i], &start))
+                return false;
+    }
+    total = start;
+    return true;
+}
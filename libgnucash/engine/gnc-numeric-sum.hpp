@@ -0,0 +1,70 @@
+/********************************************************************
+ * gnc-numeric-sum.hpp -- Summing numerators with a common denominator *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+ *                                                                  *
+\********************************************************************/
+/** @addtogroup Numeric
+ * @{
+ */
+/** @file gnc-numeric-sum.hpp
+ * @brief Fast sums of gnc_numerics that share a denominator.
+ *
+ * Long runs of amounts in one commodity, such as an account's splits,
+ * all have the commodity's SCU as denominator, so their sum is the sum of
+ * their numerators. These functions compute such sums directly on arrays
+ * of numerators. They work in blocks: when the largest magnitude in a
+ * block shows that no running sum in it can overflow, the block is summed
+ * without per-element checks, using AVX2 or SSE2 if the build enables
+ * them. Other blocks are summed with checked scalar additions.
+ *
+ * If any running sum would overflow 64 bits the functions return false,
+ * and the caller must fall back to gnc_numeric arithmetic, which is exact
+ * to 128 bits.
+ */
+
+#ifndef GNC_NUMERIC_SUM_HPP
+#define GNC_NUMERIC_SUM_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+/** Compute the running sums of an array of numerators.
+ * @param nums The numerators.
+ * @param count The number of numerators.
+ * @param start The value to which the numerators are added.
+ * @param sums Receives start + nums[0] + ... + nums[i] at index i. It must
+ * have room for count values and may be the same array as nums.
+ * @return true on success, false if a running sum overflowed. The
+ * contents of sums are then unspecified.
+ */
+bool gnc_numeric_prefix_sums (const int64_t *nums, size_t count,
+                              int64_t start, int64_t *sums) noexcept;
+
+/** Compute the sum of an array of numerators.
+ * @param nums The numerators.
+ * @param count The number of numerators.
+ * @param start The value to which the numerators are added.
+ * @param total Receives start plus the sum of the numerators.
+ * @return true on success, false if a running sum overflowed.
+ */
+bool gnc_numeric_sum (const int64_t *nums, size_t count, int64_t start,
+                      int64_t& total) noexcept;
+
+#endif /* GNC_NUMERIC_SUM_HPP */
+/** @} */
@@ -668,6 +668,14 @@ gnc_numeric_compare(gnc_numeric a, gnc_numeric b)
         return -1;
     }
 
+    /* The cross products of two 64-bit values always fit in 128 bits. */
+    if (a.denom > 0 && b.denom > 0)
+    {
+        GncInt128 lhs{GncInt128(a.num) * GncInt128(b.denom)};
+        GncInt128 rhs{GncInt128(b.num) * GncInt128(a.denom)};
+        return lhs < rhs ? -1 : rhs < lhs ? 1 : 0;
+    }
+
     GncNumeric an (a), bn (b);
 
     return an.cmp(bn);
@@ -706,6 +714,9 @@ gnc_numeric_equal(gnc_numeric a, gnc_numeric b)
         /* a valid, b invalid */
         return FALSE;
 
+    if (a.denom == b.denom)
+        return a.num == b.num;
+
     return gnc_numeric_compare (a, b) == 0;
 }
 
@@ -740,6 +751,32 @@ denom_lcd(gnc_numeric a, gnc_numeric b, int64_t denom, int how)
     return denom;
 }
 
+/* Nearly all additions and subtractions are of amounts or values in one
+ * commodity, so both operands have the commodity's SCU as denominator.
+ * When they share a denominator that the result keeps, the result is just
+ * the sum or difference of the numerators, which needs no rational
+ * arithmetic unless it overflows. Returns false if the caller must take
+ * the general path.
+ */
+static inline bool
+same_denom_add(gnc_numeric a, gnc_numeric b, gint64 denom, gint how,
+               bool subtract, gnc_numeric& result)
+{
+    auto dtype = how & GNC_NUMERIC_DENOM_MASK;
+    if (a.denom != b.denom || a.denom < 0 ||
+        (denom != GNC_DENOM_AUTO && denom != a.denom) ||
+        (dtype != GNC_HOW_DENOM_FIXED && dtype != GNC_HOW_DENOM_LCD))
+        return false;
+
+    int64_t num;
+    if (subtract ? __builtin_sub_overflow(a.num, b.num, &num) :
+        __builtin_add_overflow(a.num, b.num, &num))
+        return false;
+
+    result = {num, a.denom};
+    return true;
+}
+
 /* *******************************************************************
  *  gnc_numeric_add
  ********************************************************************/
@@ -752,6 +789,9 @@ gnc_numeric_add(gnc_numeric a, gnc_numeric b,
     {
         return gnc_numeric_error(GNC_ERROR_ARG);
     }
+    gnc_numeric result;
+    if (same_denom_add(a, b, denom, how, false, result))
+        return result;
     try
     {
         denom = denom_lcd(a, b, denom, how);
@@ -805,6 +845,9 @@ gnc_numeric_sub(gnc_numeric a, gnc_numeric b,
     {
         return gnc_numeric_error(GNC_ERROR_ARG);
     }
+    gnc_numeric result;
+    if (same_denom_add(a, b, denom, how, true, result))
+        return result;
     try
     {
         denom = denom_lcd(a, b, denom, how);
@@ -65,6 +65,9 @@ void gnc_clear_current_session()
         xaccLogDisable();
         qof_session_destroy(current_session);
         xaccLogEnable();
+        /* The journal belongs to the session's book; the next one to be
+         * edited starts a new journal. */
+        xaccCloseLog();
         current_session = NULL;
     }
 }
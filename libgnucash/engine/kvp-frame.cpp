@@ -41,12 +41,13 @@ static QofLogModule log_module = "qof.kvp";
 
 KvpFrameImpl::KvpFrameImpl(const KvpFrameImpl & rhs) noexcept
 {
+    m_valuemap.reserve(rhs.m_valuemap.size());
     std::for_each(rhs.m_valuemap.begin(), rhs.m_valuemap.end(),
         [this](const map_type::value_type & a)
         {
-            auto key = qof_string_cache_insert(a.first);
+            auto key = static_cast<const char*>(qof_string_cache_insert(a.first));
             auto val = new KvpValueImpl(*a.second);
-            this->m_valuemap.insert({key,val});
+            this->m_valuemap.emplace_back(key, val);
         }
     );
 }
@@ -62,37 +63,63 @@ KvpFrameImpl::~KvpFrameImpl() noexcept
     m_valuemap.clear();
 }
 
+static inline bool
+slot_key_less (const KvpFrameImpl::value_type & a, const char * key)
+{
+    return KvpFrameImpl::cstring_comparer{}(a.first, key);
+}
+
+KvpFrameImpl::map_type::iterator
+KvpFrameImpl::find (const char * key) noexcept
+{
+    auto spot = std::lower_bound (m_valuemap.begin (), m_valuemap.end (),
+                                  key, slot_key_less);
+    if (spot != m_valuemap.end () &&
+        (spot->first == key || std::strcmp (spot->first, key) == 0))
+        return spot;
+    return m_valuemap.end ();
+}
+
+KvpFrameImpl::map_type::const_iterator
+KvpFrameImpl::find (const char * key) const noexcept
+{
+    auto spot = std::lower_bound (m_valuemap.begin (), m_valuemap.end (),
+                                  key, slot_key_less);
+    if (spot != m_valuemap.end () &&
+        (spot->first == key || std::strcmp (spot->first, key) == 0))
+        return spot;
+    return m_valuemap.end ();
+}
+
 KvpFrame *
-KvpFrame::get_child_frame_or_nullptr (Path const & path) noexcept
+KvpFrame::get_child_frame_or_nullptr (PathIter first, PathIter last) noexcept
 {
-    if (!path.size ())
-        return this;
-    auto key = path.front ();
-    auto map_iter = m_valuemap.find (key.c_str ());
-    if (map_iter == m_valuemap.end ())
-        return nullptr;
-    auto child = map_iter->second->get <KvpFrame *> ();
-    if (!child)
-        return nullptr;
-    Path send;
-    std::copy (path.begin () + 1, path.end (), std::back_inserter (send));
-    return child->get_child_frame_or_nullptr (send);
+    auto frame = this;
+    for (; first != last; ++first)
+    {
+        auto map_iter = frame->find (first->c_str ());
+        if (map_iter == frame->m_valuemap.end ())
+            return nullptr;
+        frame = map_iter->second->get <KvpFrame *> ();
+        if (!frame)
+            return nullptr;
+    }
+    return frame;
 }
 
 KvpFrame *
-KvpFrame::get_child_frame_or_create (Path const & path) noexcept
+KvpFrame::get_child_frame_or_create (PathIter first, PathIter last) noexcept
 {
-    if (!path.size ())
-        return this;
-    auto key = path.front ();
-    auto spot = m_valuemap.find (key.c_str ());
-    if (spot == m_valuemap.end () || spot->second->get_type () != KvpValue::Type::FRAME)
-        delete set_impl (key.c_str (), new KvpValue {new KvpFrame});
-    Path send;
-    std::copy (path.begin () + 1, path.end (), std::back_inserter (send));
-    auto child_val = m_valuemap.at (key.c_str ());
-    auto child = child_val->get <KvpFrame *> ();
-    return child->get_child_frame_or_create (send);
+    auto frame = this;
+    for (; first != last; ++first)
+    {
+        auto spot = frame->find (first->c_str ());
+        if (spot == frame->m_valuemap.end () ||
+            spot->second->get_type () != KvpValue::Type::FRAME)
+            delete frame->set_impl (*first, new KvpValue {new KvpFrame});
+        frame = frame->find (first->c_str ())->second->get <KvpFrame *> ();
+    }
+    return frame;
 }
 
 
@@ -100,54 +127,69 @@ KvpValue *
 KvpFrame::set_impl (std::string const & key, KvpValue * value) noexcept
 {
     KvpValue * ret {};
-    auto spot = m_valuemap.find (key.c_str ());
-    if (spot != m_valuemap.end ())
-    {
-        qof_string_cache_remove (spot->first);
+    auto spot = std::lower_bound (m_valuemap.begin (), m_valuemap.end (),
+                                  key.c_str (), slot_key_less);
+    auto found = spot != m_valuemap.end () &&
+        std::strcmp (spot->first, key.c_str ()) == 0;
+    if (found)
         ret = spot->second;
-        m_valuemap.erase (spot);
-    }
     if (value)
     {
-        auto cachedkey = static_cast <char const *> (qof_string_cache_insert (key.c_str ()));
-        m_valuemap.emplace (cachedkey, value);
+        if (found)
+        {
+            spot->second = value;
+        }
+        else
+        {
+            auto cachedkey = static_cast <char const *> (qof_string_cache_insert (key.c_str ()));
+            m_valuemap.emplace (spot, cachedkey, value);
+        }
+    }
+    else if (found)
+    {
+        qof_string_cache_remove (spot->first);
+        m_valuemap.erase (spot);
     }
     return ret;
 }
 
 KvpValue *
-KvpFrameImpl::set (Path path, KvpValue* value) noexcept
+KvpFrameImpl::set (Path const & path, KvpValue* value) noexcept
 {
     if (path.empty())
         return nullptr;
-    auto key = path.back ();
-    path.pop_back ();
-    auto target = get_child_frame_or_nullptr (path);
+    auto target = get_child_frame_or_nullptr (path.begin (), path.end () - 1);
     if (!target)
         return nullptr;
-    return target->set_impl (key, value);
+    return target->set_impl (path.back (), value);
 }
 
 KvpValue *
-KvpFrameImpl::set_path (Path path, KvpValue* value) noexcept
+KvpFrameImpl::set_path (Path const & path, KvpValue* value) noexcept
 {
-    auto key = path.back();
-    path.pop_back();
-    auto target = get_child_frame_or_create (path);
+    if (path.empty())
+        return nullptr;
+    auto target = get_child_frame_or_create (path.begin (), path.end () - 1);
     if (!target)
         return nullptr;
-    return target->set_impl (key, value);
+    return target->set_impl (path.back (), value);
+}
+
+KvpValue *
+KvpFrameImpl::get_slot (Path const & path) noexcept
+{
+    return get_slot (path.begin (), path.end ());
 }
 
 KvpValue *
-KvpFrameImpl::get_slot (Path path) noexcept
+KvpFrameImpl::get_slot (PathIter first, PathIter last) noexcept
 {
-    auto key = path.back();
-    path.pop_back();
-    auto target = get_child_frame_or_nullptr (path);
+    if (first == last)
+        return nullptr;
+    auto target = get_child_frame_or_nullptr (first, last - 1);
     if (!target)
         return nullptr;
-    auto spot = target->m_valuemap.find (key.c_str ());
+    auto spot = target->find ((last - 1)->c_str ());
     if (spot != target->m_valuemap.end ())
         return spot->second;
     return nullptr;
@@ -216,7 +258,7 @@ int compare(const KvpFrameImpl & one, const KvpFrameImpl & two) noexcept
 {
     for (const auto & a : one.m_valuemap)
     {
-        auto otherspot = two.m_valuemap.find(a.first);
+        auto otherspot = two.find(a.first);
         if (otherspot == two.m_valuemap.end())
         {
             return 1;
@@ -85,7 +85,6 @@
 #define GNC_KVP_FRAME_TYPE
 
 #include "kvp-value.hpp"
-#include <map>
 #include <string>
 #include <vector>
 #include <cstring>
@@ -93,6 +92,10 @@
 #include <iostream>
 using Path = std::vector<std::string>;
 using KvpEntry = std::pair <std::vector <std::string>, KvpValue*>;
+/** A pair of PathIters names a run of keys in a Path, used to walk a path
+ * through nested frames without copying the remaining keys.
+ */
+using PathIter = Path::const_iterator;
 
 /** Implements KvpFrame.
  *  It's a struct because QofInstance needs to use the typename to declare a
@@ -111,14 +114,21 @@ struct KvpFrameImpl
     class cstring_comparer
     {
     public:
-	/* Returns true if one is less than two. */
+	/* Returns true if one is less than two. Keys are interned in the
+	 * string cache, so identical pointers are identical keys.
+	 */
 	bool operator()(const char * one, const char * two) const
 	    {
-		auto ret = std::strcmp(one, two) < 0;
-		return ret;
+		return one != two && std::strcmp(one, two) < 0;
 	    }
     };
-    using map_type = std::map<const char *, KvpValue*, cstring_comparer>;
+    /* Frames are small, usually no more than a handful of slots, so the
+     * slots are kept in a vector sorted by key instead of a node-based
+     * map. This keeps a frame in one allocation and lookups in a single
+     * cache-friendly binary search.
+     */
+    using value_type = std::pair<const char *, KvpValue*>;
+    using map_type = std::vector<value_type>;
 
     public:
     KvpFrameImpl() noexcept {};
@@ -156,7 +166,7 @@ struct KvpFrameImpl
      * @param newvalue: The value to set at key.
      * @return The old value if there was one or nullptr.
      */
-    KvpValue* set(Path path, KvpValue* newvalue) noexcept;
+    KvpValue* set(Path const & path, KvpValue* newvalue) noexcept;
      /**
      * Set the value with the key in a subframe following the keys in path,
      * replacing and returning the old value if it exists or nullptr if it
@@ -168,7 +178,7 @@ struct KvpFrameImpl
      * @param newvalue: The value to set at key.
      * @return The old value if there was one or nullptr.
      */
-    KvpValue* set_path(Path path, KvpValue* newvalue) noexcept;
+    KvpValue* set_path(Path const & path, KvpValue* newvalue) noexcept;
     /**
      * Make a string representation of the frame. Mostly useful for debugging.
      * @return A std::string representing the frame and all its children.
@@ -191,7 +201,16 @@ struct KvpFrameImpl
      * @param path: Path of keys leading to the desired value.
      * @return The value at the key or nullptr.
      */
-    KvpValue* get_slot(Path keys) noexcept;
+    KvpValue* get_slot(Path const & keys) noexcept;
+
+    /** Get the value for the tail of a range of keys or nullptr if it doesn't
+     * exist. Lets callers holding a precomputed Path look up a value in a
+     * subframe without allocating.
+     * @param first: Iterator to the first key of the path.
+     * @param last: Iterator past the last key of the path.
+     * @return The value at the key or nullptr.
+     */
+    KvpValue* get_slot(PathIter first, PathIter last) noexcept;
 
     /** The function should be of the form:
      * <anything> func (char const *, KvpValue *, data_type &);
@@ -232,8 +251,10 @@ struct KvpFrameImpl
     private:
     map_type m_valuemap;
 
-    KvpFrame * get_child_frame_or_nullptr (Path const &) noexcept;
-    KvpFrame * get_child_frame_or_create (Path const &) noexcept;
+    map_type::iterator find (const char *) noexcept;
+    map_type::const_iterator find (const char *) const noexcept;
+    KvpFrame * get_child_frame_or_nullptr (PathIter, PathIter) noexcept;
+    KvpFrame * get_child_frame_or_create (PathIter, PathIter) noexcept;
     void flatten_kvp_impl(std::vector <std::string>, std::vector <KvpEntry> &) const noexcept;
     KvpValue * set_impl (std::string const &, KvpValue *) noexcept;
 };
@@ -242,14 +263,20 @@ template<typename func_type, typename data_type>
 void KvpFrame::for_each_slot_prefix(std::string const & prefix,
         func_type const & func, data_type & data) const noexcept
 {
-    std::for_each (m_valuemap.begin(), m_valuemap.end(),
-        [&prefix,&func,&data](const KvpFrameImpl::map_type::value_type & a)
-        {
-            /* Testing for prefix matching */
-            if (strncmp(a.first, prefix.c_str(), prefix.size()) == 0)
-                func (&a.first[prefix.size()], a.second, data);
-        }
-    );
+    /* The slots are sorted, so every key beginning with prefix follows the
+     * first key not less than prefix in one contiguous run.
+     */
+    auto first = std::lower_bound (m_valuemap.begin(), m_valuemap.end(),
+                                   prefix.c_str(),
+                                   [](const value_type & a, const char * key)
+                                   { return std::strcmp (a.first, key) < 0; });
+    for (auto iter = first; iter != m_valuemap.end(); ++iter)
+    {
+        /* Testing for prefix matching */
+        if (strncmp(iter->first, prefix.c_str(), prefix.size()) != 0)
+            break;
+        func (&iter->first[prefix.size()], iter->second, data);
+    }
 }
 
 template <typename func_type>
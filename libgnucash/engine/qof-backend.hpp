@@ -244,6 +244,15 @@ public:
 /** Perform a sync in a way that prevents data loss on a DBI backend.
  */
     virtual void safe_sync(QofBook *) = 0;
+/** Save the changes made since the last save without the user asking
+ *  for it.  Backends that can record just the changes cheaply may do so;
+ *  the rest do a sync.
+ */
+    virtual void autosave(QofBook *book) { sync(book); }
+/** True when autosave has recorded changes that a sync would still write
+ *  out in full, so an explicit save isn't a no-op on a clean book.
+ */
+    virtual bool autosave_pending() const { return false; }
 /**   Extract the chart of accounts from the current database and create a new
  *   database with it. Implemented only in the XML backend at present.
  */
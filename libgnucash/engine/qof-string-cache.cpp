@@ -32,6 +32,8 @@
 #include <ctype.h>
 #include <stdlib.h>
 #include <string.h>
+#include <mutex>
+#include <unordered_map>
 #include "qof.h"
 
 /* Uncomment if you need to log anything.
@@ -40,40 +42,83 @@ static QofLogModule log_module = QOF_MOD_UTIL;
 /* =================================================================== */
 /* The QOF string cache                                                */
 /*                                                                     */
-/* The cache is a GHashTable where a copy of the string is the key,    */
-/* and a ref count is the value                                        */
+/* The cache interns each string in an atom holding the string and its */
+/* refcount.  The atoms are spread over shards by hash, each with its  */
+/* own lock, so threads inserting different strings rarely wait for   */
+/* each other.  An atom doesn't move while it's referenced, so equal   */
+/* cached strings are always the same pointer.                         */
 /* =================================================================== */
 
-static GHashTable* qof_string_cache = NULL;
+struct StringAtom
+{
+    guint refcount;
+    guint hash;
+    gsize size;
+    char str[1];
+};
+
+/* The key an atom is found by.  It carries the hash so the string is
+ * only hashed once, to pick the shard. */
+struct AtomKey
+{
+    const char *str;
+    guint hash;
+};
 
-static GHashTable*
-qof_get_string_cache(void)
+struct AtomKeyHash
 {
-    if (!qof_string_cache)
+    size_t operator()(const AtomKey& key) const noexcept { return key.hash; }
+};
+
+struct AtomKeyEqual
+{
+    bool operator()(const AtomKey& a, const AtomKey& b) const noexcept
     {
-        qof_string_cache = g_hash_table_new_full(
-                               g_str_hash,               /* hash_func          */
-                               g_str_equal,              /* key_equal_func     */
-                               g_free,                   /* key_destroy_func   */
-                               g_free);                  /* value_destroy_func */
+        return a.hash == b.hash && (a.str == b.str || strcmp (a.str, b.str) == 0);
     }
-    return qof_string_cache;
+};
+
+using AtomMap = std::unordered_map<AtomKey, StringAtom*, AtomKeyHash, AtomKeyEqual>;
+
+struct CacheShard
+{
+    std::mutex mutex;
+    AtomMap atoms;
+    guint64 hits;
+    guint64 misses;
+    gsize bytes;
+};
+
+#define CACHE_SHARD_BITS 5
+#define CACHE_SHARDS (1 << CACHE_SHARD_BITS)
+
+static CacheShard qof_string_cache[CACHE_SHARDS];
+
+static CacheShard&
+cache_shard (guint hash)
+{
+    /* The low bits pick the bucket within the shard, so use the high
+     * ones to pick the shard. */
+    return qof_string_cache[(hash * 2654435761u) >> (32 - CACHE_SHARD_BITS)];
 }
 
 void
 qof_string_cache_init(void)
 {
-    (void)qof_get_string_cache();
 }
 
 void
 qof_string_cache_destroy (void)
 {
-    if (qof_string_cache)
+    for (auto& shard : qof_string_cache)
     {
-        g_hash_table_destroy(qof_string_cache);
+        std::lock_guard<std::mutex> lock (shard.mutex);
+        for (auto& entry : shard.atoms)
+            g_free (entry.second);
+        shard.atoms.clear ();
+        shard.hits = shard.misses = 0;
+        shard.bytes = 0;
     }
-    qof_string_cache = NULL;
 }
 
 /* If the key exists in the cache, check the refcount.  If 1, just
@@ -83,19 +128,22 @@ qof_string_cache_remove(const char * key)
 {
     if (key && key[0] != 0)
     {
-        GHashTable* cache = qof_get_string_cache();
-        gpointer value;
-        gpointer cache_key;
-        if (g_hash_table_lookup_extended(cache, key, &cache_key, &value))
+        AtomKey atom_key {key, g_str_hash (key)};
+        auto& shard = cache_shard (atom_key.hash);
+        std::lock_guard<std::mutex> lock (shard.mutex);
+        auto iter = shard.atoms.find (atom_key);
+        if (iter != shard.atoms.end ())
         {
-            guint* refcount = (guint*)value;
-            if (*refcount == 1)
+            StringAtom* atom = iter->second;
+            if (atom->refcount == 1)
             {
-                g_hash_table_remove(cache, key);
+                shard.atoms.erase (iter);
+                shard.bytes -= atom->size;
+                g_free (atom);
             }
             else
             {
-                --(*refcount);
+                --atom->refcount;
             }
         }
     }
@@ -113,23 +161,28 @@ qof_string_cache_insert(const char * key)
             return "";
         }
 
-        GHashTable* cache = qof_get_string_cache();
-        gpointer value;
-        gpointer cache_key;
-        if (g_hash_table_lookup_extended(cache, key, &cache_key, &value))
-        {
-            guint* refcount = (guint*)value;
-            ++(*refcount);
-            return static_cast <char *> (cache_key);
-        }
-        else
+        AtomKey atom_key {key, g_str_hash (key)};
+        auto& shard = cache_shard (atom_key.hash);
+        std::lock_guard<std::mutex> lock (shard.mutex);
+        auto iter = shard.atoms.find (atom_key);
+        if (iter != shard.atoms.end ())
         {
-            gpointer new_key = g_strdup(static_cast<const char*>(key));
-            guint* refcount = static_cast<unsigned int*>(g_malloc(sizeof(guint)));
-            *refcount = 1;
-            g_hash_table_insert(cache, new_key, refcount);
-            return static_cast <char *> (new_key);
+            ++shard.hits;
+            ++iter->second->refcount;
+            return iter->second->str;
         }
+
+        auto len = strlen (key);
+        auto size = offsetof (StringAtom, str) + len + 1;
+        auto atom = static_cast<StringAtom*>(g_malloc (size));
+        atom->refcount = 1;
+        atom->hash = atom_key.hash;
+        atom->size = size;
+        memcpy (atom->str, key, len + 1);
+        shard.atoms.emplace (AtomKey {atom->str, atom->hash}, atom);
+        ++shard.misses;
+        shard.bytes += size;
+        return atom->str;
     }
     return NULL;
 }
@@ -141,4 +194,20 @@ qof_string_cache_replace(char const * dst, char const * src)
     qof_string_cache_remove (dst);
     return tmp;
 }
+
+void
+qof_string_cache_get_stats (QofStringCacheStats *stats)
+{
+    g_return_if_fail (stats);
+
+    memset (stats, 0, sizeof (*stats));
+    for (auto& shard : qof_string_cache)
+    {
+        std::lock_guard<std::mutex> lock (shard.mutex);
+        stats->hits += shard.hits;
+        stats->misses += shard.misses;
+        stats->strings += shard.atoms.size ();
+        stats->bytes += shard.bytes;
+    }
+}
 /* ************************ END OF FILE ***************************** */
@@ -64,9 +64,12 @@ extern "C"
  * function.
  *
  * Note that all the work is done when inserting or removing.  Once
- * cached the strings are just plain C strings.
+ * cached the strings are just plain C strings.  Equal cached strings
+ * are the same pointer, so comparing two cached strings can start by
+ * comparing the pointers.
  *
- * The string cache is demand-created on first use.
+ * The string cache is demand-created on first use.  It may be used
+ * from several threads at once.
  *
  **/
 
@@ -90,6 +93,19 @@ const char * qof_string_cache_insert(const char * key);
  */
 const char * qof_string_cache_replace(const char * dst, const char * src);
 
+/** Counters for the string cache. */
+typedef struct
+{
+    guint64 hits;    /**< inserts that found the string already cached */
+    guint64 misses;  /**< inserts that added the string to the cache */
+    gsize strings;   /**< strings in the cache now */
+    gsize bytes;     /**< memory held by those strings */
+} QofStringCacheStats;
+
+/** Fills in @a stats with the counters since the cache was last
+ *  destroyed. */
+void qof_string_cache_get_stats (QofStringCacheStats *stats);
+
 #define CACHE_INSERT(str) qof_string_cache_insert((str))
 #define CACHE_REMOVE(str) qof_string_cache_remove((str))
 
@@ -121,6 +121,7 @@ qof_book_init (QofBook *book)
     book->read_only = FALSE;
     book->session_dirty = FALSE;
     book->version = 0;
+    book->mutation_count = 0;
     book->cached_num_field_source_isvalid = FALSE;
     book->cached_num_days_autoreadonly_isvalid = FALSE;
 
@@ -425,6 +426,20 @@ qof_book_get_session_dirty_time (const QofBook *book)
     return book->dirty_time;
 }
 
+guint64
+qof_book_get_mutation_count (const QofBook *book)
+{
+    g_return_val_if_fail (book, 0);
+    return book->mutation_count;
+}
+
+void
+qof_book_bump_mutation_count (QofBook *book)
+{
+    if (book)
+        ++book->mutation_count;
+}
+
 void
 qof_book_set_dirty_cb(QofBook *book, QofBookDirtyCB cb, gpointer user_data)
 {
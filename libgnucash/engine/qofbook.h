@@ -101,6 +101,11 @@ struct _QofBook
      * indicator. It should only be used when session_saved is FALSE. */
     time64 dirty_time;
 
+    /* Count of instance commits since the book was created. It only
+     * ever increases, so it can be used to tell whether anything in
+     * the book has changed since some earlier point. */
+    guint64 mutation_count;
+
     /* This callback function is called any time the book dirty flag
      * changes state. Both clean->dirty and dirty->clean transitions
      * trigger a callback. */
@@ -345,6 +350,19 @@ void qof_book_mark_session_dirty(QofBook *book);
 /** Retrieve the earliest modification time on the book. */
 time64 qof_book_get_session_dirty_time(const QofBook *book);
 
+/** Retrieve the book's mutation count. It is incremented whenever an
+ *    instance in the book commits a change, and never decreases, so two
+ *    equal counts mean nothing in the book changed in between. It isn't
+ *    saved with the book and starts from zero after each load.
+ */
+guint64 qof_book_get_mutation_count(const QofBook *book);
+
+/** Increment the book's mutation count. Called by
+ *    qof_commit_edit_part2(); there is normally no need to call it
+ *    directly.
+ */
+void qof_book_bump_mutation_count(QofBook *book);
+
 /** Set the function to call when a book transitions from clean to
  *    dirty, or vice versa.
  */
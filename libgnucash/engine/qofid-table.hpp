@@ -0,0 +1,204 @@
+/********************************************************************\
+ * qofid-table.hpp -- Open-addressing GncGUID hash table            *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+ *                                                                  *
+\********************************************************************/
+/** @addtogroup Entity
+ * @{
+ */
+/** @file qofid-table.hpp
+ * @brief Hash table mapping GncGUIDs to entities for QofCollection.
+ *
+ * The table uses linear probing over a power-of-two array of slots that
+ * hold the 16-byte GUID inline next to the entity pointer, so a lookup is
+ * one hash and, usually, one cache line. GUIDs are random, so the hash is
+ * simply the two 64-bit halves of the GUID folded together and spread by a
+ * multiplicative constant. Removal uses backward-shift deletion, so there
+ * are no tombstones and lookups never degrade after many removals.
+ *
+ * The table doesn't own the entities it points to. A null value marks an
+ * empty slot, so null values can't be stored.
+ */
+
+#ifndef QOFID_TABLE_HPP
+#define QOFID_TABLE_HPP
+
+#include "guid.h"
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+template <typename T>
+class QofGuidTable
+{
+public:
+    QofGuidTable() = default;
+    QofGuidTable(const QofGuidTable&) = delete;
+    QofGuidTable& operator=(const QofGuidTable&) = delete;
+
+    /** @return the number of entries in the table. */
+    size_t size() const noexcept { return m_size; }
+
+    /** Ensure that count entries fit without rehashing. Used to size the
+     * table up front when the number of entities to be loaded is known.
+     * @param count: The number of entries expected.
+     */
+    void reserve(size_t count)
+    {
+        auto wanted = s_min_capacity;
+        while (wanted - wanted / 4 < count)
+            wanted <<= 1;
+        if (wanted > m_slots.size())
+            rehash(wanted);
+    }
+
+    /** Find the entity with the given GUID.
+     * @return the entity or nullptr if it isn't in the table.
+     */
+    T* lookup(const GncGUID& guid) const noexcept
+    {
+        if (!m_size)
+            return nullptr;
+        for (auto idx = home(guid);; idx = next(idx))
+        {
+            auto& slot{m_slots[idx]};
+            if (!slot.value)
+                return nullptr;
+            if (equal(slot.guid, guid))
+                return slot.value;
+        }
+    }
+
+    /** Insert the entity with the given GUID, replacing any entity already
+     * stored with it.
+     */
+    void insert(const GncGUID& guid, T* value)
+    {
+        if (!value)
+            return;
+        if (m_size + 1 > m_slots.size() - m_slots.size() / 4)
+            rehash(m_slots.empty() ? s_min_capacity : m_slots.size() * 2);
+        for (auto idx = home(guid);; idx = next(idx))
+        {
+            auto& slot{m_slots[idx]};
+            if (!slot.value)
+            {
+                slot.guid = guid;
+                slot.value = value;
+                ++m_size;
+                return;
+            }
+            if (equal(slot.guid, guid))
+            {
+                slot.value = value;
+                return;
+            }
+        }
+    }
+
+    /** Remove the entry with the given GUID.
+     * @return true if there was such an entry.
+     */
+    bool remove(const GncGUID& guid) noexcept
+    {
+        if (!m_size)
+            return false;
+        auto idx = home(guid);
+        for (;; idx = next(idx))
+        {
+            if (!m_slots[idx].value)
+                return false;
+            if (equal(m_slots[idx].guid, guid))
+                break;
+        }
+        /* Shift back any following entries in the same probe run that
+         * would no longer be reachable past the hole.
+         */
+        auto hole = idx;
+        for (auto cur = next(idx); m_slots[cur].value; cur = next(cur))
+        {
+            auto want = home(m_slots[cur].guid);
+            if (((cur - want) & mask()) >= ((cur - hole) & mask()))
+            {
+                m_slots[hole] = m_slots[cur];
+                hole = cur;
+            }
+        }
+        m_slots[hole] = Slot{};
+        --m_size;
+        return true;
+    }
+
+    /** Call func with each value in the table. The values are collected
+     * before any call is made, so func may insert or remove entries.
+     */
+    template <typename Func>
+    void for_each(Func&& func) const
+    {
+        std::vector<T*> values;
+        values.reserve(m_size);
+        for (const auto& slot : m_slots)
+            if (slot.value)
+                values.push_back(slot.value);
+        for (auto value : values)
+            func(value);
+    }
+
+private:
+    struct Slot
+    {
+        GncGUID guid;
+        T* value = nullptr;
+    };
+
+    static constexpr size_t s_min_capacity = 16;
+
+    size_t mask() const noexcept { return m_slots.size() - 1; }
+    size_t next(size_t idx) const noexcept { return (idx + 1) & mask(); }
+
+    size_t home(const GncGUID& guid) const noexcept
+    {
+        uint64_t lo, hi;
+        std::memcpy(&lo, guid.reserved, sizeof(lo));
+        std::memcpy(&hi, guid.reserved + sizeof(lo), sizeof(hi));
+        return static_cast<size_t>((lo ^ hi) * UINT64_C(0x9e3779b97f4a7c15)
+                                   >> 32) & mask();
+    }
+
+    static bool equal(const GncGUID& a, const GncGUID& b) noexcept
+    {
+        return std::memcmp(a.reserved, b.reserved, GUID_DATA_SIZE) == 0;
+    }
+
+    void rehash(size_t capacity)
+    {
+        std::vector<Slot> old(capacity);
+        old.swap(m_slots);
+        m_size = 0;
+        for (const auto& slot : old)
+            if (slot.value)
+                insert(slot.guid, slot.value);
+    }
+
+    std::vector<Slot> m_slots;
+    size_t m_size = 0;
+};
+
+#endif /* QOFID_TABLE_HPP */
+/** @} */
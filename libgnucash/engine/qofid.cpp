@@ -30,6 +30,7 @@
 #include "qof.h"
 #include "qofid-p.h"
 #include "qofinstance-p.h"
+#include "qofid-table.hpp"
 
 static QofLogModule log_module = QOF_MOD_ENGINE;
 
@@ -38,7 +39,7 @@ struct QofCollection_s
     QofIdType    e_type;
     gboolean     is_dirty;
 
-    GHashTable * hash_of_entities;
+    QofGuidTable<QofInstance> * hash_of_entities;
     gpointer     data;       /* place where object class can hang arbitrary data */
 };
 
@@ -50,7 +51,7 @@ qof_collection_new (QofIdType type)
     QofCollection *col;
     col = g_new0(QofCollection, 1);
     col->e_type = static_cast<QofIdType>(CACHE_INSERT (type));
-    col->hash_of_entities = guid_hash_table_new();
+    col->hash_of_entities = new QofGuidTable<QofInstance>;
     col->data = NULL;
     return col;
 }
@@ -59,7 +60,7 @@ void
 qof_collection_destroy (QofCollection *col)
 {
     CACHE_REMOVE (col->e_type);
-    g_hash_table_destroy(col->hash_of_entities);
+    delete col->hash_of_entities;
     col->e_type = NULL;
     col->hash_of_entities = NULL;
     col->data = NULL;   /** XXX there should be a destroy notifier for this */
@@ -87,7 +88,7 @@ qof_collection_remove_entity (QofInstance *ent)
     col = qof_instance_get_collection(ent);
     if (!col) return;
     guid = qof_instance_get_guid(ent);
-    g_hash_table_remove (col->hash_of_entities, guid);
+    col->hash_of_entities->remove (*guid);
     qof_instance_set_collection(ent, NULL);
 }
 
@@ -101,7 +102,7 @@ qof_collection_insert_entity (QofCollection *col, QofInstance *ent)
     if (guid_equal(guid, guid_null())) return;
     g_return_if_fail (col->e_type == ent->e_type);
     qof_collection_remove_entity (ent);
-    g_hash_table_insert (col->hash_of_entities, (gpointer)guid, ent);
+    col->hash_of_entities->insert (*guid, ent);
     qof_instance_set_collection(ent, col);
 }
 
@@ -127,7 +128,7 @@ qof_collection_add_entity (QofCollection *coll, QofInstance *ent)
     {
         return FALSE;
     }
-    g_hash_table_insert (coll->hash_of_entities, (gpointer)guid, ent);
+    coll->hash_of_entities->insert (*guid, ent);
     return TRUE;
 }
 
@@ -211,12 +212,9 @@ qof_collection_compare (QofCollection *target, QofCollection *merge)
 QofInstance *
 qof_collection_lookup_entity (const QofCollection *col, const GncGUID * guid)
 {
-    QofInstance *ent;
     g_return_val_if_fail (col, NULL);
     if (guid == NULL) return NULL;
-    ent = static_cast<QofInstance*>(g_hash_table_lookup (col->hash_of_entities,
-							 guid));
-    return ent;
+    return col->hash_of_entities->lookup (*guid);
 }
 
 QofCollection *
@@ -242,10 +240,14 @@ qof_collection_from_glist (QofIdType type, const GList *glist)
 guint
 qof_collection_count (const QofCollection *col)
 {
-    guint c;
+    return col->hash_of_entities->size();
+}
 
-    c = g_hash_table_size(col->hash_of_entities);
-    return c;
+void
+qof_collection_reserve (QofCollection *col, guint count)
+{
+    g_return_if_fail (col);
+    col->hash_of_entities->reserve (count);
 }
 
 /* =============================================================== */
@@ -301,40 +303,18 @@ qof_collection_set_data (QofCollection *col, gpointer user_data)
 
 /* =============================================================== */
 
-struct _qofid_iterate
-{
-    QofInstanceForeachCB      fcn;
-    gpointer                data;
-};
-
-static void
-foreach_cb (gpointer item, gpointer arg)
-{
-    struct _qofid_iterate *iter = static_cast<_qofid_iterate*>(arg);
-    QofInstance *ent = static_cast<QofInstance*>(item);
-
-    iter->fcn (ent, iter->data);
-}
-
 void
 qof_collection_foreach (const QofCollection *col, QofInstanceForeachCB cb_func,
                         gpointer user_data)
 {
-    struct _qofid_iterate iter;
-    GList *entries;
-
     g_return_if_fail (col);
     g_return_if_fail (cb_func);
 
-    iter.fcn = cb_func;
-    iter.data = user_data;
-
-    PINFO("Hash Table size of %s before is %d", col->e_type, g_hash_table_size(col->hash_of_entities));
+    PINFO("Hash Table size of %s before is %zu", col->e_type, col->hash_of_entities->size());
 
-    entries = g_hash_table_get_values (col->hash_of_entities);
-    g_list_foreach (entries, foreach_cb, &iter);
-    g_list_free (entries);
+    col->hash_of_entities->for_each ([cb_func, user_data](QofInstance *ent)
+                                     { cb_func (ent, user_data); });
 
-    PINFO("Hash Table size of %s after is %d", col->e_type, g_hash_table_size(col->hash_of_entities));
+    PINFO("Hash Table size of %s after is %zu", col->e_type, col->hash_of_entities->size());
 }
 /* =============================================================== */
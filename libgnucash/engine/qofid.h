@@ -118,7 +118,7 @@ print error message if its bad  */
 
 @param e_type QofIdType
 @param is_dirty gboolean
-@param hash_of_entities GHashTable
+@param hash_of_entities QofGuidTable
 @param data gpointer, place where object class can hang arbitrary data
 
 */
@@ -132,6 +132,10 @@ QofCollection * qof_collection_new (QofIdType type);
 /** return the number of entities in the collection. */
 guint qof_collection_count (const QofCollection *col);
 
+/** Make room for count entities in the collection so that loading a
+ *  known number of entities doesn't repeatedly grow the hash table. */
+void qof_collection_reserve (QofCollection *col, guint count);
+
 /** destroy the collection */
 void qof_collection_destroy (QofCollection *col);
 
@@ -90,6 +90,10 @@ void qof_instance_set_dirty(QofInstance* inst);
 
 /* reset the dirty flag */
 void qof_instance_mark_clean (QofInstance *);
+
+/* Clear the infant flag of an instance a backend has saved after
+ * qof_commit_edit_part2 returned, as one that queues its writes does. */
+void qof_instance_clear_infant (QofInstance *);
 /** Get the version number on this instance.  The version number is
  *  used to manage multi-user updates. */
 gint32 qof_instance_get_version (gconstpointer inst);
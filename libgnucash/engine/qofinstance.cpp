@@ -672,6 +672,13 @@ qof_instance_mark_clean (QofInstance *inst)
     GET_PRIVATE(inst)->dirty = FALSE;
 }
 
+void
+qof_instance_clear_infant (QofInstance *inst)
+{
+    if (!inst) return;
+    GET_PRIVATE(inst)->infant = FALSE;
+}
+
 void
 qof_instance_print_dirty (const QofInstance *inst, gpointer dummy)
 {
@@ -997,6 +1004,8 @@ qof_commit_edit_part2(QofInstance *inst,
       qof_collection_mark_dirty(priv->collection);
       qof_book_mark_session_dirty(priv->book);
     }
+    if (priv->dirty || priv->do_free)
+        qof_book_bump_mutation_count(priv->book);
 
     /* See if there's a backend.  If there is, invoke it. */
     auto be = qof_book_get_backend(priv->book);
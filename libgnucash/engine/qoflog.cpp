@@ -62,7 +62,8 @@
 #define NUM_CLOCKS 10
 
 static FILE *fout = NULL;
-static gchar* function_buffer = NULL;
+/* Per thread, as the backends log from worker threads. */
+static GPrivate function_buffer = G_PRIVATE_INIT (g_free);
 static gint qof_log_num_spaces = 0;
 static GLogFunc previous_handler = NULL;
 static gchar* qof_logger_format = NULL;
@@ -269,11 +270,7 @@ qof_log_shutdown (void)
         fout = NULL;
     }
 
-    if (function_buffer)
-    {
-        g_free(function_buffer);
-        function_buffer = NULL;
-    }
+    g_private_replace (&function_buffer, NULL);
 
     if (_modules != NULL)
     {
@@ -385,11 +382,9 @@ qof_log_prettify (const char *name)
     else
         p = buffer;
 
-    if (function_buffer)
-        g_free(function_buffer);
-    function_buffer = g_strdup(p);
+    g_private_replace (&function_buffer, g_strdup(p));
     g_free(buffer);
-    return function_buffer;
+    return static_cast<const char*>(g_private_get (&function_buffer));
 }
 
 void
@@ -849,6 +849,44 @@ GList * qof_query_run (QofQuery *q)
     return qof_query_run_internal(q, qof_query_run_cb, NULL);
 }
 
+/* Compile the query's terms and sorts if they have changed, as
+ * qof_query_run_internal does before running it. */
+static void
+query_compile_if_changed (QofQuery *q)
+{
+    if (!q->changed)
+        return;
+    query_clear_compiles (q);
+    compile_terms (q);
+    q->changed = 0;
+}
+
+gboolean qof_query_match_object (QofQuery *q, gpointer object)
+{
+    if (!q || !object) return FALSE;
+    g_return_val_if_fail (q->search_for, FALSE);
+
+    if (!QOF_CHECK_TYPE (object, q->search_for))
+        return FALSE;
+    if (!g_list_find (q->books,
+                      qof_instance_get_book (QOF_INSTANCE (object))))
+        return FALSE;
+
+    query_compile_if_changed (q);
+    return check_object (q, object) ? TRUE : FALSE;
+}
+
+gint qof_query_sort_compare (QofQuery *q, gconstpointer a, gconstpointer b)
+{
+    if (!q) return 0;
+
+    query_compile_if_changed (q);
+    if (!(q->primary_sort.comp_fcn || q->primary_sort.obj_cmp ||
+          (q->primary_sort.use_default && q->defaultSort)))
+        return 0;
+    return sort_func (a, b, q);
+}
+
 static void qof_query_run_subq_cb(QofQueryCB* qcb, gpointer cb_arg)
 {
     QofQuery* pq = static_cast<QofQuery*>(cb_arg);
@@ -227,6 +227,25 @@ GList * qof_query_run (QofQuery *query);
  */
 GList * qof_query_last_run (QofQuery *query);
 
+/** Check whether an object would be in the results of the query,
+ *  without running it over the books.  The object must match the
+ *  query's terms, be of the type searched for and belong to one of the
+ *  query's books.  max_results is not taken into account.
+ *
+ *  This lets a caller that keeps the results of a query update them as
+ *  objects change instead of re-running the query.
+ */
+gboolean qof_query_match_object (QofQuery *query, gpointer object);
+
+/** Compare two objects by the query's sort order, as qof_query_run
+ *  does when sorting its results.
+ *
+ *  @return a negative value, zero or a positive value as a sorts
+ *  before, with or after b.  Zero if the query has no sort order.
+ */
+gint qof_query_sort_compare (QofQuery *query, gconstpointer a,
+                             gconstpointer b);
+
 /** Perform a subquery, return the results.
  *  Instead of running over a book, the subquery runs over the results
  *  of the primary query.
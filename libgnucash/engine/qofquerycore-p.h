@@ -67,7 +67,7 @@ typedef struct
     QofQueryPredData	pd;
     QofStringMatch	options;
     gboolean		is_regex;
-    gchar *		matchstring;
+    const char *	matchstring;
     regex_t		compiled;
 } query_string_def, *query_string_t;
 
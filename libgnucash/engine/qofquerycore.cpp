@@ -170,7 +170,9 @@ string_match_predicate (gpointer object,
             }
             else
             {
-                if (g_strcmp0 (s, pdata->matchstring) == 0)
+                /* Both are usually cached, so equal means the same pointer. */
+                if (s == pdata->matchstring ||
+                    g_strcmp0 (s, pdata->matchstring) == 0)
                     ret = 1;
             }
         }
@@ -248,7 +250,7 @@ string_free_pdata (QofQueryPredData *pd)
     if (pdata->is_regex)
         regfree (&pdata->compiled);
 
-    g_free (pdata->matchstring);
+    CACHE_REMOVE (pdata->matchstring);
     g_free (pdata);
 }
 
@@ -272,7 +274,7 @@ string_predicate_equal (const QofQueryPredData *p1, const QofQueryPredData *p2)
 
     if (pd1->options != pd2->options) return FALSE;
     if (pd1->is_regex != pd2->is_regex) return FALSE;
-    return (g_strcmp0 (pd1->matchstring, pd2->matchstring) == 0);
+    return (pd1->matchstring == pd2->matchstring);
 }
 
 QofQueryPredData *
@@ -291,7 +293,7 @@ qof_query_string_predicate (QofQueryCompare how,
     pdata->pd.type_name = query_string_type;
     pdata->pd.how = how;
     pdata->options = options;
-    pdata->matchstring = g_strdup (str);
+    pdata->matchstring = CACHE_INSERT (str);
 
     if (is_regex)
     {
@@ -303,7 +305,7 @@ qof_query_string_predicate (QofQueryCompare how,
         rc = regcomp(&pdata->compiled, str, flags);
         if (rc)
         {
-            g_free(pdata->matchstring);
+            CACHE_REMOVE(pdata->matchstring);
             g_free(pdata);
             return NULL;
         }
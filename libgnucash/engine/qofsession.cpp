@@ -436,7 +436,23 @@ QofSessionImpl::is_saving () const noexcept
 void
 QofSessionImpl::save (QofPercentageFunc percentage_func) noexcept
 {
-    if (!qof_book_session_not_saved (m_book)) //Clean book, nothing to do.
+    save (percentage_func, &QofBackend::sync);
+}
+
+void
+QofSessionImpl::autosave (QofPercentageFunc percentage_func) noexcept
+{
+    save (percentage_func, &QofBackend::autosave);
+}
+
+void
+QofSessionImpl::save (QofPercentageFunc percentage_func,
+                      void (QofBackend::*write)(QofBook*)) noexcept
+{
+    /* A clean book has nothing to do, unless an explicit save has to write
+     * out what autosave only recorded. */
+    if (!qof_book_session_not_saved (m_book) &&
+        (write == &QofBackend::autosave || !autosave_pending ()))
         return;
     m_saving = true;
     ENTER ("sess=%p uri=%s", this, m_uri.c_str ());
@@ -453,7 +469,7 @@ QofSessionImpl::save (QofPercentageFunc percentage_func) noexcept
         if (qof_book_get_backend (m_book) != m_backend)
             qof_book_set_backend (m_book, m_backend);
         m_backend->set_percentage(percentage_func);
-        m_backend->sync(m_book);
+        (m_backend->*write)(m_book);
         auto err = m_backend->get_error();
         if (err != ERR_BACKEND_NO_ERR)
         {
@@ -515,6 +531,12 @@ QofSessionImpl::swap_books (QofSessionImpl & other) noexcept
     LEAVE (" ");
 }
 
+bool
+QofSessionImpl::autosave_pending () const noexcept
+{
+    return m_backend && m_backend->autosave_pending ();
+}
+
 bool
 QofSessionImpl::events_pending () const noexcept
 {
@@ -629,6 +651,14 @@ qof_session_save (QofSession *session,
     session->save (percentage_func);
 }
 
+void
+qof_session_autosave (QofSession *session,
+                      QofPercentageFunc percentage_func)
+{
+    if (!session) return;
+    session->autosave (percentage_func);
+}
+
 void
 qof_session_safe_save(QofSession *session, QofPercentageFunc percentage_func)
 {
@@ -643,6 +673,13 @@ qof_session_save_in_progress(const QofSession *session)
     return session->is_saving ();
 }
 
+gboolean
+qof_session_autosave_pending (const QofSession *session)
+{
+    if (!session) return FALSE;
+    return session->autosave_pending ();
+}
+
 void
 qof_session_end (QofSession *session)
 {
@@ -249,6 +249,13 @@ const char * qof_session_get_url (const QofSession *session);
 /* gboolean qof_session_not_saved(const QofSession *session); <- unimplemented */
 gboolean qof_session_save_in_progress(const QofSession *session);
 
+/**
+ * The qof_session_autosave_pending() routine returns TRUE if autosave has
+ *    recorded changes that the data file doesn't hold yet, so saving a
+ *    clean book still writes it out in full.
+ */
+gboolean qof_session_autosave_pending (const QofSession *session);
+
 /**
  * Returns the qof session's backend.
  */
@@ -263,6 +270,14 @@ QofBackend * qof_session_get_backend(const QofSession *session);
 void     qof_session_save (QofSession *session,
                            QofPercentageFunc percentage_func);
 
+/** The qof_session_autosave() method saves the session the way a timed
+ *    save should: the backend may record only what changed since the
+ *    last save instead of writing everything.  An explicit save by the
+ *    user should use qof_session_save().
+ */
+void     qof_session_autosave (QofSession *session,
+                               QofPercentageFunc percentage_func);
+
 /**
  * A special version of save used in the sql backend which moves the
  * existing tables aside, then saves everything to new tables, then
@@ -48,8 +48,10 @@ struct QofSessionImpl
     void ensure_all_data_loaded () noexcept;
     void load (QofPercentageFunc) noexcept;
     void save (QofPercentageFunc) noexcept;
+    void autosave (QofPercentageFunc) noexcept;
     void safe_save (QofPercentageFunc) noexcept;
     bool save_in_progress () const noexcept;
+    bool autosave_pending () const noexcept;
     bool export_session (QofSessionImpl & real_session, QofPercentageFunc) noexcept;
 
     bool events_pending () const noexcept;
@@ -84,6 +86,7 @@ private:
     void push_error (QofBackendError const err, std::string message) noexcept;
 
     void load_backend (std::string access_method) noexcept;
+    void save (QofPercentageFunc, void (QofBackend::*)(QofBook*)) noexcept;
 
     /* The backend. We store this during startup to avoid having to create a
      * book just to hold it.
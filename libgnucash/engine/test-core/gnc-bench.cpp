@@ -0,0 +1,655 @@
+/********************************************************************
+ * gnc-bench.cpp -- Engine performance benchmarks                   *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+ *                                                                  *
+\********************************************************************/
+/* gnc-bench builds a random book of the requested size with the
+ * generators in test-engine-stuff and times the engine operations that
+ * dominate real use: loading and saving, balance computation, queries,
+ * price lookups and scrubbing. The same seed always produces a book with
+ * the same shape, so runs from different builds can be compared. The
+ * results are written as JSON, e.g.
+ *
+ *   gnc-bench --accounts 500 --splits 200000 --output before.json
+ */
+
+#include <config.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <Account.hpp>
+#include <Query.h>
+#include <Scrub.h>
+#include <Split.h>
+#include <TransLog.h>
+#include <Transaction.h>
+#include <gnc-engine.h>
+#include <gnc-lot.h>
+#include <gnc-pricedb.h>
+#include <qof.h>
+
+#include "test-engine-stuff.h"
+#include <test-stuff.h>
+
+struct BenchConfig
+{
+    gint seed = 1;
+    gint accounts = 100;
+    gint splits = 10000;
+    gint prices = 1000;
+    gint lots = 100;
+    gint kvp_depth = 2;
+    gint kvp_elements = 4;
+    gint dates = 12;
+    gint iterations = 3;
+    gboolean no_xml = FALSE;
+    gboolean no_sql = FALSE;
+    gchar *dir = nullptr;
+    gchar *output = nullptr;
+};
+
+struct BenchResult
+{
+    std::string name;
+    std::vector<double> samples;
+    std::string error;
+};
+
+/* Each benchmark returns the time in milliseconds taken by the part of
+ * one iteration that is being measured. */
+using BenchFunc = std::function<double()>;
+
+template <typename F> static double
+elapsed_ms (F&& func)
+{
+    auto start = std::chrono::steady_clock::now ();
+    func ();
+    std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::steady_clock::now () - start;
+    return elapsed.count ();
+}
+
+static BenchResult
+run_bench (const char *name, gint iterations, const BenchFunc& func)
+{
+    BenchResult result{name, {}, {}};
+    g_printerr ("%s...\n", name);
+    try
+    {
+        for (auto i = 0; i < iterations; ++i)
+            result.samples.push_back (func ());
+    }
+    catch (const std::exception& err)
+    {
+        result.error = err.what ();
+    }
+    return result;
+}
+
+/* ================================================================= */
+/* Book generation */
+
+static void
+add_lots (QofBook *book, Account *root, gint num_lots)
+{
+    const gint splits_per_lot = 4;
+    auto accounts = gnc_account_get_descendants_sorted (root);
+    gint lots = 0;
+
+    for (auto node = accounts; node && lots < num_lots; node = g_list_next (node))
+    {
+        GNCLot *lot = nullptr;
+        gint in_lot = 0;
+
+        for (auto snode = xaccAccountGetSplitList (GNC_ACCOUNT (node->data));
+             snode; snode = g_list_next (snode))
+        {
+            auto split = static_cast<Split*>(snode->data);
+            if (xaccSplitGetLot (split))
+                continue;
+            if (!lot || in_lot == splits_per_lot)
+            {
+                if (lots == num_lots)
+                    break;
+                lot = gnc_lot_new (book);
+                in_lot = 0;
+                ++lots;
+            }
+            gnc_lot_add_split (lot, split);
+            ++in_lot;
+        }
+    }
+    g_list_free (accounts);
+}
+
+static void
+generate_book (QofBook *book, const BenchConfig& config)
+{
+    srand (config.seed);
+    random_character_include_funky_chars (FALSE);
+    set_max_kvp_depth (config.kvp_depth);
+    set_max_kvp_frame_elements (config.kvp_elements);
+    set_max_account_tree_depth (3);
+
+    auto root = get_random_account_tree (book);
+    while (gnc_account_n_descendants (root) < config.accounts)
+        get_random_account_tree (book);
+
+    auto splits = qof_book_get_collection (book, GNC_ID_SPLIT);
+    while (qof_collection_count (splits) < static_cast<guint>(config.splits))
+        add_random_transactions_to_book (book, 100);
+
+    auto pdb = gnc_pricedb_get_db (book);
+    while (gnc_pricedb_get_num_prices (pdb) < static_cast<guint>(config.prices))
+        make_random_pricedb (book, pdb);
+
+    add_lots (book, root, config.lots);
+}
+
+/* ================================================================= */
+/* Loading and saving */
+
+static void
+check_session (QofSession *session, const char *what, const std::string& url)
+{
+    auto err = qof_session_get_error (session);
+    if (err == ERR_BACKEND_NO_ERR)
+        return;
+    auto msg = g_strdup_printf ("%s %s failed: error %d", what, url.c_str (),
+                                err);
+    std::runtime_error error{msg};
+    g_free (msg);
+    throw error;
+}
+
+static double
+save_book (QofSession *session, const std::string& url)
+{
+    auto save_session = qof_session_new (qof_book_new ());
+    qof_session_begin (save_session, url.c_str (), SESSION_NEW_OVERWRITE);
+    try
+    {
+        check_session (save_session, "Creating", url);
+        qof_session_swap_data (session, save_session);
+        qof_book_mark_session_dirty (qof_session_get_book (save_session));
+        auto ms = elapsed_ms ([save_session]{
+            qof_session_save (save_session, nullptr);
+        });
+        qof_session_swap_data (session, save_session);
+        check_session (save_session, "Saving", url);
+        qof_session_end (save_session);
+        qof_session_destroy (save_session);
+        return ms;
+    }
+    catch (...)
+    {
+        qof_session_end (save_session);
+        qof_session_destroy (save_session);
+        throw;
+    }
+}
+
+static QofSession*
+open_book (const std::string& url)
+{
+    auto session = qof_session_new (qof_book_new ());
+    qof_session_begin (session, url.c_str (), SESSION_READ_ONLY);
+    try
+    {
+        check_session (session, "Opening", url);
+    }
+    catch (...)
+    {
+        qof_session_end (session);
+        qof_session_destroy (session);
+        throw;
+    }
+    return session;
+}
+
+static double
+load_book (const std::string& url)
+{
+    auto session = open_book (url);
+    auto ms = elapsed_ms ([session]{ qof_session_load (session, nullptr); });
+    qof_session_end (session);
+    qof_session_destroy (session);
+    return ms;
+}
+
+/* The account scrubs report their progress unconditionally. */
+static void
+no_progress (const char*, double)
+{
+}
+
+/* Scrubbing changes the book, so each iteration scrubs a fresh copy
+ * loaded from the saved file. */
+static double
+scrub_book (const std::string& url)
+{
+    auto session = open_book (url);
+    qof_session_load (session, nullptr);
+    auto root = gnc_book_get_root_account (qof_session_get_book (session));
+    auto ms = elapsed_ms ([root]{
+        xaccAccountTreeScrubOrphans (root, no_progress);
+        xaccAccountTreeScrubSplits (root);
+        xaccAccountTreeScrubImbalance (root, no_progress);
+    });
+    qof_session_end (session);
+    qof_session_destroy (session);
+    return ms;
+}
+
+/* ================================================================= */
+/* In-memory operations */
+
+static std::vector<time64>
+report_dates (QofBook *book, gint num_dates)
+{
+    std::pair<time64, time64> range{G_MAXINT64, G_MININT64};
+    qof_collection_foreach (qof_book_get_collection (book, GNC_ID_TRANS),
+                            [](QofInstance *inst, gpointer data) {
+                                auto range = static_cast<std::pair<time64, time64>*>(data);
+                                auto date = xaccTransGetDate (GNC_TRANSACTION (inst));
+                                range->first = std::min (range->first, date);
+                                range->second = std::max (range->second, date);
+                            }, &range);
+
+    std::vector<time64> dates;
+    if (range.first > range.second || num_dates < 1)
+        return dates;
+    auto step = (range.second - range.first) / num_dates;
+    for (auto i = 1; i <= num_dates; ++i)
+        dates.push_back (range.first + step * i);
+    return dates;
+}
+
+static double
+query_splits (QofBook *book, const std::function<void(QofQuery*)>& add_terms)
+{
+    auto query = qof_query_create_for (GNC_ID_SPLIT);
+    qof_query_set_book (query, book);
+    add_terms (query);
+    auto ms = elapsed_ms ([query]{ qof_query_run (query); });
+    qof_query_destroy (query);
+    return ms;
+}
+
+struct PriceSample
+{
+    gnc_commodity *commodity;
+    gnc_commodity *currency;
+    time64 time;
+};
+
+static std::vector<PriceSample>
+price_samples (GNCPriceDB *pdb, size_t max_samples)
+{
+    std::vector<PriceSample> samples;
+    gnc_pricedb_foreach_price (pdb, [](GNCPrice *price, gpointer data) {
+        auto samples = static_cast<std::vector<PriceSample>*>(data);
+        samples->push_back ({gnc_price_get_commodity (price),
+                             gnc_price_get_currency (price),
+                             gnc_price_get_time64 (price)});
+        return TRUE;
+    }, &samples, TRUE);
+    if (samples.size () > max_samples)
+    {
+        /* Keep an even spread rather than the first few commodities. */
+        std::vector<PriceSample> spread;
+        auto stride = samples.size () / max_samples;
+        for (size_t i = 0; i < samples.size () && spread.size () < max_samples;
+             i += stride)
+            spread.push_back (samples[i]);
+        samples.swap (spread);
+    }
+    return samples;
+}
+
+/* ================================================================= */
+/* Output */
+
+static std::string
+json_string (const std::string& str)
+{
+    std::string out{"\""};
+    for (auto c : str)
+    {
+        switch (c)
+        {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20)
+            {
+                char buf[8];
+                snprintf (buf, sizeof (buf), "\\u%04x", c);
+                out += buf;
+            }
+            else
+                out += c;
+        }
+    }
+    return out + "\"";
+}
+
+static void
+write_results (FILE *out, const BenchConfig& config, QofBook *book,
+               const std::vector<BenchResult>& results)
+{
+    auto count = [book](const char *type) {
+        return qof_collection_count (qof_book_get_collection (book, type));
+    };
+
+    fprintf (out, "{\n  \"version\": %s,\n", json_string (PROJECT_VERSION).c_str ());
+    fprintf (out, "  \"config\": {\"seed\": %d, \"accounts\": %d, \"splits\": %d, "
+             "\"prices\": %d, \"lots\": %d, \"kvp-depth\": %d, "
+             "\"kvp-elements\": %d, \"dates\": %d, \"iterations\": %d},\n",
+             config.seed, config.accounts, config.splits, config.prices,
+             config.lots, config.kvp_depth, config.kvp_elements, config.dates,
+             config.iterations);
+    fprintf (out, "  \"book\": {\"accounts\": %d, \"transactions\": %u, "
+             "\"splits\": %u, \"prices\": %u, \"lots\": %u},\n",
+             gnc_account_n_descendants (gnc_book_get_root_account (book)),
+             count (GNC_ID_TRANS), count (GNC_ID_SPLIT),
+             gnc_pricedb_get_num_prices (gnc_pricedb_get_db (book)),
+             count (GNC_ID_LOT));
+    fprintf (out, "  \"results\": [");
+
+    auto sep = "\n";
+    for (const auto& result : results)
+    {
+        fprintf (out, "%s    {\"name\": %s", sep, json_string (result.name).c_str ());
+        sep = ",\n";
+        if (!result.error.empty ())
+        {
+            fprintf (out, ", \"error\": %s}", json_string (result.error).c_str ());
+            continue;
+        }
+
+        auto sorted = result.samples;
+        std::sort (sorted.begin (), sorted.end ());
+        auto mean = sorted.empty () ? 0.0 :
+            std::accumulate (sorted.begin (), sorted.end (), 0.0) / sorted.size ();
+        auto median = sorted.empty () ? 0.0 : sorted[sorted.size () / 2];
+        fprintf (out, ", \"min-ms\": %.3f, \"median-ms\": %.3f, \"mean-ms\": %.3f, "
+                 "\"samples-ms\": [", sorted.empty () ? 0.0 : sorted.front (),
+                 median, mean);
+        auto sample_sep = "";
+        for (auto sample : result.samples)
+        {
+            fprintf (out, "%s%.3f", sample_sep, sample);
+            sample_sep = ", ";
+        }
+        fprintf (out, "]}");
+    }
+    fprintf (out, "\n  ]\n}\n");
+}
+
+/* ================================================================= */
+
+static gboolean
+parse_args (int argc, char **argv, BenchConfig& config)
+{
+    GOptionEntry entries[] =
+    {
+        { "seed", 0, 0, G_OPTION_ARG_INT, &config.seed,
+          "Seed for the random book generator", "N" },
+        { "accounts", 0, 0, G_OPTION_ARG_INT, &config.accounts,
+          "Minimum number of accounts", "N" },
+        { "splits", 0, 0, G_OPTION_ARG_INT, &config.splits,
+          "Minimum number of splits", "N" },
+        { "prices", 0, 0, G_OPTION_ARG_INT, &config.prices,
+          "Minimum number of prices", "N" },
+        { "lots", 0, 0, G_OPTION_ARG_INT, &config.lots,
+          "Maximum number of lots", "N" },
+        { "kvp-depth", 0, 0, G_OPTION_ARG_INT, &config.kvp_depth,
+          "Maximum nesting of the KVP frames attached to each object", "N" },
+        { "kvp-elements", 0, 0, G_OPTION_ARG_INT, &config.kvp_elements,
+          "Maximum number of slots in each KVP frame", "N" },
+        { "dates", 0, 0, G_OPTION_ARG_INT, &config.dates,
+          "Number of dates for the as-of-date balance benchmarks", "N" },
+        { "iterations", 0, 0, G_OPTION_ARG_INT, &config.iterations,
+          "Number of times to run each benchmark", "N" },
+        { "no-xml", 0, 0, G_OPTION_ARG_NONE, &config.no_xml,
+          "Skip the XML backend benchmarks", nullptr },
+        { "no-sql", 0, 0, G_OPTION_ARG_NONE, &config.no_sql,
+          "Skip the SQLite backend benchmarks", nullptr },
+        { "dir", 0, 0, G_OPTION_ARG_FILENAME, &config.dir,
+          "Directory for the saved books (default: a new temporary directory)",
+          "DIR" },
+        { "output", 'o', 0, G_OPTION_ARG_FILENAME, &config.output,
+          "File to write the JSON results to (default: standard output)",
+          "FILE" },
+        { nullptr }
+    };
+
+    GError *error = nullptr;
+    auto context = g_option_context_new ("- time GnuCash engine operations");
+    g_option_context_add_main_entries (context, entries, nullptr);
+    auto ok = g_option_context_parse (context, &argc, &argv, &error);
+    g_option_context_free (context);
+    if (!ok)
+    {
+        g_printerr ("%s\n", error->message);
+        g_error_free (error);
+        return FALSE;
+    }
+    config.iterations = std::max (config.iterations, 1);
+    return TRUE;
+}
+
+int
+main (int argc, char **argv)
+{
+    BenchConfig config;
+    if (!parse_args (argc, argv, config))
+        return EXIT_FAILURE;
+
+    auto out = stdout;
+    if (config.output && !(out = g_fopen (config.output, "w")))
+    {
+        g_printerr ("Unable to open %s\n", config.output);
+        return EXIT_FAILURE;
+    }
+
+    gboolean remove_dir = FALSE;
+    if (!config.dir)
+    {
+        config.dir = g_dir_make_tmp ("gnc-bench-XXXXXX", nullptr);
+        remove_dir = TRUE;
+    }
+
+    gnc_engine_init (0, nullptr);
+    xaccLogDisable ();
+
+    auto book = qof_book_new ();
+    auto session = qof_session_new (book);
+    std::vector<BenchResult> results;
+
+    results.push_back (run_bench ("generate", 1, [book, &config]{
+        return elapsed_ms ([book, &config]{ generate_book (book, config); });
+    }));
+
+    std::vector<std::string> files;
+    auto add_backend = [&](const char *name, const char *scheme) {
+        auto path = g_build_filename (config.dir, name, nullptr);
+        auto url = std::string{scheme} + "://" + path;
+        g_free (path);
+        files.push_back (name);
+
+        auto save = std::string{name} + "-save";
+        results.push_back (run_bench (save.c_str (), config.iterations,
+                                      [session, url]{
+                                          return save_book (session, url);
+                                      }));
+        if (!results.back ().error.empty ())
+            return std::string{};
+
+        auto load = std::string{name} + "-load";
+        results.push_back (run_bench (load.c_str (), config.iterations,
+                                      [url]{ return load_book (url); }));
+        return url;
+    };
+
+    std::string scrub_url;
+    if (!config.no_xml)
+        scrub_url = add_backend ("xml", "xml");
+#if defined (HAVE_DBI_DBI_H)
+    if (!config.no_sql)
+    {
+        auto url = add_backend ("sqlite", "sqlite3");
+        if (scrub_url.empty ())
+            scrub_url = url;
+    }
+#endif
+
+    auto root = gnc_book_get_root_account (book);
+    auto account_list = gnc_account_get_descendants_sorted (root);
+    AccountVec accounts;
+    for (auto node = account_list; node; node = g_list_next (node))
+        accounts.push_back (GNC_ACCOUNT (node->data));
+    g_list_free (account_list);
+
+    results.push_back (run_bench ("balance-recompute", config.iterations,
+                                  [&accounts]{
+        for (auto acc : accounts)
+            gnc_account_set_balance_dirty (acc);
+        return elapsed_ms ([&accounts]{
+            for (auto acc : accounts)
+                xaccAccountRecomputeBalance (acc);
+        });
+    }));
+
+    auto dates = report_dates (book, config.dates);
+    results.push_back (run_bench ("balance-as-of-date", config.iterations,
+                                  [&accounts, &dates]{
+        return elapsed_ms ([&accounts, &dates]{
+            for (auto acc : accounts)
+                for (auto date : dates)
+                    xaccAccountGetBalanceAsOfDate (acc, date);
+        });
+    }));
+    results.push_back (run_bench ("balances-at-dates", config.iterations,
+                                  [&accounts, &dates]{
+        return elapsed_ms ([&accounts, &dates]{
+            gnc_accounts_get_balances_at_dates (accounts, dates, true, nullptr);
+        });
+    }));
+
+    results.push_back (run_bench ("query-date-range", config.iterations,
+                                  [book, &dates]{
+        return query_splits (book, [&dates](QofQuery *query) {
+            if (dates.size () > 1)
+                xaccQueryAddDateMatchTT (query, TRUE, dates[dates.size () / 4],
+                                         TRUE, dates[dates.size () * 3 / 4],
+                                         QOF_QUERY_AND);
+        });
+    }));
+    results.push_back (run_bench ("query-account", config.iterations,
+                                  [book, &accounts]{
+        double ms = 0;
+        auto stride = std::max<size_t> (accounts.size () / 20, 1);
+        for (size_t i = 0; i < accounts.size (); i += stride)
+            ms += query_splits (book, [&accounts, i](QofQuery *query) {
+                xaccQueryAddSingleAccountMatch (query, accounts[i],
+                                                QOF_QUERY_AND);
+            });
+        return ms;
+    }));
+
+    auto pdb = gnc_pricedb_get_db (book);
+    auto samples = price_samples (pdb, 1000);
+    results.push_back (run_bench ("price-lookup", config.iterations,
+                                  [pdb, &samples]{
+        return elapsed_ms ([pdb, &samples]{
+            for (const auto& sample : samples)
+                gnc_price_unref (gnc_pricedb_lookup_nearest_in_time64
+                                 (pdb, sample.commodity, sample.currency,
+                                  sample.time));
+        });
+    }));
+    results.push_back (run_bench ("price-convert", config.iterations,
+                                  [pdb, &samples]{
+        return elapsed_ms ([pdb, &samples]{
+            for (const auto& sample : samples)
+                gnc_pricedb_convert_balance_nearest_price_t64
+                    (pdb, gnc_numeric_create (100, 1), sample.commodity,
+                     sample.currency, sample.time);
+        });
+    }));
+
+    if (!scrub_url.empty ())
+        results.push_back (run_bench ("scrub", config.iterations,
+                                      [&scrub_url]{
+                                          return scrub_book (scrub_url);
+                                      }));
+
+    write_results (out, config, book, results);
+    if (out != stdout)
+        fclose (out);
+
+    qof_session_end (session);
+    qof_session_destroy (session);
+
+    if (remove_dir)
+    {
+        for (const auto& name : files)
+        {
+            auto path = g_build_filename (config.dir, name.c_str (), nullptr);
+            auto pattern = g_strconcat (name.c_str (), ".", nullptr);
+            g_unlink (path);
+            /* The backends leave lock files and backups beside the book. */
+            auto dir = g_dir_open (config.dir, 0, nullptr);
+            while (auto entry = dir ? g_dir_read_name (dir) : nullptr)
+                if (g_str_has_prefix (entry, pattern))
+                {
+                    auto extra = g_build_filename (config.dir, entry, nullptr);
+                    g_unlink (extra);
+                    g_free (extra);
+                }
+            if (dir)
+                g_dir_close (dir);
+            g_free (pattern);
+            g_free (path);
+        }
+        g_rmdir (config.dir);
+    }
+    g_free (config.dir);
+    g_free (config.output);
+    qof_close ();
+
+    auto failed = std::any_of (results.begin (), results.end (),
+                               [](const BenchResult& result) {
+                                   return !result.error.empty ();
+                               });
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
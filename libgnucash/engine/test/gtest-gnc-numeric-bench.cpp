@@ -0,0 +1,171 @@
+/********************************************************************
+ * gtest-gnc-numeric-bench.cpp -- gnc_numeric arithmetic timing     *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+\********************************************************************/
+
+/* Checks that the same-denominator shortcuts in gnc_numeric_add,
+ * gnc_numeric_sub, gnc_numeric_compare and gnc_numeric_equal give the
+ * same results as the general rational arithmetic, and reports how long
+ * each takes on a balance-like workload of amounts in one commodity.
+ */
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+#include "../gnc-numeric.hpp"
+#include "../gnc-rational.hpp"
+
+static const int64_t scu = 100;
+static const size_t num_values = 100000;
+static const int rounds = 20;
+
+static std::vector<gnc_numeric>
+make_amounts(size_t count, int64_t denom)
+{
+    std::mt19937_64 gen(42);
+    std::uniform_int_distribution<int64_t> dist(-10000000, 10000000);
+    std::vector<gnc_numeric> values;
+    values.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+        values.push_back(gnc_numeric_create(dist(gen), denom));
+    return values;
+}
+
+/* The general path, as gnc_numeric_add took it for every call before the
+ * shortcut was added. */
+static gnc_numeric
+rational_add(gnc_numeric a, gnc_numeric b)
+{
+    GncNumeric an(a), bn(b);
+    return static_cast<gnc_numeric>(an + bn);
+}
+
+template <typename F> static double
+time_ms(F&& func)
+{
+    auto start = std::chrono::steady_clock::now();
+    func();
+    std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+TEST(gnc_numeric_same_denom, add_sub_match_rational)
+{
+    auto values = make_amounts(1000, scu);
+    for (size_t i = 1; i < values.size(); ++i)
+    {
+        auto a = values[i - 1], b = values[i];
+        EXPECT_TRUE(gnc_numeric_eq(rational_add(a, b),
+                                   gnc_numeric_add_fixed(a, b)));
+        EXPECT_TRUE(gnc_numeric_eq(rational_add(a, gnc_numeric_neg(b)),
+                                   gnc_numeric_sub_fixed(a, b)));
+        EXPECT_TRUE(gnc_numeric_eq(rational_add(a, b),
+                                   gnc_numeric_add(a, b, GNC_DENOM_AUTO,
+                                                   GNC_HOW_DENOM_LCD)));
+        EXPECT_TRUE(gnc_numeric_eq(rational_add(a, b),
+                                   gnc_numeric_add(a, b, scu,
+                                                   GNC_HOW_RND_ROUND)));
+    }
+}
+
+TEST(gnc_numeric_same_denom, denominator_kept)
+{
+    auto a = gnc_numeric_create(150, scu), b = gnc_numeric_create(50, scu);
+    /* Reducing must still reduce. */
+    auto reduced = gnc_numeric_add(a, b, GNC_DENOM_AUTO, GNC_HOW_DENOM_REDUCE);
+    EXPECT_EQ(2, reduced.num);
+    EXPECT_EQ(1, reduced.denom);
+    /* A different target denominator must still convert. */
+    auto converted = gnc_numeric_add(a, b, 1000, GNC_HOW_RND_NEVER);
+    EXPECT_EQ(2000, converted.num);
+    EXPECT_EQ(1000, converted.denom);
+    auto fixed = gnc_numeric_add_fixed(a, b);
+    EXPECT_EQ(200, fixed.num);
+    EXPECT_EQ(scu, fixed.denom);
+}
+
+TEST(gnc_numeric_same_denom, overflow_takes_general_path)
+{
+    /* The numerators' sum overflows but the reduced sum fits. */
+    auto big = gnc_numeric_create(INT64_MAX - 1, 2);
+    auto sum = gnc_numeric_add_fixed(big, big);
+    EXPECT_FALSE(gnc_numeric_check(sum));
+    EXPECT_TRUE(gnc_numeric_eq(rational_add(big, big), sum));
+    EXPECT_EQ(0, gnc_numeric_compare(sum, gnc_numeric_create(INT64_MAX - 1, 1)));
+
+    auto neg = gnc_numeric_create(INT64_MIN + 2, 2);
+    auto diff = gnc_numeric_sub_fixed(neg, big);
+    EXPECT_FALSE(gnc_numeric_check(diff));
+    EXPECT_TRUE(gnc_numeric_eq(rational_add(neg, gnc_numeric_neg(big)), diff));
+}
+
+TEST(gnc_numeric_same_denom, compare_matches_rational)
+{
+    auto values = make_amounts(1000, scu);
+    auto other = make_amounts(1000, 1000);
+    for (size_t i = 0; i < values.size(); ++i)
+    {
+        auto a = values[i], b = other[i];
+        GncNumeric an(a), bn(b);
+        EXPECT_EQ(an.cmp(bn), gnc_numeric_compare(a, b));
+        EXPECT_EQ(an.cmp(bn) == 0, gnc_numeric_equal(a, b));
+    }
+    EXPECT_EQ(0, gnc_numeric_compare(gnc_numeric_create(1, 2),
+                                     gnc_numeric_create(50, 100)));
+    EXPECT_TRUE(gnc_numeric_equal(gnc_numeric_create(1, 2),
+                                  gnc_numeric_create(50, 100)));
+    EXPECT_EQ(1, gnc_numeric_compare(gnc_numeric_create(INT64_MAX, 3),
+                                     gnc_numeric_create(INT64_MAX, 4)));
+    EXPECT_EQ(-1, gnc_numeric_compare(gnc_numeric_create(INT64_MIN, 3),
+                                      gnc_numeric_create(INT64_MIN, 4)));
+}
+
+TEST(gnc_numeric_same_denom, benchmark)
+{
+    auto values = make_amounts(num_values, scu);
+    gnc_numeric fast_sum{0, scu}, general_sum{0, scu};
+
+    auto fast = time_ms([&]() {
+        for (auto r = 0; r < rounds; ++r)
+            for (const auto& value : values)
+                fast_sum = gnc_numeric_add_fixed(fast_sum, value);
+    });
+    auto general = time_ms([&]() {
+        for (auto r = 0; r < rounds; ++r)
+            for (const auto& value : values)
+                general_sum = rational_add(general_sum, value);
+    });
+    EXPECT_TRUE(gnc_numeric_equal(fast_sum, general_sum));
+
+    int greater = 0;
+    auto compare = time_ms([&]() {
+        for (auto r = 0; r < rounds; ++r)
+            for (size_t i = 1; i < values.size(); ++i)
+                greater += gnc_numeric_compare(values[i - 1], values[i]) > 0;
+    });
+    EXPECT_GT(greater, 0);
+
+    std::cout << "gnc_numeric_add_fixed: " << fast << " ms, "
+              << "rational add: " << general << " ms, "
+              << "gnc_numeric_compare: " << compare << " ms for "
+              << rounds * num_values << " operations" << std::endl;
+}
@@ -0,0 +1,101 @@
+/********************************************************************
+ * gtest-gnc-numeric-sum.cpp -- Unit tests for gnc-numeric-sum       *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+\********************************************************************/
+
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+#include "../gnc-numeric-sum.hpp"
+
+static std::vector<int64_t>
+make_nums(size_t count, int64_t limit)
+{
+    std::mt19937_64 gen(42);
+    std::uniform_int_distribution<int64_t> dist(-limit, limit);
+    std::vector<int64_t> nums(count);
+    for (auto& num : nums)
+        num = dist(gen);
+    return nums;
+}
+
+/* Sizes either side of the block and vector widths. */
+static const size_t sizes[] = { 0, 1, 2, 3, 4, 5, 7, 255, 256, 257, 1000 };
+
+TEST(gnc_numeric_sum, sums_match_scalar)
+{
+    for (auto size : sizes)
+    {
+        auto nums = make_nums(size, 10000000);
+        int64_t expected = -17, total = 0;
+        std::vector<int64_t> sums(size);
+        ASSERT_TRUE(gnc_numeric_prefix_sums(nums.data(), size, -17,
+                                            sums.data()));
+        for (size_t i = 0; i < size; ++i)
+        {
+            expected += nums[i];
+            EXPECT_EQ(expected, sums[i]) << "size " << size << " index " << i;
+        }
+        ASSERT_TRUE(gnc_numeric_sum(nums.data(), size, -17, total));
+        EXPECT_EQ(expected, total) << "size " << size;
+    }
+}
+
+TEST(gnc_numeric_sum, prefix_sums_in_place)
+{
+    auto nums = make_nums(600, 1000);
+    auto sums = nums;
+    ASSERT_TRUE(gnc_numeric_prefix_sums(sums.data(), sums.size(), 5,
+                                        sums.data()));
+    int64_t expected = 5;
+    for (size_t i = 0; i < nums.size(); ++i)
+        EXPECT_EQ(expected += nums[i], sums[i]);
+}
+
+TEST(gnc_numeric_sum, large_values_near_limit)
+{
+    /* Too large for the unchecked path, but no sum overflows. */
+    std::vector<int64_t> nums(300);
+    for (size_t i = 0; i < nums.size(); ++i)
+        nums[i] = i % 2 ? -(INT64_MAX / 2) : INT64_MAX / 2;
+    int64_t total = 0;
+    ASSERT_TRUE(gnc_numeric_sum(nums.data(), nums.size(), 1, total));
+    EXPECT_EQ(1, total);
+    std::vector<int64_t> sums(nums.size());
+    ASSERT_TRUE(gnc_numeric_prefix_sums(nums.data(), nums.size(), 1,
+                                        sums.data()));
+    EXPECT_EQ(INT64_MAX / 2 + 1, sums[298]);
+    EXPECT_EQ(1, sums[299]);
+
+    int64_t min = INT64_MIN;
+    ASSERT_TRUE(gnc_numeric_sum(&min, 1, 0, total));
+    EXPECT_EQ(INT64_MIN, total);
+}
+
+TEST(gnc_numeric_sum, overflow_fails)
+{
+    std::vector<int64_t> nums(10, INT64_MAX / 8);
+    int64_t total = 0;
+    EXPECT_FALSE(gnc_numeric_sum(nums.data(), nums.size(), 0, total));
+    std::vector<int64_t> sums(nums.size());
+    EXPECT_FALSE(gnc_numeric_prefix_sums(nums.data(), nums.size(), 0,
+                                         sums.data()));
+    int64_t one = -1;
+    EXPECT_FALSE(gnc_numeric_sum(&one, 1, INT64_MIN, total));
+}
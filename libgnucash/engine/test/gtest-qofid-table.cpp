@@ -0,0 +1,114 @@
+/********************************************************************\
+ * gtest-qofid-table.cpp -- Unit tests for qofid-table.hpp          *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+ *                                                                  *
+ \ *********************************************************************/
+
+#include <config.h>
+#include <glib.h>
+#include "../guid.h"
+#include "../qofid-table.hpp"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <vector>
+
+class QofGuidTableTest : public ::testing::Test
+{
+protected:
+    QofGuidTableTest() : m_guids(1000), m_values(1000)
+    {
+        for (auto& guid : m_guids)
+            guid_replace (&guid);
+    }
+    std::vector<GncGUID> m_guids;
+    std::vector<int> m_values;
+    QofGuidTable<int> m_table;
+};
+
+TEST_F(QofGuidTableTest, empty)
+{
+    EXPECT_EQ(0u, m_table.size());
+    EXPECT_EQ(nullptr, m_table.lookup(m_guids[0]));
+    EXPECT_FALSE(m_table.remove(m_guids[0]));
+}
+
+TEST_F(QofGuidTableTest, insert_lookup)
+{
+    for (size_t i = 0; i < m_guids.size(); ++i)
+        m_table.insert(m_guids[i], &m_values[i]);
+    EXPECT_EQ(m_guids.size(), m_table.size());
+    for (size_t i = 0; i < m_guids.size(); ++i)
+        EXPECT_EQ(&m_values[i], m_table.lookup(m_guids[i]));
+    GncGUID other;
+    guid_replace (&other);
+    EXPECT_EQ(nullptr, m_table.lookup(other));
+}
+
+TEST_F(QofGuidTableTest, insert_replaces)
+{
+    m_table.insert(m_guids[0], &m_values[0]);
+    m_table.insert(m_guids[0], &m_values[1]);
+    EXPECT_EQ(1u, m_table.size());
+    EXPECT_EQ(&m_values[1], m_table.lookup(m_guids[0]));
+}
+
+TEST_F(QofGuidTableTest, remove)
+{
+    for (size_t i = 0; i < m_guids.size(); ++i)
+        m_table.insert(m_guids[i], &m_values[i]);
+    for (size_t i = 0; i < m_guids.size(); i += 2)
+        EXPECT_TRUE(m_table.remove(m_guids[i]));
+    EXPECT_EQ(m_guids.size() / 2, m_table.size());
+    for (size_t i = 0; i < m_guids.size(); ++i)
+        EXPECT_EQ(i % 2 ? &m_values[i] : nullptr, m_table.lookup(m_guids[i]));
+    EXPECT_FALSE(m_table.remove(m_guids[0]));
+}
+
+TEST_F(QofGuidTableTest, reserve)
+{
+    m_table.insert(m_guids[0], &m_values[0]);
+    m_table.reserve(100000);
+    EXPECT_EQ(1u, m_table.size());
+    EXPECT_EQ(&m_values[0], m_table.lookup(m_guids[0]));
+}
+
+TEST_F(QofGuidTableTest, for_each)
+{
+    for (size_t i = 0; i < m_guids.size(); ++i)
+        m_table.insert(m_guids[i], &m_values[i]);
+    std::vector<int*> seen;
+    m_table.for_each([&seen](int* value) { seen.push_back(value); });
+    ASSERT_EQ(m_values.size(), seen.size());
+    std::sort(seen.begin(), seen.end());
+    for (size_t i = 0; i < m_values.size(); ++i)
+        EXPECT_EQ(&m_values[i], seen[i]);
+}
+
+TEST_F(QofGuidTableTest, for_each_remove)
+{
+    for (size_t i = 0; i < m_guids.size(); ++i)
+        m_table.insert(m_guids[i], &m_values[i]);
+    auto& table = m_table;
+    auto& guids = m_guids;
+    auto& values = m_values;
+    m_table.for_each([&](int* value) {
+                         table.remove(guids[value - values.data()]);
+                     });
+    EXPECT_EQ(0u, m_table.size());
+}
@@ -0,0 +1,265 @@
+/********************************************************************
+ * gtest-translog.cpp -- Unit tests for the transaction journal     *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+\********************************************************************/
+
+#include <config.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include "../cashobjects.h"
+#include "../Account.h"
+#include "../Transaction.h"
+#include "../TransLog.h"
+#include "../gnc-commodity.h"
+#include <qof.h>
+#include <gtest/gtest.h>
+#include <cstring>
+#include <string>
+#include <vector>
+
+class TransLogTest : public testing::Test
+{
+protected:
+    void SetUp() {
+        qof_init ();
+        cashobjects_register ();
+        m_dir = g_dir_make_tmp ("translog-XXXXXX", nullptr);
+        ASSERT_NE (m_dir, nullptr);
+        auto base = g_build_filename (m_dir, "translog", nullptr);
+        xaccLogSetBaseName (base);
+        g_free (base);
+
+        m_book = qof_book_new ();
+        m_curr = gnc_commodity_new (m_book, "Gnu Rand", "CURRENCY", "GNR",
+                                    "", 100);
+        auto root = gnc_account_create_root (m_book);
+        m_account = xaccMallocAccount (m_book);
+        xaccAccountBeginEdit (m_account);
+        xaccAccountSetName (m_account, "Checking");
+        xaccAccountSetCommodity (m_account, m_curr);
+        xaccAccountCommitEdit (m_account);
+        gnc_account_append_child (root, m_account);
+    }
+    void TearDown() {
+        xaccCloseLog ();
+        xaccLogSetFormat (XACC_LOG_TEXT);
+        xaccLogSetSync (XACC_LOG_SYNC_NONE, 0);
+        qof_book_destroy (m_book);
+        if (auto dir = g_dir_open (m_dir, 0, nullptr))
+        {
+            while (auto name = g_dir_read_name (dir))
+            {
+                auto path = g_build_filename (m_dir, name, nullptr);
+                g_unlink (path);
+                g_free (path);
+            }
+            g_dir_close (dir);
+        }
+        g_rmdir (m_dir);
+        g_free (m_dir);
+        qof_close ();
+    }
+    Transaction* commit_transaction (int num) {
+        auto trans = xaccMallocTransaction (m_book);
+        auto split = xaccMallocSplit (m_book);
+        auto other = xaccMallocSplit (m_book);
+        auto amount = gnc_numeric_create (num * 100 + 1, 100);
+        xaccTransBeginEdit (trans);
+        xaccTransSetCurrency (trans, m_curr);
+        xaccTransSetDescription (trans, ("Payment " + std::to_string (num)).c_str ());
+        xaccTransSetDatePostedSecs (trans, 1600000000 + num);
+        xaccSplitSetParent (split, trans);
+        xaccSplitSetAccount (split, m_account);
+        xaccSplitSetMemo (split, "memo");
+        xaccSplitSetAmount (split, amount);
+        xaccSplitSetValue (split, amount);
+        xaccSplitSetParent (other, trans);
+        xaccSplitSetAmount (other, gnc_numeric_neg (amount));
+        xaccSplitSetValue (other, gnc_numeric_neg (amount));
+        xaccTransCommitEdit (trans);
+        return trans;
+    }
+    std::string journal_path () {
+        std::string path;
+        auto dir = g_dir_open (m_dir, 0, nullptr);
+        if (auto name = g_dir_read_name (dir))
+        {
+            auto filename = g_build_filename (m_dir, name, nullptr);
+            path = filename;
+            g_free (filename);
+        }
+        g_dir_close (dir);
+        return path;
+    }
+    std::vector<std::string> journal_paths () {
+        std::vector<std::string> paths;
+        auto dir = g_dir_open (m_dir, 0, nullptr);
+        while (auto name = g_dir_read_name (dir))
+        {
+            auto filename = g_build_filename (m_dir, name, nullptr);
+            paths.push_back (filename);
+            g_free (filename);
+        }
+        g_dir_close (dir);
+        return paths;
+    }
+    FILE* open_journal () {
+        auto path = journal_path ();
+        return path.empty () ? nullptr : g_fopen (path.c_str (), "rb");
+    }
+    gchar *m_dir {};
+    QofBook *m_book {};
+    gnc_commodity *m_curr {};
+    Account *m_account {};
+};
+
+TEST_F(TransLogTest, binary_round_trip)
+{
+    const int count = 200;
+    std::vector<Transaction*> transactions;
+
+    xaccLogSetFormat (XACC_LOG_BINARY);
+    xaccLogSetSync (XACC_LOG_SYNC_COUNT, 16);
+    xaccOpenLog ();
+    for (int i = 0; i < count; ++i)
+        transactions.push_back (commit_transaction (i));
+    xaccCloseLog ();
+
+    auto file = open_journal ();
+    ASSERT_NE (file, nullptr);
+    auto reader = xaccLogReaderNew (file);
+    ASSERT_NE (reader, nullptr);
+
+    TransLogRecord record;
+    int read = 0;
+    while (xaccLogReaderNext (reader, &record))
+    {
+        /* Each commit logs the transaction as it was and as it is. */
+        if (record.flag != 'C')
+            continue;
+        auto trans = transactions[read];
+        EXPECT_TRUE (guid_equal (&record.trans_guid, xaccTransGetGUID (trans)));
+        EXPECT_STREQ (record.description, xaccTransGetDescription (trans));
+        EXPECT_EQ (record.date_posted, xaccTransGetDate (trans));
+        ASSERT_EQ (record.num_splits, 2u);
+        for (guint i = 0; i < record.num_splits; ++i)
+        {
+            auto split = xaccTransGetSplit (trans, i);
+            auto& logged = record.splits[i];
+            EXPECT_TRUE (guid_equal (&logged.split_guid, xaccSplitGetGUID (split)));
+            EXPECT_TRUE (gnc_numeric_equal (logged.amount, xaccSplitGetAmount (split)));
+            EXPECT_STREQ (logged.memo, xaccSplitGetMemo (split));
+        }
+        EXPECT_STREQ (record.splits[0].acc_name, "Checking");
+        EXPECT_TRUE (guid_equal (&record.splits[0].acc_guid,
+                                 xaccAccountGetGUID (m_account)));
+        EXPECT_TRUE (guid_equal (&record.splits[1].acc_guid, guid_null ()));
+        ++read;
+    }
+    EXPECT_FALSE (xaccLogReaderFailed (reader));
+    EXPECT_EQ (read, count);
+    xaccLogReaderDestroy (reader);
+    fclose (file);
+}
+
+TEST_F(TransLogTest, damaged_record)
+{
+    xaccLogSetFormat (XACC_LOG_BINARY);
+    xaccOpenLog ();
+    for (int i = 0; i < 10; ++i)
+        commit_transaction (i);
+    xaccLogFlush ();
+    xaccCloseLog ();
+
+    /* Lose the end of the last record, as a crash might. */
+    auto path = journal_path ();
+    gchar *contents;
+    gsize size;
+    ASSERT_TRUE (g_file_get_contents (path.c_str (), &contents, &size, nullptr));
+    ASSERT_TRUE (g_file_set_contents (path.c_str (), contents, size - 10, nullptr));
+    g_free (contents);
+
+    auto file = open_journal ();
+    auto reader = xaccLogReaderNew (file);
+    ASSERT_NE (reader, nullptr);
+    TransLogRecord record;
+    int read = 0;
+    while (xaccLogReaderNext (reader, &record))
+        ++read;
+    EXPECT_EQ (read, 19);
+    EXPECT_TRUE (xaccLogReaderFailed (reader));
+    xaccLogReaderDestroy (reader);
+    fclose (file);
+}
+
+TEST_F(TransLogTest, text_is_not_binary)
+{
+    xaccOpenLog ();
+    commit_transaction (1);
+    xaccCloseLog ();
+
+    auto file = open_journal ();
+    ASSERT_NE (file, nullptr);
+    EXPECT_EQ (xaccLogReaderNew (file), nullptr);
+    char line[32];
+    ASSERT_NE (fgets (line, sizeof (line), file), nullptr);
+    EXPECT_EQ (strncmp (line, "mod\ttrans_guid", 14), 0);
+    fclose (file);
+}
+
+TEST_F(TransLogTest, reopen_starts_a_new_file)
+{
+    xaccLogSetFormat (XACC_LOG_BINARY);
+    xaccOpenLog ();
+    commit_transaction (1);
+    /* A new sync policy carries on in the same file. */
+    xaccLogSetSync (XACC_LOG_SYNC_COUNT, 1);
+    commit_transaction (2);
+    xaccLogFlush ();
+    EXPECT_EQ (journal_paths ().size (), 1u);
+
+    /* Changing the format and back within a second starts two more
+     * files rather than writing a second header into one. */
+    xaccLogSetFormat (XACC_LOG_TEXT);
+    commit_transaction (3);
+    xaccLogSetFormat (XACC_LOG_BINARY);
+    commit_transaction (4);
+    xaccCloseLog ();
+
+    auto paths = journal_paths ();
+    ASSERT_EQ (paths.size (), 3u);
+    int binary = 0, read = 0;
+    for (const auto& path : paths)
+    {
+        auto file = g_fopen (path.c_str (), "rb");
+        ASSERT_NE (file, nullptr);
+        if (auto reader = xaccLogReaderNew (file))
+        {
+            TransLogRecord record;
+            while (xaccLogReaderNext (reader, &record))
+                ++read;
+            EXPECT_FALSE (xaccLogReaderFailed (reader));
+            xaccLogReaderDestroy (reader);
+            ++binary;
+        }
+        fclose (file);
+    }
+    EXPECT_EQ (binary, 2);
+    EXPECT_EQ (read, 6);
+}
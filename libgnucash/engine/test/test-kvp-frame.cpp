@@ -181,6 +181,29 @@ TEST_F (KvpFrameTest, GetSlotPath)
     EXPECT_EQ (v1, t_root.get_slot(path3a));
 }
 
+TEST_F (KvpFrameTest, GetSlotRange)
+{
+    Path path1 {"top", "first", "top", "third"};
+    EXPECT_EQ (t_int_val, t_root.get_slot(path1.begin(), path1.begin() + 2));
+    EXPECT_EQ (t_str_val, t_root.get_slot(path1.begin() + 2, path1.end()));
+    EXPECT_EQ (nullptr, t_root.get_slot(path1.begin(), path1.end()));
+    EXPECT_EQ (nullptr, t_root.get_slot(path1.begin(), path1.begin()));
+}
+
+TEST_F (KvpFrameTest, KeysSorted)
+{
+    auto f1 = t_root.get_slot({"top"})->get<KvpFrame*>();
+    f1->set({"alpha"}, new KvpValue{INT64_C(1)});
+    f1->set({"zulu"}, new KvpValue{INT64_C(2)});
+    f1->set({"fourth"}, new KvpValue{INT64_C(3)});
+    auto keys = f1->get_keys();
+    EXPECT_TRUE (std::is_sorted (keys.begin(), keys.end()));
+    EXPECT_EQ (keys.size(), 6ul);
+    delete f1->set({"fourth"}, nullptr);
+    EXPECT_EQ (nullptr, f1->get_slot({"fourth"}));
+    EXPECT_EQ (f1->get_keys().size(), 5ul);
+}
+
 TEST_F (KvpFrameTest, Empty)
 {
     KvpFrameImpl f1, f2;
@@ -77,8 +77,85 @@ test_qof_string_cache( void )
     g_assert(str1_1 != str1_4);
 }
 
+static void
+test_qof_string_cache_stats( void )
+{
+    QofStringCacheStats before, after;
+    const gchar* str1;
+
+    qof_string_cache_get_stats(&before);
+    str1 = qof_string_cache_insert("stats string");
+    qof_string_cache_insert("stats string");
+    qof_string_cache_get_stats(&after);
+    g_assert_cmpuint(after.misses, ==, before.misses + 1);
+    g_assert_cmpuint(after.hits, ==, before.hits + 1);
+    g_assert_cmpuint(after.strings, ==, before.strings + 1);
+    g_assert_cmpuint(after.bytes, >, before.bytes + strlen(str1));
+
+    qof_string_cache_remove(str1);
+    qof_string_cache_remove(str1);
+    qof_string_cache_get_stats(&after);
+    g_assert_cmpuint(after.strings, ==, before.strings);
+    g_assert_cmpuint(after.bytes, ==, before.bytes);
+}
+
+#define N_THREADS 4
+#define THREAD_STRINGS 500
+#define THREAD_INSERTS 20000
+
+static gpointer
+insert_strings (gpointer data)
+{
+    const gchar** cached = data;
+    gchar str[32];
+
+    for (int i = 0; i < THREAD_INSERTS; i++)
+    {
+        g_snprintf(str, sizeof(str), "thread string %d", i % THREAD_STRINGS);
+        cached[i] = qof_string_cache_insert(str);
+    }
+    return NULL;
+}
+
+static void
+test_qof_string_cache_threads( void )
+{
+    /* Threads inserting the same strings get the same addresses. */
+    const gchar** cached[N_THREADS];
+    GThread* threads[N_THREADS];
+    QofStringCacheStats before, after;
+
+    qof_string_cache_get_stats(&before);
+    for (int t = 0; t < N_THREADS; t++)
+    {
+        cached[t] = g_new(const gchar*, THREAD_INSERTS);
+        threads[t] = g_thread_new("string-cache", insert_strings, cached[t]);
+    }
+    for (int t = 0; t < N_THREADS; t++)
+        g_thread_join(threads[t]);
+
+    for (int t = 1; t < N_THREADS; t++)
+        for (int i = 0; i < THREAD_INSERTS; i++)
+            g_assert(cached[t][i] == cached[0][i]);
+
+    qof_string_cache_get_stats(&after);
+    g_assert_cmpuint(after.strings, ==, before.strings + THREAD_STRINGS);
+    g_assert_cmpuint(after.misses, ==, before.misses + THREAD_STRINGS);
+
+    for (int t = 0; t < N_THREADS; t++)
+    {
+        for (int i = 0; i < THREAD_INSERTS; i++)
+            qof_string_cache_remove(cached[t][i]);
+        g_free(cached[t]);
+    }
+    qof_string_cache_get_stats(&after);
+    g_assert_cmpuint(after.strings, ==, before.strings);
+}
+
 void
 test_suite_qof_string_cache ( void )
 {
     GNC_TEST_ADD_FUNC( suitename, "string-cache", test_qof_string_cache);
+    GNC_TEST_ADD_FUNC( suitename, "string-cache-stats", test_qof_string_cache_stats);
+    GNC_TEST_ADD_FUNC( suitename, "string-cache-threads", test_qof_string_cache_threads);
 }
@@ -28,6 +28,7 @@
 #include "../qof.h"
 #include "../gnc-features.h"
 #include "../qofbook-p.h"
+#include "../qofinstance-p.h"
 #include "../qofbookslots.h"
 /* For gnc_account_create_root() */
 #include "../Account.h"
@@ -681,6 +682,26 @@ test_book_get_session_dirty_time( Fixture *fixture, gconstpointer pData )
 
 }
 
+static void
+test_book_get_mutation_count( Fixture *fixture, gconstpointer pData )
+{
+    QofInstance *inst = QOF_INSTANCE( fixture->book );
+
+    g_test_message( "Testing count on new book = 0" );
+    g_assert_cmpuint( qof_book_get_mutation_count( fixture->book ), == , 0 );
+
+    g_test_message( "Testing commit of a dirty instance bumps count" );
+    qof_begin_edit( inst );
+    qof_instance_set_dirty( inst );
+    qof_commit_edit( inst );
+    qof_commit_edit_part2( inst, NULL, NULL, NULL );
+    g_assert_cmpuint( qof_book_get_mutation_count( fixture->book ), == , 1 );
+
+    g_test_message( "Testing saving the book doesn't reset count" );
+    qof_book_mark_session_saved( fixture->book );
+    g_assert_cmpuint( qof_book_get_mutation_count( fixture->book ), == , 1 );
+}
+
 static void
 test_book_set_dirty_cb( Fixture *fixture, gconstpointer pData )
 {
@@ -969,6 +990,7 @@ test_suite_qofbook ( void )
     GNC_TEST_ADD( suitename, "use split action for num field", Fixture, NULL, setup, test_book_use_split_action_for_num_field, teardown );
     GNC_TEST_ADD( suitename, "mark session dirty", Fixture, NULL, setup, test_book_mark_session_dirty, teardown );
     GNC_TEST_ADD( suitename, "session dirty time", Fixture, NULL, setup, test_book_get_session_dirty_time, teardown );
+    GNC_TEST_ADD( suitename, "mutation count", Fixture, NULL, setup, test_book_get_mutation_count, teardown );
     GNC_TEST_ADD( suitename, "set dirty callback", Fixture, NULL, setup, test_book_set_dirty_cb, teardown );
     GNC_TEST_ADD( suitename, "shutting down", Fixture, NULL, setup, test_book_shutting_down, teardown );
     GNC_TEST_ADD( suitename, "set get data", Fixture, NULL, setup, test_book_set_get_data, teardown );
@@ -65,6 +65,61 @@ test_trans_query (Transaction *trans, gpointer data)
     return 0;
 }
 
+/* The splits qof_query_run returns must be exactly those for which
+ * qof_query_match_object is true, in qof_query_sort_compare order. */
+static void
+test_match_object (QofBook *book)
+{
+    Account *root = gnc_book_get_root_account (book);
+    GList *accounts = gnc_account_get_descendants (root);
+    QofQuery *q;
+    GList *results, *node;
+    GHashTable *in_results;
+    int matched = 0;
+
+    if (!accounts)
+        return;
+
+    q = qof_query_create_for (GNC_ID_SPLIT);
+    qof_query_set_book (q, book);
+    xaccQueryAddSingleAccountMatch (q, GNC_ACCOUNT (accounts->data),
+                                    QOF_QUERY_AND);
+    qof_query_set_sort_order (q, qof_query_build_param_list (QUERY_DEFAULT_SORT,
+                                                             NULL),
+                              NULL, NULL);
+
+    results = qof_query_run (q);
+    in_results = g_hash_table_new (g_direct_hash, g_direct_equal);
+    for (node = results; node; node = node->next)
+    {
+        g_hash_table_add (in_results, node->data);
+        if (!qof_query_match_object (q, node->data))
+            failure ("query result doesn't match the query");
+        if (node->next &&
+            qof_query_sort_compare (q, node->data, node->next->data) > 0)
+            failure ("query results aren't in sort order");
+    }
+
+    for (node = accounts; node; node = node->next)
+        for (GList *lp = xaccAccountGetSplitList (GNC_ACCOUNT (node->data));
+             lp; lp = lp->next)
+        {
+            gboolean match = qof_query_match_object (q, lp->data);
+            if (match != g_hash_table_contains (in_results, lp->data))
+                failure ("qof_query_match_object disagrees with qof_query_run");
+            matched += match;
+        }
+
+    if (matched == (int)g_list_length (results))
+        success ("qof_query_match_object agrees with qof_query_run");
+    else
+        failure ("qof_query_match_object found a different number of splits");
+
+    g_hash_table_destroy (in_results);
+    qof_query_destroy (q);
+    g_list_free (accounts);
+}
+
 static void
 run_test (void)
 {
@@ -79,6 +134,7 @@ run_test (void)
     add_random_transactions_to_book (book, 20);
 
     xaccAccountTreeForEachTransaction (root, test_trans_query, book);
+    test_match_object (book);
 
     qof_session_end (session);
 }
@@ -398,6 +398,100 @@ static void test_some()
     test_specific(PERIOD_DAY, 7,    4, 1, 2000,    4, 8, 2000,  4, 15, 2000);
 }
 
+#define NUM_STEPS_TO_TEST 100
+
+/* recurrenceNthInstance and recurrenceCountInstances compute directly
+   what stepping with recurrenceNextInstance gives. */
+static void test_direct()
+{
+    Recurrence r;
+    GDate d_start, d_ref, d_step, d_next, d_nth, d_end;
+    PeriodType pt;
+    WeekendAdjust wadj;
+    guint16 mult;
+    gint32 j1;
+    guint n;
+
+    for (pt = PERIOD_ONCE; pt < NUM_PERIOD_TYPES; pt++)
+    {
+        for (wadj = WEEKEND_ADJ_NONE; wadj < NUM_WEEKEND_ADJS; wadj++)
+        {
+            for (j1 = JULIAN_START; j1 < JULIAN_START + NUM_DATES_TO_TEST; j1++)
+            {
+                g_date_set_julian(&d_start, j1);
+                mult = get_random_int_in_range(1, NUM_MULT_TO_TEST);
+                recurrenceSet(&r, mult, pt, &d_start, wadj);
+
+                /* Stepping from the start date. */
+                d_step = d_start = recurrenceGetDate(&r);
+                for (n = 0; n < NUM_STEPS_TO_TEST; n++)
+                {
+                    recurrenceNthInstance(&r, n, &d_nth);
+                    if (!do_test(g_date_valid(&d_nth) == g_date_valid(&d_step),
+                                 "nth instance validity") ||
+                        !g_date_valid(&d_step) ||
+                        !test_equal(&d_nth, &d_step))
+                        break;
+                    d_next = d_step;
+                    recurrenceNextInstance(&r, &d_next, &d_step);
+                }
+
+                /* Stepping from some other date. */
+                g_date_set_julian(&d_ref, get_random_int_in_range(j1 - 400, j1 + 4000));
+                d_step = d_ref;
+                for (n = 1; n <= NUM_STEPS_TO_TEST; n++)
+                {
+                    d_next = d_step;
+                    recurrenceNextInstance(&r, &d_next, &d_step);
+                    if (!g_date_valid(&d_step))
+                        break;
+
+                    if (!do_test(recurrenceCountInstances(&r, &d_ref, &d_step) == n,
+                                 "count up to an instance"))
+                        break;
+                    d_end = d_step;
+                    g_date_subtract_days(&d_end, 1);
+                    if (!do_test(recurrenceCountInstances(&r, &d_ref, &d_end) == n - 1,
+                                 "count up to the day before an instance"))
+                        break;
+                }
+            }
+        }
+    }
+}
+
+/* Time counting a daily recurrence's instances over a long range, as
+   projecting an SX's cash flow does, by stepping and directly. */
+static void test_count_time()
+{
+    Recurrence r;
+    GDate start, ref, end, next;
+    gint64 t0, t1, t2;
+    guint stepped = 0, counted;
+
+    g_date_set_dmy(&start, 1, 1, 2000);
+    g_date_set_dmy(&end, 31, 12, 2099);
+    recurrenceSet(&r, 1, PERIOD_DAY, &start, WEEKEND_ADJ_NONE);
+
+    t0 = g_get_monotonic_time();
+    ref = start;
+    for (;;)
+    {
+        recurrenceNextInstance(&r, &ref, &next);
+        if (g_date_compare(&next, &end) > 0)
+            break;
+        ref = next;
+        stepped++;
+    }
+    t1 = g_get_monotonic_time();
+    counted = recurrenceCountInstances(&r, &start, &end);
+    t2 = g_get_monotonic_time();
+
+    do_test(counted == stepped, "counted as many instances as stepped");
+    printf("%u daily instances: %" G_GINT64_FORMAT " us stepping, %"
+           G_GINT64_FORMAT " us counting\n", stepped, t1 - t0, t2 - t1);
+}
+
 static void test_use()
 {
     Recurrence *r;
@@ -418,6 +512,10 @@ static void test_main()
 
     test_all();
 
+    test_direct();
+
+    test_count_time();
+
     qof_book_destroy (book);
 }
 
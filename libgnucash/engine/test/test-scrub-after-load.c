@@ -0,0 +1,252 @@
+/********************************************************************\
+ * test-scrub-after-load.c -- the after-load scrub repairs a book   *
+ * as the separate scrubs it replaces do                            *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+ *                                                                  *
+\********************************************************************/
+
+#include <config.h>
+
+#include <glib.h>
+#include <stdlib.h>
+
+#include "cashobjects.h"
+#include "Account.h"
+#include "Scrub.h"
+#include "SplitP.h"
+#include "TransLog.h"
+#include "Transaction.h"
+#include "TransactionP.h"
+#include "gnc-commodity.h"
+#include "test-stuff.h"
+
+static Account *
+make_account (QofBook *book, gnc_commodity *commodity, const char *name)
+{
+    Account *acc = xaccMallocAccount (book);
+
+    xaccAccountBeginEdit (acc);
+    xaccAccountSetName (acc, name);
+    xaccAccountSetType (acc, ACCT_TYPE_BANK);
+    if (commodity)
+        xaccAccountSetCommodity (acc, commodity);
+    gnc_account_append_child (gnc_book_get_root_account (book), acc);
+    xaccAccountCommitEdit (acc);
+    return acc;
+}
+
+static Split *
+add_split (QofBook *book, Transaction *trans, Account *acc, gint64 amount,
+           gint64 value)
+{
+    Split *split = xaccMallocSplit (book);
+
+    xaccSplitSetParent (split, trans);
+    if (acc)
+        xaccSplitSetAccount (split, acc);
+    xaccSplitSetValue (split, gnc_numeric_create (value, 100));
+    xaccSplitSetAmount (split, gnc_numeric_create (amount, 100));
+    return split;
+}
+
+static Transaction *
+begin_transaction (QofBook *book, GPtrArray *transactions,
+                   gnc_commodity *currency, const char *description)
+{
+    Transaction *trans = xaccMallocTransaction (book);
+
+    xaccTransBeginEdit (trans);
+    if (currency)
+        xaccTransSetCurrency (trans, currency);
+    xaccTransSetDescription (trans, description);
+    xaccTransSetDatePostedSecsNormalized (trans, 1000000000 +
+                                          transactions->len * 86400);
+    g_ptr_array_add (transactions, trans);
+    return trans;
+}
+
+/* The kinds of damage the scrubs repair, among them a transaction with
+ * no currency that has a split in an account without a commodity, which
+ * the currency scrub sees before the account is repaired. */
+static GPtrArray *
+make_damaged_book (QofBook *book)
+{
+    gnc_commodity_table *table = gnc_commodity_table_get_table (book);
+    gnc_commodity *usd = gnc_commodity_new (book, "US Dollar", "CURRENCY",
+                                            "USD", "840", 100);
+    gnc_commodity *eur = gnc_commodity_new (book, "Euro", "CURRENCY",
+                                            "EUR", "978", 100);
+    GPtrArray *transactions = g_ptr_array_new ();
+    Account *checking, *savings, *legacy, *euro;
+    Transaction *trans;
+    Split *split;
+
+    usd = gnc_commodity_table_insert (table, usd);
+    eur = gnc_commodity_table_insert (table, eur);
+    checking = make_account (book, usd, "Checking");
+    savings = make_account (book, usd, "Savings");
+    euro = make_account (book, eur, "Euro");
+    /* As in files older than 1.8: only the old currency. */
+    legacy = make_account (book, NULL, "Legacy");
+    DxaccAccountSetCurrency (legacy, usd);
+
+    xaccDisableDataScrubbing ();
+
+    trans = begin_transaction (book, transactions, usd, "Clean");
+    add_split (book, trans, checking, -100, -100);
+    add_split (book, trans, savings, 100, 100);
+    xaccTransCommitEdit (trans);
+
+    trans = begin_transaction (book, transactions, NULL, "No currency");
+    add_split (book, trans, checking, -200, -200);
+    add_split (book, trans, savings, 200, 200);
+    xaccTransCommitEdit (trans);
+
+    trans = begin_transaction (book, transactions, usd, "Amount isn't value");
+    add_split (book, trans, checking, -250, -300);
+    add_split (book, trans, savings, 300, 300);
+    xaccTransCommitEdit (trans);
+
+    trans = begin_transaction (book, transactions, NULL, "Legacy account");
+    add_split (book, trans, legacy, -350, -400);
+    add_split (book, trans, checking, 400, 400);
+    xaccTransCommitEdit (trans);
+
+    trans = begin_transaction (book, transactions, eur, "Foreign");
+    add_split (book, trans, euro, -500, -500);
+    add_split (book, trans, checking, 550, 500);
+    xaccTransCommitEdit (trans);
+
+    trans = begin_transaction (book, transactions, usd, "Bad value");
+    split = add_split (book, trans, checking, -600, -600);
+    split->value = gnc_numeric_error (GNC_ERROR_OVERFLOW);
+    add_split (book, trans, savings, 600, 600);
+    xaccTransCommitEdit (trans);
+
+    trans = begin_transaction (book, transactions, usd, "Orphan");
+    add_split (book, trans, NULL, -700, -700);
+    add_split (book, trans, savings, 700, 700);
+    xaccTransCommitEdit (trans);
+
+    xaccEnableDataScrubbing ();
+    return transactions;
+}
+
+static void
+compare_accounts (Account *root_a, Account *root_b)
+{
+    GList *accounts_a = gnc_account_get_descendants_sorted (root_a);
+    GList *accounts_b = gnc_account_get_descendants_sorted (root_b);
+    GList *node_a, *node_b;
+
+    do_test (g_list_length (accounts_a) == g_list_length (accounts_b),
+             "same number of accounts");
+    for (node_a = accounts_a, node_b = accounts_b; node_a && node_b;
+         node_a = node_a->next, node_b = node_b->next)
+    {
+        Account *acc_a = node_a->data, *acc_b = node_b->data;
+        const char *name = xaccAccountGetName (acc_a);
+
+        do_test_args (g_strcmp0 (name, xaccAccountGetName (acc_b)) == 0,
+                      "same account", __FILE__, __LINE__, "%s", name);
+        do_test_args (g_strcmp0 (gnc_commodity_get_mnemonic (xaccAccountGetCommodity (acc_a)),
+                                 gnc_commodity_get_mnemonic (xaccAccountGetCommodity (acc_b))) == 0,
+                      "same account commodity", __FILE__, __LINE__, "%s", name);
+    }
+    g_list_free (accounts_a);
+    g_list_free (accounts_b);
+}
+
+static void
+compare_transactions (Transaction *trans_a, Transaction *trans_b)
+{
+    const char *description = xaccTransGetDescription (trans_a);
+    int n_splits = xaccTransCountSplits (trans_a);
+
+    do_test_args (g_strcmp0 (gnc_commodity_get_mnemonic (xaccTransGetCurrency (trans_a)),
+                             gnc_commodity_get_mnemonic (xaccTransGetCurrency (trans_b))) == 0,
+                  "same currency", __FILE__, __LINE__, "%s", description);
+    do_test_args (n_splits == xaccTransCountSplits (trans_b), "same splits",
+                  __FILE__, __LINE__, "%s", description);
+    for (int i = 0; i < n_splits; i++)
+    {
+        Split *split_a = xaccTransGetSplit (trans_a, i);
+        Split *split_b = xaccTransGetSplit (trans_b, i);
+
+        do_test_args (split_b &&
+                      g_strcmp0 (xaccAccountGetName (xaccSplitGetAccount (split_a)),
+                                 xaccAccountGetName (xaccSplitGetAccount (split_b))) == 0 &&
+                      gnc_numeric_equal (xaccSplitGetAmount (split_a),
+                                         xaccSplitGetAmount (split_b)) &&
+                      gnc_numeric_equal (xaccSplitGetValue (split_a),
+                                         xaccSplitGetValue (split_b)),
+                      "same split", __FILE__, __LINE__, "%s split %d",
+                      description, i);
+    }
+}
+
+static void
+test_scrub_after_load (void)
+{
+    QofBook *book_a = qof_book_new ();
+    QofBook *book_b = qof_book_new ();
+    GPtrArray *transactions_a = make_damaged_book (book_a);
+    GPtrArray *transactions_b = make_damaged_book (book_b);
+    Account *root_a = gnc_book_get_root_account (book_a);
+    Account *root_b = gnc_book_get_root_account (book_b);
+
+    /* What loading an XML file used to do. */
+    xaccAccountTreeScrubQuoteSources (root_a,
+                                      gnc_commodity_table_get_table (book_a));
+    xaccAccountTreeScrubCommodities (root_a);
+    xaccAccountTreeScrubSplits (root_a);
+
+    xaccAccountTreeScrubAfterLoad (root_b,
+                                   gnc_commodity_table_get_table (book_b));
+
+    do_test (xaccAccountGetCommodity (gnc_account_lookup_by_name (root_b,
+                                                                  "Legacy")) &&
+             xaccTransGetCurrency (g_ptr_array_index (transactions_b, 1)),
+             "book repaired");
+    compare_accounts (root_a, root_b);
+    do_test (transactions_a->len == transactions_b->len,
+             "same number of transactions");
+    for (guint i = 0; i < transactions_a->len; i++)
+        compare_transactions (g_ptr_array_index (transactions_a, i),
+                              g_ptr_array_index (transactions_b, i));
+
+    g_ptr_array_free (transactions_a, TRUE);
+    g_ptr_array_free (transactions_b, TRUE);
+    qof_book_destroy (book_a);
+    qof_book_destroy (book_b);
+}
+
+int
+main (int argc, char **argv)
+{
+    qof_init ();
+    if (cashobjects_register ())
+    {
+        xaccLogDisable ();
+        test_scrub_after_load ();
+        print_test_results ();
+    }
+    qof_close ();
+    return get_rv ();
+}
@@ -0,0 +1,172 @@
+/********************************************************************\
+ * test-scrub-book.c -- check and repair a book on several threads  *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+ *                                                                  *
+\********************************************************************/
+
+#include <config.h>
+
+#include <glib.h>
+#include <stdlib.h>
+
+#include "cashobjects.h"
+#include "Account.h"
+#include "Scrub.h"
+#include "ScrubBook.h"
+#include "TransLog.h"
+#include "Transaction.h"
+#include "TransactionP.h"
+#include "gnc-commodity.h"
+#include "test-stuff.h"
+
+#define NUM_TRANSACTIONS 500
+#define BROKEN_EVERY 25
+
+static Account *
+make_account (QofBook *book, Account *parent, gnc_commodity *currency,
+              const char *name)
+{
+    Account *acc = xaccMallocAccount (book);
+
+    xaccAccountBeginEdit (acc);
+    xaccAccountSetName (acc, name);
+    xaccAccountSetType (acc, ACCT_TYPE_BANK);
+    xaccAccountSetCommodity (acc, currency);
+    gnc_account_append_child (parent, acc);
+    xaccAccountCommitEdit (acc);
+    return acc;
+}
+
+static void
+add_split (QofBook *book, Transaction *trans, Account *acc, gint64 cents)
+{
+    Split *split = xaccMallocSplit (book);
+    gnc_numeric value = gnc_numeric_create (cents, 100);
+
+    xaccSplitSetParent (split, trans);
+    xaccSplitSetAccount (split, acc);
+    xaccSplitSetValue (split, value);
+    xaccSplitSetAmount (split, value);
+}
+
+/* Every BROKEN_EVERY'th transaction is left unbalanced. */
+static GPtrArray *
+make_book (QofBook *book, gnc_commodity *currency)
+{
+    Account *root = gnc_book_get_root_account (book);
+    GPtrArray *accounts = g_ptr_array_new ();
+    GPtrArray *transactions = g_ptr_array_new ();
+
+    for (int i = 0; i < 3; i++)
+    {
+        char *name = g_strdup_printf ("Top %d", i);
+        Account *top = make_account (book, root, currency, name);
+        g_free (name);
+        g_ptr_array_add (accounts, top);
+        for (int j = 0; j < 3; j++)
+        {
+            name = g_strdup_printf ("Child %d-%d", i, j);
+            g_ptr_array_add (accounts,
+                             make_account (book, top, currency, name));
+            g_free (name);
+        }
+    }
+
+    xaccDisableDataScrubbing ();
+    for (int i = 0; i < NUM_TRANSACTIONS; i++)
+    {
+        Transaction *trans = xaccMallocTransaction (book);
+        Account *from = g_ptr_array_index (accounts, i % accounts->len);
+        Account *to = g_ptr_array_index (accounts, (i * 7 + 3) % accounts->len);
+        gint64 cents = 100 + i;
+
+        xaccTransBeginEdit (trans);
+        xaccTransSetCurrency (trans, currency);
+        xaccTransSetDatePostedSecsNormalized (trans, 1000000000 + i * 86400);
+        add_split (book, trans, from, -cents);
+        add_split (book, trans, to, i % BROKEN_EVERY ? cents : cents + 1);
+        xaccTransCommitEdit (trans);
+        g_ptr_array_add (transactions, trans);
+    }
+    xaccEnableDataScrubbing ();
+
+    g_ptr_array_free (accounts, TRUE);
+    return transactions;
+}
+
+static guint
+count_unbalanced (GPtrArray *transactions)
+{
+    guint count = 0;
+    for (guint i = 0; i < transactions->len; i++)
+        if (!xaccTransIsBalanced (g_ptr_array_index (transactions, i)))
+            count++;
+    return count;
+}
+
+static void
+test_scrub_book (guint n_threads)
+{
+    QofBook *book = qof_book_new ();
+    gnc_commodity_table *table = gnc_commodity_table_get_table (book);
+    gnc_commodity *currency = gnc_commodity_new (book, "US Dollar", "CURRENCY",
+                                                 "USD", "840", 100);
+    GPtrArray *transactions;
+    const guint broken = NUM_TRANSACTIONS / BROKEN_EVERY;
+    guint repaired;
+
+    currency = gnc_commodity_table_insert (table, currency);
+    transactions = make_book (book, currency);
+    do_test_args (count_unbalanced (transactions) == broken, "unbalanced book",
+                  __FILE__, __LINE__, "%u threads", n_threads);
+
+    gnc_set_abort_scrub (TRUE);
+    repaired = xaccBookScrub (book, GNC_SCRUB_ALL, n_threads, NULL);
+    gnc_set_abort_scrub (FALSE);
+    do_test_args (repaired == 0 && count_unbalanced (transactions) == broken,
+                  "aborted scrub", __FILE__, __LINE__, "%u threads", n_threads);
+
+    repaired = xaccBookScrub (book, GNC_SCRUB_ALL, n_threads, NULL);
+    do_test_args (repaired == broken, "repaired count", __FILE__, __LINE__,
+                  "%u threads, %u repaired", n_threads, repaired);
+    do_test_args (count_unbalanced (transactions) == 0, "balanced book",
+                  __FILE__, __LINE__, "%u threads", n_threads);
+
+    repaired = xaccBookScrub (book, GNC_SCRUB_ALL, n_threads, NULL);
+    do_test_args (repaired == 0, "nothing left to repair", __FILE__, __LINE__,
+                  "%u threads, %u repaired", n_threads, repaired);
+
+    g_ptr_array_free (transactions, TRUE);
+    qof_book_destroy (book);
+}
+
+int
+main (int argc, char **argv)
+{
+    qof_init ();
+    if (cashobjects_register ())
+    {
+        xaccLogDisable ();
+        test_scrub_book (1);
+        test_scrub_book (4);
+        print_test_results ();
+    }
+    qof_close ();
+    return get_rv ();
+}
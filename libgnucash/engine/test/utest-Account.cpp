@@ -34,6 +34,7 @@
 #include "../Split.h"
 #include "../Transaction.h"
 #include "../gnc-lot.h"
+#include "../gnc-pricedb.h"
 
 #if defined(__clang__) && (__clang_major__ == 5 || (__clang_major__ == 3 && __clang_minor__ < 5))
 #define USE_CLANG_FUNC_SIG 1
@@ -2271,6 +2272,110 @@ test_xaccAccountGetPresentBalance (Fixture *fixture, gconstpointer pData)
     dval = gnc_numeric_to_double (val);
     g_assert_cmpfloat (dval, == , dbal);
 }
+
+static Account*
+subtree_account (Account *parent, const char *name, gnc_commodity *comm)
+{
+    auto acct = xaccMallocAccount (gnc_account_get_book (parent));
+    xaccAccountBeginEdit (acct);
+    xaccAccountSetName (acct, name);
+    xaccAccountSetType (acct, ACCT_TYPE_ASSET);
+    xaccAccountSetCommodity (acct, comm);
+    gnc_account_append_child (parent, acct);
+    xaccAccountCommitEdit (acct);
+    return acct;
+}
+
+static void
+subtree_txn (Account *acct, Account *other, gnc_commodity *curr,
+             gint64 amount, gint64 value, char recn, gint days_ago)
+{
+    auto book = gnc_account_get_book (acct);
+    auto txn = xaccMallocTransaction (book);
+    auto split = xaccMallocSplit (book);
+    auto other_split = xaccMallocSplit (book);
+
+    xaccTransBeginEdit (txn);
+    xaccTransSetCurrency (txn, curr);
+    xaccTransSetDatePostedSecsNormalized (txn, gnc_time (NULL) - days_ago * 86400);
+    xaccSplitSetParent (split, txn);
+    xaccSplitSetAccount (split, acct);
+    xaccSplitSetAmount (split, gnc_numeric_create (amount, 100));
+    xaccSplitSetValue (split, gnc_numeric_create (value, 100));
+    xaccSplitSetReconcile (split, recn);
+    xaccSplitSetParent (other_split, txn);
+    xaccSplitSetAccount (other_split, other);
+    xaccSplitSetAmount (other_split, gnc_numeric_create (-value, 100));
+    xaccSplitSetValue (other_split, gnc_numeric_create (-value, 100));
+    xaccTransCommitEdit (txn);
+}
+
+#define assert_amount(val, amount) \
+    g_assert_true (gnc_numeric_equal ((val), gnc_numeric_create ((amount), 100)))
+
+/* The recursive balances come from sums kept for each subtree, which
+ * must follow changes to the balances and to the tree below. */
+static void
+test_xaccAccountGetBalanceInCurrency_subtree (Fixture *fixture, gconstpointer pData)
+{
+    auto root = fixture->acct;
+    auto book = gnc_account_get_book (root);
+    auto usd = gnc_commodity_new (book, "US Dollar", "CURRENCY", "USD", "", 100);
+    auto eur = gnc_commodity_new (book, "Euro", "CURRENCY", "EUR", "", 100);
+    auto price = gnc_price_create (book);
+    auto other = subtree_account (root, "other", usd);
+    auto parent = subtree_account (root, "parent", usd);
+    auto child = subtree_account (parent, "child", usd);
+    auto euro_child = subtree_account (parent, "euro", eur);
+    auto grandchild = subtree_account (child, "grandchild", usd);
+
+    gnc_price_begin_edit (price);
+    gnc_price_set_commodity (price, eur);
+    gnc_price_set_currency (price, usd);
+    gnc_price_set_time64 (price, gnc_time (NULL) - 30 * 86400);
+    gnc_price_set_value (price, gnc_numeric_create (2, 1));
+    gnc_price_commit_edit (price);
+    gnc_pricedb_add_price (gnc_pricedb_get_db (book), price);
+    gnc_price_unref (price);
+
+    subtree_txn (grandchild, other, usd, 1000, 1000, CREC, 10);
+    subtree_txn (child, other, usd, 500, 500, YREC, 10);
+    subtree_txn (euro_child, other, usd, 300, 600, NREC, 10);
+
+    assert_amount (xaccAccountGetBalanceInCurrency (parent, usd, TRUE), 2100);
+    assert_amount (xaccAccountGetClearedBalanceInCurrency (parent, usd, TRUE), 1500);
+    assert_amount (xaccAccountGetReconciledBalanceInCurrency (parent, usd, TRUE), 500);
+    assert_amount (xaccAccountGetBalanceInCurrency (parent, usd, FALSE), 0);
+    assert_amount (xaccAccountGetBalanceInCurrency (child, usd, TRUE), 1500);
+    assert_amount (xaccAccountGetBalanceInCurrency (euro_child, NULL, TRUE), 300);
+    assert_amount (xaccAccountGetPresentBalanceInCurrency (parent, usd, TRUE), 2100);
+
+    /* A new split deep in the tree reaches the parent, and one in the
+     * future only the current balance. */
+    subtree_txn (grandchild, other, usd, 100, 100, NREC, 1);
+    subtree_txn (grandchild, other, usd, 50, 50, NREC, -10);
+    assert_amount (xaccAccountGetBalanceInCurrency (parent, usd, TRUE), 2250);
+    assert_amount (xaccAccountGetClearedBalanceInCurrency (parent, usd, TRUE), 1500);
+    assert_amount (xaccAccountGetPresentBalanceInCurrency (parent, usd, TRUE), 2200);
+    assert_amount (xaccAccountGetBalanceAsOfDateInCurrency (parent, gnc_time (NULL) - 5 * 86400, usd, TRUE), 2100);
+
+    /* Moving an account moves its balances. */
+    gnc_account_append_child (euro_child, grandchild);
+    assert_amount (xaccAccountGetBalanceInCurrency (parent, usd, TRUE), 2250);
+    assert_amount (xaccAccountGetBalanceInCurrency (child, usd, TRUE), 500);
+    assert_amount (xaccAccountGetBalanceInCurrency (euro_child, usd, TRUE), 1750);
+    assert_amount (xaccAccountGetPresentBalanceInCurrency (child, usd, TRUE), 500);
+
+    gnc_account_append_child (root, euro_child);
+    assert_amount (xaccAccountGetBalanceInCurrency (parent, usd, TRUE), 500);
+    assert_amount (xaccAccountGetPresentBalanceInCurrency (parent, usd, TRUE), 500);
+
+    /* So does changing an account's commodity. */
+    xaccAccountBeginEdit (child);
+    xaccAccountSetCommodity (child, eur);
+    xaccAccountCommitEdit (child);
+    assert_amount (xaccAccountGetBalanceInCurrency (parent, usd, TRUE), 1000);
+}
 /*
  * xaccAccountConvertBalanceToCurrency
  * xaccAccountConvertBalanceToCurrencyAsOfDate are wrappers around
@@ -2874,6 +2979,7 @@ test_suite_account (void)
     GNC_TEST_ADD (suitename, "xaccAccountGetProjectedMinimumBalance", Fixture, &some_data, setup, test_xaccAccountGetProjectedMinimumBalance,  teardown );
     GNC_TEST_ADD (suitename, "xaccAccountGetBalanceAsOfDate", Fixture, &some_data, setup, test_xaccAccountGetBalanceAsOfDate,  teardown );
     GNC_TEST_ADD (suitename, "xaccAccountGetPresentBalance", Fixture, &some_data, setup, test_xaccAccountGetPresentBalance,  teardown );
+    GNC_TEST_ADD (suitename, "xaccAccountGetBalanceInCurrency subtree", Fixture, NULL, setup, test_xaccAccountGetBalanceInCurrency_subtree,  teardown );
     GNC_TEST_ADD (suitename, "xaccAccountFindOpenLots", Fixture, &complex_data, setup, test_xaccAccountFindOpenLots,  teardown );
     GNC_TEST_ADD (suitename, "xaccAccountForEachLot", Fixture, &complex_data, setup, test_xaccAccountForEachLot,  teardown );
 